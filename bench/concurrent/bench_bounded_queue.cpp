@@ -0,0 +1,137 @@
+#include "babylon/concurrent/bounded_queue.h"
+#include "babylon/concurrent/ring_queue.h"
+
+#include "benchmark/benchmark.h"
+
+using ::babylon::ConcurrentBoundedQueue;
+using ::babylon::ConcurrentMpscQueue;
+using ::babylon::ConcurrentSpscQueue;
+
+namespace {
+
+// Even threads push and odd threads pop. Every thread run the same number of
+// iterations, so total pushed always match total popped and no one is left
+// blocking at the end. Items processed count pushed elements only.
+template <typename Q, bool PUSH_CONCURRENT, bool POP_CONCURRENT, bool USE_FUTEX>
+void run_push_pop(::benchmark::State& state) {
+  static Q queue;
+  using Iterator = typename Q::Iterator;
+  size_t batch = state.range(0);
+  if (state.thread_index() == 0) {
+    queue.reserve_and_clear(1024);
+  }
+  if (state.thread_index() % 2 == 0) {
+    for (auto _ : state) {
+      queue.template push_n<PUSH_CONCURRENT, USE_FUTEX, USE_FUTEX>(
+          [&](Iterator iter, Iterator end) {
+            while (iter != end) {
+              *iter++ = batch;
+            }
+          },
+          batch);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+  } else {
+    for (auto _ : state) {
+      queue.template pop_n<POP_CONCURRENT, USE_FUTEX, USE_FUTEX>(
+          [&](Iterator iter, Iterator end) {
+            while (iter != end) {
+              ::benchmark::DoNotOptimize(*iter++);
+            }
+          },
+          batch);
+    }
+  }
+}
+
+template <bool USE_FUTEX>
+void BM_bounded_queue_spsc(::benchmark::State& state) {
+  run_push_pop<ConcurrentBoundedQueue<size_t>, false, false, USE_FUTEX>(state);
+}
+
+template <bool USE_FUTEX>
+void BM_bounded_queue_mpmc(::benchmark::State& state) {
+  run_push_pop<ConcurrentBoundedQueue<size_t>, true, true, USE_FUTEX>(state);
+}
+
+template <bool USE_FUTEX>
+void BM_spsc_queue(::benchmark::State& state) {
+  run_push_pop<ConcurrentSpscQueue<size_t>, false, false, USE_FUTEX>(state);
+}
+
+// Thread 1 is the only consumer, all other threads push
+template <bool USE_FUTEX>
+void BM_mpsc_queue(::benchmark::State& state) {
+  static ConcurrentMpscQueue<size_t> queue;
+  using Iterator = ConcurrentMpscQueue<size_t>::Iterator;
+  size_t batch = state.range(0);
+  size_t producer_num = state.threads() - 1;
+  if (state.thread_index() == 0) {
+    queue.reserve_and_clear(1024);
+  }
+  if (state.thread_index() != 1) {
+    for (auto _ : state) {
+      queue.template push_n<true, USE_FUTEX, USE_FUTEX>(
+          [&](Iterator iter, Iterator end) {
+            while (iter != end) {
+              *iter++ = batch;
+            }
+          },
+          batch);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+  } else {
+    for (auto _ : state) {
+      queue.template pop_n<false, USE_FUTEX, USE_FUTEX>(
+          [&](Iterator iter, Iterator end) {
+            while (iter != end) {
+              ::benchmark::DoNotOptimize(*iter++);
+            }
+          },
+          batch * producer_num);
+    }
+  }
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_bounded_queue_spsc, true)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Threads(2)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_bounded_queue_spsc, false)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Threads(2)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_spsc_queue, true)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Threads(2)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_spsc_queue, false)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Threads(2)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_bounded_queue_mpmc, true)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_bounded_queue_mpmc, false)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_mpsc_queue, true)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_mpsc_queue, false)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
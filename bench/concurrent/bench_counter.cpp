@@ -0,0 +1,66 @@
+#include "babylon/concurrent/counter.h"
+
+#include "benchmark/benchmark.h"
+
+using ::babylon::ConcurrentAdder;
+using ::babylon::ConcurrentSummer;
+
+namespace {
+
+void BM_concurrent_adder(::benchmark::State& state) {
+  static ConcurrentAdder adder;
+  for (auto _ : state) {
+    adder << 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_atomic_adder(::benchmark::State& state) {
+  static ::std::atomic<ssize_t> adder {0};
+  for (auto _ : state) {
+    adder.fetch_add(1, ::std::memory_order_relaxed);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_concurrent_summer(::benchmark::State& state) {
+  static ConcurrentSummer summer;
+  ssize_t value = 0;
+  for (auto _ : state) {
+    summer << value++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Sum and num share one cacheline, the same as a naive implementation
+void BM_atomic_summer(::benchmark::State& state) {
+  static ::std::atomic<ssize_t> sum {0};
+  static ::std::atomic<size_t> num {0};
+  ssize_t value = 0;
+  for (auto _ : state) {
+    sum.fetch_add(value++, ::std::memory_order_relaxed);
+    num.fetch_add(1, ::std::memory_order_relaxed);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Read side cost, which need to walk all thread local instances
+void BM_concurrent_adder_value(::benchmark::State& state) {
+  static ConcurrentAdder adder;
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      ::benchmark::DoNotOptimize(adder.value());
+    } else {
+      adder << 1;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_concurrent_adder)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_atomic_adder)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_concurrent_summer)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_atomic_summer)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_concurrent_adder_value)->ThreadRange(2, 16)->UseRealTime();
@@ -0,0 +1,60 @@
+#include "babylon/concurrent/thread_local.h"
+
+#include "benchmark/benchmark.h"
+
+using ::babylon::CompactEnumerableThreadLocal;
+using ::babylon::EnumerableThreadLocal;
+
+namespace {
+
+void BM_enumerable_thread_local(::benchmark::State& state) {
+  static EnumerableThreadLocal<size_t> storage;
+  for (auto _ : state) {
+    ++storage.local();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_compact_enumerable_thread_local(::benchmark::State& state) {
+  static CompactEnumerableThreadLocal<size_t> storage;
+  for (auto _ : state) {
+    ++storage.local();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Baseline of compiler supported thread local
+void BM_thread_local(::benchmark::State& state) {
+  static thread_local size_t storage = 0;
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(++storage);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Cost of aggregating all instances
+void BM_enumerable_thread_local_for_each(::benchmark::State& state) {
+  static EnumerableThreadLocal<size_t> storage;
+  ++storage.local();
+  for (auto _ : state) {
+    size_t sum = 0;
+    storage.for_each([&](size_t* iter, size_t* end) {
+      while (iter != end) {
+        sum += *iter++;
+      }
+    });
+    ::benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_enumerable_thread_local)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_compact_enumerable_thread_local)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK(BM_thread_local)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_enumerable_thread_local_for_each)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
@@ -0,0 +1,127 @@
+#include "babylon/concurrent/transient_hash_table.h"
+
+// clang-format off
+#include BABYLON_EXTERNAL(absl/container/flat_hash_map.h)
+// clang-format on
+
+#include "benchmark/benchmark.h"
+
+#if BABYLON_BENCH_WITH_TBB
+#include "tbb/concurrent_hash_map.h"
+#endif // BABYLON_BENCH_WITH_TBB
+
+#include <mutex>        // std::unique_lock
+#include <random>       // std::mt19937_64
+#include <shared_mutex> // std::shared_mutex
+
+using ::babylon::ConcurrentTransientHashMap;
+
+namespace {
+
+constexpr size_t KEY_NUM = 1 << 16;
+
+// Key sequence of each thread is pre-generated, keep rng out of measurement
+::std::vector<uint64_t> random_keys(size_t seed) {
+  ::std::mt19937_64 gen(seed);
+  ::std::vector<uint64_t> keys(KEY_NUM);
+  for (auto& key : keys) {
+    key = gen() % KEY_NUM;
+  }
+  return keys;
+}
+
+struct BabylonMap {
+  void reset() {
+    map.clear();
+    map.reserve(KEY_NUM);
+  }
+  bool find(uint64_t key) {
+    return map.find(key) != map.end();
+  }
+  void emplace(uint64_t key) {
+    map.emplace(key, key);
+  }
+  ConcurrentTransientHashMap<uint64_t, uint64_t> map;
+};
+
+struct AbslMap {
+  void reset() {
+    ::std::unique_lock<::std::shared_mutex> lock {mutex};
+    map.clear();
+    map.reserve(KEY_NUM);
+  }
+  bool find(uint64_t key) {
+    ::std::shared_lock<::std::shared_mutex> lock {mutex};
+    return map.find(key) != map.end();
+  }
+  void emplace(uint64_t key) {
+    ::std::unique_lock<::std::shared_mutex> lock {mutex};
+    map.emplace(key, key);
+  }
+  ::std::shared_mutex mutex;
+  ::absl::flat_hash_map<uint64_t, uint64_t> map;
+};
+
+#if BABYLON_BENCH_WITH_TBB
+struct TbbMap {
+  void reset() {
+    map.clear();
+    map.rehash(KEY_NUM);
+  }
+  bool find(uint64_t key) {
+    typename Map::const_accessor accessor;
+    return map.find(accessor, key);
+  }
+  void emplace(uint64_t key) {
+    map.emplace(key, key);
+  }
+  using Map = ::tbb::concurrent_hash_map<uint64_t, uint64_t>;
+  Map map;
+};
+#endif // BABYLON_BENCH_WITH_TBB
+
+// Lookup on a fully populated map
+template <typename M>
+void BM_map_find(::benchmark::State& state) {
+  static M map;
+  if (state.thread_index() == 0) {
+    map.reset();
+    for (size_t i = 0; i < KEY_NUM; ++i) {
+      map.emplace(i);
+    }
+  }
+  auto keys = random_keys(state.thread_index());
+  size_t index = 0;
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(map.find(keys[index++ % KEY_NUM]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Insert into an empty map, most keys hit existing ones after warm up
+template <typename M>
+void BM_map_emplace(::benchmark::State& state) {
+  static M map;
+  if (state.thread_index() == 0) {
+    map.reset();
+  }
+  auto keys = random_keys(state.thread_index());
+  size_t index = 0;
+  for (auto _ : state) {
+    map.emplace(keys[index++ % KEY_NUM]);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_map_find, BabylonMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_map_find, AbslMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_map_emplace, BabylonMap)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_map_emplace, AbslMap)->ThreadRange(1, 16)->UseRealTime();
+#if BABYLON_BENCH_WITH_TBB
+BENCHMARK_TEMPLATE(BM_map_find, TbbMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_map_emplace, TbbMap)->ThreadRange(1, 16)->UseRealTime();
+#endif // BABYLON_BENCH_WITH_TBB
@@ -0,0 +1,65 @@
+#include "babylon/concurrent/vector.h"
+
+#include "benchmark/benchmark.h"
+
+using ::babylon::ConcurrentVector;
+
+namespace {
+
+// Grow from empty by ensure, each thread work on its own index sequence, so
+// growth is driven by all threads together
+void BM_concurrent_vector_ensure(::benchmark::State& state) {
+  static ConcurrentVector<size_t> vector;
+  if (state.thread_index() == 0) {
+    vector = ConcurrentVector<size_t> {static_cast<size_t>(state.range(0))};
+  }
+  size_t index = state.thread_index();
+  size_t step = state.threads();
+  for (auto _ : state) {
+    vector.ensure(index) = index;
+    index += step;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Random access on a reserved vector, compare with std::vector below
+void BM_concurrent_vector_access(::benchmark::State& state) {
+  static ConcurrentVector<size_t> vector;
+  constexpr size_t SIZE = 1 << 16;
+  if (state.thread_index() == 0) {
+    vector = ConcurrentVector<size_t> {static_cast<size_t>(state.range(0))};
+    vector.reserve(SIZE);
+  }
+  size_t index = state.thread_index() * 7919;
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(vector[index++ & (SIZE - 1)]);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_std_vector_access(::benchmark::State& state) {
+  static ::std::vector<size_t> vector;
+  constexpr size_t SIZE = 1 << 16;
+  if (state.thread_index() == 0) {
+    vector.resize(SIZE);
+  }
+  size_t index = state.thread_index() * 7919;
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(vector[index++ & (SIZE - 1)]);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_concurrent_vector_ensure)
+    ->RangeMultiplier(16)
+    ->Range(16, 4096)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK(BM_concurrent_vector_access)
+    ->RangeMultiplier(16)
+    ->Range(16, 4096)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK(BM_std_vector_access)->ThreadRange(1, 16)->UseRealTime();
@@ -12,6 +12,25 @@ int BasicExecutor::invoke(MoveOnlyFunction<void(void)>&&) noexcept {
   return -1;
 }
 
+int BasicExecutor::invoke_n(MoveOnlyFunction<void(void)>* functions,
+                            size_t num) noexcept {
+  for (size_t i = 0; i < num; ++i) {
+    auto ret = invoke(::std::move(functions[i]));
+    if (ret != 0) {
+      for (size_t j = 0; j < i; ++j) {
+        functions[j] = MoveOnlyFunction<void(void)> {};
+      }
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int BasicExecutor::invoke_with_priority(
+    MoveOnlyFunction<void(void)>&& function, TaskPriority) noexcept {
+  return invoke(::std::move(function));
+}
+
 BasicExecutor*& BasicExecutor::current() noexcept {
   static thread_local BasicExecutor* executor;
   return executor;
@@ -2,12 +2,23 @@
 
 #include "babylon/move_only_function.h" // MoveOnlyFunction
 
+#include <stdint.h> // uint8_t
+
 BABYLON_COROUTINE_NAMESPACE_BEGIN
 class BasicPromise;
 BABYLON_COROUTINE_NAMESPACE_END
 
 BABYLON_NAMESPACE_BEGIN
 
+// Priority class of a task. Executor supporting it, like ThreadPoolExecutor,
+// keep tasks of different priority in separate lanes, so background work will
+// not queue in front of latency critical ones. Others just ignore it.
+enum class TaskPriority : uint8_t {
+  CRITICAL = 0,
+  NORMAL = 1,
+  BACKGROUND = 2,
+};
+
 // Unified interface about an asynchronous execution mechanism.
 //
 // **NOT** designed to be directly used or derived by custom implementations.
@@ -40,6 +51,21 @@ class BasicExecutor {
   //        never be called inside.
   virtual int invoke(MoveOnlyFunction<void(void)>&& function) noexcept;
 
+  // Bulk version of invoke. Default implementation just invoke functions one
+  // by one and stop at first failure. Implementation can override it to
+  // transfer them all in one batch, amortizing the cost of enqueue and wakeup.
+  //
+  // return ==0: All functions are transferred and moved away.
+  //        !=0: Some transfer fail. Functions already transferred are left
+  //        empty, others are not moved away and never be called inside.
+  virtual int invoke_n(MoveOnlyFunction<void(void)>* functions,
+                       size_t num) noexcept;
+
+  // Same as invoke, but with a priority hint. Default implementation ignore
+  // the priority and just invoke.
+  virtual int invoke_with_priority(MoveOnlyFunction<void(void)>&& function,
+                                   TaskPriority priority) noexcept;
+
  private:
   static BasicExecutor*& current() noexcept;
 
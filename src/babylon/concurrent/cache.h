@@ -0,0 +1,113 @@
+#pragma once
+
+#include "babylon/concurrent/counter.h"              // ConcurrentAdder
+#include "babylon/concurrent/garbage_collector.h"    // GarbageCollector
+#include "babylon/concurrent/transient_hash_table.h" // ConcurrentFixedSwissTable
+#include "babylon/concurrent/vector.h"               // ConcurrentVector
+#include "babylon/environment.h"
+
+#include <atomic>     // std::atomic
+#include <functional> // std::hash
+#include <memory>     // std::unique_ptr
+#include <mutex>      // std::mutex
+
+BABYLON_NAMESPACE_BEGIN
+
+// Bounded concurrent key-value cache with CLOCK eviction, designed for long
+// lived lookup caches such as item features keyed by item id.
+//
+// Keys are spread over power-of-2 shards. Each shard holds:
+// 1. a ConcurrentFixedSwissTable mapping key to entry slot, looked up by
+//    SIMD group probing
+// 2. a ConcurrentVector of entry slots, each slot points to an immutable
+//    node holding key and value, plus a CLOCK referenced bit
+//
+// Read operations only enter an Epoch critical region, never take any lock,
+// and finish in bounded steps. Write operations of the same shard are
+// serialized by a shard mutex. Replaced or evicted nodes, erased table entries
+// and rebuilt tables are all retired to an internal GarbageCollector, and
+// reclaimed after concurrent readers leave. Each cache run its own background
+// gc thread, so it is not copyable nor movable.
+template <typename K, typename V, typename H = ::std::hash<K>>
+class ConcurrentCache {
+ private:
+  struct Node;
+  struct Slot;
+  struct Shard;
+  class Reclaimer;
+
+  using Table = ConcurrentFixedSwissTable<
+      ::std::pair<const K, size_t>, H,
+      internal::concurrent_transient_hash_table::PairKeyExtractor<K, size_t>>;
+
+ public:
+  ConcurrentCache() = delete;
+  ConcurrentCache(ConcurrentCache&&) = delete;
+  ConcurrentCache(const ConcurrentCache&) = delete;
+  ConcurrentCache& operator=(ConcurrentCache&&) = delete;
+  ConcurrentCache& operator=(const ConcurrentCache&) = delete;
+  ~ConcurrentCache() noexcept;
+
+  // Hold at most capacity entries in total, spread over shards. Shard number
+  // is ceiled to 2^n, and capacity is ceiled to multiple of shard number.
+  ConcurrentCache(size_t capacity, size_t min_shard_num = 16) noexcept;
+
+  inline size_t capacity() const noexcept;
+  inline size_t shard_num() const noexcept;
+  // Number of entries currently cached, O(threads)
+  inline size_t size() const noexcept;
+
+  // [Wait-free] Find key and call C(const V& value) when hit. Value is kept
+  // valid during callback, even if it is replaced or evicted concurrently.
+  // return: whether key is hit
+  template <typename C>
+  inline bool find(const K& key, C&& callback) noexcept;
+  // [Wait-free] Find key and copy value out when hit.
+  inline bool get(const K& key, V& value) noexcept;
+  // [Wait-free] Whether key is cached now. Not count in hit / miss nor mark
+  // the entry as referenced.
+  inline bool contains(const K& key) noexcept;
+
+  // Insert or replace the value of key, constructed by V(args...). Evict an
+  // entry by CLOCK when shard is full.
+  // return: true when key is newly inserted, false when replaced
+  template <typename KK, typename... Args>
+  bool put(KK&& key, Args&&... args) noexcept;
+
+  // Remove key from cache.
+  // return: whether key is removed
+  bool erase(const K& key) noexcept;
+
+  // Counters accumulated since construction, O(threads)
+  inline size_t hit_count() const noexcept;
+  inline size_t miss_count() const noexcept;
+  inline size_t eviction_count() const noexcept;
+
+ private:
+  inline Shard& shard_of(size_t hash) noexcept;
+
+  // Find an empty slot for new entry, evict one by CLOCK when all used.
+  // Shard mutex must be held.
+  size_t acquire_slot(Shard& shard) noexcept;
+  void evict(Shard& shard, size_t index) noexcept;
+  // Insert key -> index into shard table, rebuild a new table from live
+  // slots when old one is full of tombstones. Shard mutex must be held.
+  void index_slot(Shard& shard, const K& key, size_t index) noexcept;
+  void rebuild_table(Shard& shard) noexcept;
+
+  size_t _shard_mask {0};
+  size_t _shard_capacity {0};
+  size_t _table_bucket_count {0};
+  ::std::unique_ptr<Shard[]> _shards;
+
+  ConcurrentAdder _size;
+  ConcurrentAdder _hits;
+  ConcurrentAdder _misses;
+  ConcurrentAdder _evictions;
+
+  GarbageCollector<Reclaimer> _garbage_collector;
+};
+
+BABYLON_NAMESPACE_END
+
+#include "babylon/concurrent/cache.hpp"
@@ -0,0 +1,341 @@
+#pragma once
+
+#include "babylon/absl_numeric_bits.h" // absl::bit_ceil
+#include "babylon/concurrent/cache.h"
+
+#include <mutex> // std::lock_guard
+
+BABYLON_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentCache::Node begin
+// Immutable after published, replace creates a new node instead
+template <typename K, typename V, typename H>
+struct ConcurrentCache<K, V, H>::Node {
+  template <typename KK, typename... Args>
+  Node(KK&& key, Args&&... args) noexcept
+      : key(::std::forward<KK>(key)), value(::std::forward<Args>(args)...) {}
+
+  K key;
+  V value;
+};
+// ConcurrentCache::Node end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentCache::Slot begin
+template <typename K, typename V, typename H>
+struct ConcurrentCache<K, V, H>::Slot {
+  ::std::atomic<Node*> node {nullptr};
+  // Set by reader on hit, cleared by CLOCK hand to give a second chance
+  ::std::atomic<bool> referenced {false};
+};
+// ConcurrentCache::Slot end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentCache::Shard begin
+template <typename K, typename V, typename H>
+struct alignas(BABYLON_CACHELINE_SIZE) ConcurrentCache<K, V, H>::Shard {
+  ::std::atomic<Table*> table {nullptr};
+  ConcurrentVector<Slot> slots;
+
+  // Below are only accessed by writer with mutex held
+  ::std::mutex mutex;
+  // Slots [0, used) have been handed out at least once
+  size_t used {0};
+  size_t clock_hand {0};
+  // Evictions and erases since last compact of table
+  size_t erased {0};
+};
+// ConcurrentCache::Shard end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentCache::Reclaimer begin
+// Reclaim one of: an erased table entry, a replaced or evicted node, or a
+// whole table replaced by rebuild. Task not reclaimed yet when garbage
+// collector stop is drained in destructor instead of dropped, so key of an
+// erased entry is still destroyed.
+template <typename K, typename V, typename H>
+class ConcurrentCache<K, V, H>::Reclaimer {
+ public:
+  Reclaimer() noexcept = default;
+  Reclaimer(Reclaimer&& other) noexcept {
+    *this = ::std::move(other);
+  }
+  Reclaimer(const Reclaimer&) = delete;
+  Reclaimer& operator=(Reclaimer&& other) noexcept {
+    ::std::swap(_entry_reclaimer, other._entry_reclaimer);
+    ::std::swap(_node, other._node);
+    ::std::swap(_table, other._table);
+    return *this;
+  }
+  Reclaimer& operator=(const Reclaimer&) = delete;
+  ~Reclaimer() noexcept {
+    (*this)();
+    delete _node;
+    delete _table;
+  }
+
+  Reclaimer(typename Table::Reclaimer entry_reclaimer) noexcept
+      : _entry_reclaimer {entry_reclaimer} {}
+  Reclaimer(Node* node) noexcept : _node {node} {}
+  Reclaimer(Table* table) noexcept : _table {table} {}
+
+  void operator()() noexcept {
+    _entry_reclaimer();
+    _entry_reclaimer = {};
+  }
+
+ private:
+  typename Table::Reclaimer _entry_reclaimer;
+  Node* _node {nullptr};
+  Table* _table {nullptr};
+};
+// ConcurrentCache::Reclaimer end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentCache begin
+template <typename K, typename V, typename H>
+ConcurrentCache<K, V, H>::ConcurrentCache(size_t capacity,
+                                          size_t min_shard_num) noexcept {
+  auto shard_num = ::absl::bit_ceil(::std::max<size_t>(min_shard_num, 1));
+  _shard_mask = shard_num - 1;
+  _shard_capacity = ::std::max<size_t>((capacity + _shard_mask) / shard_num, 1);
+  // Keep load factor of table no more than 1/2, leave room for tombstones
+  _table_bucket_count = ::absl::bit_ceil(_shard_capacity * 2);
+  _shards.reset(new Shard[shard_num]);
+  for (size_t i = 0; i < shard_num; ++i) {
+    _shards[i].table.store(new Table {_table_bucket_count},
+                           ::std::memory_order_relaxed);
+  }
+  _garbage_collector.set_queue_capacity(1024);
+  _garbage_collector.start();
+}
+
+template <typename K, typename V, typename H>
+ConcurrentCache<K, V, H>::~ConcurrentCache() noexcept {
+  // No reader left, pending tasks are all reclaimed in retire order before
+  // gc thread exit. Live tables are only deleted after that
+  _garbage_collector.stop();
+  for (size_t i = 0; i <= _shard_mask; ++i) {
+    auto& shard = _shards[i];
+    for (size_t j = 0; j < shard.used; ++j) {
+      delete shard.slots[j].node.load(::std::memory_order_relaxed);
+    }
+    delete shard.table.load(::std::memory_order_relaxed);
+  }
+}
+
+template <typename K, typename V, typename H>
+inline size_t ConcurrentCache<K, V, H>::capacity() const noexcept {
+  return _shard_capacity * (_shard_mask + 1);
+}
+
+template <typename K, typename V, typename H>
+inline size_t ConcurrentCache<K, V, H>::shard_num() const noexcept {
+  return _shard_mask + 1;
+}
+
+template <typename K, typename V, typename H>
+inline size_t ConcurrentCache<K, V, H>::size() const noexcept {
+  return static_cast<size_t>(_size.value());
+}
+
+template <typename K, typename V, typename H>
+template <typename C>
+inline bool ConcurrentCache<K, V, H>::find(const K& key,
+                                           C&& callback) noexcept {
+  auto& shard = shard_of(H()(key));
+  ::std::lock_guard<Epoch> lock {_garbage_collector.epoch()};
+  auto table = shard.table.load(::std::memory_order_acquire);
+  auto iter = table->find(key);
+  if (iter != table->end()) {
+    auto& slot = shard.slots[iter->second];
+    auto node = slot.node.load(::std::memory_order_acquire);
+    // Slot may be evicted and reused by another key after table lookup
+    if (ABSL_PREDICT_TRUE(node != nullptr && node->key == key)) {
+      // Avoid dirty the cacheline when already referenced
+      if (!slot.referenced.load(::std::memory_order_relaxed)) {
+        slot.referenced.store(true, ::std::memory_order_relaxed);
+      }
+      _hits << 1;
+      callback(static_cast<const V&>(node->value));
+      return true;
+    }
+  }
+  _misses << 1;
+  return false;
+}
+
+template <typename K, typename V, typename H>
+inline bool ConcurrentCache<K, V, H>::get(const K& key, V& value) noexcept {
+  return find(key, [&](const V& cached_value) {
+    value = cached_value;
+  });
+}
+
+template <typename K, typename V, typename H>
+inline bool ConcurrentCache<K, V, H>::contains(const K& key) noexcept {
+  auto& shard = shard_of(H()(key));
+  ::std::lock_guard<Epoch> lock {_garbage_collector.epoch()};
+  auto table = shard.table.load(::std::memory_order_acquire);
+  auto iter = table->find(key);
+  if (iter == table->end()) {
+    return false;
+  }
+  auto node =
+      shard.slots[iter->second].node.load(::std::memory_order_acquire);
+  return node != nullptr && node->key == key;
+}
+
+template <typename K, typename V, typename H>
+template <typename KK, typename... Args>
+ABSL_ATTRIBUTE_NOINLINE bool ConcurrentCache<K, V, H>::put(
+    KK&& key, Args&&... args) noexcept {
+  auto node =
+      new Node {::std::forward<KK>(key), ::std::forward<Args>(args)...};
+  auto& shard = shard_of(H()(node->key));
+  // Only writer retire and reclaim, and all writers of a shard are serialized
+  // by mutex, so no Epoch critical region is needed here. Retire outside
+  // critical region also avoid blocking on a full gc queue forever.
+  ::std::lock_guard<::std::mutex> lock {shard.mutex};
+  auto table = shard.table.load(::std::memory_order_relaxed);
+  auto iter = table->find(node->key);
+  if (iter != table->end()) {
+    auto& slot = shard.slots[iter->second];
+    auto old_node = slot.node.exchange(node, ::std::memory_order_acq_rel);
+    slot.referenced.store(true, ::std::memory_order_relaxed);
+    _garbage_collector.retire(Reclaimer {old_node});
+    return false;
+  }
+
+  auto index = acquire_slot(shard);
+  auto& slot = shard.slots[index];
+  slot.referenced.store(false, ::std::memory_order_relaxed);
+  // Publish node before index it, so reader hit in table always see it
+  slot.node.store(node, ::std::memory_order_release);
+  index_slot(shard, node->key, index);
+  _size << 1;
+  return true;
+}
+
+template <typename K, typename V, typename H>
+ABSL_ATTRIBUTE_NOINLINE bool ConcurrentCache<K, V, H>::erase(
+    const K& key) noexcept {
+  auto& shard = shard_of(H()(key));
+  ::std::lock_guard<::std::mutex> lock {shard.mutex};
+  auto table = shard.table.load(::std::memory_order_relaxed);
+  auto iter = table->find(key);
+  if (iter == table->end()) {
+    return false;
+  }
+  auto index = iter->second;
+  table->erase(key, _garbage_collector);
+  auto node =
+      shard.slots[index].node.exchange(nullptr, ::std::memory_order_acq_rel);
+  _garbage_collector.retire(Reclaimer {node});
+  shard.erased++;
+  _size << -1;
+  return true;
+}
+
+template <typename K, typename V, typename H>
+inline size_t ConcurrentCache<K, V, H>::hit_count() const noexcept {
+  return static_cast<size_t>(_hits.value());
+}
+
+template <typename K, typename V, typename H>
+inline size_t ConcurrentCache<K, V, H>::miss_count() const noexcept {
+  return static_cast<size_t>(_misses.value());
+}
+
+template <typename K, typename V, typename H>
+inline size_t ConcurrentCache<K, V, H>::eviction_count() const noexcept {
+  return static_cast<size_t>(_evictions.value());
+}
+
+template <typename K, typename V, typename H>
+inline typename ConcurrentCache<K, V, H>::Shard&
+ConcurrentCache<K, V, H>::shard_of(size_t hash) noexcept {
+  // Table use low bits of hash, mix and take high bits for shard instead
+  auto mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15UL;
+  return _shards[(mixed >> 40) & _shard_mask];
+}
+
+template <typename K, typename V, typename H>
+ABSL_ATTRIBUTE_NOINLINE size_t
+ConcurrentCache<K, V, H>::acquire_slot(Shard& shard) noexcept {
+  if (shard.used < _shard_capacity) {
+    shard.slots.ensure(shard.used);
+    return shard.used++;
+  }
+  // CLOCK: sweep slots from hand, clear referenced bit as second chance, and
+  // take first one not referenced. Finish in at most two rounds.
+  while (true) {
+    auto index = shard.clock_hand;
+    shard.clock_hand = index + 1 < _shard_capacity ? index + 1 : 0;
+    auto& slot = shard.slots[index];
+    if (slot.node.load(::std::memory_order_relaxed) == nullptr) {
+      return index;
+    }
+    if (slot.referenced.load(::std::memory_order_relaxed)) {
+      slot.referenced.store(false, ::std::memory_order_relaxed);
+      continue;
+    }
+    evict(shard, index);
+    return index;
+  }
+}
+
+template <typename K, typename V, typename H>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentCache<K, V, H>::evict(
+    Shard& shard, size_t index) noexcept {
+  auto& slot = shard.slots[index];
+  auto node = slot.node.exchange(nullptr, ::std::memory_order_acq_rel);
+  shard.table.load(::std::memory_order_relaxed)
+      ->erase(node->key, _garbage_collector);
+  _garbage_collector.retire(Reclaimer {node});
+  shard.erased++;
+  _size << -1;
+  _evictions << 1;
+}
+
+template <typename K, typename V, typename H>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentCache<K, V, H>::index_slot(
+    Shard& shard, const K& key, size_t index) noexcept {
+  auto table = shard.table.load(::std::memory_order_relaxed);
+  // Purge reclaimed tombstones once every round of capacity. Compact can run
+  // concurrently with reader, and insertion is excluded by shard mutex
+  if (shard.erased >= _shard_capacity) {
+    shard.erased = 0;
+    table->compact();
+  }
+  if (ABSL_PREDICT_TRUE(table->emplace(key, index).second)) {
+    return;
+  }
+  // Tombstones still in probe chain can not be purged by compact, and
+  // finally fill the table. Rebuild from live slots in that case
+  rebuild_table(shard);
+}
+
+template <typename K, typename V, typename H>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentCache<K, V, H>::rebuild_table(
+    Shard& shard) noexcept {
+  auto table = new Table {_table_bucket_count};
+  for (size_t i = 0; i < shard.used; ++i) {
+    auto node = shard.slots[i].node.load(::std::memory_order_relaxed);
+    if (node != nullptr) {
+      table->emplace(node->key, i);
+    }
+  }
+  auto old_table = shard.table.exchange(table, ::std::memory_order_acq_rel);
+  _garbage_collector.retire(Reclaimer {old_table});
+  shard.erased = 0;
+}
+// ConcurrentCache end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
@@ -1,6 +1,10 @@
 #include "babylon/concurrent/counter.h"
 
 #include "babylon/new.h"
+#include "babylon/sanitizer_helper.h" // BABYLON_LEAK_CHECK_DISABLER
+
+#include <algorithm> // std::find
+#include <cmath>     // std::ceil
 
 BABYLON_NAMESPACE_BEGIN
 
@@ -32,6 +36,251 @@ ConcurrentSummer::Summary ConcurrentSummer::value() const noexcept {
 // ConcurrentSummer end
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentWindowTicker begin
+ConcurrentWindowTicker::~ConcurrentWindowTicker() noexcept {
+  stop();
+}
+
+ConcurrentWindowTicker& ConcurrentWindowTicker::instance() noexcept {
+  // 后台线程持续运行到进程退出，因此实例本身也不做销毁
+  BABYLON_LEAK_CHECK_DISABLER();
+  static auto ticker = [] {
+    auto ticker = new ConcurrentWindowTicker;
+    ticker->start(::std::chrono::seconds {1});
+    return ticker;
+  }();
+  return *ticker;
+}
+
+int ConcurrentWindowTicker::start(
+    ::std::chrono::milliseconds interval) noexcept {
+  ::std::lock_guard<::std::mutex> lock {_running_mutex};
+  if (_running) {
+    return 0;
+  }
+  _running = true;
+  _thread = ::std::thread(&ConcurrentWindowTicker::keep_tick, this, interval);
+  return 0;
+}
+
+void ConcurrentWindowTicker::stop() noexcept {
+  {
+    ::std::lock_guard<::std::mutex> lock {_running_mutex};
+    _running = false;
+  }
+  _running_cond.notify_all();
+  if (_thread.joinable()) {
+    _thread.join();
+  }
+}
+
+void ConcurrentWindowTicker::tick() noexcept {
+  // 持锁驱动，保证注销返回后不再被驱动
+  ::std::lock_guard<::std::mutex> lock {_mutex};
+  for (auto tickable : _tickables) {
+    tickable->tick();
+  }
+}
+
+void ConcurrentWindowTicker::register_tickable(Tickable& tickable) noexcept {
+  ::std::lock_guard<::std::mutex> lock {_mutex};
+  _tickables.emplace_back(&tickable);
+}
+
+void ConcurrentWindowTicker::unregister_tickable(Tickable& tickable) noexcept {
+  ::std::lock_guard<::std::mutex> lock {_mutex};
+  auto iter = ::std::find(_tickables.begin(), _tickables.end(), &tickable);
+  if (iter != _tickables.end()) {
+    *iter = _tickables.back();
+    _tickables.pop_back();
+  }
+}
+
+void ConcurrentWindowTicker::keep_tick(
+    ::std::chrono::milliseconds interval) noexcept {
+  auto next_tick_time = ::std::chrono::steady_clock::now() + interval;
+  ::std::unique_lock<::std::mutex> lock {_running_mutex};
+  while (!_running_cond.wait_until(lock, next_tick_time, [&] {
+    return !_running;
+  })) {
+    lock.unlock();
+    tick();
+    lock.lock();
+    // 按照固定节拍推进，避免tick本身的耗时累积成漂移
+    next_tick_time += interval;
+  }
+}
+// ConcurrentWindowTicker end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentWindowAdder begin
+ConcurrentWindowAdder::ConcurrentWindowAdder(
+    size_t window_size, ConcurrentWindowTicker& ticker) noexcept
+    : _ticker {ticker}, _series {window_size, 0} {
+  _ticker.register_tickable(*this);
+}
+
+ConcurrentWindowAdder::~ConcurrentWindowAdder() noexcept {
+  _ticker.unregister_tickable(*this);
+}
+
+ssize_t ConcurrentWindowAdder::value(size_t window) const noexcept {
+  ssize_t earliest;
+  ssize_t latest;
+  _series.range(window, earliest, latest);
+  return latest - earliest;
+}
+
+double ConcurrentWindowAdder::rate(size_t window) const noexcept {
+  ssize_t earliest;
+  ssize_t latest;
+  window = _series.range(window, earliest, latest);
+  return window == 0 ? 0 : static_cast<double>(latest - earliest) / window;
+}
+
+void ConcurrentWindowAdder::tick() noexcept {
+  _series.push(_adder.value());
+}
+// ConcurrentWindowAdder end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentWindowSummer begin
+ConcurrentWindowSummer::ConcurrentWindowSummer(
+    size_t window_size, ConcurrentWindowTicker& ticker) noexcept
+    : _ticker {ticker}, _series {window_size, {0, 0}} {
+  _ticker.register_tickable(*this);
+}
+
+ConcurrentWindowSummer::~ConcurrentWindowSummer() noexcept {
+  _ticker.unregister_tickable(*this);
+}
+
+ConcurrentSummer::Summary ConcurrentWindowSummer::value(
+    size_t window) const noexcept {
+  ConcurrentSummer::Summary earliest;
+  ConcurrentSummer::Summary latest;
+  _series.range(window, earliest, latest);
+  return {latest.sum - earliest.sum, latest.num - earliest.num};
+}
+
+double ConcurrentWindowSummer::average(size_t window) const noexcept {
+  auto summary = value(window);
+  return summary.num == 0 ? 0 : static_cast<double>(summary.sum) / summary.num;
+}
+
+double ConcurrentWindowSummer::rate(size_t window) const noexcept {
+  ConcurrentSummer::Summary earliest;
+  ConcurrentSummer::Summary latest;
+  window = _series.range(window, earliest, latest);
+  return window == 0 ? 0
+                     : static_cast<double>(latest.num - earliest.num) / window;
+}
+
+void ConcurrentWindowSummer::tick() noexcept {
+  _series.push(_summer.value());
+}
+// ConcurrentWindowSummer end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentHistogram begin
+ConcurrentHistogram::Snapshot ConcurrentHistogram::snapshot() const noexcept {
+  Snapshot snapshot;
+  _storage.for_each([&](const Slot& slot) {
+    for (size_t i = 0; i < BUCKET_NUM; ++i) {
+      snapshot._buckets[i] += slot.buckets[i];
+    }
+    snapshot._sum += slot.sum;
+  });
+  // 计数线程先累加分桶再累加sum，这里重新汇总count保证和分桶一致
+  for (auto count : snapshot._buckets) {
+    snapshot._count += count;
+  }
+  return snapshot;
+}
+// ConcurrentHistogram end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentHistogram::Snapshot begin
+ConcurrentHistogram::Snapshot& ConcurrentHistogram::Snapshot::operator+=(
+    const Snapshot& other) noexcept {
+  for (size_t i = 0; i < BUCKET_NUM; ++i) {
+    _buckets[i] += other._buckets[i];
+  }
+  _sum += other._sum;
+  _count += other._count;
+  return *this;
+}
+
+ConcurrentHistogram::Snapshot& ConcurrentHistogram::Snapshot::operator-=(
+    const Snapshot& other) noexcept {
+  for (size_t i = 0; i < BUCKET_NUM; ++i) {
+    _buckets[i] -= other._buckets[i];
+  }
+  _sum -= other._sum;
+  _count -= other._count;
+  return *this;
+}
+
+double ConcurrentHistogram::Snapshot::average() const noexcept {
+  return _count == 0 ? 0 : static_cast<double>(_sum) / _count;
+}
+
+uint32_t ConcurrentHistogram::Snapshot::percentile(
+    double ratio) const noexcept {
+  if (_count == 0) {
+    return 0;
+  }
+  // 找到累计数量首次达到ceil(ratio * count)的分桶，至少为第1个样本
+  auto rank = static_cast<uint64_t>(::std::ceil(ratio * _count));
+  rank = ::std::max<uint64_t>(::std::min<uint64_t>(rank, _count), 1);
+  uint64_t accumulated = 0;
+  for (size_t i = 0; i < BUCKET_NUM; ++i) {
+    accumulated += _buckets[i];
+    if (accumulated >= rank) {
+      return bucket_upper_bound(i);
+    }
+  }
+  return bucket_upper_bound(BUCKET_NUM - 1);
+}
+// ConcurrentHistogram::Snapshot end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentHistogramWindow begin
+ConcurrentHistogramWindow::ConcurrentHistogramWindow(
+    const ConcurrentHistogram& histogram, size_t window_size,
+    ConcurrentWindowTicker& ticker) noexcept
+    : _histogram {histogram},
+      _ticker {ticker},
+      _series {window_size, histogram.snapshot()} {
+  _ticker.register_tickable(*this);
+}
+
+ConcurrentHistogramWindow::~ConcurrentHistogramWindow() noexcept {
+  _ticker.unregister_tickable(*this);
+}
+
+void ConcurrentHistogramWindow::tick() noexcept {
+  // 在锁外汇聚，避免阻塞并发的读取
+  _series.push(_histogram.snapshot());
+}
+
+ConcurrentHistogram::Snapshot ConcurrentHistogramWindow::snapshot(
+    size_t window) const noexcept {
+  ConcurrentHistogram::Snapshot earliest;
+  ConcurrentHistogram::Snapshot latest;
+  _series.range(window, earliest, latest);
+  latest -= earliest;
+  return latest;
+}
+// ConcurrentHistogramWindow end
+////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // ConcurrentSampler::Sample begin
 ConcurrentSampler::Sample::~Sample() noexcept {
@@ -3,7 +3,12 @@
 #include "babylon/concurrent/thread_local.h" // CompactEnumerableThreadLocal
 #include "babylon/environment.h"
 
-#include <type_traits> // std::is_integral, std::is_floating_point
+#include <chrono>             // std::chrono::milliseconds
+#include <condition_variable> // std::condition_variable
+#include <mutex>              // std::mutex
+#include <thread>             // std::thread
+#include <type_traits>        // std::is_integral, std::is_floating_point
+#include <vector>             // std::vector
 
 #ifdef __x86_64__
 #include <x86intrin.h>
@@ -316,6 +321,281 @@ class ConcurrentSampler {
   ::std::atomic<uint32_t> _version {0};
 };
 
+// 窗口计数器的驱动器，周期性调用所有注册者的tick
+// 一般使用进程级共享的instance，由一个低频后台线程每秒驱动一次
+// 也可以独立构造，不启动后台线程而是手动调用tick，便于测试或者对齐外部统计周期
+class ConcurrentWindowTicker {
+ public:
+  // 被驱动的接口，需要保证tick足够轻量
+  class Tickable {
+   public:
+    virtual ~Tickable() noexcept = default;
+    virtual void tick() noexcept = 0;
+  };
+
+  ConcurrentWindowTicker() noexcept = default;
+  ConcurrentWindowTicker(ConcurrentWindowTicker&&) = delete;
+  ConcurrentWindowTicker(const ConcurrentWindowTicker&) = delete;
+  ConcurrentWindowTicker& operator=(ConcurrentWindowTicker&&) = delete;
+  ConcurrentWindowTicker& operator=(const ConcurrentWindowTicker&) = delete;
+  ~ConcurrentWindowTicker() noexcept;
+
+  // 进程级共享实例，首次使用时启动每秒驱动一次的后台线程，永不销毁
+  static ConcurrentWindowTicker& instance() noexcept;
+
+  // 启动后台线程，按照interval周期驱动
+  int start(::std::chrono::milliseconds interval) noexcept;
+  // 停止后台线程
+  void stop() noexcept;
+
+  // 驱动所有注册者tick一次
+  void tick() noexcept;
+
+  // 注册和注销，注销返回后保证不再被驱动
+  void register_tickable(Tickable& tickable) noexcept;
+  void unregister_tickable(Tickable& tickable) noexcept;
+
+ private:
+  void keep_tick(::std::chrono::milliseconds interval) noexcept;
+
+  ::std::mutex _mutex;
+  ::std::vector<Tickable*> _tickables;
+
+  ::std::mutex _running_mutex;
+  ::std::condition_variable _running_cond;
+  bool _running {false};
+  ::std::thread _thread;
+};
+
+namespace internal {
+// 窗口计数器使用的累计值环，每次tick记录一个累计值，最多保留window_size + 1个
+// 最近n次tick之间的增量即为最新值减去n次之前的值
+template <typename T>
+class ConcurrentWindowSeries {
+ public:
+  ConcurrentWindowSeries(size_t window_size, T initial_value) noexcept
+      : _values(::std::max<size_t>(window_size, 1) + 1, initial_value) {}
+
+  inline size_t window_size() const noexcept {
+    return _values.size() - 1;
+  }
+
+  void push(T value) noexcept {
+    ::std::lock_guard<::std::mutex> lock {_mutex};
+    _tick_times++;
+    _values[_tick_times % _values.size()] = ::std::move(value);
+  }
+
+  // 获取最近window次tick首尾的累计值，window超过已记录的次数时按实际次数截断
+  // 返回实际的window
+  size_t range(size_t window, T& earliest, T& latest) const noexcept {
+    ::std::lock_guard<::std::mutex> lock {_mutex};
+    window = ::std::min(window, ::std::min(_tick_times, window_size()));
+    latest = _values[_tick_times % _values.size()];
+    earliest = _values[(_tick_times - window) % _values.size()];
+    return window;
+  }
+
+ private:
+  mutable ::std::mutex _mutex;
+  ::std::vector<T> _values;
+  size_t _tick_times {0};
+};
+} // namespace internal
+
+// 带滑动窗口的高并发累加计数器
+// 计数操作直接进入内部的ConcurrentAdder，不引入任何额外开销
+// 由ConcurrentWindowTicker每秒记录一次累计值，读取时通过差分得到窗口内的增量
+class ConcurrentWindowAdder : public ConcurrentWindowTicker::Tickable {
+ public:
+  ConcurrentWindowAdder(ConcurrentWindowAdder&&) = delete;
+  ConcurrentWindowAdder(const ConcurrentWindowAdder&) = delete;
+  ConcurrentWindowAdder& operator=(ConcurrentWindowAdder&&) = delete;
+  ConcurrentWindowAdder& operator=(const ConcurrentWindowAdder&) = delete;
+  virtual ~ConcurrentWindowAdder() noexcept override;
+
+  // 保留最近window_size次tick，默认注册到进程级共享的ticker
+  explicit ConcurrentWindowAdder(
+      size_t window_size = 60,
+      ConcurrentWindowTicker& ticker =
+          ConcurrentWindowTicker::instance()) noexcept;
+
+  inline size_t window_size() const noexcept;
+
+  // 分散计数接口
+  template <typename U>
+  inline ConcurrentWindowAdder& operator<<(const U& value) noexcept;
+
+  // 开始以来的累计值
+  inline ssize_t value() const noexcept;
+  // 最近window次tick之间的增量
+  ssize_t value(size_t window) const noexcept;
+  // 最近window次tick之间的平均每次tick增量，即每秒速率，未tick过时返回0
+  double rate(size_t window) const noexcept;
+
+  virtual void tick() noexcept override;
+
+ private:
+  ConcurrentWindowTicker& _ticker;
+  ConcurrentAdder _adder;
+  internal::ConcurrentWindowSeries<ssize_t> _series;
+};
+
+// 带滑动窗口的高并发求和计数器
+// 计数操作直接进入内部的ConcurrentSummer，不引入任何额外开销
+// 由ConcurrentWindowTicker每秒记录一次累计值，读取时通过差分得到窗口内的增量
+class ConcurrentWindowSummer : public ConcurrentWindowTicker::Tickable {
+ public:
+  ConcurrentWindowSummer(ConcurrentWindowSummer&&) = delete;
+  ConcurrentWindowSummer(const ConcurrentWindowSummer&) = delete;
+  ConcurrentWindowSummer& operator=(ConcurrentWindowSummer&&) = delete;
+  ConcurrentWindowSummer& operator=(const ConcurrentWindowSummer&) = delete;
+  virtual ~ConcurrentWindowSummer() noexcept override;
+
+  // 保留最近window_size次tick，默认注册到进程级共享的ticker
+  explicit ConcurrentWindowSummer(
+      size_t window_size = 60,
+      ConcurrentWindowTicker& ticker =
+          ConcurrentWindowTicker::instance()) noexcept;
+
+  inline size_t window_size() const noexcept;
+
+  // 分散计数接口
+  inline ConcurrentWindowSummer& operator<<(ssize_t value) noexcept;
+  inline ConcurrentWindowSummer& operator<<(
+      ConcurrentSummer::Summary summary) noexcept;
+
+  // 开始以来的累计值
+  inline ConcurrentSummer::Summary value() const noexcept;
+  // 最近window次tick之间的增量
+  ConcurrentSummer::Summary value(size_t window) const noexcept;
+  // 最近window次tick之间的sum / num，没有计数时返回0
+  double average(size_t window) const noexcept;
+  // 最近window次tick之间的平均每次tick计数次数，即每秒速率，未tick过时返回0
+  double rate(size_t window) const noexcept;
+
+  virtual void tick() noexcept override;
+
+ private:
+  ConcurrentWindowTicker& _ticker;
+  ConcurrentSummer _summer;
+  internal::ConcurrentWindowSeries<ConcurrentSummer::Summary> _series;
+};
+
+// 高并发直方图计数器
+// 原理上等价于利用锁同步
+// 计数操作进行lock {buckets[bucket_index(value)] += 1; sum += value}
+// 读取操作进行lock {buckets; sum}
+//
+// 采用HDR风格的对数-线性分桶，相比ConcurrentSampler不做采样，分位值精确到桶
+// value [0, 64) => 每个值独占一个桶
+// value [2^n, 2^(n+1)) => 等宽切分为32个子桶，相对误差不超过1/32
+//
+// 实现上针对多写少读的场景做了优化，更适用于典型的耗时统计场景
+// 计数操作改为独立发生在对应的线程局部数据上，只进行一次无竞争的累加
+// 读取时汇聚得到可合并、可相减的快照，配合ConcurrentHistogramWindow实现滑动窗口
+class ConcurrentHistogram {
+ public:
+  constexpr static size_t SUB_BUCKET_BITS = 5;
+  constexpr static size_t SUB_BUCKET_NUM = 1 << SUB_BUCKET_BITS;
+  constexpr static size_t BUCKET_NUM = (33 - SUB_BUCKET_BITS) * SUB_BUCKET_NUM;
+
+  class Snapshot;
+
+  // 可默认构造，不能移动和拷贝
+  ConcurrentHistogram() noexcept = default;
+  ConcurrentHistogram(ConcurrentHistogram&&) = delete;
+  ConcurrentHistogram(const ConcurrentHistogram&) = delete;
+  ConcurrentHistogram& operator=(ConcurrentHistogram&&) = delete;
+  ConcurrentHistogram& operator=(const ConcurrentHistogram&) = delete;
+  ~ConcurrentHistogram() noexcept = default;
+
+  // 计算目标值所在的分桶，以及分桶包含的值域[lower_bound, upper_bound]
+  inline static size_t bucket_index(uint32_t value) noexcept;
+  inline static uint32_t bucket_lower_bound(size_t index) noexcept;
+  inline static uint32_t bucket_upper_bound(size_t index) noexcept;
+
+  // 分散计数接口
+  inline ConcurrentHistogram& operator<<(uint32_t value) noexcept;
+
+  // 汇聚读取接口，得到开始以来的累计快照
+  Snapshot snapshot() const noexcept;
+
+ private:
+  struct Slot {
+    uint64_t buckets[BUCKET_NUM];
+    uint64_t sum;
+  };
+
+  // 单个Slot约7KB，按照16KB一组打包到线程局部存储中
+  CompactEnumerableThreadLocal<Slot, 256, true> _storage;
+};
+
+// 直方图快照，支持合并多个直方图，以及相减得到两次快照之间的增量
+class ConcurrentHistogram::Snapshot {
+ public:
+  Snapshot() noexcept = default;
+  Snapshot(Snapshot&&) noexcept = default;
+  Snapshot(const Snapshot&) noexcept = default;
+  Snapshot& operator=(Snapshot&&) noexcept = default;
+  Snapshot& operator=(const Snapshot&) noexcept = default;
+  ~Snapshot() noexcept = default;
+
+  Snapshot& operator+=(const Snapshot& other) noexcept;
+  Snapshot& operator-=(const Snapshot& other) noexcept;
+
+  inline uint64_t count() const noexcept;
+  inline uint64_t sum() const noexcept;
+  inline uint64_t bucket_count(size_t index) const noexcept;
+  // 无样本时返回0
+  double average() const noexcept;
+
+  // 分位值，ratio取值[0, 1]，例如0.999代表p999
+  // 返回所在分桶的上界，无样本时返回0
+  uint32_t percentile(double ratio) const noexcept;
+
+ private:
+  uint64_t _buckets[BUCKET_NUM] = {};
+  uint64_t _sum {0};
+  uint64_t _count {0};
+
+  friend ConcurrentHistogram;
+};
+
+// 直方图的滑动窗口统计
+// 和ConcurrentWindowAdder一样由ConcurrentWindowTicker每秒tick一次
+// 每次tick记录一个累计快照，最多保留window_size + 1个
+// 最近n次tick之间的增量即为最新快照减去n次之前的快照，即得到最近n秒的直方图
+class ConcurrentHistogramWindow : public ConcurrentWindowTicker::Tickable {
+ public:
+  ConcurrentHistogramWindow(ConcurrentHistogramWindow&&) = delete;
+  ConcurrentHistogramWindow(const ConcurrentHistogramWindow&) = delete;
+  ConcurrentHistogramWindow& operator=(ConcurrentHistogramWindow&&) = delete;
+  ConcurrentHistogramWindow& operator=(const ConcurrentHistogramWindow&) =
+      delete;
+  virtual ~ConcurrentHistogramWindow() noexcept override;
+
+  // 构造时记录初始快照，保留最近window_size次tick，默认注册到进程级共享的ticker
+  // histogram需要在窗口的生命周期内保持有效
+  explicit ConcurrentHistogramWindow(
+      const ConcurrentHistogram& histogram, size_t window_size = 60,
+      ConcurrentWindowTicker& ticker =
+          ConcurrentWindowTicker::instance()) noexcept;
+
+  inline size_t window_size() const noexcept;
+
+  // 记录一个新的累计快照，淘汰最早的快照
+  virtual void tick() noexcept override;
+
+  // 最近window次tick之间的增量，window超过已记录的次数时按实际次数计算
+  ConcurrentHistogram::Snapshot snapshot(size_t window) const noexcept;
+
+ private:
+  const ConcurrentHistogram& _histogram;
+  ConcurrentWindowTicker& _ticker;
+  internal::ConcurrentWindowSeries<ConcurrentHistogram::Snapshot> _series;
+};
+
 inline ABSL_ATTRIBUTE_ALWAYS_INLINE ConcurrentSummer&
 ConcurrentSummer::operator<<(ssize_t value) noexcept {
   return operator<<({value, 1});
@@ -405,4 +685,119 @@ ConcurrentSampler::xorshift128_rand() noexcept {
 // ConcurrentSampler end
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentWindowAdder begin
+inline size_t ConcurrentWindowAdder::window_size() const noexcept {
+  return _series.window_size();
+}
+
+template <typename U>
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE ConcurrentWindowAdder&
+ConcurrentWindowAdder::operator<<(const U& value) noexcept {
+  _adder << value;
+  return *this;
+}
+
+inline ssize_t ConcurrentWindowAdder::value() const noexcept {
+  return _adder.value();
+}
+// ConcurrentWindowAdder end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentWindowSummer begin
+inline size_t ConcurrentWindowSummer::window_size() const noexcept {
+  return _series.window_size();
+}
+
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE ConcurrentWindowSummer&
+ConcurrentWindowSummer::operator<<(ssize_t value) noexcept {
+  _summer << value;
+  return *this;
+}
+
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE ConcurrentWindowSummer&
+ConcurrentWindowSummer::operator<<(ConcurrentSummer::Summary summary) noexcept {
+  _summer << summary;
+  return *this;
+}
+
+inline ConcurrentSummer::Summary ConcurrentWindowSummer::value()
+    const noexcept {
+  return _summer.value();
+}
+// ConcurrentWindowSummer end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentHistogram begin
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE size_t
+ConcurrentHistogram::bucket_index(uint32_t value) noexcept {
+  // [0, 2 * SUB_BUCKET_NUM) => value
+  // [2^n, 2^(n+1)) => shift * SUB_BUCKET_NUM + (value >> shift)
+  // 其中shift = n - SUB_BUCKET_BITS，value >> shift落在[SUB_BUCKET_NUM,
+  // 2 * SUB_BUCKET_NUM)
+  if (value < 2 * SUB_BUCKET_NUM) {
+    return value;
+  }
+  size_t shift = 31 - static_cast<size_t>(__builtin_clz(value)) -
+                 SUB_BUCKET_BITS;
+  return shift * SUB_BUCKET_NUM + (value >> shift);
+}
+
+inline uint32_t ConcurrentHistogram::bucket_lower_bound(size_t index) noexcept {
+  if (index < 2 * SUB_BUCKET_NUM) {
+    return index;
+  }
+  size_t shift = index / SUB_BUCKET_NUM - 1;
+  return static_cast<uint32_t>((index % SUB_BUCKET_NUM + SUB_BUCKET_NUM)
+                               << shift);
+}
+
+inline uint32_t ConcurrentHistogram::bucket_upper_bound(size_t index) noexcept {
+  if (index < 2 * SUB_BUCKET_NUM) {
+    return index;
+  }
+  size_t shift = index / SUB_BUCKET_NUM - 1;
+  return bucket_lower_bound(index) + ((1U << shift) - 1);
+}
+
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE ConcurrentHistogram&
+ConcurrentHistogram::operator<<(uint32_t value) noexcept {
+  auto& local = _storage.local();
+  // local的唯一修改者是自己，所以这里不需要使用原子加法
+  // 正确对齐的数值类型赋值本身是原子发生的
+  auto& bucket = local.buckets[bucket_index(value)];
+  bucket = bucket + 1;
+  local.sum = local.sum + value;
+  return *this;
+}
+// ConcurrentHistogram end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentHistogram::Snapshot begin
+inline uint64_t ConcurrentHistogram::Snapshot::count() const noexcept {
+  return _count;
+}
+
+inline uint64_t ConcurrentHistogram::Snapshot::sum() const noexcept {
+  return _sum;
+}
+
+inline uint64_t ConcurrentHistogram::Snapshot::bucket_count(
+    size_t index) const noexcept {
+  return _buckets[index];
+}
+// ConcurrentHistogram::Snapshot end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentHistogramWindow begin
+inline size_t ConcurrentHistogramWindow::window_size() const noexcept {
+  return _series.window_size();
+}
+// ConcurrentHistogramWindow end
+////////////////////////////////////////////////////////////////////////////////
+
 BABYLON_NAMESPACE_END
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "babylon/concurrent/bounded_queue.h"
+#include "babylon/concurrent/ring_queue.h"
 #include "babylon/executor.h"
 
 BABYLON_NAMESPACE_BEGIN
@@ -11,10 +12,13 @@ BABYLON_NAMESPACE_BEGIN
 // 典型在需要大量偶发活跃队列的场景（比如大量socket，大量raft
 // log），可以显著节省线程数 在使用系统线程执行时尤其重要
 // 即使是使用类似bthread的协程模式，节省栈数目也可以节省内存开销
-template <typename T, typename S = SchedInterface>
+// 底层队列Q默认采用ConcurrentBoundedQueue，由于消费者唯一，也可以替换为
+// ConcurrentMpscQueue，去掉消费侧的原子操作
+template <typename T, typename S = SchedInterface,
+          typename Q = ConcurrentBoundedQueue<T, S>>
 class ConcurrentExecutionQueue {
  private:
-  using Queue = ConcurrentBoundedQueue<T, S>;
+  using Queue = Q;
 
  public:
   using Iterator = typename Queue::Iterator;
@@ -73,48 +77,48 @@ class ConcurrentExecutionQueue {
   ConsumeFunction _consume_function;
 };
 
-template <typename T, typename S>
+template <typename T, typename S, typename Q>
 template <typename C>
-int ConcurrentExecutionQueue<T, S>::initialize(size_t capacity_hint,
-                                               Executor& executor,
-                                               C&& consume_function) noexcept {
+int ConcurrentExecutionQueue<T, S, Q>::initialize(
+    size_t capacity_hint, Executor& executor,
+    C&& consume_function) noexcept {
   _queue.reserve_and_clear(capacity_hint);
   _executor = &executor;
   _consume_function = ::std::forward<C>(consume_function);
   return 0;
 }
 
-template <typename T, typename S>
-inline size_t ConcurrentExecutionQueue<T, S>::capacity() const noexcept {
+template <typename T, typename S, typename Q>
+inline size_t ConcurrentExecutionQueue<T, S, Q>::capacity() const noexcept {
   return _queue.capacity();
 }
 
-template <typename T, typename S>
-inline size_t ConcurrentExecutionQueue<T, S>::size() const noexcept {
+template <typename T, typename S, typename Q>
+inline size_t ConcurrentExecutionQueue<T, S, Q>::size() const noexcept {
   return _queue.size();
 }
 
-template <typename T, typename S>
-inline int ConcurrentExecutionQueue<T, S>::execute(T&& value) noexcept {
+template <typename T, typename S, typename Q>
+inline int ConcurrentExecutionQueue<T, S, Q>::execute(T&& value) noexcept {
   _queue.template push<true, false, false>(::std::move(value));
   return signal_push_event();
 }
 
-template <typename T, typename S>
-inline int ConcurrentExecutionQueue<T, S>::execute(const T& value) noexcept {
+template <typename T, typename S, typename Q>
+inline int ConcurrentExecutionQueue<T, S, Q>::execute(const T& value) noexcept {
   _queue.template push<true, false, false>(value);
   return signal_push_event();
 }
 
-template <typename T, typename S>
-void ConcurrentExecutionQueue<T, S>::join() noexcept {
+template <typename T, typename S, typename Q>
+void ConcurrentExecutionQueue<T, S, Q>::join() noexcept {
   while (_events.load(::std::memory_order_acquire)) {
     S::usleep(1000);
   }
 }
 
-template <typename T, typename S>
-inline int ConcurrentExecutionQueue<T, S>::signal_push_event() noexcept {
+template <typename T, typename S, typename Q>
+inline int ConcurrentExecutionQueue<T, S, Q>::signal_push_event() noexcept {
   if (0 != _events.fetch_add(1, ::std::memory_order_acq_rel)) {
     return 0;
   }
@@ -122,8 +126,8 @@ inline int ConcurrentExecutionQueue<T, S>::signal_push_event() noexcept {
   return start_consumer();
 }
 
-template <typename T, typename S>
-int ConcurrentExecutionQueue<T, S>::start_consumer() noexcept {
+template <typename T, typename S, typename Q>
+int ConcurrentExecutionQueue<T, S, Q>::start_consumer() noexcept {
   size_t events = 1;
   do {
     auto ret =
@@ -136,8 +140,8 @@ int ConcurrentExecutionQueue<T, S>::start_consumer() noexcept {
   return -1;
 }
 
-template <typename T, typename S>
-void ConcurrentExecutionQueue<T, S>::consume_until_empty() noexcept {
+template <typename T, typename S, typename Q>
+void ConcurrentExecutionQueue<T, S, Q>::consume_until_empty() noexcept {
   size_t events = _events.load(::std::memory_order_acquire);
   while (true) {
     auto poped = _queue.template try_pop_n<false, false>(_consume_function,
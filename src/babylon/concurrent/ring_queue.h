@@ -0,0 +1,418 @@
+#pragma once
+
+#include "babylon/concurrent/sched_interface.h" // Futex
+#include "babylon/environment.h"
+#include "babylon/type_traits.h" // IsInvocable
+
+#include <atomic> // std::atomic
+#include <memory> // std::unique_ptr
+
+BABYLON_NAMESPACE_BEGIN
+
+namespace internal {
+namespace concurrent_ring_queue {
+
+// Futex based blocking wait shared by ring queues. Waiter announce itself
+// before recheck the condition, and waker check announcement after publish.
+// Both side separate them by seq_cst fence, so no wakeup is lost. Waker pay
+// only a fence and a load when no one is waiting.
+template <typename S>
+class alignas(BABYLON_CACHELINE_SIZE) Waiter {
+ public:
+  // Wait until predicate() return true. Block on futex if USE_FUTEX_WAIT,
+  // otherwise spin with yield
+  template <bool USE_FUTEX_WAIT, typename P>
+  inline void wait_until(P&& predicate) noexcept;
+
+  // Call after condition changed
+  inline void wakeup_one() noexcept;
+  inline void wakeup_all() noexcept;
+
+ private:
+  template <typename P>
+  void block_until(P& predicate) noexcept;
+
+  ::std::atomic<uint32_t> _waiters {0};
+  // Value is a sequence number bumped by every effective wakeup
+  Futex<S> _futex {0};
+};
+
+} // namespace concurrent_ring_queue
+} // namespace internal
+
+// Ring queue for exactly one producer thread and one consumer thread.
+// Compared to ConcurrentBoundedQueue with CONCURRENT = false, there is no
+// per-slot version futex at all:
+// 1. Producer and consumer each own one index, publish by a single release
+//    store after a whole batch done
+// 2. Each side cache the index of the other side, and only reload it when
+//    cached one is not enough for current operation
+// 3. Optional futex based blocking wait is provided by a queue level waiter,
+//    instead of every slot
+//
+// Template parameters keep the same meaning and order as
+// ConcurrentBoundedQueue, so it can replace a bounded queue which is used with
+// CONCURRENT = false on both side. CONCURRENT must be false here.
+template <typename T, typename S = SchedInterface>
+class ConcurrentSpscQueue {
+ public:
+  // Slots are stored continuously, batch callback get plain pointer range
+  using Iterator = T*;
+
+  // Default capacity is 1
+  ConcurrentSpscQueue() noexcept;
+  ConcurrentSpscQueue(ConcurrentSpscQueue&&) = delete;
+  ConcurrentSpscQueue(const ConcurrentSpscQueue&) = delete;
+  ConcurrentSpscQueue& operator=(ConcurrentSpscQueue&&) = delete;
+  ConcurrentSpscQueue& operator=(const ConcurrentSpscQueue&) = delete;
+  ~ConcurrentSpscQueue() noexcept = default;
+
+  // Construct with capacity no less than min_capacity, ceiled to 2^n
+  ConcurrentSpscQueue(size_t min_capacity) noexcept;
+
+  inline size_t capacity() const noexcept;
+
+  // Approximate number of elements waiting in queue
+  inline size_t size() const noexcept;
+
+  // Resize and drop all elements. Not thread safe.
+  // return: capacity after resize
+  size_t reserve_and_clear(size_t min_capacity) noexcept;
+
+  // Drop all elements. Not thread safe.
+  void clear() noexcept;
+
+  // Push an element, wait when queue is full. Default push =
+  // push<CONCURRENT = false, USE_FUTEX_WAIT = true, USE_FUTEX_WAKE = true>.
+  // USE_FUTEX_WAIT and USE_FUTEX_WAKE work the same as ConcurrentBoundedQueue
+  template <typename U, typename ::std::enable_if<
+                            ::std::is_assignable<T&, U>::value, int>::type = 0>
+  inline void push(U&& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline void push(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename U,
+            typename ::std::enable_if<::std::is_assignable<T&, U>::value,
+                                      int>::type = 0>
+  inline void push(U&& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline void push(C&& callback) noexcept;
+
+  // Push an element if not full. Default try_push = try_push<CONCURRENT =
+  // false, USE_FUTEX_WAKE = true>
+  template <typename U, typename ::std::enable_if<
+                            ::std::is_assignable<T&, U>::value, int>::type = 0>
+  inline bool try_push(U&& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline bool try_push(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename U,
+            typename ::std::enable_if<::std::is_assignable<T&, U>::value,
+                                      int>::type = 0>
+  inline bool try_push(U&& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline bool try_push(C&& callback) noexcept;
+
+  // Push num elements in batch. Call C(Iterator begin, Iterator end) to fill
+  // them, may be called several times when ring wrap around or queue is
+  // nearly full, but total size of ranges always equal to num
+  template <typename IT>
+  inline void push_n(IT begin, IT end) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void push_n(C&& callback, size_t num) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename IT>
+  inline void push_n(IT begin, IT end) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void push_n(C&& callback, size_t num) noexcept;
+
+  // Push at most num elements without wait
+  // return: number of elements actually pushed
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline size_t try_push_n(C&& callback, size_t num) noexcept;
+
+  // Pop an element, wait when queue is empty. Default pop = pop<CONCURRENT =
+  // false, USE_FUTEX_WAIT = true, USE_FUTEX_WAKE = true>
+  inline void pop(T& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline void pop(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE>
+  inline void pop(T& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline void pop(C&& callback) noexcept;
+
+  // Pop an element if not empty. Default try_pop = try_pop<CONCURRENT =
+  // false, USE_FUTEX_WAKE = true>
+  inline bool try_pop(T& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline bool try_pop(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE>
+  inline bool try_pop(T& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline bool try_pop(C&& callback) noexcept;
+
+  // Pop num elements in batch, wait until all available. Callback works like
+  // push_n
+  template <typename IT>
+  inline void pop_n(IT begin, IT end) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void pop_n(C&& callback, size_t num) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename IT>
+  inline void pop_n(IT begin, IT end) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void pop_n(C&& callback, size_t num) noexcept;
+
+  // Pop at most num elements without wait
+  // return: number of elements actually popped
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline size_t try_pop_n(C&& callback, size_t num) noexcept;
+
+ private:
+  using Waiter = internal::concurrent_ring_queue::Waiter<S>;
+
+  // Slots free to push / ready to pop. Cached index of other side is reloaded
+  // only when it can not satisfy expected number
+  inline size_t free_num(size_t tail, size_t expected) noexcept;
+  inline size_t ready_num(size_t head, size_t expected) noexcept;
+
+  // Call callback on [index, index + num), split into two ranges when wrap
+  template <typename C>
+  inline void deal_range(C& callback, size_t index, size_t num) noexcept;
+
+  size_t _capacity {1};
+  size_t _mask {0};
+  ::std::unique_ptr<T[]> _slots;
+
+  // Owned by consumer
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<size_t> _head {0};
+  size_t _cached_tail {0};
+  // Owned by producer
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<size_t> _tail {0};
+  size_t _cached_head {0};
+
+  // Producer wait for free slots, consumer wait for ready slots
+  Waiter _push_waiter;
+  Waiter _pop_waiter;
+};
+
+// Ring queue for any number of producer threads and exactly one consumer
+// thread. Producers claim index by fetch_add and publish each slot through a
+// plain sequence word, Vyukov style, which is not a futex. The single
+// consumer never need atomic read-modify-write, and blocking wait on both
+// side go through queue level waiter like ConcurrentSpscQueue.
+//
+// Template parameters keep the same meaning and order as
+// ConcurrentBoundedQueue. CONCURRENT is effective for push, and must be false
+// for pop. It can replace a bounded queue used in MPSC way, e.g. in
+// ConcurrentExecutionQueue.
+template <typename T, typename S = SchedInterface>
+class ConcurrentMpscQueue {
+ private:
+  struct Slot {
+    T value;
+    // Equal to index when free to push, index + 1 after pushed, and advance
+    // to index + capacity after popped
+    ::std::atomic<size_t> sequence {0};
+  };
+
+ public:
+  class Iterator {
+   public:
+    using difference_type = ssize_t;
+    using value_type = T;
+    using pointer = T*;
+    using reference = T&;
+    using iterator_category = ::std::random_access_iterator_tag;
+
+    inline Iterator(Slot* slot) noexcept;
+    inline Iterator& operator++() noexcept;
+    inline Iterator operator++(int) noexcept;
+    inline Iterator operator+(ssize_t offset) const noexcept;
+    inline Iterator operator-(ssize_t offset) const noexcept;
+    inline bool operator==(Iterator other) const noexcept;
+    inline bool operator!=(Iterator other) const noexcept;
+    inline bool operator<(Iterator other) const noexcept;
+    inline bool operator<=(Iterator other) const noexcept;
+    inline bool operator>(Iterator other) const noexcept;
+    inline bool operator>=(Iterator other) const noexcept;
+    inline T& operator*() const noexcept;
+    inline T* operator->() const noexcept;
+    inline ssize_t operator-(Iterator other) const noexcept;
+
+   private:
+    Slot* _slot {nullptr};
+  };
+
+  // Default capacity is 1
+  ConcurrentMpscQueue() noexcept;
+  ConcurrentMpscQueue(ConcurrentMpscQueue&&) = delete;
+  ConcurrentMpscQueue(const ConcurrentMpscQueue&) = delete;
+  ConcurrentMpscQueue& operator=(ConcurrentMpscQueue&&) = delete;
+  ConcurrentMpscQueue& operator=(const ConcurrentMpscQueue&) = delete;
+  ~ConcurrentMpscQueue() noexcept = default;
+
+  // Construct with capacity no less than min_capacity, ceiled to 2^n
+  ConcurrentMpscQueue(size_t min_capacity) noexcept;
+
+  inline size_t capacity() const noexcept;
+
+  // Approximate number of elements waiting in queue
+  inline size_t size() const noexcept;
+
+  // Resize and drop all elements. Not thread safe.
+  // return: capacity after resize
+  size_t reserve_and_clear(size_t min_capacity) noexcept;
+
+  // Drop all elements. Not thread safe.
+  void clear() noexcept;
+
+  // Default push = push<CONCURRENT = true, USE_FUTEX_WAIT = true,
+  // USE_FUTEX_WAKE = true>. Others are same as ConcurrentSpscQueue
+  template <typename U, typename ::std::enable_if<
+                            ::std::is_assignable<T&, U>::value, int>::type = 0>
+  inline void push(U&& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline void push(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename U,
+            typename ::std::enable_if<::std::is_assignable<T&, U>::value,
+                                      int>::type = 0>
+  inline void push(U&& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline void push(C&& callback) noexcept;
+
+  // Default try_push = try_push<CONCURRENT = true, USE_FUTEX_WAKE = true>
+  template <typename U, typename ::std::enable_if<
+                            ::std::is_assignable<T&, U>::value, int>::type = 0>
+  inline bool try_push(U&& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline bool try_push(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename U,
+            typename ::std::enable_if<::std::is_assignable<T&, U>::value,
+                                      int>::type = 0>
+  inline bool try_push(U&& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline bool try_push(C&& callback) noexcept;
+
+  template <typename IT>
+  inline void push_n(IT begin, IT end) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void push_n(C&& callback, size_t num) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename IT>
+  inline void push_n(IT begin, IT end) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void push_n(C&& callback, size_t num) noexcept;
+
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline size_t try_push_n(C&& callback, size_t num) noexcept;
+
+  // Default pop = pop<CONCURRENT = false, USE_FUTEX_WAIT = true,
+  // USE_FUTEX_WAKE = true>. Others are same as ConcurrentSpscQueue
+  inline void pop(T& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline void pop(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE>
+  inline void pop(T& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline void pop(C&& callback) noexcept;
+
+  // Default try_pop = try_pop<CONCURRENT = false, USE_FUTEX_WAKE = true>
+  inline bool try_pop(T& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline bool try_pop(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE>
+  inline bool try_pop(T& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline bool try_pop(C&& callback) noexcept;
+
+  template <typename IT>
+  inline void pop_n(IT begin, IT end) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void pop_n(C&& callback, size_t num) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename IT>
+  inline void pop_n(IT begin, IT end) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+            typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void pop_n(C&& callback, size_t num) noexcept;
+
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline size_t try_pop_n(C&& callback, size_t num) noexcept;
+
+ private:
+  using Waiter = internal::concurrent_ring_queue::Waiter<S>;
+
+  // Try push or pop continuous slots start from index, without crossing
+  // the end of ring
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C>
+  inline size_t try_push_continuously(C& callback, size_t num) noexcept;
+  template <bool USE_FUTEX_WAKE, typename C>
+  inline size_t try_pop_continuously(C& callback, size_t num) noexcept;
+
+  template <bool USE_FUTEX_WAKE>
+  inline void publish(size_t index, size_t num) noexcept;
+  template <bool USE_FUTEX_WAKE>
+  inline void release(size_t index, size_t num) noexcept;
+
+  size_t _capacity {1};
+  size_t _mask {0};
+  ::std::unique_ptr<Slot[]> _slots;
+
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<size_t> _head {0};
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<size_t> _tail {0};
+
+  Waiter _push_waiter;
+  Waiter _pop_waiter;
+};
+
+BABYLON_NAMESPACE_END
+
+#include "babylon/concurrent/ring_queue.hpp"
@@ -0,0 +1,943 @@
+#pragma once
+
+#include "babylon/absl_numeric_bits.h" // absl::bit_ceil
+#include "babylon/concurrent/ring_queue.h"
+
+#include <algorithm> // std::min
+
+BABYLON_NAMESPACE_BEGIN
+
+namespace internal {
+namespace concurrent_ring_queue {
+
+////////////////////////////////////////////////////////////////////////////////
+// Waiter begin
+template <typename S>
+template <bool USE_FUTEX_WAIT, typename P>
+inline void Waiter<S>::wait_until(P&& predicate) noexcept {
+  if (ABSL_PREDICT_TRUE(predicate())) {
+    return;
+  }
+  if (USE_FUTEX_WAIT) {
+    block_until(predicate);
+    return;
+  }
+  do {
+    S::yield();
+  } while (!predicate());
+}
+
+template <typename S>
+inline void Waiter<S>::wakeup_one() noexcept {
+  ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+  if (ABSL_PREDICT_FALSE(_waiters.load(::std::memory_order_relaxed) != 0)) {
+    _futex.value().fetch_add(1, ::std::memory_order_relaxed);
+    _futex.wake_one();
+  }
+}
+
+template <typename S>
+inline void Waiter<S>::wakeup_all() noexcept {
+  ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+  if (ABSL_PREDICT_FALSE(_waiters.load(::std::memory_order_relaxed) != 0)) {
+    _futex.value().fetch_add(1, ::std::memory_order_relaxed);
+    _futex.wake_all();
+  }
+}
+
+template <typename S>
+template <typename P>
+ABSL_ATTRIBUTE_NOINLINE void Waiter<S>::block_until(P& predicate) noexcept {
+  while (true) {
+    // Load sequence before announce, any wakeup after that make wait return
+    // immediately
+    auto sequence = _futex.value().load(::std::memory_order_acquire);
+    _waiters.fetch_add(1, ::std::memory_order_relaxed);
+    ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+    if (predicate()) {
+      _waiters.fetch_sub(1, ::std::memory_order_relaxed);
+      return;
+    }
+    _futex.wait(sequence, nullptr);
+    _waiters.fetch_sub(1, ::std::memory_order_relaxed);
+    if (predicate()) {
+      return;
+    }
+  }
+}
+// Waiter end
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace concurrent_ring_queue
+} // namespace internal
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentSpscQueue begin
+template <typename T, typename S>
+ConcurrentSpscQueue<T, S>::ConcurrentSpscQueue() noexcept
+    : ConcurrentSpscQueue(1) {}
+
+template <typename T, typename S>
+ConcurrentSpscQueue<T, S>::ConcurrentSpscQueue(size_t min_capacity) noexcept {
+  reserve_and_clear(min_capacity);
+}
+
+template <typename T, typename S>
+inline size_t ConcurrentSpscQueue<T, S>::capacity() const noexcept {
+  return _capacity;
+}
+
+template <typename T, typename S>
+inline size_t ConcurrentSpscQueue<T, S>::size() const noexcept {
+  auto head = _head.load(::std::memory_order_relaxed);
+  auto tail = _tail.load(::std::memory_order_relaxed);
+  return tail > head ? tail - head : 0;
+}
+
+template <typename T, typename S>
+size_t ConcurrentSpscQueue<T, S>::reserve_and_clear(
+    size_t min_capacity) noexcept {
+  auto new_capacity = ::absl::bit_ceil(::std::max<size_t>(min_capacity, 1));
+  if (!_slots || new_capacity != _capacity) {
+    _slots.reset(new T[new_capacity]);
+    _capacity = new_capacity;
+    _mask = new_capacity - 1;
+  }
+  clear();
+  return _capacity;
+}
+
+template <typename T, typename S>
+void ConcurrentSpscQueue<T, S>::clear() noexcept {
+  _head.store(0, ::std::memory_order_relaxed);
+  _cached_tail = 0;
+  _tail.store(0, ::std::memory_order_relaxed);
+  _cached_head = 0;
+}
+
+template <typename T, typename S>
+template <typename U, typename ::std::enable_if<
+                          ::std::is_assignable<T&, U>::value, int>::type>
+inline void ConcurrentSpscQueue<T, S>::push(U&& value) noexcept {
+  push<false, true, true>(::std::forward<U>(value));
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentSpscQueue<T, S>::push(C&& callback) noexcept {
+  push<false, true, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <
+    bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE, typename U,
+    typename ::std::enable_if<::std::is_assignable<T&, U>::value, int>::type>
+inline void ConcurrentSpscQueue<T, S>::push(U&& value) noexcept {
+  push<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](T& target) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        target = ::std::forward<U>(value);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename C, typename>
+inline void ConcurrentSpscQueue<T, S>::push(C&& callback) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentSpscQueue support only one producer");
+  auto tail = _tail.load(::std::memory_order_relaxed);
+  _push_waiter.template wait_until<USE_FUTEX_WAIT>(
+      [&] ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        return free_num(tail, 1) > 0;
+      });
+  callback(_slots[tail & _mask]);
+  _tail.store(tail + 1, ::std::memory_order_release);
+  if (USE_FUTEX_WAKE) {
+    _pop_waiter.wakeup_one();
+  }
+}
+
+template <typename T, typename S>
+template <typename U, typename ::std::enable_if<
+                          ::std::is_assignable<T&, U>::value, int>::type>
+inline bool ConcurrentSpscQueue<T, S>::try_push(U&& value) noexcept {
+  return try_push<false, true>(::std::forward<U>(value));
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline bool ConcurrentSpscQueue<T, S>::try_push(C&& callback) noexcept {
+  return try_push<false, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <
+    bool CONCURRENT, bool USE_FUTEX_WAKE, typename U,
+    typename ::std::enable_if<::std::is_assignable<T&, U>::value, int>::type>
+inline bool ConcurrentSpscQueue<T, S>::try_push(U&& value) noexcept {
+  return try_push<CONCURRENT, USE_FUTEX_WAKE>(
+      [&](T& target) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        target = ::std::forward<U>(value);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline bool ConcurrentSpscQueue<T, S>::try_push(C&& callback) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentSpscQueue support only one producer");
+  auto tail = _tail.load(::std::memory_order_relaxed);
+  if (free_num(tail, 1) == 0) {
+    return false;
+  }
+  callback(_slots[tail & _mask]);
+  _tail.store(tail + 1, ::std::memory_order_release);
+  if (USE_FUTEX_WAKE) {
+    _pop_waiter.wakeup_one();
+  }
+  return true;
+}
+
+template <typename T, typename S>
+template <typename IT>
+inline void ConcurrentSpscQueue<T, S>::push_n(IT begin, IT end) noexcept {
+  push_n<false, true, true>(begin, end);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentSpscQueue<T, S>::push_n(C&& callback,
+                                              size_t num) noexcept {
+  push_n<false, true, true>(::std::forward<C>(callback), num);
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename IT>
+inline void ConcurrentSpscQueue<T, S>::push_n(IT begin, IT end) noexcept {
+  push_n<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](Iterator dest_begin, Iterator dest_end) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        auto num = dest_end - dest_begin;
+        ::std::copy(begin, begin + num, dest_begin);
+        begin += num;
+      },
+      ::std::distance(begin, end));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename C, typename>
+inline void ConcurrentSpscQueue<T, S>::push_n(C&& callback,
+                                              size_t num) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentSpscQueue support only one producer");
+  auto tail = _tail.load(::std::memory_order_relaxed);
+  while (num > 0) {
+    _push_waiter.template wait_until<USE_FUTEX_WAIT>(
+        [&] ABSL_ATTRIBUTE_ALWAYS_INLINE {
+          return free_num(tail, 1) > 0;
+        });
+    auto batch = ::std::min(num, free_num(tail, num));
+    deal_range(callback, tail, batch);
+    tail += batch;
+    _tail.store(tail, ::std::memory_order_release);
+    if (USE_FUTEX_WAKE) {
+      _pop_waiter.wakeup_one();
+    }
+    num -= batch;
+  }
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline size_t ConcurrentSpscQueue<T, S>::try_push_n(C&& callback,
+                                                    size_t num) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentSpscQueue support only one producer");
+  auto tail = _tail.load(::std::memory_order_relaxed);
+  auto batch = ::std::min(num, free_num(tail, num));
+  if (batch == 0) {
+    return 0;
+  }
+  deal_range(callback, tail, batch);
+  _tail.store(tail + batch, ::std::memory_order_release);
+  if (USE_FUTEX_WAKE) {
+    _pop_waiter.wakeup_one();
+  }
+  return batch;
+}
+
+template <typename T, typename S>
+inline void ConcurrentSpscQueue<T, S>::pop(T& value) noexcept {
+  pop<false, true, true>(value);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentSpscQueue<T, S>::pop(C&& callback) noexcept {
+  pop<false, true, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE>
+inline void ConcurrentSpscQueue<T, S>::pop(T& value) noexcept {
+  pop<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](T& source) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        value = ::std::move(source);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename C, typename>
+inline void ConcurrentSpscQueue<T, S>::pop(C&& callback) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentSpscQueue support only one consumer");
+  auto head = _head.load(::std::memory_order_relaxed);
+  _pop_waiter.template wait_until<USE_FUTEX_WAIT>(
+      [&] ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        return ready_num(head, 1) > 0;
+      });
+  callback(_slots[head & _mask]);
+  _head.store(head + 1, ::std::memory_order_release);
+  if (USE_FUTEX_WAKE) {
+    _push_waiter.wakeup_one();
+  }
+}
+
+template <typename T, typename S>
+inline bool ConcurrentSpscQueue<T, S>::try_pop(T& value) noexcept {
+  return try_pop<false, true>(value);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline bool ConcurrentSpscQueue<T, S>::try_pop(C&& callback) noexcept {
+  return try_pop<false, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE>
+inline bool ConcurrentSpscQueue<T, S>::try_pop(T& value) noexcept {
+  return try_pop<CONCURRENT, USE_FUTEX_WAKE>(
+      [&](T& source) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        value = ::std::move(source);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline bool ConcurrentSpscQueue<T, S>::try_pop(C&& callback) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentSpscQueue support only one consumer");
+  auto head = _head.load(::std::memory_order_relaxed);
+  if (ready_num(head, 1) == 0) {
+    return false;
+  }
+  callback(_slots[head & _mask]);
+  _head.store(head + 1, ::std::memory_order_release);
+  if (USE_FUTEX_WAKE) {
+    _push_waiter.wakeup_one();
+  }
+  return true;
+}
+
+template <typename T, typename S>
+template <typename IT>
+inline void ConcurrentSpscQueue<T, S>::pop_n(IT begin, IT end) noexcept {
+  pop_n<false, true, true>(begin, end);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentSpscQueue<T, S>::pop_n(C&& callback,
+                                             size_t num) noexcept {
+  pop_n<false, true, true>(::std::forward<C>(callback), num);
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename IT>
+inline void ConcurrentSpscQueue<T, S>::pop_n(IT begin, IT end) noexcept {
+  pop_n<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](Iterator src_begin, Iterator src_end) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        ::std::move(src_begin, src_end, begin);
+        begin += src_end - src_begin;
+      },
+      ::std::distance(begin, end));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename C, typename>
+inline void ConcurrentSpscQueue<T, S>::pop_n(C&& callback,
+                                             size_t num) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentSpscQueue support only one consumer");
+  auto head = _head.load(::std::memory_order_relaxed);
+  while (num > 0) {
+    _pop_waiter.template wait_until<USE_FUTEX_WAIT>(
+        [&] ABSL_ATTRIBUTE_ALWAYS_INLINE {
+          return ready_num(head, 1) > 0;
+        });
+    auto batch = ::std::min(num, ready_num(head, num));
+    deal_range(callback, head, batch);
+    head += batch;
+    _head.store(head, ::std::memory_order_release);
+    if (USE_FUTEX_WAKE) {
+      _push_waiter.wakeup_one();
+    }
+    num -= batch;
+  }
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline size_t ConcurrentSpscQueue<T, S>::try_pop_n(C&& callback,
+                                                   size_t num) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentSpscQueue support only one consumer");
+  auto head = _head.load(::std::memory_order_relaxed);
+  auto batch = ::std::min(num, ready_num(head, num));
+  if (batch == 0) {
+    return 0;
+  }
+  deal_range(callback, head, batch);
+  _head.store(head + batch, ::std::memory_order_release);
+  if (USE_FUTEX_WAKE) {
+    _push_waiter.wakeup_one();
+  }
+  return batch;
+}
+
+template <typename T, typename S>
+inline size_t ConcurrentSpscQueue<T, S>::free_num(size_t tail,
+                                                  size_t expected) noexcept {
+  auto free = _capacity - (tail - _cached_head);
+  if (free < expected) {
+    _cached_head = _head.load(::std::memory_order_acquire);
+    free = _capacity - (tail - _cached_head);
+  }
+  return free;
+}
+
+template <typename T, typename S>
+inline size_t ConcurrentSpscQueue<T, S>::ready_num(size_t head,
+                                                   size_t expected) noexcept {
+  auto ready = _cached_tail - head;
+  if (ready < expected) {
+    _cached_tail = _tail.load(::std::memory_order_acquire);
+    ready = _cached_tail - head;
+  }
+  return ready;
+}
+
+template <typename T, typename S>
+template <typename C>
+inline void ConcurrentSpscQueue<T, S>::deal_range(C& callback, size_t index,
+                                                  size_t num) noexcept {
+  auto offset = index & _mask;
+  auto first_num = ::std::min(num, _capacity - offset);
+  auto slots = _slots.get();
+  callback(slots + offset, slots + offset + first_num);
+  if (first_num < num) {
+    callback(slots, slots + num - first_num);
+  }
+}
+// ConcurrentSpscQueue end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentMpscQueue::Iterator begin
+template <typename T, typename S>
+inline ConcurrentMpscQueue<T, S>::Iterator::Iterator(Slot* slot) noexcept
+    : _slot(slot) {}
+
+template <typename T, typename S>
+inline typename ConcurrentMpscQueue<T, S>::Iterator&
+ConcurrentMpscQueue<T, S>::Iterator::operator++() noexcept {
+  ++_slot;
+  return *this;
+}
+
+template <typename T, typename S>
+inline typename ConcurrentMpscQueue<T, S>::Iterator
+ConcurrentMpscQueue<T, S>::Iterator::operator++(int) noexcept {
+  Iterator ret = *this;
+  ++(*this);
+  return ret;
+}
+
+template <typename T, typename S>
+inline typename ConcurrentMpscQueue<T, S>::Iterator
+ConcurrentMpscQueue<T, S>::Iterator::operator+(
+    ssize_t offset) const noexcept {
+  return Iterator(_slot + offset);
+}
+
+template <typename T, typename S>
+inline typename ConcurrentMpscQueue<T, S>::Iterator
+ConcurrentMpscQueue<T, S>::Iterator::operator-(
+    ssize_t offset) const noexcept {
+  return Iterator(_slot - offset);
+}
+
+template <typename T, typename S>
+inline bool ConcurrentMpscQueue<T, S>::Iterator::operator==(
+    Iterator other) const noexcept {
+  return _slot == other._slot;
+}
+
+template <typename T, typename S>
+inline bool ConcurrentMpscQueue<T, S>::Iterator::operator!=(
+    Iterator other) const noexcept {
+  return !(*this == other);
+}
+
+template <typename T, typename S>
+inline bool ConcurrentMpscQueue<T, S>::Iterator::operator<(
+    Iterator other) const noexcept {
+  return _slot < other._slot;
+}
+
+template <typename T, typename S>
+inline bool ConcurrentMpscQueue<T, S>::Iterator::operator<=(
+    Iterator other) const noexcept {
+  return _slot <= other._slot;
+}
+
+template <typename T, typename S>
+inline bool ConcurrentMpscQueue<T, S>::Iterator::operator>(
+    Iterator other) const noexcept {
+  return _slot > other._slot;
+}
+
+template <typename T, typename S>
+inline bool ConcurrentMpscQueue<T, S>::Iterator::operator>=(
+    Iterator other) const noexcept {
+  return _slot >= other._slot;
+}
+
+template <typename T, typename S>
+inline T& ConcurrentMpscQueue<T, S>::Iterator::operator*()
+    const noexcept {
+  return _slot->value;
+}
+
+template <typename T, typename S>
+inline T* ConcurrentMpscQueue<T, S>::Iterator::operator->()
+    const noexcept {
+  return &_slot->value;
+}
+
+template <typename T, typename S>
+inline ssize_t ConcurrentMpscQueue<T, S>::Iterator::operator-(
+    Iterator other) const noexcept {
+  return _slot - other._slot;
+}
+// ConcurrentMpscQueue::Iterator end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentMpscQueue begin
+template <typename T, typename S>
+ConcurrentMpscQueue<T, S>::ConcurrentMpscQueue() noexcept
+    : ConcurrentMpscQueue(1) {}
+
+template <typename T, typename S>
+ConcurrentMpscQueue<T, S>::ConcurrentMpscQueue(size_t min_capacity) noexcept {
+  reserve_and_clear(min_capacity);
+}
+
+template <typename T, typename S>
+inline size_t ConcurrentMpscQueue<T, S>::capacity() const noexcept {
+  return _capacity;
+}
+
+template <typename T, typename S>
+inline size_t ConcurrentMpscQueue<T, S>::size() const noexcept {
+  auto head = _head.load(::std::memory_order_relaxed);
+  auto tail = _tail.load(::std::memory_order_relaxed);
+  return tail > head ? tail - head : 0;
+}
+
+template <typename T, typename S>
+size_t ConcurrentMpscQueue<T, S>::reserve_and_clear(
+    size_t min_capacity) noexcept {
+  auto new_capacity = ::absl::bit_ceil(::std::max<size_t>(min_capacity, 1));
+  if (!_slots || new_capacity != _capacity) {
+    _slots.reset(new Slot[new_capacity]);
+    _capacity = new_capacity;
+    _mask = new_capacity - 1;
+  }
+  clear();
+  return _capacity;
+}
+
+template <typename T, typename S>
+void ConcurrentMpscQueue<T, S>::clear() noexcept {
+  for (size_t i = 0; i < _capacity; ++i) {
+    _slots[i].sequence.store(i, ::std::memory_order_relaxed);
+  }
+  _head.store(0, ::std::memory_order_relaxed);
+  _tail.store(0, ::std::memory_order_relaxed);
+}
+
+template <typename T, typename S>
+template <typename U, typename ::std::enable_if<
+                          ::std::is_assignable<T&, U>::value, int>::type>
+inline void ConcurrentMpscQueue<T, S>::push(U&& value) noexcept {
+  push<true, true, true>(::std::forward<U>(value));
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentMpscQueue<T, S>::push(C&& callback) noexcept {
+  push<true, true, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <
+    bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE, typename U,
+    typename ::std::enable_if<::std::is_assignable<T&, U>::value, int>::type>
+inline void ConcurrentMpscQueue<T, S>::push(U&& value) noexcept {
+  push<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](T& target) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        target = ::std::forward<U>(value);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename C, typename>
+inline void ConcurrentMpscQueue<T, S>::push(C&& callback) noexcept {
+  push_n<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](Iterator iter, Iterator) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        callback(*iter);
+      },
+      1);
+}
+
+template <typename T, typename S>
+template <typename U, typename ::std::enable_if<
+                          ::std::is_assignable<T&, U>::value, int>::type>
+inline bool ConcurrentMpscQueue<T, S>::try_push(U&& value) noexcept {
+  return try_push<true, true>(::std::forward<U>(value));
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline bool ConcurrentMpscQueue<T, S>::try_push(C&& callback) noexcept {
+  return try_push<true, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <
+    bool CONCURRENT, bool USE_FUTEX_WAKE, typename U,
+    typename ::std::enable_if<::std::is_assignable<T&, U>::value, int>::type>
+inline bool ConcurrentMpscQueue<T, S>::try_push(U&& value) noexcept {
+  return try_push<CONCURRENT, USE_FUTEX_WAKE>(
+      [&](T& target) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        target = ::std::forward<U>(value);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline bool ConcurrentMpscQueue<T, S>::try_push(C&& callback) noexcept {
+  return 1 == try_push_n<CONCURRENT, USE_FUTEX_WAKE>(
+                  [&](Iterator iter, Iterator) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+                    callback(*iter);
+                  },
+                  1);
+}
+
+template <typename T, typename S>
+template <typename IT>
+inline void ConcurrentMpscQueue<T, S>::push_n(IT begin, IT end) noexcept {
+  push_n<true, true, true>(begin, end);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentMpscQueue<T, S>::push_n(C&& callback,
+                                              size_t num) noexcept {
+  push_n<true, true, true>(::std::forward<C>(callback), num);
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename IT>
+inline void ConcurrentMpscQueue<T, S>::push_n(IT begin, IT end) noexcept {
+  push_n<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](Iterator dest_begin, Iterator dest_end) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        auto num = dest_end - dest_begin;
+        ::std::copy(begin, begin + num, dest_begin);
+        begin += num;
+      },
+      ::std::distance(begin, end));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename C, typename>
+inline void ConcurrentMpscQueue<T, S>::push_n(C&& callback,
+                                              size_t num) noexcept {
+  size_t index;
+  if (CONCURRENT) {
+    index = _tail.fetch_add(num, ::std::memory_order_relaxed);
+  } else {
+    index = _tail.load(::std::memory_order_relaxed);
+    _tail.store(index + num, ::std::memory_order_relaxed);
+  }
+  auto end_index = index + num;
+  while (index < end_index) {
+    // Slots from one round of ring at a time, publish them before wait for
+    // next round
+    auto offset = index & _mask;
+    auto batch = ::std::min(end_index - index, _capacity - offset);
+    auto slots = &_slots[offset];
+    for (size_t i = 0; i < batch; ++i) {
+      auto& sequence = slots[i].sequence;
+      auto expected = index + i;
+      _push_waiter.template wait_until<USE_FUTEX_WAIT>(
+          [&] ABSL_ATTRIBUTE_ALWAYS_INLINE {
+            return sequence.load(::std::memory_order_acquire) == expected;
+          });
+    }
+    callback(Iterator {slots}, Iterator {slots + batch});
+    publish<USE_FUTEX_WAKE>(index, batch);
+    index += batch;
+  }
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline size_t ConcurrentMpscQueue<T, S>::try_push_n(C&& callback,
+                                                    size_t num) noexcept {
+  size_t pushed = 0;
+  while (pushed < num) {
+    auto batch = try_push_continuously<CONCURRENT, USE_FUTEX_WAKE>(
+        callback, num - pushed);
+    if (batch == 0) {
+      break;
+    }
+    pushed += batch;
+  }
+  return pushed;
+}
+
+template <typename T, typename S>
+inline void ConcurrentMpscQueue<T, S>::pop(T& value) noexcept {
+  pop<false, true, true>(value);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentMpscQueue<T, S>::pop(C&& callback) noexcept {
+  pop<false, true, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE>
+inline void ConcurrentMpscQueue<T, S>::pop(T& value) noexcept {
+  pop<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](T& source) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        value = ::std::move(source);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename C, typename>
+inline void ConcurrentMpscQueue<T, S>::pop(C&& callback) noexcept {
+  pop_n<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](Iterator iter, Iterator) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        callback(*iter);
+      },
+      1);
+}
+
+template <typename T, typename S>
+inline bool ConcurrentMpscQueue<T, S>::try_pop(T& value) noexcept {
+  return try_pop<false, true>(value);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline bool ConcurrentMpscQueue<T, S>::try_pop(C&& callback) noexcept {
+  return try_pop<false, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE>
+inline bool ConcurrentMpscQueue<T, S>::try_pop(T& value) noexcept {
+  return try_pop<CONCURRENT, USE_FUTEX_WAKE>(
+      [&](T& source) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        value = ::std::move(source);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline bool ConcurrentMpscQueue<T, S>::try_pop(C&& callback) noexcept {
+  return 1 == try_pop_n<CONCURRENT, USE_FUTEX_WAKE>(
+                  [&](Iterator iter, Iterator) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+                    callback(*iter);
+                  },
+                  1);
+}
+
+template <typename T, typename S>
+template <typename IT>
+inline void ConcurrentMpscQueue<T, S>::pop_n(IT begin, IT end) noexcept {
+  pop_n<false, true, true>(begin, end);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentMpscQueue<T, S>::pop_n(C&& callback,
+                                             size_t num) noexcept {
+  pop_n<false, true, true>(::std::forward<C>(callback), num);
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename IT>
+inline void ConcurrentMpscQueue<T, S>::pop_n(IT begin, IT end) noexcept {
+  pop_n<CONCURRENT, USE_FUTEX_WAIT, USE_FUTEX_WAKE>(
+      [&](Iterator src_begin, Iterator src_end) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        ::std::move(src_begin, src_end, begin);
+        begin += src_end - src_begin;
+      },
+      ::std::distance(begin, end));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, bool USE_FUTEX_WAKE,
+          typename C, typename>
+inline void ConcurrentMpscQueue<T, S>::pop_n(C&& callback,
+                                             size_t num) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentMpscQueue support only one consumer");
+  auto index = _head.load(::std::memory_order_relaxed);
+  auto end_index = index + num;
+  while (index < end_index) {
+    auto offset = index & _mask;
+    auto batch = ::std::min(end_index - index, _capacity - offset);
+    auto slots = &_slots[offset];
+    for (size_t i = 0; i < batch; ++i) {
+      auto& sequence = slots[i].sequence;
+      auto expected = index + i + 1;
+      _pop_waiter.template wait_until<USE_FUTEX_WAIT>(
+          [&] ABSL_ATTRIBUTE_ALWAYS_INLINE {
+            return sequence.load(::std::memory_order_acquire) == expected;
+          });
+    }
+    callback(Iterator {slots}, Iterator {slots + batch});
+    release<USE_FUTEX_WAKE>(index, batch);
+    index += batch;
+  }
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline size_t ConcurrentMpscQueue<T, S>::try_pop_n(C&& callback,
+                                                   size_t num) noexcept {
+  static_assert(!CONCURRENT, "ConcurrentMpscQueue support only one consumer");
+  size_t popped = 0;
+  while (popped < num) {
+    auto batch =
+        try_pop_continuously<USE_FUTEX_WAKE>(callback, num - popped);
+    if (batch == 0) {
+      break;
+    }
+    popped += batch;
+  }
+  return popped;
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C>
+inline size_t ConcurrentMpscQueue<T, S>::try_push_continuously(
+    C& callback, size_t num) noexcept {
+  auto index = _tail.load(::std::memory_order_relaxed);
+  size_t batch = 0;
+  while (true) {
+    auto offset = index & _mask;
+    auto max_batch = ::std::min(num, _capacity - offset);
+    batch = 0;
+    while (batch < max_batch &&
+           _slots[offset + batch].sequence.load(::std::memory_order_acquire) ==
+               index + batch) {
+      ++batch;
+    }
+    if (batch == 0) {
+      // Slot not free may be caused by stale index, retry on new one
+      auto current_index = _tail.load(::std::memory_order_relaxed);
+      if (CONCURRENT && current_index != index) {
+        index = current_index;
+        continue;
+      }
+      return 0;
+    }
+    if (!CONCURRENT) {
+      _tail.store(index + batch, ::std::memory_order_relaxed);
+      break;
+    }
+    if (_tail.compare_exchange_weak(index, index + batch,
+                                    ::std::memory_order_relaxed)) {
+      break;
+    }
+  }
+  auto slots = &_slots[index & _mask];
+  callback(Iterator {slots}, Iterator {slots + batch});
+  publish<USE_FUTEX_WAKE>(index, batch);
+  return batch;
+}
+
+template <typename T, typename S>
+template <bool USE_FUTEX_WAKE, typename C>
+inline size_t ConcurrentMpscQueue<T, S>::try_pop_continuously(
+    C& callback, size_t num) noexcept {
+  auto index = _head.load(::std::memory_order_relaxed);
+  auto offset = index & _mask;
+  auto max_batch = ::std::min(num, _capacity - offset);
+  size_t batch = 0;
+  while (batch < max_batch &&
+         _slots[offset + batch].sequence.load(::std::memory_order_acquire) ==
+             index + batch + 1) {
+    ++batch;
+  }
+  if (batch == 0) {
+    return 0;
+  }
+  auto slots = &_slots[offset];
+  callback(Iterator {slots}, Iterator {slots + batch});
+  release<USE_FUTEX_WAKE>(index, batch);
+  return batch;
+}
+
+template <typename T, typename S>
+template <bool USE_FUTEX_WAKE>
+inline void ConcurrentMpscQueue<T, S>::publish(size_t index,
+                                               size_t num) noexcept {
+  auto slots = &_slots[index & _mask];
+  for (size_t i = 0; i < num; ++i) {
+    slots[i].sequence.store(index + i + 1, ::std::memory_order_release);
+  }
+  if (USE_FUTEX_WAKE) {
+    _pop_waiter.wakeup_one();
+  }
+}
+
+template <typename T, typename S>
+template <bool USE_FUTEX_WAKE>
+inline void ConcurrentMpscQueue<T, S>::release(size_t index,
+                                               size_t num) noexcept {
+  auto slots = &_slots[index & _mask];
+  for (size_t i = 0; i < num; ++i) {
+    slots[i].sequence.store(index + i + _capacity,
+                            ::std::memory_order_release);
+  }
+  _head.store(index + num, ::std::memory_order_relaxed);
+  // Several producers may wait on different slots
+  if (USE_FUTEX_WAKE) {
+    _push_waiter.wakeup_all();
+  }
+}
+// ConcurrentMpscQueue end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "babylon/concurrent/counter.h"           // ConcurrentAdder
+#include "babylon/concurrent/garbage_collector.h" // GarbageCollector
+#include "babylon/concurrent/thread_local.h"      // EnumerableThreadLocal
+#include "babylon/environment.h"
+#include "babylon/reusable/memory_resource.h" // std::pmr::memory_resource
+
+#include <atomic>     // std::atomic
+#include <functional> // std::less
+#include <iterator>   // std::forward_iterator_tag
+#include <utility>    // std::pair
+
+BABYLON_NAMESPACE_BEGIN
+
+// Lock-free ordered map based on skiplist, for range lookups like features
+// bucketed by time, or prefix scans over string keys.
+//
+// Insert, erase and lookup are all lock-free, following the marked pointer
+// algorithm described in The Art of Multiprocessor Programming, chapter 14.
+// A node is first linked at level 0 and becomes visible, then its tower is
+// built bottom-up. Erase marks the tower top-down and the node is logically
+// removed once level 0 is marked. Marked nodes are unlinked by the traversal
+// passing by, and retired to an internal GarbageCollector when both its tower
+// building and erase are finished, so it is unreachable from any level.
+//
+// All accesses run inside an Epoch critical region, entered through a per
+// thread Epoch::Accessor for point operations, or a dedicated one owned by
+// Range for iteration. A Range can be held for a long time and even passed
+// between threads, nodes reachable from it keep valid until it is destroyed.
+// But a long living Range also delay all reclamation, and erase will finally
+// block when gc queue is full, so never erase while holding a Range in the
+// same thread.
+//
+// Node memory is allocated from a std::pmr::memory_resource, default is
+// new_delete_resource. Use a SwissMemoryResource for insert mostly usage, in
+// which case memory of erased node is only released together with resource.
+template <typename K, typename V, typename C = ::std::less<K>>
+class ConcurrentSkipListMap {
+ private:
+  struct Node;
+  class Reclaimer;
+
+  using Link = ::std::atomic<uintptr_t>;
+
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = ::std::pair<const K, V>;
+  using key_compare = C;
+
+  class Range;
+
+  // Forward iterator on level 0, skip nodes erased before reaching them.
+  // Only valid inside the Range it comes from.
+  class Iterator {
+   public:
+    using difference_type = ssize_t;
+    using value_type = ConcurrentSkipListMap::value_type;
+    using pointer = value_type*;
+    using reference = value_type&;
+    using iterator_category = ::std::forward_iterator_tag;
+
+    inline Iterator() noexcept = default;
+    inline Iterator& operator++() noexcept;
+    inline Iterator operator++(int) noexcept;
+    inline bool operator==(Iterator other) const noexcept;
+    inline bool operator!=(Iterator other) const noexcept;
+    inline value_type& operator*() const noexcept;
+    inline value_type* operator->() const noexcept;
+
+   private:
+    inline explicit Iterator(Node* node) noexcept;
+
+    Node* _node {nullptr};
+
+    friend ConcurrentSkipListMap;
+    friend Range;
+  };
+
+  // Critical region pinning all nodes reachable during its lifetime. Movable,
+  // and iterators got from it keep valid after move.
+  class Range {
+   public:
+    inline Range() noexcept = default;
+    inline Range(Range&&) noexcept;
+    Range(const Range&) = delete;
+    inline Range& operator=(Range&&) noexcept;
+    Range& operator=(const Range&) = delete;
+    inline ~Range() noexcept;
+
+    inline Iterator begin() const noexcept;
+    inline Iterator end() const noexcept;
+
+   private:
+    inline Range(Epoch::Accessor&& accessor) noexcept;
+
+    Epoch::Accessor _accessor;
+    Node* _first {nullptr};
+
+    friend ConcurrentSkipListMap;
+  };
+
+  ConcurrentSkipListMap(ConcurrentSkipListMap&&) = delete;
+  ConcurrentSkipListMap(const ConcurrentSkipListMap&) = delete;
+  ConcurrentSkipListMap& operator=(ConcurrentSkipListMap&&) = delete;
+  ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap&) = delete;
+  ~ConcurrentSkipListMap() noexcept;
+
+  ConcurrentSkipListMap() noexcept;
+  explicit ConcurrentSkipListMap(
+      ::std::pmr::memory_resource& memory_resource) noexcept;
+
+  // Number of entries currently in map, O(threads)
+  inline size_t size() const noexcept;
+
+  // [Lock-free] Insert value constructed by V(args...) when key not exist.
+  // return: whether key is newly inserted
+  template <typename KK, typename... Args>
+  bool emplace(KK&& key, Args&&... args) noexcept;
+
+  // [Lock-free] Remove key from map. Node is reclaimed after all concurrent
+  // readers leave.
+  // return: whether key is removed by this call
+  bool erase(const K& key) noexcept;
+
+  // [Lock-free] Find key and call callback(V& value) when found. Value is
+  // kept valid during callback, even if erased concurrently. Concurrent
+  // modification to value itself need to be synchronized by user.
+  // return: whether key is found
+  template <typename CB>
+  inline bool find(const K& key, CB&& callback) noexcept;
+  inline bool contains(const K& key) noexcept;
+
+  // [Lock-free] Iterate all entries, or entries from first key not less than
+  // lower, in order. Entries inserted or erased concurrently may or may not
+  // be visited, but every visited entry is valid until range destroyed.
+  Range range() noexcept;
+  Range range(const K& lower) noexcept;
+
+  // [Lock-free] Call callback(const K& key, V& value) for keys in
+  // [lower, upper) in order.
+  // return: number of entries visited
+  template <typename CB>
+  size_t scan(const K& lower, const K& upper, CB&& callback) noexcept;
+
+ private:
+  // P = 1/4, enough for 4^16 entries
+  constexpr static size_t MAX_HEIGHT = 16;
+  // Bits in Node::state, node is retired by the one finish last
+  constexpr static uint8_t TOWER_DONE = 1;
+  constexpr static uint8_t ERASED = 2;
+
+  inline static Node* unmark(uintptr_t link) noexcept;
+  inline static bool is_marked(uintptr_t link) noexcept;
+  // First node not erased at level 0, start from the one link point to
+  inline static Node* skip_erased(uintptr_t link) noexcept;
+  inline static size_t random_height() noexcept;
+
+  template <typename KK, typename... Args>
+  Node* create_node(size_t height, KK&& key, Args&&... args) noexcept;
+  void destroy_node(Node* node) noexcept;
+
+  inline Epoch::Accessor& local_accessor() noexcept;
+
+  // Read only search, return first live node with key not less than key
+  inline Node* lower_bound(const K& key) const noexcept;
+  // Search with unlinking marked nodes passed by. Fill preds and succs of
+  // every level and return whether succs[0] is a live node with equal key.
+  bool find_position(const K& key, Link** preds, Node** succs) noexcept;
+  // Unlink all marked nodes with equal key from every level. Called after
+  // node is fully marked and its tower building finished, so it can not be
+  // reachable from any level anymore after return.
+  void unlink(const K& key) noexcept;
+  // One pass of above two. Fail when a predecessor is found marked or
+  // changed during unlinking, and need to restart from head.
+  bool try_find_position(const K& key, Link** preds, Node** succs) noexcept;
+  bool try_unlink(const K& key) noexcept;
+  // Link node at upper levels after it is linked at level 0. Stop when node
+  // is erased concurrently.
+  void build_tower(Node* node, Link** preds, Node** succs) noexcept;
+  // Finish one side of node and unlink it when the other side already
+  // finished. return: node to retire after leaving critical region
+  Node* finish(Node* node, uint8_t side) noexcept;
+
+  C _compare;
+  ::std::pmr::memory_resource* _memory_resource;
+  Link _head[MAX_HEIGHT];
+  ConcurrentAdder _size;
+
+  GarbageCollector<Reclaimer> _garbage_collector;
+  // Destroyed before garbage collector, which own the epoch
+  EnumerableThreadLocal<Epoch::Accessor> _accessors;
+};
+
+BABYLON_NAMESPACE_END
+
+#include "babylon/concurrent/skip_list.hpp"
@@ -0,0 +1,557 @@
+#pragma once
+
+#include "babylon/absl_numeric_bits.h" // absl::countr_zero
+#include "babylon/concurrent/skip_list.h"
+
+#include <mutex> // std::lock_guard
+#include <tuple> // std::forward_as_tuple
+
+BABYLON_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentSkipListMap::Node begin
+// Variable length node, tower of height links follows the node itself. The
+// lowest bit of a link marks this node as erased at that level, and the link
+// is frozen once marked.
+template <typename K, typename V, typename C>
+struct ConcurrentSkipListMap<K, V, C>::Node {
+  template <typename KK, typename... Args>
+  Node(size_t height, KK&& key, Args&&... args) noexcept
+      : value {::std::piecewise_construct,
+               ::std::forward_as_tuple(::std::forward<KK>(key)),
+               ::std::forward_as_tuple(::std::forward<Args>(args)...)},
+        height {static_cast<uint8_t>(height)} {
+    for (size_t i = 0; i < height; ++i) {
+      new (&next[i]) Link {0};
+    }
+  }
+
+  inline const K& key() const noexcept {
+    return value.first;
+  }
+
+  value_type value;
+  uint8_t height;
+  ::std::atomic<uint8_t> state {0};
+  Link next[0];
+};
+// ConcurrentSkipListMap::Node end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentSkipListMap::Reclaimer begin
+// Destroy an unlinked node. Task not reclaimed yet when garbage collector stop
+// is released instead.
+template <typename K, typename V, typename C>
+class ConcurrentSkipListMap<K, V, C>::Reclaimer {
+ public:
+  Reclaimer() noexcept = default;
+  Reclaimer(Reclaimer&& other) noexcept {
+    *this = ::std::move(other);
+  }
+  Reclaimer(const Reclaimer&) = delete;
+  Reclaimer& operator=(Reclaimer&& other) noexcept {
+    ::std::swap(_map, other._map);
+    ::std::swap(_node, other._node);
+    return *this;
+  }
+  Reclaimer& operator=(const Reclaimer&) = delete;
+  ~Reclaimer() noexcept {
+    (*this)();
+  }
+
+  Reclaimer(ConcurrentSkipListMap* map, Node* node) noexcept
+      : _map {map}, _node {node} {}
+
+  void operator()() noexcept {
+    if (_node != nullptr) {
+      _map->destroy_node(_node);
+      _node = nullptr;
+    }
+  }
+
+ private:
+  ConcurrentSkipListMap* _map {nullptr};
+  Node* _node {nullptr};
+};
+// ConcurrentSkipListMap::Reclaimer end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentSkipListMap::Iterator begin
+template <typename K, typename V, typename C>
+inline ConcurrentSkipListMap<K, V, C>::Iterator::Iterator(Node* node) noexcept
+    : _node {node} {}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::Iterator&
+ConcurrentSkipListMap<K, V, C>::Iterator::operator++() noexcept {
+  _node = skip_erased(_node->next[0].load(::std::memory_order_acquire));
+  return *this;
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::Iterator
+ConcurrentSkipListMap<K, V, C>::Iterator::operator++(int) noexcept {
+  auto result = *this;
+  ++*this;
+  return result;
+}
+
+template <typename K, typename V, typename C>
+inline bool ConcurrentSkipListMap<K, V, C>::Iterator::operator==(
+    Iterator other) const noexcept {
+  return _node == other._node;
+}
+
+template <typename K, typename V, typename C>
+inline bool ConcurrentSkipListMap<K, V, C>::Iterator::operator!=(
+    Iterator other) const noexcept {
+  return _node != other._node;
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::value_type&
+ConcurrentSkipListMap<K, V, C>::Iterator::operator*() const noexcept {
+  return _node->value;
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::value_type*
+ConcurrentSkipListMap<K, V, C>::Iterator::operator->() const noexcept {
+  return &_node->value;
+}
+// ConcurrentSkipListMap::Iterator end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentSkipListMap::Range begin
+template <typename K, typename V, typename C>
+inline ConcurrentSkipListMap<K, V, C>::Range::Range(Range&& other) noexcept {
+  *this = ::std::move(other);
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::Range&
+ConcurrentSkipListMap<K, V, C>::Range::operator=(Range&& other) noexcept {
+  ::std::swap(_accessor, other._accessor);
+  ::std::swap(_first, other._first);
+  return *this;
+}
+
+template <typename K, typename V, typename C>
+inline ConcurrentSkipListMap<K, V, C>::Range::~Range() noexcept {
+  if (_accessor) {
+    _accessor.unlock();
+  }
+}
+
+template <typename K, typename V, typename C>
+inline ConcurrentSkipListMap<K, V, C>::Range::Range(
+    Epoch::Accessor&& accessor) noexcept
+    : _accessor {::std::move(accessor)} {
+  _accessor.lock();
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::Iterator
+ConcurrentSkipListMap<K, V, C>::Range::begin() const noexcept {
+  return Iterator {_first};
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::Iterator
+ConcurrentSkipListMap<K, V, C>::Range::end() const noexcept {
+  return Iterator {};
+}
+// ConcurrentSkipListMap::Range end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentSkipListMap begin
+template <typename K, typename V, typename C>
+ConcurrentSkipListMap<K, V, C>::ConcurrentSkipListMap() noexcept
+    : ConcurrentSkipListMap {*::std::pmr::new_delete_resource()} {}
+
+template <typename K, typename V, typename C>
+ConcurrentSkipListMap<K, V, C>::ConcurrentSkipListMap(
+    ::std::pmr::memory_resource& memory_resource) noexcept
+    : _memory_resource {&memory_resource} {
+  for (auto& link : _head) {
+    link.store(0, ::std::memory_order_relaxed);
+  }
+  _garbage_collector.set_queue_capacity(1024);
+  _garbage_collector.start();
+}
+
+template <typename K, typename V, typename C>
+ConcurrentSkipListMap<K, V, C>::~ConcurrentSkipListMap() noexcept {
+  _garbage_collector.stop();
+  // Every node still linked at level 0 is live, since erased nodes are only
+  // retired after unlinked from all levels
+  auto node = unmark(_head[0].load(::std::memory_order_relaxed));
+  while (node != nullptr) {
+    auto next = unmark(node->next[0].load(::std::memory_order_relaxed));
+    destroy_node(node);
+    node = next;
+  }
+}
+
+template <typename K, typename V, typename C>
+inline size_t ConcurrentSkipListMap<K, V, C>::size() const noexcept {
+  return static_cast<size_t>(_size.value());
+}
+
+template <typename K, typename V, typename C>
+template <typename KK, typename... Args>
+ABSL_ATTRIBUTE_NOINLINE bool ConcurrentSkipListMap<K, V, C>::emplace(
+    KK&& key, Args&&... args) noexcept {
+  Node* retired_node = nullptr;
+  {
+    ::std::lock_guard<Epoch::Accessor> lock {local_accessor()};
+    Link* preds[MAX_HEIGHT];
+    Node* succs[MAX_HEIGHT];
+    if (find_position(key, preds, succs)) {
+      return false;
+    }
+
+    auto height = random_height();
+    auto node = create_node(height, ::std::forward<KK>(key),
+                            ::std::forward<Args>(args)...);
+    auto& node_key = node->key();
+    // Link level 0 to make node visible, node is not published until success
+    while (true) {
+      for (size_t level = 0; level < height; ++level) {
+        node->next[level].store(reinterpret_cast<uintptr_t>(succs[level]),
+                                ::std::memory_order_relaxed);
+      }
+      auto expected = reinterpret_cast<uintptr_t>(succs[0]);
+      if (preds[0][0].compare_exchange_strong(
+              expected, reinterpret_cast<uintptr_t>(node),
+              ::std::memory_order_acq_rel, ::std::memory_order_relaxed)) {
+        break;
+      }
+      if (find_position(node_key, preds, succs)) {
+        destroy_node(node);
+        return false;
+      }
+    }
+    _size << 1;
+    build_tower(node, preds, succs);
+    retired_node = finish(node, TOWER_DONE);
+  }
+  // Retire outside of critical region, since it may block when gc queue is
+  // full and wait for reclaim of this region
+  if (retired_node != nullptr) {
+    _garbage_collector.retire(Reclaimer {this, retired_node});
+  }
+  return true;
+}
+
+template <typename K, typename V, typename C>
+ABSL_ATTRIBUTE_NOINLINE bool ConcurrentSkipListMap<K, V, C>::erase(
+    const K& key) noexcept {
+  Node* retired_node = nullptr;
+  {
+    ::std::lock_guard<Epoch::Accessor> lock {local_accessor()};
+    auto node = lower_bound(key);
+    if (node == nullptr || _compare(key, node->key())) {
+      return false;
+    }
+    // Mark tower top-down, concurrent tower building stop at marked level
+    for (size_t level = node->height; level-- > 1;) {
+      auto link = node->next[level].load(::std::memory_order_relaxed);
+      while (!is_marked(link) &&
+             !node->next[level].compare_exchange_weak(
+                 link, link | 1, ::std::memory_order_acq_rel,
+                 ::std::memory_order_relaxed)) {
+      }
+    }
+    // Only one of concurrent erase win at level 0
+    auto link = node->next[0].load(::std::memory_order_relaxed);
+    while (true) {
+      if (is_marked(link)) {
+        return false;
+      }
+      if (node->next[0].compare_exchange_weak(link, link | 1,
+                                              ::std::memory_order_acq_rel,
+                                              ::std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    _size << -1;
+    retired_node = finish(node, ERASED);
+  }
+  if (retired_node != nullptr) {
+    _garbage_collector.retire(Reclaimer {this, retired_node});
+  }
+  return true;
+}
+
+template <typename K, typename V, typename C>
+template <typename CB>
+inline bool ConcurrentSkipListMap<K, V, C>::find(const K& key,
+                                                 CB&& callback) noexcept {
+  ::std::lock_guard<Epoch::Accessor> lock {local_accessor()};
+  auto node = lower_bound(key);
+  if (node == nullptr || _compare(key, node->key())) {
+    return false;
+  }
+  callback(node->value.second);
+  return true;
+}
+
+template <typename K, typename V, typename C>
+inline bool ConcurrentSkipListMap<K, V, C>::contains(const K& key) noexcept {
+  return find(key, [](V&) {});
+}
+
+template <typename K, typename V, typename C>
+ABSL_ATTRIBUTE_NOINLINE typename ConcurrentSkipListMap<K, V, C>::Range
+ConcurrentSkipListMap<K, V, C>::range() noexcept {
+  Range range {_garbage_collector.epoch().create_accessor()};
+  range._first = skip_erased(_head[0].load(::std::memory_order_acquire));
+  return range;
+}
+
+template <typename K, typename V, typename C>
+ABSL_ATTRIBUTE_NOINLINE typename ConcurrentSkipListMap<K, V, C>::Range
+ConcurrentSkipListMap<K, V, C>::range(const K& lower) noexcept {
+  Range range {_garbage_collector.epoch().create_accessor()};
+  range._first = lower_bound(lower);
+  return range;
+}
+
+template <typename K, typename V, typename C>
+template <typename CB>
+ABSL_ATTRIBUTE_NOINLINE size_t ConcurrentSkipListMap<K, V, C>::scan(
+    const K& lower, const K& upper, CB&& callback) noexcept {
+  ::std::lock_guard<Epoch::Accessor> lock {local_accessor()};
+  size_t visited = 0;
+  for (Iterator iter {lower_bound(lower)}, end; iter != end; ++iter) {
+    if (!_compare(iter->first, upper)) {
+      break;
+    }
+    callback(static_cast<const K&>(iter->first), iter->second);
+    visited++;
+  }
+  return visited;
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::Node*
+ConcurrentSkipListMap<K, V, C>::unmark(uintptr_t link) noexcept {
+  return reinterpret_cast<Node*>(link & ~static_cast<uintptr_t>(1));
+}
+
+template <typename K, typename V, typename C>
+inline bool ConcurrentSkipListMap<K, V, C>::is_marked(uintptr_t link) noexcept {
+  return link & 1;
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::Node*
+ConcurrentSkipListMap<K, V, C>::skip_erased(uintptr_t link) noexcept {
+  auto node = unmark(link);
+  while (node != nullptr) {
+    link = node->next[0].load(::std::memory_order_acquire);
+    if (!is_marked(link)) {
+      break;
+    }
+    node = unmark(link);
+  }
+  return node;
+}
+
+template <typename K, typename V, typename C>
+inline size_t ConcurrentSkipListMap<K, V, C>::random_height() noexcept {
+  thread_local uint64_t seed = reinterpret_cast<uintptr_t>(&seed) | 1;
+  seed ^= seed << 13;
+  seed ^= seed >> 7;
+  seed ^= seed << 17;
+  // Every 2 trailing zero bits add a level, so P = 1/4
+  auto height = (::absl::countr_zero(seed | (1UL << 63)) >> 1) + 1;
+  return ::std::min<size_t>(height, MAX_HEIGHT);
+}
+
+template <typename K, typename V, typename C>
+template <typename KK, typename... Args>
+ABSL_ATTRIBUTE_NOINLINE typename ConcurrentSkipListMap<K, V, C>::Node*
+ConcurrentSkipListMap<K, V, C>::create_node(size_t height, KK&& key,
+                                            Args&&... args) noexcept {
+  auto memory = _memory_resource->allocate(sizeof(Node) + height * sizeof(Link),
+                                           alignof(Node));
+  return new (memory) Node {height, ::std::forward<KK>(key),
+                            ::std::forward<Args>(args)...};
+}
+
+template <typename K, typename V, typename C>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentSkipListMap<K, V, C>::destroy_node(
+    Node* node) noexcept {
+  auto size = sizeof(Node) + node->height * sizeof(Link);
+  node->~Node();
+  _memory_resource->deallocate(node, size, alignof(Node));
+}
+
+template <typename K, typename V, typename C>
+inline Epoch::Accessor&
+ConcurrentSkipListMap<K, V, C>::local_accessor() noexcept {
+  auto& accessor = _accessors.local();
+  if (ABSL_PREDICT_FALSE(!accessor)) {
+    accessor = _garbage_collector.epoch().create_accessor();
+  }
+  return accessor;
+}
+
+template <typename K, typename V, typename C>
+inline typename ConcurrentSkipListMap<K, V, C>::Node*
+ConcurrentSkipListMap<K, V, C>::lower_bound(const K& key) const noexcept {
+  const Link* pred = _head;
+  Node* curr = nullptr;
+  for (size_t level = MAX_HEIGHT; level-- > 0;) {
+    curr = unmark(pred[level].load(::std::memory_order_acquire));
+    while (curr != nullptr) {
+      auto link = curr->next[level].load(::std::memory_order_acquire);
+      if (is_marked(link)) {
+        curr = unmark(link);
+        continue;
+      }
+      if (!_compare(curr->key(), key)) {
+        break;
+      }
+      pred = curr->next;
+      curr = unmark(link);
+    }
+  }
+  return curr;
+}
+
+template <typename K, typename V, typename C>
+ABSL_ATTRIBUTE_NOINLINE bool ConcurrentSkipListMap<K, V, C>::find_position(
+    const K& key, Link** preds, Node** succs) noexcept {
+  while (!try_find_position(key, preds, succs)) {
+  }
+  return succs[0] != nullptr && !_compare(key, succs[0]->key());
+}
+
+template <typename K, typename V, typename C>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentSkipListMap<K, V, C>::unlink(
+    const K& key) noexcept {
+  while (!try_unlink(key)) {
+  }
+}
+
+template <typename K, typename V, typename C>
+bool ConcurrentSkipListMap<K, V, C>::try_find_position(
+    const K& key, Link** preds, Node** succs) noexcept {
+  Link* pred = _head;
+  for (size_t level = MAX_HEIGHT; level-- > 0;) {
+    auto pred_link = pred[level].load(::std::memory_order_acquire);
+    if (is_marked(pred_link)) {
+      return false;
+    }
+    auto curr = unmark(pred_link);
+    while (curr != nullptr) {
+      auto link = curr->next[level].load(::std::memory_order_acquire);
+      if (is_marked(link)) {
+        auto expected = reinterpret_cast<uintptr_t>(curr);
+        if (!pred[level].compare_exchange_strong(
+                expected, link & ~static_cast<uintptr_t>(1),
+                ::std::memory_order_acq_rel, ::std::memory_order_relaxed)) {
+          return false;
+        }
+        curr = unmark(link);
+        continue;
+      }
+      if (!_compare(curr->key(), key)) {
+        break;
+      }
+      pred = curr->next;
+      curr = unmark(link);
+    }
+    preds[level] = pred;
+    succs[level] = curr;
+  }
+  return true;
+}
+
+template <typename K, typename V, typename C>
+bool ConcurrentSkipListMap<K, V, C>::try_unlink(const K& key) noexcept {
+  // Same as try_find_position, but walk over live nodes with equal key, since
+  // a new node with equal key may be linked before the erased one
+  Link* pred = _head;
+  for (size_t level = MAX_HEIGHT; level-- > 0;) {
+    auto walk = pred;
+    auto walk_link = walk[level].load(::std::memory_order_acquire);
+    if (is_marked(walk_link)) {
+      return false;
+    }
+    auto curr = unmark(walk_link);
+    while (curr != nullptr) {
+      auto link = curr->next[level].load(::std::memory_order_acquire);
+      if (is_marked(link)) {
+        auto expected = reinterpret_cast<uintptr_t>(curr);
+        if (!walk[level].compare_exchange_strong(
+                expected, link & ~static_cast<uintptr_t>(1),
+                ::std::memory_order_acq_rel, ::std::memory_order_relaxed)) {
+          return false;
+        }
+        curr = unmark(link);
+        continue;
+      }
+      if (_compare(curr->key(), key)) {
+        pred = curr->next;
+      } else if (_compare(key, curr->key())) {
+        break;
+      }
+      walk = curr->next;
+      curr = unmark(link);
+    }
+  }
+  return true;
+}
+
+template <typename K, typename V, typename C>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentSkipListMap<K, V, C>::build_tower(
+    Node* node, Link** preds, Node** succs) noexcept {
+  for (size_t level = 1; level < node->height; ++level) {
+    while (true) {
+      // Point to successor first, fail only when marked by erase
+      auto link = node->next[level].load(::std::memory_order_acquire);
+      auto succ = reinterpret_cast<uintptr_t>(succs[level]);
+      if (is_marked(link)) {
+        return;
+      }
+      if (link != succ && !node->next[level].compare_exchange_strong(
+                              link, succ, ::std::memory_order_acq_rel,
+                              ::std::memory_order_relaxed)) {
+        return;
+      }
+      if (preds[level][level].compare_exchange_strong(
+              succ, reinterpret_cast<uintptr_t>(node),
+              ::std::memory_order_acq_rel, ::std::memory_order_relaxed)) {
+        break;
+      }
+      // Node not found at level 0 means it is erased already
+      find_position(node->key(), preds, succs);
+      if (succs[0] != node) {
+        return;
+      }
+    }
+  }
+}
+
+template <typename K, typename V, typename C>
+ABSL_ATTRIBUTE_NOINLINE typename ConcurrentSkipListMap<K, V, C>::Node*
+ConcurrentSkipListMap<K, V, C>::finish(Node* node, uint8_t side) noexcept {
+  auto state = node->state.fetch_or(side, ::std::memory_order_acq_rel);
+  if ((state | side) != (TOWER_DONE | ERASED)) {
+    return nullptr;
+  }
+  unlink(node->key());
+  return node;
+}
+// ConcurrentSkipListMap end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
@@ -1,5 +1,10 @@
 #include "babylon/concurrent/transient_hash_table.h"
 
+#include <fcntl.h>    // ::open
+#include <sys/mman.h> // ::mmap
+#include <sys/stat.h> // ::fstat
+#include <unistd.h>   // ::write
+
 BABYLON_NAMESPACE_BEGIN
 
 namespace internal {
@@ -33,6 +38,12 @@ ABSL_ATTRIBUTE_WEAK constexpr size_t Group::CHECKER_MASK_BITS;
 ABSL_ATTRIBUTE_WEAK constexpr int8_t Group::DUMMY_CONTROL;
 ABSL_ATTRIBUTE_WEAK constexpr int8_t Group::BUSY_CONTROL;
 ABSL_ATTRIBUTE_WEAK constexpr int8_t Group::EMPTY_CONTROL;
+ABSL_ATTRIBUTE_WEAK constexpr int8_t Group::DELETED_CONTROL;
+ABSL_ATTRIBUTE_WEAK constexpr int8_t Group::RECLAIMED_CONTROL;
+ABSL_ATTRIBUTE_WEAK constexpr int8_t Group::MIGRATED_CONTROL;
+ABSL_ATTRIBUTE_WEAK constexpr uint64_t PersistHeader::MAGIC;
+ABSL_ATTRIBUTE_WEAK constexpr uint32_t PersistHeader::VERSION;
+ABSL_ATTRIBUTE_WEAK constexpr size_t PersistWriter::BUFFER_SIZE;
 #endif // __cplusplus < 201703L
 
 ABSL_ATTRIBUTE_WEAK uintptr_t constexpr_symbol_generator() {
@@ -43,7 +54,114 @@ ABSL_ATTRIBUTE_WEAK uintptr_t constexpr_symbol_generator() {
          reinterpret_cast<uintptr_t>(&Group::CHECKER_MASK_BITS) +
          reinterpret_cast<uintptr_t>(&Group::DUMMY_CONTROL) +
          reinterpret_cast<uintptr_t>(&Group::BUSY_CONTROL) +
-         reinterpret_cast<uintptr_t>(&Group::EMPTY_CONTROL);
+         reinterpret_cast<uintptr_t>(&Group::EMPTY_CONTROL) +
+         reinterpret_cast<uintptr_t>(&Group::DELETED_CONTROL) +
+         reinterpret_cast<uintptr_t>(&Group::RECLAIMED_CONTROL) +
+         reinterpret_cast<uintptr_t>(&Group::MIGRATED_CONTROL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistWriter begin
+PersistWriter::~PersistWriter() noexcept {
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+}
+
+int PersistWriter::open(const char* path) noexcept {
+  _fd = ::open(path, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+  if (_fd < 0) {
+    return -1;
+  }
+  _buffer.reset(new char[BUFFER_SIZE]);
+  return 0;
+}
+
+void PersistWriter::append(const void* data, size_t size) noexcept {
+  auto bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    if (_buffer_used == BUFFER_SIZE) {
+      flush();
+    }
+    auto copy_size = ::std::min(size, BUFFER_SIZE - _buffer_used);
+    __builtin_memcpy(_buffer.get() + _buffer_used, bytes, copy_size);
+    _buffer_used += copy_size;
+    bytes += copy_size;
+    size -= copy_size;
+  }
+}
+
+void PersistWriter::fill(int8_t value, size_t size) noexcept {
+  while (size > 0) {
+    if (_buffer_used == BUFFER_SIZE) {
+      flush();
+    }
+    auto fill_size = ::std::min(size, BUFFER_SIZE - _buffer_used);
+    __builtin_memset(_buffer.get() + _buffer_used, value, fill_size);
+    _buffer_used += fill_size;
+    size -= fill_size;
+  }
+}
+
+int PersistWriter::close() noexcept {
+  flush();
+  if (0 != ::close(_fd) && _errno == 0) {
+    _errno = errno;
+  }
+  _fd = -1;
+  if (_errno != 0) {
+    errno = _errno;
+    return -1;
+  }
+  return 0;
+}
+
+void PersistWriter::flush() noexcept {
+  size_t written = 0;
+  while (_errno == 0 && written < _buffer_used) {
+    auto ret = ::write(_fd, _buffer.get() + written, _buffer_used - written);
+    if (ret >= 0) {
+      written += static_cast<size_t>(ret);
+    } else if (errno != EINTR) {
+      _errno = errno;
+    }
+  }
+  _buffer_used = 0;
+}
+// PersistWriter end
+////////////////////////////////////////////////////////////////////////////////
+
+int map_file(const char* path, void*& address, size_t& size) noexcept {
+  auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  struct ::stat stat;
+  if (0 != ::fstat(fd, &stat)) {
+    auto saved_errno = errno;
+    ::close(fd);
+    errno = saved_errno;
+    return -1;
+  }
+  if (stat.st_size == 0) {
+    ::close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+  size = static_cast<size_t>(stat.st_size);
+  address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  auto saved_errno = errno;
+  // 映射建立后不再依赖文件描述符
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    errno = saved_errno;
+    return -1;
+  }
+  return 0;
+}
+
+void unmap_file(void* address, size_t size) noexcept {
+  ::munmap(address, size);
 }
 
 } // namespace concurrent_transient_hash_table
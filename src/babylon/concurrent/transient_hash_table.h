@@ -11,13 +11,17 @@
 
 #include <inttypes.h> // ::*int*_t
 
-#include <atomic>     // std::atomic
-#include <functional> // std::hash
-#include <list>       // std::list
-#include <mutex>      // std::mutex
+#include <atomic>      // std::atomic
+#include <functional>  // std::hash
+#include <list>        // std::list
+#include <mutex>       // std::mutex
+#include <type_traits> // std::is_copy_constructible
 
 BABYLON_NAMESPACE_BEGIN
 
+template <typename R>
+class GarbageCollector;
+
 // 内部类型前置声明
 namespace internal {
 namespace concurrent_transient_hash_table {
@@ -26,13 +30,18 @@ template <typename K, typename V>
 struct PairKeyExtractor;
 class GroupIterator;
 class Group;
+struct PersistHeader;
 uintptr_t constexpr_symbol_generator();
 } // namespace concurrent_transient_hash_table
 } // namespace internal
 
 // 采用SwissTable的实现原理（https://abseil.io/about/design/swisstables）
-// 去除了自动容量调整和删除支持，但支持了高效的并发插入
+// 去除了自动容量调整，但支持了高效的并发插入
 // 由于去除了自动容量调整，插入有可能因为表满而失败
+//
+// 删除采用墓碑标记实现，被删除的元素通过GarbageCollector延迟回收
+// 墓碑先标记为DELETED，在所有读者离开后析构元素并转为RECLAIMED
+// RECLAIMED的墓碑会被探测路径经过它的插入直接复用，也可以由compact恢复为空位
 template <typename T, typename H = ::std::hash<T>,
           typename E =
               internal::concurrent_transient_hash_table::IdentityKeyExtractor>
@@ -61,6 +70,10 @@ class ConcurrentFixedSwissTable {
   template <bool CONST>
   class Iterator;
 
+  // 配合GarbageCollector使用的回收动作
+  // 析构被删除的元素，并将槽位标记为可由compact清理
+  class Reclaimer;
+
   using key_type = T;
   using value_type = T;
   using size_type = size_t;
@@ -124,6 +137,22 @@ class ConcurrentFixedSwissTable {
   inline ::std::pair<iterator, bool> emplace(K&& key, Args&&... args) noexcept;
   // iterator emplace_hint(const_iterator hint, Args&&... args);
   // iterator erase(iterator pos);
+  // 【并发安全】删除操作，返回实际删除的元素个数
+  // 删除仅将槽位标记为墓碑，元素本身通过gc延迟到无读者后析构
+  // 完成回收的墓碑会被探测路径经过它的插入直接复用
+  // 需要通过R {Reclaimer}构造回收动作，例如R = Reclaimer或std::function
+  //
+  // 使用删除功能时，查找、遍历和删除本身都需要在gc.epoch()的临界区中进行
+  // 并且在clear/rehash/reserve/swap/析构之前，需要确保已提交的回收动作执行完毕
+  template <typename K, typename R>
+  size_t erase(const K& key, GarbageCollector<R>& gc) noexcept;
+  // 将已经完成回收的墓碑恢复为空位，返回清理的墓碑个数
+  // 插入虽然可以直接复用墓碑，但是依然需要路径末尾存在空位
+  // 清理可以缩短探测链，并在墓碑堆积时恢复出空位
+  // 只有确认不处于任何探测链中的墓碑才会被清理
+  // 其余的留待clear或者rehash/reserve扩容重建时消除
+  // 支持和查询&删除动作并发，不支持和插入动作以及其他compact并发
+  size_t compact() noexcept;
   // 交换容器，不支持和查询&插入动作并发
   void swap(ConcurrentFixedSwissTable& other) noexcept;
   // node_type extract(const_iterator position);
@@ -143,6 +172,18 @@ class ConcurrentFixedSwissTable {
   inline bool contains(const K& key) const noexcept;
   //::std::pair<iterator, iterator> equal_range(K&& key);
 
+  // 【并发安全】批量查找&插入操作，结果等同于对keys[0, num)逐个调用
+  // find/emplace，并通过callback(size_t i, result)返回第i个key的结果
+  // 其中result分别同find/emplace的返回值
+  //
+  // 每BATCH_SIZE个key为一批，先统一计算哈希，并预取各自起始组的控制字节和槽位
+  // 再逐个进行探测，使一批key的访存延迟相互重叠，适合大批量离散key的查找
+  template <typename K, typename C>
+  void find_batch(const K* keys, size_t num, C&& callback) noexcept;
+  template <typename K, typename C,
+            typename = typename ::std::enable_if<CanUseAsKey<K>::value>::type>
+  void emplace_batch(const K* keys, size_t num, C&& callback) noexcept;
+
   // iterator begin(size_t bucket_index);
   // iterator end(size_t bucket_index);
   // 获得桶数目，出于性能考虑，桶数目都是2^n
@@ -160,8 +201,30 @@ class ConcurrentFixedSwissTable {
   // hasher hash_function() const;
   // key_equal key_eq() const;
 
+  // 持久化支持，仅适用于可平凡拷贝的T，典型如整数key&value构成的大词典
+  // 文件由头部和与内存布局完全一致的控制字节&槽位数组构成
+  // 头部记录桶数目、元素个数、元素尺寸，以及前若干个元素的哈希指纹
+  // 用于加载时检测元素类型或哈希函数和写出时不一致的情况
+  //
+  // 写出不支持和插入&删除动作并发，成功返回0，失败返回-1并设置errno
+  int dump(const char* path) const noexcept;
+  // 将dump写出的文件只读mmap映射，直接作为存储提供查找，启动时无需逐个插入
+  // 只需要按需换入页面。映射区域关联到文件实体，可以配合MemoryLocker锁定
+  //
+  // 加载后只支持查找和遍历，插入和删除会直接失败，分别返回end()和0
+  // 需要修改时可以复制构造出一个普通的表
+  // clear/rehash/reserve也会将存储重建为普通的表
+  // 成功返回0，失败返回-1并设置errno，失败时原有内容不受影响
+  int load_mmap(const char* path) noexcept;
+
  private:
   using Group = internal::concurrent_transient_hash_table::Group;
+  using PersistHeader =
+      internal::concurrent_transient_hash_table::PersistHeader;
+
+  // 批量操作每批预取的key个数，需要覆盖一次访存延迟，又不至于使预取的
+  // 缓存行在探测前被挤出L1
+  static constexpr size_t BATCH_SIZE = 16;
 
   static constexpr ::std::align_val_t VALUE_ALIGNMENT =
       static_cast<::std::align_val_t>(alignof(CachelineAligned<T>));
@@ -174,8 +237,49 @@ class ConcurrentFixedSwissTable {
   ::std::pair<iterator, bool> do_emplace(K&& key_or_value,
                                          Args&&... args) noexcept;
 
+  // 使用预先计算好的哈希值完成探测，供单个和批量操作共用
+  template <typename K>
+  inline iterator find_with_hash(const K& key, size_t hash) noexcept;
+  template <typename K, typename... Args>
+  inline ::std::pair<iterator, bool> do_emplace_with_hash(
+      size_t hash, K&& key_or_value, Args&&... args) noexcept;
+  // 持有end_step所在组的空位后，从头沿探测路径重新查找key
+  // 找到时返回{序号, true}，否则尝试认领首个已回收的墓碑
+  // 返回{墓碑序号, false}，没有可认领的墓碑时序号为bucket_count()
+  template <typename K>
+  ::std::pair<size_t, bool> recheck_and_revive(const K& key, size_t hash,
+                                               size_t end_step) noexcept;
+  // 预取hash对应起始组的控制字节和首个槽位
+  inline void prefetch(size_t hash) const noexcept;
+
   inline T& at(size_t index) noexcept;
 
+  // 为了减少查找分支，对于序号在前Group::SIZE - 1的元素需要
+  // 额外向尾部环形追加一份冗余低位哈希，返回冗余位置的序号
+  // 对于低序号以外的部分冗余序号和原始序号是一致的
+  inline size_t cloned_index(size_t index) const noexcept;
+
+  void reclaim(size_t index) noexcept;
+  bool purgeable(size_t index) const noexcept;
+
+  // 持久化的头部占用大小，保证后续控制字节和槽位的对齐和内存中一致
+  static size_t persist_header_size() noexcept;
+  // 前若干个元素的哈希值组合，用于检测哈希函数是否一致
+  size_t hash_fingerprint() const noexcept;
+
+  // 渐进迁移支持，供ConcurrentTransientHashSet使用
+  // 将base_index开始的一个组内的元素通过copier复制到后续子表
+  // 复制完成后再将原位置标记为已迁移，保证迁移过程中元素始终可查找
+  template <typename C>
+  void migrate_group(size_t base_index, C&& copier) noexcept;
+  // 将内容为checker的index位置标记为已迁移，元素本身保留到clear时再析构
+  // 以便迁移前获取的引用依然有效，位置已经被删除或迁移时返回false
+  bool abandon(size_t index, int8_t checker) noexcept;
+  // 生成释放整张表存储的回收动作，供完成迁移的子表经由gc释放
+  inline Reclaimer release_reclaimer() noexcept;
+  // 读者离开后释放存储，仍有删除的元素等待回收时保留，由所属容器最终析构
+  void release() noexcept;
+
   using GroupIterator =
       internal::concurrent_transient_hash_table::GroupIterator;
   ::std::tuple<size_t, GroupIterator> find_first_non_empty(
@@ -184,8 +288,14 @@ class ConcurrentFixedSwissTable {
   ::std::atomic<int8_t>* _controls;
   CachelineAligned<T>* _values {nullptr};
   size_t _bucket_mask;
+  // 通过load_mmap加载时，记录映射区域用于释放
+  void* _mapping {nullptr};
+  size_t _mapping_size {0};
 
   ConcurrentAdder _size;
+
+  template <typename, typename, typename>
+  friend class ConcurrentTransientHashSet;
 };
 
 // 包装ConcurrentFixedSwissTable，提供了简单的自动容量扩展功能
@@ -198,6 +308,10 @@ class ConcurrentFixedSwissTable {
 //
 // 对于检索和插入操作，有可能需要对所有表执行一次
 // 因此设计上常态还是希望能够反复使用一张表，或使用前先调整到充足的容量
+//
+// 对于无法预估容量又需要长期使用的场景，可以开启渐进迁移
+// 此时查找和插入操作会协作地将最早一张子表的元素逐组复制到后续子表
+// 完成迁移的子表不再参与检索，最终收敛到单张表一次探测的状态
 template <typename T, typename H = ::std::hash<T>,
           typename E =
               internal::concurrent_transient_hash_table::IdentityKeyExtractor>
@@ -222,6 +336,7 @@ class ConcurrentTransientHashSet {
   using const_pointer = typename Table::const_pointer;
   using iterator = Iterator<false>;
   using const_iterator = Iterator<true>;
+  using Reclaimer = typename Table::Reclaimer;
 
   // 可默认构造
   ConcurrentTransientHashSet() noexcept = default;
@@ -262,11 +377,35 @@ class ConcurrentTransientHashSet {
   inline ::std::pair<iterator, bool> emplace(Args&&... args) noexcept;
   // iterator emplace_hint(const_iterator hint, Args&&... args);
   // iterator erase(iterator pos);
+  // 【并发安全】删除操作，约束同ConcurrentFixedSwissTable::erase
+  template <typename K, typename R>
+  inline size_t erase(const K& key, GarbageCollector<R>& gc) noexcept;
+  // 清理最后一张子表中已经完成回收的墓碑，约束同
+  // ConcurrentFixedSwissTable::compact
+  // 插入总是优先尝试前面的子表，只有最后一张子表可以安全恢复空位
+  // 前面子表中的墓碑留待clear/rehash/reserve合并时消除
+  size_t compact() noexcept;
   // 交换容器，不支持和查询&插入动作并发
   void swap(ConcurrentTransientHashSet& other) noexcept;
   // node_type extract(const_iterator position);
   // void merge(source);
 
+  // 设置存在多张子表时，每次查找&插入操作协助迁移的组数，默认为0不迁移
+  // 迁移通过拷贝构造完成，仅对可拷贝构造的T生效，原位置的元素会保留到
+  // 子表释放时再析构，因此迁移前获取的引用依然可以安全访问
+  // 但迁移后对其进行的修改不会再被查找观测到，需要原地修改元素的场景不宜开启
+  // 迁移过程中并发的遍历可能观测到同一个元素的两个副本
+  // 完成迁移的子表从查找路径上摘除，此后恢复到单表一次探测
+  //
+  // 不指定gc时，摘除的子表保留到clear/rehash/reserve时再释放
+  // 指定gc时，摘除的子表经由gc在读者离开后释放，此时所有操作以及对元素的访问
+  // 都需要在gc.epoch()的临界区中进行，且要求R可以由Reclaimer构造
+  // 配合删除使用时，迁移需要读取元素，插入也需要在gc.epoch()的临界区中进行
+  // 不支持和查询&插入动作并发
+  void set_migration_step(size_t groups) noexcept;
+  template <typename R>
+  void set_migration_step(size_t groups, GarbageCollector<R>& gc) noexcept;
+
   ////////////////////////////////////////////////////////////////////////////
   // 【并发安全】查找操作
   // 与标准库语义区别在于返回的iterator不支持进一步的遍历操作，只能用于
@@ -282,6 +421,15 @@ class ConcurrentTransientHashSet {
   inline bool contains(const K& key) const noexcept;
   //::std::pair<iterator, iterator> equal_range(K&& key);
 
+  // 【并发安全】批量查找&插入操作，语义同ConcurrentFixedSwissTable
+  // 只存在一张子表时批量预取后探测，头表满时剩余的key逐个插入到扩展子表
+  // 存在多张子表时退化为逐个find/emplace
+  // 对于ConcurrentTransientHashMap，emplace_batch插入的value采用默认构造
+  template <typename K, typename C>
+  void find_batch(const K* keys, size_t num, C&& callback) noexcept;
+  template <typename K, typename C>
+  void emplace_batch(const K* keys, size_t num, C&& callback) noexcept;
+
   // iterator begin(size_t bucket_index);
   // iterator end(size_t bucket_index);
   // 获得桶数目，出于性能考虑，桶数目都是2^n
@@ -300,11 +448,43 @@ class ConcurrentTransientHashSet {
   // key_equal key_eq() const;
 
  private:
+  using Group = internal::concurrent_transient_hash_table::Group;
+
   struct TableNode;
 
   size_t total_size(TableNode* node) const noexcept;
 
+  template <typename K>
+  iterator find_in_chain(const K& key) noexcept;
+  template <typename K, typename... Args>
+  ::std::pair<iterator, bool> emplace_in_chain(K&& key_or_value,
+                                               Args&&... args) noexcept;
+  template <typename... Args>
+  ::std::pair<typename Table::iterator, bool> emplace_from(
+      TableNode* node, Args&&... args) noexcept;
+
+  // 摘除已经完成迁移的子表，返回首个仍然可能包含元素的子表
+  TableNode* first_active_node() noexcept;
+  // 释放摘除的子表，存在gc时提前释放存储，其余部分保留到clear和析构时
+  void retire(TableNode* node) noexcept;
+  template <typename R>
+  static void retire_table(void* gc, Table& table) noexcept;
+  // clear/rehash/reserve合并子表时沿用迁移设置
+  void copy_migration_setting(const ConcurrentTransientHashSet& other) noexcept;
+  // 协助迁移_migration_step个组之后，返回首个仍然可能包含元素的子表
+  TableNode* migrate() noexcept;
+  void migrate(TableNode* node, ::std::true_type) noexcept;
+  void migrate(TableNode* node, ::std::false_type) noexcept;
+
   TableNode _head;
+  // 首个仍然可能包含元素的子表，完成迁移的子表会从这里摘除
+  ::std::atomic<TableNode*> _first {&_head};
+  // 已经摘除的动态子表，clear和析构时统一释放
+  ::std::atomic<TableNode*> _retired {nullptr};
+  size_t _migration_step {0};
+  // 通过set_migration_step注册的gc，用于提前释放摘除子表的存储
+  void* _gc {nullptr};
+  void (*_retire_table)(void*, Table&) noexcept {nullptr};
 
   template <bool CONST>
   friend class Iterator;
@@ -322,8 +502,16 @@ struct ConcurrentTransientHashSet<T, H, E>::TableNode {
 
   inline void swap(TableNode& other) noexcept;
 
+  // 所有组都已经完成迁移，不再包含任何元素
+  inline bool retired() const noexcept;
+
   Table table;
   ::std::atomic<TableNode*> next {nullptr};
+  // 下一个待认领迁移的组序号，以及已经完成迁移的组数
+  ::std::atomic<size_t> migrate_cursor {0};
+  ::std::atomic<size_t> migrated_groups {0};
+  // 摘除后串联在待释放链表中
+  TableNode* next_retired {nullptr};
 };
 
 template <typename T, typename H, typename E>
@@ -357,6 +545,15 @@ ConcurrentTransientHashSet<T, H, E>::TableNode::swap(
   next.store(other.next.load(::std::memory_order_relaxed),
              ::std::memory_order_relaxed);
   other.next.store(tmp, ::std::memory_order_relaxed);
+  auto cursor = migrate_cursor.load(::std::memory_order_relaxed);
+  migrate_cursor.store(other.migrate_cursor.load(::std::memory_order_relaxed),
+                       ::std::memory_order_relaxed);
+  other.migrate_cursor.store(cursor, ::std::memory_order_relaxed);
+  auto groups = migrated_groups.load(::std::memory_order_relaxed);
+  migrated_groups.store(
+      other.migrated_groups.load(::std::memory_order_relaxed),
+      ::std::memory_order_relaxed);
+  other.migrated_groups.store(groups, ::std::memory_order_relaxed);
 }
 
 template <typename K, typename V, typename H = ::std::hash<K>>
@@ -16,6 +16,10 @@
 #include <sanitizer/tsan_interface.h> // ::__tsan_acquire
 #endif                                // ABSL_HAVE_THREAD_SANITIZER
 
+#include <errno.h> // errno
+
+#include <memory> // std::unique_ptr
+
 #pragma GCC diagnostic push
 // Thread Sanitizer目前无法支持std::atomic_thread_fence
 // gcc-12之后增加了相应的报错，显示标记忽视并特殊处理相关段落
@@ -147,6 +151,15 @@ class Group {
   static constexpr int8_t BUSY_CONTROL = static_cast<int8_t>(0x81);
   // 可用未知当前也没有写入过元素
   static constexpr int8_t EMPTY_CONTROL = static_cast<int8_t>(0x80);
+  // 元素已被删除，等待所有读者离开临界区后回收
+  static constexpr int8_t DELETED_CONTROL = static_cast<int8_t>(0x83);
+  // 元素已经回收，可以被插入直接复用，或者由compact恢复为空位
+  static constexpr int8_t RECLAIMED_CONTROL = static_cast<int8_t>(0x84);
+  // 元素已经迁移到后续子表，原值保留到clear时析构
+  static constexpr int8_t MIGRATED_CONTROL = static_cast<int8_t>(0x85);
+  // 已回收的墓碑正在被复用写入，和BUSY_CONTROL不同，不能视为『空』
+  // 否则会截断穿过这个位置的探测链
+  static constexpr int8_t REVIVING_CONTROL = static_cast<int8_t>(0x86);
 
   static_assert(sizeof(int8_t) == sizeof(::std::atomic<int8_t>) &&
                     alignof(int8_t) == alignof(::std::atomic<int8_t>),
@@ -178,22 +191,24 @@ class Group {
     return GroupIterator {mask};
   }
 
-  // 检测16个byte各自是否表示有内容
-  // 有内容的byte都采用7bit表达，通过符号位判定即可快速过滤
-  // 符号位为1的特殊值，在查找时都视为『空』
+  // 检测16个byte各自是否表示『空』，即可以终止探测的位置
+  // 有内容的byte都采用7bit表达，特殊值都是负数
+  // 其中小于DELETED_CONTROL的特殊值，在查找时都视为『空』
   // 尽管emplace操作并不认为可以发起写入
+  // 而删除和回收状态的墓碑仍然处于探测链中，不能视为『空』
   inline ABSL_ATTRIBUTE_ALWAYS_INLINE GroupIterator match_empty() noexcept {
 #if defined(__SSE2__)
-    uint16_t mask = _mm_movemask_epi8(_controls);
+    uint16_t mask = _mm_movemask_epi8(
+        _mm_cmplt_epi8(_controls, _mm_set1_epi8(DELETED_CONTROL)));
 #elif defined(__ARM_NEON)
     uint16x8_t mask128 = vreinterpretq_u16_u8(
-        vceqq_s8(vandq_s8(_controls, vdupq_n_s8(0x80)), vdupq_n_s8(0x80)));
+        vcltq_s8(_controls, vdupq_n_s8(DELETED_CONTROL)));
     uint8x8_t mask64 = vshrn_n_u16(mask128, 4);
     uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(mask64), 0);
 #else  // !defined(__SSE2__) && !defined(__ARM_NEON)
     uint16_t mask = 0;
     for (size_t i = 0; i < SIZE; ++i) {
-      if (_controls[i] < 0) {
+      if (_controls[i] < DELETED_CONTROL) {
         mask |= 1 << i;
       }
     }
@@ -201,7 +216,9 @@ class Group {
     return GroupIterator {mask};
   }
 
-  // match_empty的取反结果，用于遍历有内容的位置
+  // 检测16个byte各自是否为有效内容，即非负的7bit check值，用于遍历元素
+  // 所有特殊值都不匹配，包括墓碑（DELETED/RECLAIMED）、已迁移（MIGRATED）
+  // 和正在写入（BUSY/REVIVING）的位置，因此并不是match_empty的取反
   inline ABSL_ATTRIBUTE_ALWAYS_INLINE GroupIterator match_non_empty() noexcept {
 #if defined(__SSE2__)
     uint16_t mask = ~_mm_movemask_epi8(_controls);
@@ -272,6 +289,65 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE Group::Group(
 #endif // !defined(__SSE2__) && !defined(__ARM_NEON)
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentFixedSwissTable持久化文件的头部，之后紧跟和内存布局一致的
+// 控制字节和槽位数组
+struct PersistHeader {
+  // 'BSWISSTB'
+  static constexpr uint64_t MAGIC = 0x4254535349575342ULL;
+  static constexpr uint32_t VERSION = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t value_size;
+  uint64_t value_alignment;
+  uint64_t bucket_count;
+  uint64_t size;
+  uint64_t hash_fingerprint;
+};
+
+// 可以按字节持久化的类型，std::pair的拷贝赋值不平凡，需要按成员展开判断
+template <typename T>
+struct IsPersistable : public ::std::is_trivially_copyable<T> {};
+template <typename K, typename V>
+struct IsPersistable<::std::pair<K, V>>
+    : public ::std::integral_constant<
+          bool, IsPersistable<typename ::std::remove_cv<K>::type>::value &&
+                    IsPersistable<typename ::std::remove_cv<V>::type>::value> {
+};
+
+// 带缓冲的顺序文件写入，任一环节出错后续写入均忽略，在close时统一报告
+class PersistWriter {
+ public:
+  PersistWriter() noexcept = default;
+  PersistWriter(PersistWriter&&) = delete;
+  PersistWriter(const PersistWriter&) = delete;
+  PersistWriter& operator=(PersistWriter&&) = delete;
+  PersistWriter& operator=(const PersistWriter&) = delete;
+  ~PersistWriter() noexcept;
+
+  int open(const char* path) noexcept;
+  void append(const void* data, size_t size) noexcept;
+  void fill(int8_t value, size_t size) noexcept;
+  // 写出缓冲数据并关闭，成功返回0，失败返回-1并设置errno
+  int close() noexcept;
+
+ private:
+  static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+  void flush() noexcept;
+
+  int _fd {-1};
+  int _errno {0};
+  ::std::unique_ptr<char[]> _buffer;
+  size_t _buffer_used {0};
+};
+
+// 只读映射整个文件，成功返回0，失败返回-1并设置errno
+int map_file(const char* path, void*& address, size_t& size) noexcept;
+void unmap_file(void* address, size_t size) noexcept;
+////////////////////////////////////////////////////////////////////////////////
+
 } // namespace concurrent_transient_hash_table
 } // namespace internal
 
@@ -326,6 +402,28 @@ class ConcurrentFixedSwissTable<T, H, E>::Iterator {
   friend class ConcurrentFixedSwissTable;
 };
 
+// ConcurrentFixedSwissTable配套的回收动作
+template <typename T, typename H, typename E>
+class ConcurrentFixedSwissTable<T, H, E>::Reclaimer {
+ public:
+  inline Reclaimer() noexcept = default;
+  inline Reclaimer(Reclaimer&&) noexcept = default;
+  inline Reclaimer(const Reclaimer&) noexcept = default;
+  inline Reclaimer& operator=(Reclaimer&&) noexcept = default;
+  inline Reclaimer& operator=(const Reclaimer&) noexcept = default;
+  inline ~Reclaimer() noexcept = default;
+
+  inline void operator()() noexcept;
+
+ private:
+  inline Reclaimer(ConcurrentFixedSwissTable& table, size_t index) noexcept;
+
+  ConcurrentFixedSwissTable* _table {nullptr};
+  size_t _index {SIZE_MAX};
+
+  friend class ConcurrentFixedSwissTable;
+};
+
 template <typename T, typename H, typename E>
 template <bool CONST>
 class ConcurrentTransientHashSet<T, H, E>::Iterator {
@@ -455,6 +553,27 @@ inline ConcurrentFixedSwissTable<T, H, E>::Iterator<CONST>::Iterator(
 // ConcurrentFixedSwissTable::Iterator end
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentFixedSwissTable::Reclaimer begin
+template <typename T, typename H, typename E>
+inline void
+ConcurrentFixedSwissTable<T, H, E>::Reclaimer::operator()() noexcept {
+  if (_table != nullptr) {
+    if (ABSL_PREDICT_TRUE(_index != SIZE_MAX)) {
+      _table->reclaim(_index);
+    } else {
+      _table->release();
+    }
+  }
+}
+
+template <typename T, typename H, typename E>
+inline ConcurrentFixedSwissTable<T, H, E>::Reclaimer::Reclaimer(
+    ConcurrentFixedSwissTable& table, size_t index) noexcept
+    : _table {&table}, _index {index} {}
+// ConcurrentFixedSwissTable::Reclaimer end
+////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // ConcurrentFixedSwissTable begin
 template <typename T, typename H, typename E>
@@ -503,6 +622,12 @@ ConcurrentFixedSwissTable<T, H, E>::operator=(
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE
     ConcurrentFixedSwissTable<T, H, E>::~ConcurrentFixedSwissTable() noexcept {
+  if (ABSL_PREDICT_FALSE(_mapping != nullptr)) {
+    // 只读映射的元素都是可平凡析构的，直接解除映射
+    internal::concurrent_transient_hash_table::unmap_file(_mapping,
+                                                          _mapping_size);
+    return;
+  }
   if (_controls != Group::s_dummy_controls) {
     clear();
     auto allocate_size = calculate_allocate_size(_bucket_mask + 1);
@@ -562,17 +687,29 @@ ConcurrentFixedSwissTable<T, H, E>::clear() noexcept {
     construct_with_bucket(Group::SIZE);
     return;
   }
-  if (empty()) {
+  if (ABSL_PREDICT_FALSE(_mapping != nullptr)) {
+    // 映射不可写入，重建一份相同桶数目的普通存储
+    ConcurrentFixedSwissTable table {bucket_count()};
+    swap(table);
     return;
   }
   for (size_t i = 0; i < bucket_count(); i += Group::SIZE) {
-    auto iter = Group {_controls + i}.match_non_empty();
-    if (iter) {
+    Group group {_controls + i};
+    auto iter = group.match_non_empty();
+    // 已迁移的元素依然保有值，同样需要析构
+    auto migrated_iter = group.match(Group::MIGRATED_CONTROL);
+    // 只有元素和墓碑需要清理，全空的组跳过避免无效写入
+    if (iter || migrated_iter || group.match(Group::DELETED_CONTROL) ||
+        group.match(Group::RECLAIMED_CONTROL)) {
       Group::clear(_controls + i);
-      do {
+      while (iter) {
         auto offset = *iter++;
         at(i + offset).~T();
-      } while (iter);
+      }
+      while (migrated_iter) {
+        auto offset = *migrated_iter++;
+        at(i + offset).~T();
+      }
     }
   }
   // 补齐SIMD用的镜像位直接清理
@@ -599,6 +736,84 @@ ConcurrentFixedSwissTable<T, H, E>::emplace(K&& key, Args&&... args) noexcept {
   return do_emplace(::std::forward<K>(key), ::std::forward<Args>(args)...);
 }
 
+template <typename T, typename H, typename E>
+template <typename K, typename R>
+ABSL_ATTRIBUTE_NOINLINE size_t ConcurrentFixedSwissTable<T, H, E>::erase(
+    const K& key, GarbageCollector<R>& gc) noexcept {
+  // 只读映射不可修改
+  if (ABSL_PREDICT_FALSE(_mapping != nullptr)) {
+    return 0;
+  }
+  // 哈希值中截取低位用于检测，剩余高位用于桶选择
+  auto hash = hasher()(key);
+  int8_t checker = hash & Group::CHECKER_MASK;
+  auto base_index = (hash >> Group::CHECKER_MASK_BITS) & _bucket_mask;
+
+  // 和查找采用相同的探测序列
+  size_t step = 0;
+  while (step <= _bucket_mask) {
+    Group group {_controls + base_index};
+    auto iter = group.match(checker);
+    while (iter) {
+      auto offset = *iter++;
+      auto index = (base_index + offset) & _bucket_mask;
+      ::std::atomic_thread_fence(::std::memory_order_acquire);
+#if ABSL_HAVE_THREAD_SANITIZER
+      __tsan_acquire(_controls + base_index + offset);
+#endif // ABSL_HAVE_THREAD_SANITIZER
+      if (E::extract(at(index)) == key) {
+        // 并发删除同一个元素时，只有竞争成功的一方提交回收
+        // 插入时冗余位先于原始位写入，这里原始位成功标记后
+        // 再覆盖冗余位，保证冗余位不会残留已删除元素的低位哈希
+        int8_t control_value = checker;
+        if (!_controls[index].compare_exchange_strong(
+                control_value, Group::DELETED_CONTROL,
+                ::std::memory_order_relaxed, ::std::memory_order_relaxed)) {
+          return 0;
+        }
+        _controls[cloned_index(index)].store(Group::DELETED_CONTROL,
+                                             ::std::memory_order_relaxed);
+        _size << -1;
+        gc.retire(R {Reclaimer {*this, index}});
+        return 1;
+      }
+    }
+    if (group.match_empty()) {
+      break;
+    }
+
+    step += Group::SIZE;
+    base_index = (base_index + step) & _bucket_mask;
+  }
+
+  return 0;
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE size_t
+ConcurrentFixedSwissTable<T, H, E>::compact() noexcept {
+  // 只读映射中不存在墓碑，也不可修改
+  if (ABSL_PREDICT_FALSE(_mapping != nullptr)) {
+    return 0;
+  }
+  size_t purged = 0;
+  for (size_t i = 0; i < bucket_count(); i += Group::SIZE) {
+    auto iter = Group {_controls + i}.match(Group::RECLAIMED_CONTROL);
+    while (iter) {
+      auto index = i + *iter++;
+      // 逐个恢复，前面恢复的空位可以帮助后续墓碑满足条件
+      if (purgeable(index)) {
+        _controls[cloned_index(index)].store(Group::EMPTY_CONTROL,
+                                             ::std::memory_order_relaxed);
+        _controls[index].store(Group::EMPTY_CONTROL,
+                               ::std::memory_order_relaxed);
+        purged++;
+      }
+    }
+  }
+  return purged;
+}
+
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE void ConcurrentFixedSwissTable<T, H, E>::swap(
     ConcurrentFixedSwissTable& other) noexcept {
@@ -606,6 +821,8 @@ ABSL_ATTRIBUTE_NOINLINE void ConcurrentFixedSwissTable<T, H, E>::swap(
   ::std::swap(_values, other._values);
   ::std::swap(_bucket_mask, other._bucket_mask);
   ::std::swap(_size, other._size);
+  ::std::swap(_mapping, other._mapping);
+  ::std::swap(_mapping_size, other._mapping_size);
 }
 
 template <typename T, typename H, typename E>
@@ -619,8 +836,16 @@ template <typename T, typename H, typename E>
 template <typename K>
 ABSL_ATTRIBUTE_NOINLINE typename ConcurrentFixedSwissTable<T, H, E>::iterator
 ConcurrentFixedSwissTable<T, H, E>::find(const K& key) noexcept {
+  return find_with_hash(key, hasher()(key));
+}
+
+template <typename T, typename H, typename E>
+template <typename K>
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE
+    typename ConcurrentFixedSwissTable<T, H, E>::iterator
+    ConcurrentFixedSwissTable<T, H, E>::find_with_hash(const K& key,
+                                                       size_t hash) noexcept {
   // 哈希值中截取低位用于检测，剩余高位用于桶选择
-  auto hash = hasher()(key);
   int8_t checker = hash & Group::CHECKER_MASK;
   auto base_index = (hash >> Group::CHECKER_MASK_BITS) & _bucket_mask;
 
@@ -669,6 +894,48 @@ inline bool ConcurrentFixedSwissTable<T, H, E>::contains(
   return find(key) != end();
 }
 
+template <typename T, typename H, typename E>
+template <typename K, typename C>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentFixedSwissTable<T, H, E>::find_batch(
+    const K* keys, size_t num, C&& callback) noexcept {
+  size_t hashes[BATCH_SIZE];
+  for (size_t begin = 0; begin < num; begin += BATCH_SIZE) {
+    auto batch_size = ::std::min(num - begin, BATCH_SIZE);
+    // 先对整批发起预取，探测时起始组大概率已经进入缓存
+    for (size_t i = 0; i < batch_size; ++i) {
+      hashes[i] = hasher()(keys[begin + i]);
+      prefetch(hashes[i]);
+    }
+    for (size_t i = 0; i < batch_size; ++i) {
+      callback(begin + i, find_with_hash(keys[begin + i], hashes[i]));
+    }
+  }
+}
+
+template <typename T, typename H, typename E>
+template <typename K, typename C, typename>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentFixedSwissTable<T, H, E>::emplace_batch(
+    const K* keys, size_t num, C&& callback) noexcept {
+  // 只读映射不可插入，和容量饱和一样逐个返回失败
+  if (ABSL_PREDICT_FALSE(_mapping != nullptr)) {
+    for (size_t i = 0; i < num; ++i) {
+      callback(i, ::std::pair<iterator, bool> {end(), false});
+    }
+    return;
+  }
+  size_t hashes[BATCH_SIZE];
+  for (size_t begin = 0; begin < num; begin += BATCH_SIZE) {
+    auto batch_size = ::std::min(num - begin, BATCH_SIZE);
+    for (size_t i = 0; i < batch_size; ++i) {
+      hashes[i] = hasher()(keys[begin + i]);
+      prefetch(hashes[i]);
+    }
+    for (size_t i = 0; i < batch_size; ++i) {
+      callback(begin + i, do_emplace_with_hash(hashes[i], keys[begin + i]));
+    }
+  }
+}
+
 template <typename T, typename H, typename E>
 inline size_t ConcurrentFixedSwissTable<T, H, E>::bucket_count()
     const noexcept {
@@ -713,6 +980,101 @@ ABSL_ATTRIBUTE_NOINLINE void ConcurrentFixedSwissTable<T, H, E>::reserve(
   }
 }
 
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE int ConcurrentFixedSwissTable<T, H, E>::dump(
+    const char* path) const noexcept {
+  static_assert(
+      internal::concurrent_transient_hash_table::IsPersistable<T>::value,
+      "only trivially copyable value can be dumped");
+
+  internal::concurrent_transient_hash_table::PersistWriter writer;
+  if (0 != writer.open(path)) {
+    return -1;
+  }
+
+  PersistHeader header;
+  header.magic = PersistHeader::MAGIC;
+  header.version = PersistHeader::VERSION;
+  header.value_size = sizeof(T);
+  header.value_alignment = static_cast<uint64_t>(VALUE_ALIGNMENT);
+  header.bucket_count = bucket_count();
+  header.size = size();
+  header.hash_fingerprint = hash_fingerprint();
+  writer.append(&header, sizeof(header));
+  writer.fill(0, persist_header_size() - sizeof(header));
+
+  // 默认构造的实例按照空表写出，加载后是一个普通的空表
+  auto controls_size = bucket_count() + Group::SIZE;
+  if (ABSL_PREDICT_FALSE(_controls == Group::s_dummy_controls)) {
+    writer.fill(Group::EMPTY_CONTROL, controls_size);
+  } else {
+    writer.append(_controls, controls_size);
+  }
+  auto values_offset = calculate_values_offset(bucket_count());
+  writer.fill(0, values_offset - controls_size);
+
+  // 只写出有内容的槽位，其余位置补零，避免未初始化的内存落盘
+  for (size_t i = 0; i < bucket_count(); ++i) {
+    auto control = _controls[i].load(::std::memory_order_relaxed);
+    if (control >= 0 || control == Group::MIGRATED_CONTROL) {
+      writer.append(&_values[i], sizeof(CachelineAligned<T>));
+    } else {
+      writer.fill(0, sizeof(CachelineAligned<T>));
+    }
+  }
+  auto values_size = sizeof(CachelineAligned<T>) * bucket_count();
+  writer.fill(0, calculate_allocate_size(bucket_count()) - values_offset -
+                     values_size);
+  return writer.close();
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE int ConcurrentFixedSwissTable<T, H, E>::load_mmap(
+    const char* path) noexcept {
+  static_assert(
+      internal::concurrent_transient_hash_table::IsPersistable<T>::value,
+      "only trivially copyable value can be loaded");
+
+  void* address;
+  size_t size;
+  if (0 != internal::concurrent_transient_hash_table::map_file(path, address,
+                                                               size)) {
+    return -1;
+  }
+
+  // 先组装到临时表，校验失败时随临时表一起解除映射
+  ConcurrentFixedSwissTable table;
+  table._mapping = address;
+  table._mapping_size = size;
+
+  auto header = static_cast<const PersistHeader*>(address);
+  if (size < persist_header_size() || header->magic != PersistHeader::MAGIC ||
+      header->version != PersistHeader::VERSION ||
+      header->value_size != sizeof(T) ||
+      header->value_alignment != static_cast<uint64_t>(VALUE_ALIGNMENT) ||
+      header->bucket_count < Group::SIZE ||
+      (header->bucket_count & (header->bucket_count - 1)) != 0 ||
+      size != persist_header_size() +
+                  calculate_allocate_size(header->bucket_count)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  auto buffer = static_cast<int8_t*>(address) + persist_header_size();
+  table._controls = reinterpret_cast<::std::atomic<int8_t>*>(buffer);
+  table._values = reinterpret_cast<CachelineAligned<T>*>(
+      buffer + calculate_values_offset(header->bucket_count));
+  table._bucket_mask = header->bucket_count - 1;
+  table._size << static_cast<ssize_t>(header->size);
+  if (table.hash_fingerprint() != header->hash_fingerprint) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  swap(table);
+  return 0;
+}
+
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE void
 ConcurrentFixedSwissTable<T, H, E>::construct_with_bucket(
@@ -756,9 +1118,23 @@ ABSL_ATTRIBUTE_NOINLINE ::std::pair<
     typename ConcurrentFixedSwissTable<T, H, E>::iterator, bool>
 ConcurrentFixedSwissTable<T, H, E>::do_emplace(K&& key_or_value,
                                                Args&&... args) noexcept {
+  // 只读映射不可插入，和容量饱和一样返回失败，Args...未被消耗
+  if (ABSL_PREDICT_FALSE(_mapping != nullptr)) {
+    return {end(), false};
+  }
+  auto hash = hasher()(E::extract(key_or_value));
+  return do_emplace_with_hash(hash, ::std::forward<K>(key_or_value),
+                              ::std::forward<Args>(args)...);
+}
+
+template <typename T, typename H, typename E>
+template <typename K, typename... Args>
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE ::std::pair<
+    typename ConcurrentFixedSwissTable<T, H, E>::iterator, bool>
+ConcurrentFixedSwissTable<T, H, E>::do_emplace_with_hash(
+    size_t hash, K&& key_or_value, Args&&... args) noexcept {
   // 哈希值中截取低位用于检测，剩余高位用于桶选择
   auto& key = E::extract(key_or_value);
-  auto hash = hasher()(key);
   int8_t checker = hash & Group::CHECKER_MASK;
   auto base_index = (hash >> Group::CHECKER_MASK_BITS) & _bucket_mask;
 
@@ -785,25 +1161,42 @@ ConcurrentFixedSwissTable<T, H, E>::do_emplace(K&& key_or_value,
     iter = group.match_empty();
     if (iter) {
       auto offset = *iter;
-      // 为了减少查找分支，对于序号在前Group::SIZE - 1的元素需要
-      // 额外向尾部环形追加一份冗余低位哈希
-      // 出于统一编码的考虑，所以位置都会写两次低位哈希
-      // 只是对于低序号以外的部分冗余序号和原始序号是一致的
+      // 出于统一编码的考虑，所有位置都会写两次低位哈希
       auto index = (base_index + offset) & _bucket_mask;
-      auto cloned_index = ((index - Group::GROUP_MASK) & _bucket_mask) +
-                          (Group::GROUP_MASK & _bucket_mask);
       auto& control = _controls[index];
-      auto& cloned_control = _controls[cloned_index];
+      auto& cloned_control = _controls[cloned_index(index)];
       int8_t control_value = Group::EMPTY_CONTROL;
       // 统一采用原始序号竞争写入权限
       if (control.compare_exchange_strong(control_value, Group::BUSY_CONTROL,
                                           ::std::memory_order_acquire,
                                           ::std::memory_order_relaxed)) {
+        // 持有空位期间，同一个key的插入都会在这里避让等待
+        // 重新确认探测路径上不存在key，并优先复用路径上已回收的墓碑
+        auto revived = recheck_and_revive(key, hash, step);
+        if (ABSL_PREDICT_FALSE(revived.second)) {
+          // 空位之前被其他线程借用，key已经写入到了墓碑中
+          control.store(Group::EMPTY_CONTROL, ::std::memory_order_release);
+          return {{*this, revived.first}, false};
+        } else if (revived.first != bucket_count()) {
+          auto revived_index = revived.first;
+          UsesAllocatorConstructor::construct(
+              &at(revived_index), allocator_type(),
+              ::std::forward<K>(key_or_value), ::std::forward<Args>(args)...);
+          _controls[cloned_index(revived_index)].store(
+              checker, ::std::memory_order_release);
+          _controls[revived_index].store(checker, ::std::memory_order_release);
+          // 写入完成后再归还空位，后续等待者重新确认时可以看到这次写入
+          control.store(Group::EMPTY_CONTROL, ::std::memory_order_release);
+          _size << 1;
+          return {{*this, revived_index}, true};
+        }
         UsesAllocatorConstructor::construct(&at(index), allocator_type(),
                                             ::std::forward<K>(key_or_value),
                                             ::std::forward<Args>(args)...);
-        control.store(checker, ::std::memory_order_release);
+        // 先写冗余位再写原始位，删除以原始位为准竞争
+        // 确保删除标记不会被这里延后的冗余位写入覆盖
         cloned_control.store(checker, ::std::memory_order_release);
+        control.store(checker, ::std::memory_order_release);
         _size << 1;
         return {{*this, index}, true};
       } else if (control_value == Group::DUMMY_CONTROL) {
@@ -826,11 +1219,201 @@ ConcurrentFixedSwissTable<T, H, E>::do_emplace(K&& key_or_value,
   return {end(), false};
 }
 
+template <typename T, typename H, typename E>
+template <typename K>
+ABSL_ATTRIBUTE_NOINLINE ::std::pair<size_t, bool>
+ConcurrentFixedSwissTable<T, H, E>::recheck_and_revive(
+    const K& key, size_t hash, size_t end_step) noexcept {
+  int8_t checker = hash & Group::CHECKER_MASK;
+  auto base_index = (hash >> Group::CHECKER_MASK_BITS) & _bucket_mask;
+
+  // 空位之前的组不会再出现空位，同一个key的插入只可能发生在
+  // 持有空位的线程中，这里看到的就是key在探测路径上的全部状态
+  size_t revived_index = bucket_count();
+  size_t step = 0;
+  while (true) {
+    Group group {_controls + base_index};
+    auto iter = group.match(checker);
+    while (iter) {
+      auto offset = *iter++;
+      auto index = (base_index + offset) & _bucket_mask;
+      ::std::atomic_thread_fence(::std::memory_order_acquire);
+#if ABSL_HAVE_THREAD_SANITIZER
+      __tsan_acquire(_controls + base_index + offset);
+#endif // ABSL_HAVE_THREAD_SANITIZER
+      if (E::extract(at(index)) == key) {
+        return {index, true};
+      }
+    }
+    if (revived_index == bucket_count()) {
+      auto reclaimed_iter = group.match(Group::RECLAIMED_CONTROL);
+      if (reclaimed_iter) {
+        revived_index = (base_index + *reclaimed_iter) & _bucket_mask;
+      }
+    }
+    if (step >= end_step) {
+      break;
+    }
+
+    step += Group::SIZE;
+    base_index = (base_index + step) & _bucket_mask;
+  }
+
+  // 墓碑可能同时处于其他key的探测路径上，竞争失败时退回使用空位
+  if (revived_index != bucket_count()) {
+    int8_t control_value = Group::RECLAIMED_CONTROL;
+    if (!_controls[revived_index].compare_exchange_strong(
+            control_value, Group::REVIVING_CONTROL, ::std::memory_order_acquire,
+            ::std::memory_order_relaxed)) {
+      revived_index = bucket_count();
+    }
+  }
+  return {revived_index, false};
+}
+
+template <typename T, typename H, typename E>
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE void
+ConcurrentFixedSwissTable<T, H, E>::prefetch(size_t hash) const noexcept {
+  auto base_index = (hash >> Group::CHECKER_MASK_BITS) & _bucket_mask;
+  // 控制字节组可能跨越两个缓存行，首尾各预取一次
+  __builtin_prefetch(_controls + base_index);
+  __builtin_prefetch(_controls + base_index + Group::GROUP_MASK);
+  // 低负载下元素大概率就位于起始位置
+  __builtin_prefetch(_values + base_index);
+}
+
 template <typename T, typename H, typename E>
 inline T& ConcurrentFixedSwissTable<T, H, E>::at(size_t index) noexcept {
   return _values[index];
 }
 
+template <typename T, typename H, typename E>
+inline size_t ConcurrentFixedSwissTable<T, H, E>::cloned_index(
+    size_t index) const noexcept {
+  return ((index - Group::GROUP_MASK) & _bucket_mask) +
+         (Group::GROUP_MASK & _bucket_mask);
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentFixedSwissTable<T, H, E>::reclaim(
+    size_t index) noexcept {
+  at(index).~T();
+  _controls[cloned_index(index)].store(Group::RECLAIMED_CONTROL,
+                                       ::std::memory_order_release);
+  _controls[index].store(Group::RECLAIMED_CONTROL,
+                         ::std::memory_order_release);
+}
+
+template <typename T, typename H, typename E>
+template <typename C>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentFixedSwissTable<T, H, E>::migrate_group(
+    size_t base_index, C&& copier) noexcept {
+  for (size_t offset = 0; offset < Group::SIZE; ++offset) {
+    auto index = base_index + offset;
+    auto& control = _controls[index];
+    auto control_value = control.load(::std::memory_order_acquire);
+    // 其他线程正在插入过程中，避让等待
+    while (control_value == Group::BUSY_CONTROL ||
+           control_value == Group::REVIVING_CONTROL) {
+      ::sched_yield();
+      control_value = control.load(::std::memory_order_acquire);
+    }
+    // 空位、墓碑等特殊值都无需迁移
+    if (control_value < 0) {
+      continue;
+    }
+#if ABSL_HAVE_THREAD_SANITIZER
+    __tsan_acquire(&control);
+#endif // ABSL_HAVE_THREAD_SANITIZER
+    // 先写入副本再标记原位置，确保任何时刻都至少有一处可以查找到
+    auto result = copier(static_cast<const T&>(at(index)));
+    if (!abandon(index, control_value) && result.second) {
+      // 复制期间原位置被并发删除，撤销刚刚写入的副本
+      result.first._table->abandon(result.first._index, control_value);
+    }
+  }
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE bool ConcurrentFixedSwissTable<T, H, E>::abandon(
+    size_t index, int8_t checker) noexcept {
+  // 和删除一样以原始位为准竞争，release保证观测到标记的一方也能看到副本
+  if (!_controls[index].compare_exchange_strong(
+          checker, Group::MIGRATED_CONTROL, ::std::memory_order_release,
+          ::std::memory_order_relaxed)) {
+    return false;
+  }
+  _controls[cloned_index(index)].store(Group::MIGRATED_CONTROL,
+                                       ::std::memory_order_relaxed);
+  _size << -1;
+  return true;
+}
+
+template <typename T, typename H, typename E>
+inline typename ConcurrentFixedSwissTable<T, H, E>::Reclaimer
+ConcurrentFixedSwissTable<T, H, E>::release_reclaimer() noexcept {
+  return Reclaimer {*this, SIZE_MAX};
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE void
+ConcurrentFixedSwissTable<T, H, E>::release() noexcept {
+  // 删除的元素对应的回收动作可能还在其他gc中排队，需要保留存储
+  for (size_t i = 0; i < bucket_count(); i += Group::SIZE) {
+    Group group {_controls + i};
+    if (group.match(Group::DELETED_CONTROL)) {
+      return;
+    }
+  }
+  ConcurrentFixedSwissTable table;
+  swap(table);
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE size_t
+ConcurrentFixedSwissTable<T, H, E>::persist_header_size() noexcept {
+  return align_up(sizeof(PersistHeader), VALUE_ALIGNMENT);
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE size_t
+ConcurrentFixedSwissTable<T, H, E>::hash_fingerprint() const noexcept {
+  // 标准库哈希没有种子，实现却可能随编译环境变化
+  // 通过重新计算已有元素的哈希来检测，取前16个足以覆盖常见情况
+  size_t fingerprint = 0;
+  size_t count = 0;
+  for (auto& value : *this) {
+    fingerprint = fingerprint * 31 + hasher()(E::extract(value));
+    if (++count >= 16) {
+      break;
+    }
+  }
+  return fingerprint;
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE bool ConcurrentFixedSwissTable<T, H, E>::purgeable(
+    size_t index) const noexcept {
+  // 分别向前向后寻找最近的空位，如果二者距离不超过一个组大小
+  // 那么任何覆盖index的组都至少包含二者之一
+  // 由于空位只会被插入消耗，或者由compact在相同条件下产生
+  // 可以推知这些组从未满过，也就不存在穿过index的探测链
+  // 恢复为空位不会截断其他元素的查找
+  size_t before = 1;
+  while (before < Group::SIZE &&
+         _controls[(index - before) & _bucket_mask].load(
+             ::std::memory_order_relaxed) != Group::EMPTY_CONTROL) {
+    before++;
+  }
+  size_t after = 1;
+  while (after < Group::SIZE &&
+         _controls[(index + after) & _bucket_mask].load(
+             ::std::memory_order_relaxed) != Group::EMPTY_CONTROL) {
+    after++;
+  }
+  return before + after <= Group::SIZE;
+}
+
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE typename ::std::tuple<
     size_t, typename ConcurrentFixedSwissTable<T, H, E>::GroupIterator>
@@ -929,6 +1512,17 @@ ConcurrentTransientHashSet<T, H, E>::Iterator<CONST>::Iterator(
 // ConcurrentTransientHashSet::Iterator end
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentTransientHashSet::TableNode begin
+template <typename T, typename H, typename E>
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE bool
+ConcurrentTransientHashSet<T, H, E>::TableNode::retired() const noexcept {
+  return migrated_groups.load(::std::memory_order_acquire) ==
+         table.bucket_count() / Group::SIZE;
+}
+// ConcurrentTransientHashSet::TableNode end
+////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // ConcurrentTransientHashSet begin
 template <typename T, typename H, typename E>
@@ -943,7 +1537,10 @@ template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE
 ConcurrentTransientHashSet<T, H, E>::ConcurrentTransientHashSet(
     const ConcurrentTransientHashSet& other) noexcept
-    : _head {other.size()} {
+    : _head {other.size()},
+      _migration_step {other._migration_step},
+      _gc {other._gc},
+      _retire_table {other._retire_table} {
   for (auto& value : other) {
     _head.table.emplace(value);
   }
@@ -969,9 +1566,17 @@ ConcurrentTransientHashSet<T, H, E>::operator=(
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE ConcurrentTransientHashSet<
     T, H, E>::~ConcurrentTransientHashSet() noexcept {
-  auto node = _head.next.load(::std::memory_order_relaxed);
+  auto node = _first.load(::std::memory_order_relaxed);
   while (node != nullptr) {
     auto next = node->next.load(::std::memory_order_relaxed);
+    if (node != &_head) {
+      delete node;
+    }
+    node = next;
+  }
+  node = _retired.load(::std::memory_order_relaxed);
+  while (node != nullptr) {
+    auto next = node->next_retired;
     delete node;
     node = next;
   }
@@ -986,18 +1591,16 @@ ConcurrentTransientHashSet<T, H, E>::ConcurrentTransientHashSet(
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE typename ConcurrentTransientHashSet<T, H, E>::iterator
 ConcurrentTransientHashSet<T, H, E>::begin() noexcept {
-  auto node = _head.next.load(::std::memory_order_acquire);
-  auto iter = _head.table.begin();
-  if (iter != _head.table.end()) {
-    return {node, iter};
-  }
-  while (ABSL_PREDICT_FALSE(node != nullptr)) {
-    iter = node->table.begin();
+  // 删除或迁移后前面的子表可能为空，而后续子表依然存在元素
+  auto node = _first.load(::std::memory_order_acquire);
+  do {
+    auto iter = node->table.begin();
+    auto next = node->next.load(::std::memory_order_acquire);
     if (iter != node->table.end()) {
-      return {nullptr, iter};
+      return {next, iter};
     }
-    node = _head.next.load(::std::memory_order_acquire);
-  }
+    node = next;
+  } while (ABSL_PREDICT_FALSE(node != nullptr));
   return {};
 }
 
@@ -1029,15 +1632,16 @@ ConcurrentTransientHashSet<T, H, E>::end() const noexcept {
 template <typename T, typename H, typename E>
 inline ABSL_ATTRIBUTE_ALWAYS_INLINE bool
 ConcurrentTransientHashSet<T, H, E>::empty() const noexcept {
-  return _head.table.empty();
+  return size() == 0;
 }
 
 template <typename T, typename H, typename E>
 inline ABSL_ATTRIBUTE_ALWAYS_INLINE size_t
 ConcurrentTransientHashSet<T, H, E>::size() const noexcept {
-  auto node = _head.next.load(::std::memory_order_acquire);
-  if (ABSL_PREDICT_TRUE(node == nullptr)) {
-    return _head.table.size();
+  auto node = _first.load(::std::memory_order_acquire);
+  if (ABSL_PREDICT_TRUE(node->next.load(::std::memory_order_acquire) ==
+                        nullptr)) {
+    return node->table.size();
   }
   return total_size(node);
 }
@@ -1045,12 +1649,16 @@ ConcurrentTransientHashSet<T, H, E>::size() const noexcept {
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE void
 ConcurrentTransientHashSet<T, H, E>::clear() noexcept {
-  auto node = _head.next.load(::std::memory_order_relaxed);
-  if (ABSL_PREDICT_TRUE(node == nullptr)) {
+  auto node = _first.load(::std::memory_order_relaxed);
+  if (ABSL_PREDICT_TRUE(node == &_head && node->next.load(
+                                              ::std::memory_order_relaxed) ==
+                                              nullptr)) {
     return _head.table.clear();
   }
 
-  *this = ConcurrentTransientHashSet {size()};
+  ConcurrentTransientHashSet tmp {size()};
+  tmp.copy_migration_setting(*this);
+  *this = ::std::move(tmp);
 }
 
 template <typename T, typename H, typename E>
@@ -1069,11 +1677,48 @@ template <typename T, typename H, typename E>
 template <typename... Args>
 inline ::std::pair<typename ConcurrentTransientHashSet<T, H, E>::iterator, bool>
 ConcurrentTransientHashSet<T, H, E>::emplace(Args&&... args) noexcept {
-  auto node = &_head;
+  auto node = _first.load(::std::memory_order_acquire);
+  if (ABSL_PREDICT_FALSE(node->next.load(::std::memory_order_acquire) !=
+                         nullptr)) {
+    return emplace_in_chain(::std::forward<Args>(args)...);
+  }
+  auto result = emplace_from(node, ::std::forward<Args>(args)...);
+  return {{nullptr, result.first}, result.second};
+}
+
+template <typename T, typename H, typename E>
+template <typename K, typename... Args>
+ABSL_ATTRIBUTE_NOINLINE ::std::pair<
+    typename ConcurrentTransientHashSet<T, H, E>::iterator, bool>
+ConcurrentTransientHashSet<T, H, E>::emplace_in_chain(
+    K&& key_or_value, Args&&... args) noexcept {
+  auto node = migrate();
+  // 已经开始迁移的子表中，插入可能落入已经完成迁移的组而被遗漏
+  // 因此只在这里确认元素不存在，实际插入交给后续子表
+  if (node->migrate_cursor.load(::std::memory_order_acquire) > 0) {
+    auto result = node->table.find(E::extract(key_or_value));
+    if (result != node->table.end()) {
+      return {{nullptr, result}, false};
+    }
+    // 迁移先写入副本再标记原位置，未命中时确保后续子表中的副本可见
+    ::std::atomic_thread_fence(::std::memory_order_acquire);
+    node = node->next.load(::std::memory_order_acquire);
+  }
+  auto result = emplace_from(node, ::std::forward<K>(key_or_value),
+                             ::std::forward<Args>(args)...);
+  return {{nullptr, result.first}, result.second};
+}
+
+template <typename T, typename H, typename E>
+template <typename... Args>
+inline ::std::pair<
+    typename ConcurrentTransientHashSet<T, H, E>::Table::iterator, bool>
+ConcurrentTransientHashSet<T, H, E>::emplace_from(TableNode* node,
+                                                  Args&&... args) noexcept {
   while (true) {
     auto result = node->table.emplace(::std::forward<Args>(args)...);
     if (result.first != node->table.end()) {
-      return {{nullptr, result.first}, result.second};
+      return result;
     }
 
     auto next = node->next.load(::std::memory_order_acquire);
@@ -1091,10 +1736,81 @@ ConcurrentTransientHashSet<T, H, E>::emplace(Args&&... args) noexcept {
   }
 }
 
+template <typename T, typename H, typename E>
+template <typename K, typename R>
+inline size_t ConcurrentTransientHashSet<T, H, E>::erase(
+    const K& key, GarbageCollector<R>& gc) noexcept {
+  size_t erased = 0;
+  auto node = first_active_node();
+  do {
+    erased += node->table.erase(key, gc);
+    // 迁移过程中元素可能短暂同时存在于前后两张子表，需要一并删除
+    if (erased > 0 && _migration_step == 0) {
+      return 1;
+    }
+    node = node->next.load(::std::memory_order_acquire);
+  } while (node != nullptr);
+  return erased > 0 ? 1 : 0;
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE size_t
+ConcurrentTransientHashSet<T, H, E>::compact() noexcept {
+  auto node = _first.load(::std::memory_order_acquire);
+  auto next = node->next.load(::std::memory_order_acquire);
+  while (next != nullptr) {
+    node = next;
+    next = node->next.load(::std::memory_order_acquire);
+  }
+  return node->table.compact();
+}
+
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::swap(
     ConcurrentTransientHashSet& other) noexcept {
+  // 头表内嵌在容器中，交换后指向头表的_first需要随之修正
+  auto first = _first.load(::std::memory_order_relaxed);
+  auto other_first = other._first.load(::std::memory_order_relaxed);
   ::std::swap(_head, other._head);
+  _first.store(other_first == &other._head ? &_head : other_first,
+               ::std::memory_order_relaxed);
+  other._first.store(first == &_head ? &other._head : first,
+                     ::std::memory_order_relaxed);
+  auto retired = _retired.load(::std::memory_order_relaxed);
+  _retired.store(other._retired.load(::std::memory_order_relaxed),
+                 ::std::memory_order_relaxed);
+  other._retired.store(retired, ::std::memory_order_relaxed);
+  ::std::swap(_migration_step, other._migration_step);
+  ::std::swap(_gc, other._gc);
+  ::std::swap(_retire_table, other._retire_table);
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE void
+ConcurrentTransientHashSet<T, H, E>::set_migration_step(
+    size_t groups) noexcept {
+  _migration_step = groups;
+  _gc = nullptr;
+  _retire_table = nullptr;
+}
+
+template <typename T, typename H, typename E>
+template <typename R>
+ABSL_ATTRIBUTE_NOINLINE void
+ConcurrentTransientHashSet<T, H, E>::set_migration_step(
+    size_t groups, GarbageCollector<R>& gc) noexcept {
+  _migration_step = groups;
+  _gc = &gc;
+  _retire_table = &retire_table<R>;
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE void
+ConcurrentTransientHashSet<T, H, E>::copy_migration_setting(
+    const ConcurrentTransientHashSet& other) noexcept {
+  _migration_step = other._migration_step;
+  _gc = other._gc;
+  _retire_table = other._retire_table;
 }
 
 template <typename T, typename H, typename E>
@@ -1108,22 +1824,22 @@ template <typename T, typename H, typename E>
 template <typename K>
 inline typename ConcurrentTransientHashSet<T, H, E>::iterator
 ConcurrentTransientHashSet<T, H, E>::find(const K& key) noexcept {
-  auto result = _head.table.find(key);
-  if (result != _head.table.end()) {
-    return {nullptr, result};
+  auto node = _first.load(::std::memory_order_acquire);
+  if (ABSL_PREDICT_FALSE(node->next.load(::std::memory_order_acquire) !=
+                         nullptr)) {
+    return find_in_chain(key);
   }
 
-  auto node = _head.next.load(::std::memory_order_acquire);
-  if (ABSL_PREDICT_FALSE(node != nullptr)) {
-    do {
-      result = node->table.find(key);
-      if (result != node->table.end()) {
-        return {nullptr, result};
-      }
-      node = node->next.load(::std::memory_order_acquire);
-    } while (node != nullptr);
+  auto result = node->table.find(key);
+  if (result != node->table.end()) {
+    return {nullptr, result};
+  }
+  // 查找期间子表可能刚好完成扩展并被迁移走，未命中时回到链表中确认
+  ::std::atomic_thread_fence(::std::memory_order_acquire);
+  if (ABSL_PREDICT_FALSE(node->next.load(::std::memory_order_acquire) !=
+                         nullptr)) {
+    return find_in_chain(key);
   }
-
   return {};
 }
 
@@ -1142,23 +1858,81 @@ inline bool ConcurrentTransientHashSet<T, H, E>::contains(
   return find(key) != end();
 }
 
+template <typename T, typename H, typename E>
+template <typename K, typename C>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::find_batch(
+    const K* keys, size_t num, C&& callback) noexcept {
+  auto node = _first.load(::std::memory_order_acquire);
+  if (ABSL_PREDICT_FALSE(node->next.load(::std::memory_order_acquire) !=
+                         nullptr)) {
+    for (size_t i = 0; i < num; ++i) {
+      callback(i, find_in_chain(keys[i]));
+    }
+    return;
+  }
+
+  node->table.find_batch(
+      keys, num, [&](size_t i, typename Table::iterator result) {
+        if (result != node->table.end()) {
+          callback(i, iterator {nullptr, result});
+          return;
+        }
+        // 同find，未命中时确认子表没有在查找期间被迁移走
+        ::std::atomic_thread_fence(::std::memory_order_acquire);
+        if (ABSL_PREDICT_FALSE(node->next.load(::std::memory_order_acquire) !=
+                               nullptr)) {
+          callback(i, find_in_chain(keys[i]));
+        } else {
+          callback(i, iterator {});
+        }
+      });
+}
+
+template <typename T, typename H, typename E>
+template <typename K, typename C>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::emplace_batch(
+    const K* keys, size_t num, C&& callback) noexcept {
+  auto node = _first.load(::std::memory_order_acquire);
+  if (ABSL_PREDICT_FALSE(node->next.load(::std::memory_order_acquire) !=
+                         nullptr)) {
+    for (size_t i = 0; i < num; ++i) {
+      callback(i, emplace(keys[i]));
+    }
+    return;
+  }
+
+  node->table.emplace_batch(
+      keys, num,
+      [&](size_t i, ::std::pair<typename Table::iterator, bool> result) {
+        // 头表已满，经由扩展子表完成插入
+        if (ABSL_PREDICT_FALSE(result.first == node->table.end())) {
+          result = emplace_from(node, keys[i]);
+        }
+        callback(i, ::std::pair<iterator, bool> {{nullptr, result.first},
+                                                 result.second});
+      });
+}
+
 template <typename T, typename H, typename E>
 inline size_t ConcurrentTransientHashSet<T, H, E>::bucket_count()
     const noexcept {
-  return _head.table.bucket_count();
+  return _first.load(::std::memory_order_acquire)->table.bucket_count();
 }
 
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::rehash(
     size_t min_bucket_count) noexcept {
-  auto node = _head.next.load(::std::memory_order_relaxed);
-  if (ABSL_PREDICT_TRUE(node == nullptr)) {
+  auto node = _first.load(::std::memory_order_relaxed);
+  if (ABSL_PREDICT_TRUE(node == &_head && node->next.load(
+                                              ::std::memory_order_relaxed) ==
+                                              nullptr)) {
     _head.table.rehash(min_bucket_count);
     return;
   }
 
   min_bucket_count = ::std::max(size(), min_bucket_count);
   ConcurrentTransientHashSet tmp {min_bucket_count};
+  tmp.copy_migration_setting(*this);
   for (auto& value : *this) {
     tmp.emplace(::std::move(value));
   }
@@ -1168,14 +1942,17 @@ ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::rehash(
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::reserve(
     size_t min_size) noexcept {
-  auto node = _head.next.load(::std::memory_order_relaxed);
-  if (ABSL_PREDICT_TRUE(node == nullptr)) {
+  auto node = _first.load(::std::memory_order_relaxed);
+  if (ABSL_PREDICT_TRUE(node == &_head && node->next.load(
+                                              ::std::memory_order_relaxed) ==
+                                              nullptr)) {
     _head.table.reserve(min_size);
     return;
   }
 
   min_size = ::std::max(size(), min_size);
   ConcurrentTransientHashSet tmp {min_size};
+  tmp.copy_migration_setting(*this);
   for (auto& value : *this) {
     tmp.emplace(::std::move(value));
   }
@@ -1185,16 +1962,114 @@ ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::reserve(
 template <typename T, typename H, typename E>
 ABSL_ATTRIBUTE_NOINLINE size_t ConcurrentTransientHashSet<T, H, E>::total_size(
     TableNode* node) const noexcept {
-  auto sum = _head.table.bucket_count();
-  while (true) {
+  // 支持删除后前面的子表也不一定是满的，需要逐个统计
+  size_t sum = 0;
+  while (node != nullptr) {
+    sum += node->table.size();
+    node = node->next.load(::std::memory_order_acquire);
+  }
+  return sum;
+}
+
+template <typename T, typename H, typename E>
+template <typename K>
+ABSL_ATTRIBUTE_NOINLINE typename ConcurrentTransientHashSet<T, H, E>::iterator
+ConcurrentTransientHashSet<T, H, E>::find_in_chain(const K& key) noexcept {
+  auto node = migrate();
+  do {
+    auto result = node->table.find(key);
+    if (result != node->table.end()) {
+      return {nullptr, result};
+    }
+    // 迁移先写入副本再标记原位置，未命中时确保后续子表中的副本可见
+    ::std::atomic_thread_fence(::std::memory_order_acquire);
+    node = node->next.load(::std::memory_order_acquire);
+  } while (node != nullptr);
+  return {};
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE typename ConcurrentTransientHashSet<T, H, E>::TableNode*
+ConcurrentTransientHashSet<T, H, E>::first_active_node() noexcept {
+  // 迁移总是从最早的子表开始逐张进行，完成迁移的子表一定构成前缀
+  // 竞争摘除成功的一方负责释放，之后查找可以恢复到单表的快速路径
+  auto node = _first.load(::std::memory_order_acquire);
+  while (ABSL_PREDICT_FALSE(node->retired())) {
     auto next = node->next.load(::std::memory_order_acquire);
-    if (next == nullptr) {
-      return sum + node->table.size();
+    if (_first.compare_exchange_strong(node, next,
+                                       ::std::memory_order_acq_rel,
+                                       ::std::memory_order_acquire)) {
+      retire(node);
+      node = next;
     }
-    sum += node->table.bucket_count();
-    node = next;
+  }
+  return node;
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::retire(
+    TableNode* node) noexcept {
+  if (node != &_head) {
+    auto retired = _retired.load(::std::memory_order_relaxed);
+    do {
+      node->next_retired = retired;
+    } while (!_retired.compare_exchange_weak(retired, node,
+                                             ::std::memory_order_release,
+                                             ::std::memory_order_relaxed));
+  }
+  if (_retire_table != nullptr) {
+    _retire_table(_gc, node->table);
+  }
+}
+
+template <typename T, typename H, typename E>
+template <typename R>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::retire_table(
+    void* gc, Table& table) noexcept {
+  static_cast<GarbageCollector<R>*>(gc)->retire(
+      R {table.release_reclaimer()});
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE typename ConcurrentTransientHashSet<T, H, E>::TableNode*
+ConcurrentTransientHashSet<T, H, E>::migrate() noexcept {
+  auto node = first_active_node();
+  if (_migration_step > 0 &&
+      node->next.load(::std::memory_order_acquire) != nullptr) {
+    migrate(node, ::std::is_copy_constructible<T> {});
+    if (node->retired()) {
+      node = first_active_node();
+    }
+  }
+  return node;
+}
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::migrate(
+    TableNode* node, ::std::true_type) noexcept {
+  auto next = node->next.load(::std::memory_order_acquire);
+  auto group_count = node->table.bucket_count() / Group::SIZE;
+  for (size_t i = 0; i < _migration_step; ++i) {
+    // 全部认领完毕后只剩读取，避免读路径反复修改同一个缓存行
+    if (node->migrate_cursor.load(::std::memory_order_relaxed) >=
+        group_count) {
+      return;
+    }
+    // 以组为单位认领，同一个组只会由一个线程迁移
+    auto group = node->migrate_cursor.fetch_add(1, ::std::memory_order_relaxed);
+    if (group >= group_count) {
+      return;
+    }
+    node->table.migrate_group(group * Group::SIZE, [&](const T& value) {
+      return emplace_from(next, value);
+    });
+    node->migrated_groups.fetch_add(1, ::std::memory_order_release);
   }
 }
+
+template <typename T, typename H, typename E>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentTransientHashSet<T, H, E>::migrate(
+    TableNode*, ::std::false_type) noexcept {}
 // ConcurrentTransientHashSet end
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -14,6 +14,7 @@ class ConcurrentTransientTopic {
  public:
   class Iterator;
   class Consumer;
+  class ConsumerGroup;
   class ConstConsumer;
   class ConstConsumeRange;
 
@@ -66,6 +67,11 @@ class ConcurrentTransientTopic {
   inline Consumer subscribe() noexcept;
   inline ConstConsumer subscribe() const noexcept;
 
+  // 创建一个消费组，组内的多个消费者共享同一个消费进度
+  // 每个数据只会被组内的一个消费者获取，适合多个线程分摊处理同一份数据流
+  // 消费组之间以及和subscribe创建的消费者之间相互独立，各自从0开始消费全部数据
+  inline ConsumerGroup subscribe_group() noexcept;
+
   // 清理已发布数据，重置进度，以便重新使用
   // 不会释放已经填充的数据，后续publish可以复用这些对象
   inline void clear() noexcept;
@@ -124,6 +130,7 @@ class ConcurrentTransientTopic {
     size_t _size {0};
 
     friend class Consumer;
+    friend class ConsumerGroup;
   };
 
   // 消费者，通过subscribe创建
@@ -156,6 +163,45 @@ class ConcurrentTransientTopic {
     friend class ConcurrentTransientTopic;
   };
 
+  // 消费组，通过subscribe_group创建
+  // 和Consumer不同，同一个消费组的consume可以被多个线程并发调用
+  // 每次consume通过一次原子操作从共享进度上认领一段互不重叠的区间
+  //
+  // 认领只会等待首个位置就绪，之后只连续认领已经发布的部分
+  // 因此返回的区段可能少于num，即使尚未关闭也是如此
+  // 这保证了关闭后，不会有消费者认领关闭位置之后永远不会发布的数据而无法结束
+  // topic在clear后需要重新创建消费组
+  class ConsumerGroup {
+   public:
+    // 默认构造无效空实例
+    inline ConsumerGroup() noexcept = default;
+    inline ConsumerGroup(ConsumerGroup&& other) noexcept;
+    ConsumerGroup(const ConsumerGroup&) = delete;
+    inline ConsumerGroup& operator=(ConsumerGroup&& other) noexcept;
+    ConsumerGroup& operator=(const ConsumerGroup&) = delete;
+
+    // 判断是否是个有效实例
+    inline operator bool() const noexcept;
+
+    // 【线程安全】已经关闭且数据全部被组内认领后，返回nullptr
+    // 否则认领一个数据并返回数据指针
+    inline T* consume() noexcept;
+
+    // 【线程安全】已经关闭且数据全部被组内认领后，返回无效ConsumeRange
+    // 否则认领并返回[1, num]个已发布数据构成的ConsumeRange
+    // num为0时直接返回空区段，不会改变组内进度
+    inline ConsumeRange consume(size_t num) noexcept;
+
+   private:
+    inline ConsumerGroup(ConcurrentTransientTopic* queue) noexcept;
+
+    ConcurrentTransientTopic* _queue {nullptr};
+    alignas(BABYLON_CACHELINE_SIZE)::std::atomic<size_t> _next_consume_index {
+        0};
+
+    friend class ConcurrentTransientTopic;
+  };
+
   class ConstConsumeRange : private ConsumeRange {
    public:
     inline ConstConsumeRange() noexcept = default;
@@ -224,6 +270,7 @@ class ConcurrentTransientTopic {
   alignas(BABYLON_CACHELINE_SIZE)::std::atomic<size_t> _next_event_index {0};
 
   friend class Consumer;
+  friend class ConsumerGroup;
 };
 
 BABYLON_NAMESPACE_END
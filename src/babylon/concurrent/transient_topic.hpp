@@ -110,6 +110,12 @@ ConcurrentTransientTopic<T, S>::subscribe() const noexcept {
   return const_cast<ConcurrentTransientTopic<T, S>*>(this)->subscribe();
 }
 
+template <typename T, typename S>
+inline typename ConcurrentTransientTopic<T, S>::ConsumerGroup
+ConcurrentTransientTopic<T, S>::subscribe_group() noexcept {
+  return ConsumerGroup(this);
+}
+
 template <typename T, typename S>
 inline void ConcurrentTransientTopic<T, S>::clear() noexcept {
   _slots.for_each(0, _slots.size(), [](Slot* iter, Slot* end) {
@@ -404,6 +410,87 @@ inline ConcurrentTransientTopic<T, S>::Consumer::Consumer(
 // ConcurrentTransientTopic::Consumer end
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// ConcurrentTransientTopic::ConsumerGroup begin
+template <typename T, typename S>
+inline ConcurrentTransientTopic<T, S>::ConsumerGroup::ConsumerGroup(
+    ConsumerGroup&& other) noexcept {
+  *this = ::std::move(other);
+}
+
+template <typename T, typename S>
+inline typename ConcurrentTransientTopic<T, S>::ConsumerGroup&
+ConcurrentTransientTopic<T, S>::ConsumerGroup::operator=(
+    ConsumerGroup&& other) noexcept {
+  ::std::swap(_queue, other._queue);
+  auto tmp = _next_consume_index.load(::std::memory_order_relaxed);
+  _next_consume_index.store(
+      other._next_consume_index.load(::std::memory_order_relaxed),
+      ::std::memory_order_relaxed);
+  other._next_consume_index.store(tmp, ::std::memory_order_relaxed);
+  return *this;
+}
+
+template <typename T, typename S>
+inline ConcurrentTransientTopic<T, S>::ConsumerGroup::operator bool()
+    const noexcept {
+  return _queue != nullptr;
+}
+
+template <typename T, typename S>
+inline T* ConcurrentTransientTopic<T, S>::ConsumerGroup::consume() noexcept {
+  auto range = consume(1);
+  if (range.size() > 0) {
+    return &range[0];
+  }
+  return nullptr;
+}
+
+template <typename T, typename S>
+inline typename ConcurrentTransientTopic<T, S>::ConsumeRange
+ConcurrentTransientTopic<T, S>::ConsumerGroup::consume(size_t num) noexcept {
+  auto begin_index = _next_consume_index.load(::std::memory_order_relaxed);
+  // 和Consumer一致返回空区段，不等待也不认领
+  if (ABSL_PREDICT_FALSE(num == 0)) {
+    return ConsumeRange {_queue->_slots.reserved_snapshot(begin_index),
+                         begin_index, 0};
+  }
+  while (true) {
+    auto end_index = begin_index + num;
+    auto snapshot = _queue->_slots.reserved_snapshot(end_index);
+    // 只等待首个位置，关闭位置之后的数据永远不会就绪
+    auto& first_slot = snapshot[begin_index];
+    first_slot.futex.wait_until_ready();
+    if (first_slot.futex.is_closed()) {
+      return {};
+    }
+    size_t consumed = 1;
+    while (consumed < num &&
+           snapshot[begin_index + consumed].futex.is_published()) {
+      ++consumed;
+    }
+    // 认领失败时begin_index更新为最新进度，重新等待和认领
+    if (_next_consume_index.compare_exchange_weak(
+            begin_index, begin_index + consumed,
+            ::std::memory_order_relaxed)) {
+      ::std::atomic_thread_fence(::std::memory_order_acquire);
+#if ABSL_HAVE_THREAD_SANITIZER
+      for (size_t i = 0; i < consumed; ++i) {
+        snapshot[begin_index + i].futex.mark_tsan_acquire();
+      }
+#endif // ABSL_HAVE_THREAD_SANITIZER
+      return ConsumeRange {snapshot, begin_index, consumed};
+    }
+  }
+}
+
+template <typename T, typename S>
+inline ConcurrentTransientTopic<T, S>::ConsumerGroup::ConsumerGroup(
+    ConcurrentTransientTopic* queue) noexcept
+    : _queue(queue) {}
+// ConcurrentTransientTopic::ConsumerGroup end
+///////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // ConcurrentTransientTopic::ConstConsumeRange begin
 template <typename T, typename S>
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "babylon/concurrent/bounded_queue.h"     // ConcurrentBoundedQueue
+#include "babylon/concurrent/garbage_collector.h" // GarbageCollector
+#include "babylon/concurrent/sched_interface.h"   // Futex
+#include "babylon/environment.h"
+#include "babylon/type_traits.h" // IsInvocable
+
+#include <atomic> // std::atomic
+#include <memory> // std::unique_ptr
+#include <mutex>  // std::once_flag
+
+BABYLON_NAMESPACE_BEGIN
+
+// Unbounded MPMC queue built from a linked list of fixed size segments. Slot
+// and futex design follow ConcurrentBoundedQueue:
+// 1. push and pop claim their index by a single fetch_add, then operate on
+//    the corresponding slot without contention
+// 2. push never block, a new segment is linked when index run out of the
+//    last one
+// 3. pop block on futex of its own slot when queue is empty, and the matching
+//    push wake it up
+//
+// Segment is located by walking from a head or tail hint inside an Epoch
+// critical region. Once all slots of a segment are consumed, it is unlinked
+// and retired to a GarbageCollector, which recycle it for later segments after
+// all walkers leave. By default each queue run its own background gc thread,
+// started lazily when the first segment is retired. When there are many
+// queues, sharing one GarbageCollector among them is recommended. Gc keep a
+// pointer back to queue, so it is not copyable nor movable.
+//
+// Unlike ConcurrentBoundedQueue, slots are packed instead of cacheline
+// aligned, so a segment of small elements do not cost 64B per slot. Batch
+// operations on adjacent slots benefit from this too, at the cost of some
+// false sharing between concurrent single element operations.
+template <typename T, typename S = SchedInterface>
+class ConcurrentUnboundedQueue {
+ private:
+  struct Slot {
+    T value;
+    // EMPTY -> READY by push, pop may mark WAITING before block on it, and
+    // reset to EMPTY after consumed
+    Futex<S> futex {0};
+  };
+  struct Segment;
+  class SegmentReclaimer;
+
+ public:
+  // Reclaim action retired to GarbageCollector, give consumed segment back to
+  // queue for reuse
+  using Reclaimer = SegmentReclaimer;
+
+  class Iterator {
+   public:
+    using difference_type = ssize_t;
+    using value_type = T;
+    using pointer = T*;
+    using reference = T&;
+    using iterator_category = ::std::random_access_iterator_tag;
+
+    inline Iterator(Slot* slot) noexcept;
+    inline Iterator& operator++() noexcept;
+    inline Iterator operator++(int) noexcept;
+    inline Iterator operator+(ssize_t offset) const noexcept;
+    inline Iterator operator-(ssize_t offset) const noexcept;
+    inline bool operator==(Iterator other) const noexcept;
+    inline bool operator!=(Iterator other) const noexcept;
+    inline bool operator<(Iterator other) const noexcept;
+    inline bool operator<=(Iterator other) const noexcept;
+    inline bool operator>(Iterator other) const noexcept;
+    inline bool operator>=(Iterator other) const noexcept;
+    inline T& operator*() const noexcept;
+    inline T* operator->() const noexcept;
+    inline ssize_t operator-(Iterator other) const noexcept;
+
+   private:
+    Slot* _slot {nullptr};
+  };
+
+  // Default segment size is 1024
+  ConcurrentUnboundedQueue() noexcept;
+  ConcurrentUnboundedQueue(ConcurrentUnboundedQueue&&) = delete;
+  ConcurrentUnboundedQueue(const ConcurrentUnboundedQueue&) = delete;
+  ConcurrentUnboundedQueue& operator=(ConcurrentUnboundedQueue&&) = delete;
+  ConcurrentUnboundedQueue& operator=(const ConcurrentUnboundedQueue&) =
+      delete;
+  ~ConcurrentUnboundedQueue() noexcept;
+
+  // Construct with segment size no less than min_segment_size. Actual size is
+  // ceiled to 2^n. Larger segment amortize more cost of linking and recycling,
+  // but occupy more memory even when queue is nearly empty.
+  ConcurrentUnboundedQueue(size_t min_segment_size) noexcept;
+
+  // Retire consumed segments to gc shared with other queues, instead of
+  // running a gc thread of its own. R need to be constructible from Reclaimer,
+  // e.g. Reclaimer itself when all queues are of the same type, or
+  // MoveOnlyFunction<void(void)>. Gc should be started and outlive queue.
+  // Destructor of queue wait until all segments it retired come back.
+  template <typename R>
+  ConcurrentUnboundedQueue(size_t min_segment_size,
+                           GarbageCollector<R>& gc) noexcept;
+
+  inline size_t segment_size() const noexcept;
+
+  // Approximate number of elements waiting in queue. Not synchronized with
+  // in-flight operations, and count them in.
+  inline size_t size() const noexcept;
+
+  // Push an element. Default push = push<CONCURRENT = true, USE_FUTEX_WAKE =
+  // true>. Call C(T& value) to fill slot, value is published after C return.
+  // CONCURRENT: Whether other push may happen concurrently
+  // USE_FUTEX_WAKE: Whether to wakeup pop blocking on futex. Must be true if
+  //                 any pop use USE_FUTEX_WAIT
+  template <typename U, typename ::std::enable_if<
+                            ::std::is_assignable<T&, U>::value, int>::type = 0>
+  inline void push(U&& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline void push(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename U,
+            typename ::std::enable_if<::std::is_assignable<T&, U>::value,
+                                      int>::type = 0>
+  inline void push(U&& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline void push(C&& callback) noexcept;
+
+  // Push num elements in batch. Call C(Iterator begin, Iterator end) to fill
+  // them, may be called several times when crossing segments, but total size
+  // of ranges always equal to num. Template parameters are same as push.
+  template <typename IT>
+  inline void push_n(IT begin, IT end) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void push_n(C&& callback, size_t num) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename IT>
+  inline void push_n(IT begin, IT end) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void push_n(C&& callback, size_t num) noexcept;
+
+  // Pop an element, wait until available. Default pop = pop<CONCURRENT =
+  // true, USE_FUTEX_WAIT = true>. Call C(T& value) to consume it.
+  // CONCURRENT: Whether other pop may happen concurrently
+  // USE_FUTEX_WAIT: Block on futex if true, otherwise spin with yield
+  inline void pop(T& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline void pop(C&& callback) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT>
+  inline void pop(T& value) noexcept;
+  template <
+      bool CONCURRENT, bool USE_FUTEX_WAIT, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline void pop(C&& callback) noexcept;
+
+  // Pop an element if available, return false when queue is empty. Default
+  // try_pop = try_pop<CONCURRENT = true>.
+  inline bool try_pop(T& value) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, T&>::value>::type>
+  inline bool try_pop(C&& callback) noexcept;
+  template <bool CONCURRENT>
+  inline bool try_pop(T& value) noexcept;
+  template <
+      bool CONCURRENT, typename C,
+      typename = typename ::std::enable_if<IsInvocable<C, T&>::value>::type>
+  inline bool try_pop(C&& callback) noexcept;
+
+  // Pop num elements in batch, wait until all available. Call C(Iterator
+  // begin, Iterator end) to consume them, may be called several times like
+  // push_n. Template parameters are same as pop.
+  template <typename IT>
+  inline void pop_n(IT begin, IT end) noexcept;
+  template <typename C, typename = typename ::std::enable_if<
+                            IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void pop_n(C&& callback, size_t num) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, typename IT>
+  inline void pop_n(IT begin, IT end) noexcept;
+  template <bool CONCURRENT, bool USE_FUTEX_WAIT, typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline void pop_n(C&& callback, size_t num) noexcept;
+
+  // Pop at most num elements in batch without wait.
+  // return: number of elements actually popped, may less than num
+  template <bool CONCURRENT, typename C,
+            typename = typename ::std::enable_if<
+                IsInvocable<C, Iterator, Iterator>::value>::type>
+  inline size_t try_pop_n(C&& callback, size_t num) noexcept;
+
+  // Drop all elements not consumed. Not thread safe, can not run concurrently
+  // with any other operation.
+  void clear() noexcept;
+
+ private:
+  static constexpr uint32_t EMPTY = 0;
+  static constexpr uint32_t READY = 1;
+  static constexpr uint32_t WAITING = 2;
+
+  template <bool CONCURRENT>
+  inline static size_t claim(::std::atomic<size_t>& next_index,
+                             size_t num) noexcept;
+  // Mark slots READY and wake pop waiting on them. Pop may consume and retire
+  // segment as soon as slot is READY, so wake is done inside epoch
+  inline void publish(Slot* slots, size_t num, bool wakeup) noexcept;
+  template <bool USE_FUTEX_WAIT>
+  inline static void wait_until_ready(Slot& slot) noexcept;
+
+  // Locate segment holding index. Caller must guarantee that index is not
+  // consumed yet, so that segment is still linked, and keep valid after
+  // return
+  inline Segment* locate_push_segment(size_t index) noexcept;
+  inline Segment* locate_pop_segment(size_t index) noexcept;
+  inline Segment* walk_to_segment(Segment* segment, size_t id) noexcept;
+  Segment* next_segment(Segment* segment) noexcept;
+  inline static void advance_hint(::std::atomic<Segment*>& hint,
+                                  Segment* segment) noexcept;
+
+  template <bool CONCURRENT, typename C>
+  inline size_t try_pop_n_in_segment(C&& callback, size_t num) noexcept;
+  inline void finish_consume(Segment* segment, size_t num) noexcept;
+  void retire_consumed_segments() noexcept;
+  void start_own_garbage_collector() noexcept;
+
+  Segment* allocate_segment(size_t id) noexcept;
+  void recycle_segment(Segment* segment) noexcept;
+  void free_segments() noexcept;
+
+  void initialize_segments() noexcept;
+  template <typename R>
+  static void retire_to(void* gc, SegmentReclaimer&& reclaimer) noexcept;
+
+  size_t _segment_size {0};
+  size_t _segment_mask {0};
+  size_t _segment_bits {0};
+
+  // Consumed segments waiting to be reused
+  ConcurrentBoundedQueue<Segment*> _free_segments {16};
+  // Own gc when not shared, otherwise type of shared gc is erased
+  ::std::unique_ptr<GarbageCollector<SegmentReclaimer>> _own_garbage_collector;
+  ::std::once_flag _own_garbage_collector_started;
+  void* _garbage_collector {nullptr};
+  void (*_retire)(void*, SegmentReclaimer&&) noexcept {nullptr};
+  Epoch* _epoch {nullptr};
+  // Segments retired but not come back yet
+  ::std::atomic<size_t> _retired_segment_num {0};
+
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<Segment*> _head {nullptr};
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<Segment*> _tail {nullptr};
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<size_t> _next_push_index {0};
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<size_t> _next_pop_index {0};
+};
+
+BABYLON_NAMESPACE_END
+
+#include "babylon/concurrent/unbounded_queue.hpp"
@@ -0,0 +1,708 @@
+#pragma once
+
+#include "babylon/absl_numeric_bits.h" // absl::bit_ceil
+#include "babylon/concurrent/unbounded_queue.h"
+
+#include <mutex> // std::lock_guard
+
+BABYLON_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentUnboundedQueue::Segment begin
+template <typename T, typename S>
+struct ConcurrentUnboundedQueue<T, S>::Segment {
+  Segment(size_t size) noexcept : slots {new Slot[size]} {}
+
+  // Segment holds index range [id * segment_size, (id + 1) * segment_size)
+  size_t id {0};
+  ::std::atomic<Segment*> next {nullptr};
+  // Segment is unlinked and retired after all slots consumed
+  ::std::atomic<size_t> consumed {0};
+  ::std::unique_ptr<Slot[]> slots;
+};
+// ConcurrentUnboundedQueue::Segment end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentUnboundedQueue::SegmentReclaimer begin
+// Give segment back to queue for reuse when called. Segment not reclaimed yet
+// when garbage collector stop is deleted instead.
+template <typename T, typename S>
+class ConcurrentUnboundedQueue<T, S>::SegmentReclaimer {
+ public:
+  SegmentReclaimer() noexcept = default;
+  SegmentReclaimer(SegmentReclaimer&& other) noexcept {
+    *this = ::std::move(other);
+  }
+  SegmentReclaimer(const SegmentReclaimer&) = delete;
+  SegmentReclaimer& operator=(SegmentReclaimer&& other) noexcept {
+    ::std::swap(_queue, other._queue);
+    ::std::swap(_segment, other._segment);
+    return *this;
+  }
+  SegmentReclaimer& operator=(const SegmentReclaimer&) = delete;
+  ~SegmentReclaimer() noexcept {
+    if (_segment != nullptr) {
+      delete _segment;
+      _queue->_retired_segment_num.fetch_sub(1, ::std::memory_order_release);
+    }
+  }
+
+  SegmentReclaimer(ConcurrentUnboundedQueue* queue, Segment* segment) noexcept
+      : _queue {queue}, _segment {segment} {}
+
+  void operator()() noexcept {
+    _queue->recycle_segment(_segment);
+    _segment = nullptr;
+    _queue->_retired_segment_num.fetch_sub(1, ::std::memory_order_release);
+  }
+
+ private:
+  ConcurrentUnboundedQueue* _queue {nullptr};
+  Segment* _segment {nullptr};
+};
+// ConcurrentUnboundedQueue::SegmentReclaimer end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentUnboundedQueue::Iterator begin
+template <typename T, typename S>
+inline ConcurrentUnboundedQueue<T, S>::Iterator::Iterator(Slot* slot) noexcept
+    : _slot(slot) {}
+
+template <typename T, typename S>
+inline typename ConcurrentUnboundedQueue<T, S>::Iterator&
+ConcurrentUnboundedQueue<T, S>::Iterator::operator++() noexcept {
+  ++_slot;
+  return *this;
+}
+
+template <typename T, typename S>
+inline typename ConcurrentUnboundedQueue<T, S>::Iterator
+ConcurrentUnboundedQueue<T, S>::Iterator::operator++(int) noexcept {
+  Iterator ret = *this;
+  ++(*this);
+  return ret;
+}
+
+template <typename T, typename S>
+inline typename ConcurrentUnboundedQueue<T, S>::Iterator
+ConcurrentUnboundedQueue<T, S>::Iterator::operator+(
+    ssize_t offset) const noexcept {
+  return Iterator(_slot + offset);
+}
+
+template <typename T, typename S>
+inline typename ConcurrentUnboundedQueue<T, S>::Iterator
+ConcurrentUnboundedQueue<T, S>::Iterator::operator-(
+    ssize_t offset) const noexcept {
+  return Iterator(_slot - offset);
+}
+
+template <typename T, typename S>
+inline bool ConcurrentUnboundedQueue<T, S>::Iterator::operator==(
+    Iterator other) const noexcept {
+  return _slot == other._slot;
+}
+
+template <typename T, typename S>
+inline bool ConcurrentUnboundedQueue<T, S>::Iterator::operator!=(
+    Iterator other) const noexcept {
+  return !(*this == other);
+}
+
+template <typename T, typename S>
+inline bool ConcurrentUnboundedQueue<T, S>::Iterator::operator<(
+    Iterator other) const noexcept {
+  return _slot < other._slot;
+}
+
+template <typename T, typename S>
+inline bool ConcurrentUnboundedQueue<T, S>::Iterator::operator<=(
+    Iterator other) const noexcept {
+  return _slot <= other._slot;
+}
+
+template <typename T, typename S>
+inline bool ConcurrentUnboundedQueue<T, S>::Iterator::operator>(
+    Iterator other) const noexcept {
+  return _slot > other._slot;
+}
+
+template <typename T, typename S>
+inline bool ConcurrentUnboundedQueue<T, S>::Iterator::operator>=(
+    Iterator other) const noexcept {
+  return _slot >= other._slot;
+}
+
+template <typename T, typename S>
+inline T& ConcurrentUnboundedQueue<T, S>::Iterator::operator*()
+    const noexcept {
+  return _slot->value;
+}
+
+template <typename T, typename S>
+inline T* ConcurrentUnboundedQueue<T, S>::Iterator::operator->()
+    const noexcept {
+  return &_slot->value;
+}
+
+template <typename T, typename S>
+inline ssize_t ConcurrentUnboundedQueue<T, S>::Iterator::operator-(
+    Iterator other) const noexcept {
+  return _slot - other._slot;
+}
+// ConcurrentUnboundedQueue::Iterator end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentUnboundedQueue begin
+template <typename T, typename S>
+ConcurrentUnboundedQueue<T, S>::ConcurrentUnboundedQueue() noexcept
+    : ConcurrentUnboundedQueue(1024) {}
+
+template <typename T, typename S>
+ConcurrentUnboundedQueue<T, S>::ConcurrentUnboundedQueue(
+    size_t min_segment_size) noexcept
+    : _own_garbage_collector {new GarbageCollector<SegmentReclaimer>} {
+  // Thread is not started until first segment retired, see
+  // start_own_garbage_collector
+  _own_garbage_collector->set_queue_capacity(1024);
+  _garbage_collector = _own_garbage_collector.get();
+  _retire = &retire_to<SegmentReclaimer>;
+  _epoch = &_own_garbage_collector->epoch();
+  _segment_size = ::absl::bit_ceil(::std::max<size_t>(min_segment_size, 1));
+  initialize_segments();
+}
+
+template <typename T, typename S>
+template <typename R>
+ConcurrentUnboundedQueue<T, S>::ConcurrentUnboundedQueue(
+    size_t min_segment_size, GarbageCollector<R>& gc) noexcept
+    : _garbage_collector {&gc}, _retire {&retire_to<R>}, _epoch {&gc.epoch()} {
+  _segment_size = ::absl::bit_ceil(::std::max<size_t>(min_segment_size, 1));
+  initialize_segments();
+}
+
+template <typename T, typename S>
+ConcurrentUnboundedQueue<T, S>::~ConcurrentUnboundedQueue() noexcept {
+  if (_own_garbage_collector) {
+    _own_garbage_collector->stop();
+  }
+  // Shared gc keep running, wait until it give back all retired segments
+  while (_retired_segment_num.load(::std::memory_order_acquire) > 0) {
+    S::yield();
+  }
+  free_segments();
+}
+
+template <typename T, typename S>
+inline size_t ConcurrentUnboundedQueue<T, S>::segment_size() const noexcept {
+  return _segment_size;
+}
+
+template <typename T, typename S>
+inline size_t ConcurrentUnboundedQueue<T, S>::size() const noexcept {
+  auto next_pop_index = _next_pop_index.load(::std::memory_order_relaxed);
+  auto next_push_index = _next_push_index.load(::std::memory_order_relaxed);
+  // Blocking pop may claim index before push, treat as empty
+  return next_push_index > next_pop_index ? next_push_index - next_pop_index
+                                          : 0;
+}
+
+template <typename T, typename S>
+template <typename U, typename ::std::enable_if<
+                          ::std::is_assignable<T&, U>::value, int>::type>
+inline void ConcurrentUnboundedQueue<T, S>::push(U&& value) noexcept {
+  push<true, true>(::std::forward<U>(value));
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentUnboundedQueue<T, S>::push(C&& callback) noexcept {
+  push<true, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <
+    bool CONCURRENT, bool USE_FUTEX_WAKE, typename U,
+    typename ::std::enable_if<::std::is_assignable<T&, U>::value, int>::type>
+inline void ConcurrentUnboundedQueue<T, S>::push(U&& value) noexcept {
+  push<CONCURRENT, USE_FUTEX_WAKE>(
+      [&](T& target) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        target = ::std::forward<U>(value);
+      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline void ConcurrentUnboundedQueue<T, S>::push(C&& callback) noexcept {
+  auto index = claim<CONCURRENT>(_next_push_index, 1);
+  auto segment = locate_push_segment(index);
+  auto& slot = segment->slots[index & _segment_mask];
+  callback(slot.value);
+  publish(&slot, 1, USE_FUTEX_WAKE);
+}
+
+template <typename T, typename S>
+template <typename IT>
+inline void ConcurrentUnboundedQueue<T, S>::push_n(IT begin, IT end) noexcept {
+  push_n<true, true>(begin, end);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentUnboundedQueue<T, S>::push_n(C&& callback,
+                                                   size_t num) noexcept {
+  push_n<true, true>(::std::forward<C>(callback), num);
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename IT>
+inline void ConcurrentUnboundedQueue<T, S>::push_n(IT begin, IT end) noexcept {
+  push_n<CONCURRENT, USE_FUTEX_WAKE>(
+      [&](Iterator dest_begin, Iterator dest_end) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        auto num = dest_end - dest_begin;
+        ::std::copy(begin, begin + num, dest_begin);
+        begin += num;
+      },
+      ::std::distance(begin, end));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAKE, typename C, typename>
+inline void ConcurrentUnboundedQueue<T, S>::push_n(C&& callback,
+                                                   size_t num) noexcept {
+  auto index = claim<CONCURRENT>(_next_push_index, num);
+  auto end_index = index + num;
+  while (index < end_index) {
+    // Deal with one segment at a time
+    auto segment = locate_push_segment(index);
+    auto offset = index & _segment_mask;
+    auto batch = ::std::min(end_index - index, _segment_size - offset);
+    auto slots = &segment->slots[offset];
+    callback(Iterator {slots}, Iterator {slots + batch});
+    publish(slots, batch, USE_FUTEX_WAKE);
+    index += batch;
+  }
+}
+
+template <typename T, typename S>
+inline void ConcurrentUnboundedQueue<T, S>::pop(T& value) noexcept {
+  pop<true, true>(value);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentUnboundedQueue<T, S>::pop(C&& callback) noexcept {
+  pop<true, true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT>
+inline void ConcurrentUnboundedQueue<T, S>::pop(T& value) noexcept {
+  pop<CONCURRENT, USE_FUTEX_WAIT>([&](T& source)
+                                      ABSL_ATTRIBUTE_ALWAYS_INLINE {
+                                        value = ::std::move(source);
+                                      });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, typename C, typename>
+inline void ConcurrentUnboundedQueue<T, S>::pop(C&& callback) noexcept {
+  auto index = claim<CONCURRENT>(_next_pop_index, 1);
+  auto segment = locate_pop_segment(index);
+  auto& slot = segment->slots[index & _segment_mask];
+  wait_until_ready<USE_FUTEX_WAIT>(slot);
+  callback(slot.value);
+  slot.futex.value().store(EMPTY, ::std::memory_order_relaxed);
+  finish_consume(segment, 1);
+}
+
+template <typename T, typename S>
+inline bool ConcurrentUnboundedQueue<T, S>::try_pop(T& value) noexcept {
+  return try_pop<true>(value);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline bool ConcurrentUnboundedQueue<T, S>::try_pop(C&& callback) noexcept {
+  return try_pop<true>(::std::forward<C>(callback));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT>
+inline bool ConcurrentUnboundedQueue<T, S>::try_pop(T& value) noexcept {
+  return try_pop<CONCURRENT>([&](T& source) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+    value = ::std::move(source);
+  });
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, typename C, typename>
+inline bool ConcurrentUnboundedQueue<T, S>::try_pop(C&& callback) noexcept {
+  return 1 == try_pop_n_in_segment<CONCURRENT>(
+                  [&](Iterator iter, Iterator) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+                    callback(*iter);
+                  },
+                  1);
+}
+
+template <typename T, typename S>
+template <typename IT>
+inline void ConcurrentUnboundedQueue<T, S>::pop_n(IT begin, IT end) noexcept {
+  pop_n<true, true>(begin, end);
+}
+
+template <typename T, typename S>
+template <typename C, typename>
+inline void ConcurrentUnboundedQueue<T, S>::pop_n(C&& callback,
+                                                  size_t num) noexcept {
+  pop_n<true, true>(::std::forward<C>(callback), num);
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, typename IT>
+inline void ConcurrentUnboundedQueue<T, S>::pop_n(IT begin, IT end) noexcept {
+  pop_n<CONCURRENT, USE_FUTEX_WAIT>(
+      [&](Iterator src_begin, Iterator src_end) ABSL_ATTRIBUTE_ALWAYS_INLINE {
+        ::std::move(src_begin, src_end, begin);
+        begin += src_end - src_begin;
+      },
+      ::std::distance(begin, end));
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, bool USE_FUTEX_WAIT, typename C, typename>
+inline void ConcurrentUnboundedQueue<T, S>::pop_n(C&& callback,
+                                                  size_t num) noexcept {
+  auto index = claim<CONCURRENT>(_next_pop_index, num);
+  auto end_index = index + num;
+  while (index < end_index) {
+    auto segment = locate_pop_segment(index);
+    auto offset = index & _segment_mask;
+    auto batch = ::std::min(end_index - index, _segment_size - offset);
+    auto slots = &segment->slots[offset];
+    for (size_t i = 0; i < batch; ++i) {
+      wait_until_ready<USE_FUTEX_WAIT>(slots[i]);
+    }
+    callback(Iterator {slots}, Iterator {slots + batch});
+    for (size_t i = 0; i < batch; ++i) {
+      slots[i].futex.value().store(EMPTY, ::std::memory_order_relaxed);
+    }
+    finish_consume(segment, batch);
+    index += batch;
+  }
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, typename C, typename>
+inline size_t ConcurrentUnboundedQueue<T, S>::try_pop_n(C&& callback,
+                                                        size_t num) noexcept {
+  size_t popped = 0;
+  while (popped < num) {
+    auto batch =
+        try_pop_n_in_segment<CONCURRENT>(::std::forward<C>(callback),
+                                         num - popped);
+    if (batch == 0) {
+      break;
+    }
+    popped += batch;
+  }
+  return popped;
+}
+
+template <typename T, typename S>
+void ConcurrentUnboundedQueue<T, S>::clear() noexcept {
+  free_segments();
+  auto segment = allocate_segment(0);
+  _head.store(segment, ::std::memory_order_relaxed);
+  _tail.store(segment, ::std::memory_order_relaxed);
+  _next_push_index.store(0, ::std::memory_order_relaxed);
+  _next_pop_index.store(0, ::std::memory_order_relaxed);
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT>
+inline size_t ConcurrentUnboundedQueue<T, S>::claim(
+    ::std::atomic<size_t>& next_index, size_t num) noexcept {
+  if (CONCURRENT) {
+    return next_index.fetch_add(num, ::std::memory_order_relaxed);
+  }
+  auto index = next_index.load(::std::memory_order_relaxed);
+  next_index.store(index + num, ::std::memory_order_relaxed);
+  return index;
+}
+
+template <typename T, typename S>
+inline void ConcurrentUnboundedQueue<T, S>::publish(Slot* slots, size_t num,
+                                                    bool wakeup) noexcept {
+  if (!wakeup) {
+    for (size_t i = 0; i < num; ++i) {
+      slots[i].futex.value().store(READY, ::std::memory_order_release);
+    }
+    return;
+  }
+  // Slot published may be consumed and its segment retired before wake_one,
+  // stay in epoch to keep futex valid until wake done
+  ::std::lock_guard<Epoch> lock {*_epoch};
+  for (size_t i = 0; i < num; ++i) {
+    // Only the pop claimed this index may wait on it, wake one is enough
+    auto& futex = slots[i].futex;
+    if (futex.value().exchange(READY, ::std::memory_order_release) ==
+        WAITING) {
+      futex.wake_one();
+    }
+  }
+}
+
+template <typename T, typename S>
+template <bool USE_FUTEX_WAIT>
+inline void ConcurrentUnboundedQueue<T, S>::wait_until_ready(
+    Slot& slot) noexcept {
+  auto state = slot.futex.value().load(::std::memory_order_acquire);
+  while (state != READY) {
+    if (!USE_FUTEX_WAIT) {
+      S::yield();
+      state = slot.futex.value().load(::std::memory_order_acquire);
+      continue;
+    }
+    // Mark waiting before block, so push know to wake
+    if (state == EMPTY &&
+        !slot.futex.value().compare_exchange_strong(
+            state, WAITING, ::std::memory_order_acquire)) {
+      continue;
+    }
+    slot.futex.wait(WAITING, nullptr);
+    state = slot.futex.value().load(::std::memory_order_acquire);
+  }
+}
+
+template <typename T, typename S>
+inline typename ConcurrentUnboundedQueue<T, S>::Segment*
+ConcurrentUnboundedQueue<T, S>::locate_push_segment(size_t index) noexcept {
+  auto id = index >> _segment_bits;
+  ::std::lock_guard<Epoch> lock {*_epoch};
+  // Tail may already be moved forward by later push. Head never pass a
+  // segment with unconsumed index, fallback to it in that case
+  auto segment = _tail.load(::std::memory_order_acquire);
+  if (segment->id > id) {
+    segment = _head.load(::std::memory_order_acquire);
+  }
+  segment = walk_to_segment(segment, id);
+  advance_hint(_tail, segment);
+  return segment;
+}
+
+template <typename T, typename S>
+inline typename ConcurrentUnboundedQueue<T, S>::Segment*
+ConcurrentUnboundedQueue<T, S>::locate_pop_segment(size_t index) noexcept {
+  auto id = index >> _segment_bits;
+  ::std::lock_guard<Epoch> lock {*_epoch};
+  return walk_to_segment(_head.load(::std::memory_order_acquire), id);
+}
+
+template <typename T, typename S>
+inline typename ConcurrentUnboundedQueue<T, S>::Segment*
+ConcurrentUnboundedQueue<T, S>::walk_to_segment(Segment* segment,
+                                                size_t id) noexcept {
+  while (segment->id < id) {
+    segment = next_segment(segment);
+  }
+  return segment;
+}
+
+template <typename T, typename S>
+ABSL_ATTRIBUTE_NOINLINE typename ConcurrentUnboundedQueue<T, S>::Segment*
+ConcurrentUnboundedQueue<T, S>::next_segment(Segment* segment) noexcept {
+  auto next = segment->next.load(::std::memory_order_acquire);
+  if (next != nullptr) {
+    return next;
+  }
+  // Both push and pop may reach a segment not linked yet, whoever first link
+  // it win
+  auto new_segment = allocate_segment(segment->id + 1);
+  if (segment->next.compare_exchange_strong(next, new_segment,
+                                            ::std::memory_order_acq_rel)) {
+    return new_segment;
+  }
+  recycle_segment(new_segment);
+  return next;
+}
+
+template <typename T, typename S>
+inline void ConcurrentUnboundedQueue<T, S>::advance_hint(
+    ::std::atomic<Segment*>& hint, Segment* segment) noexcept {
+  auto current = hint.load(::std::memory_order_acquire);
+  while (current->id < segment->id) {
+    if (hint.compare_exchange_weak(current, segment,
+                                   ::std::memory_order_seq_cst)) {
+      return;
+    }
+  }
+}
+
+template <typename T, typename S>
+template <bool CONCURRENT, typename C>
+inline size_t ConcurrentUnboundedQueue<T, S>::try_pop_n_in_segment(
+    C&& callback, size_t num) noexcept {
+  Segment* segment = nullptr;
+  size_t offset = 0;
+  size_t batch = 0;
+  {
+    ::std::lock_guard<Epoch> lock {*_epoch};
+    auto index = _next_pop_index.load(::std::memory_order_acquire);
+    while (true) {
+      auto id = index >> _segment_bits;
+      segment = _head.load(::std::memory_order_acquire);
+      // Index observed is stale, already consumed and unlinked
+      if (ABSL_PREDICT_FALSE(segment->id > id)) {
+        index = _next_pop_index.load(::std::memory_order_acquire);
+        continue;
+      }
+      // Not linked means nothing pushed there yet
+      while (segment != nullptr && segment->id < id) {
+        segment = segment->next.load(::std::memory_order_acquire);
+      }
+      if (segment == nullptr) {
+        return 0;
+      }
+      offset = index & _segment_mask;
+      auto max_batch = ::std::min(num, _segment_size - offset);
+      batch = 0;
+      while (batch < max_batch &&
+             segment->slots[offset + batch].futex.value().load(
+                 ::std::memory_order_acquire) == READY) {
+        ++batch;
+      }
+      if (batch == 0) {
+        // Slot consumed by others after index loaded, retry on new index
+        auto current_index = _next_pop_index.load(::std::memory_order_acquire);
+        if (CONCURRENT && current_index != index) {
+          index = current_index;
+          continue;
+        }
+        return 0;
+      }
+      if (!CONCURRENT) {
+        _next_pop_index.store(index + batch, ::std::memory_order_relaxed);
+        break;
+      }
+      if (_next_pop_index.compare_exchange_weak(index, index + batch,
+                                                ::std::memory_order_acquire)) {
+        break;
+      }
+    }
+  }
+  // Claimed slots are not consumed, keep segment valid outside of epoch
+  auto slots = &segment->slots[offset];
+  callback(Iterator {slots}, Iterator {slots + batch});
+  for (size_t i = 0; i < batch; ++i) {
+    slots[i].futex.value().store(EMPTY, ::std::memory_order_relaxed);
+  }
+  finish_consume(segment, batch);
+  return batch;
+}
+
+template <typename T, typename S>
+inline void ConcurrentUnboundedQueue<T, S>::finish_consume(
+    Segment* segment, size_t num) noexcept {
+  if (segment->consumed.fetch_add(num, ::std::memory_order_seq_cst) + num ==
+      _segment_size) {
+    retire_consumed_segments();
+  }
+}
+
+template <typename T, typename S>
+ABSL_ATTRIBUTE_NOINLINE void
+ConcurrentUnboundedQueue<T, S>::retire_consumed_segments() noexcept {
+  // Segments may be consumed out of order, only unlink from head in order.
+  // Who finish a segment not at head yet, leave it to who finish the head
+  while (true) {
+    Segment* head = nullptr;
+    {
+      ::std::lock_guard<Epoch> lock {*_epoch};
+      head = _head.load(::std::memory_order_seq_cst);
+      if (head->consumed.load(::std::memory_order_seq_cst) != _segment_size) {
+        return;
+      }
+      auto next = next_segment(head);
+      if (!_head.compare_exchange_strong(head, next,
+                                         ::std::memory_order_seq_cst)) {
+        continue;
+      }
+      // Tail may lag behind, never let it point to a retired segment
+      advance_hint(_tail, next);
+    }
+    // Retire outside of epoch, since it may block when gc queue is full
+    start_own_garbage_collector();
+    _retired_segment_num.fetch_add(1, ::std::memory_order_relaxed);
+    _retire(_garbage_collector, SegmentReclaimer {this, head});
+  }
+}
+
+template <typename T, typename S>
+void ConcurrentUnboundedQueue<T, S>::start_own_garbage_collector() noexcept {
+  // Queue never consume a whole segment cost no gc thread at all
+  if (_own_garbage_collector) {
+    ::std::call_once(_own_garbage_collector_started,
+                     [this] { _own_garbage_collector->start(); });
+  }
+}
+
+template <typename T, typename S>
+typename ConcurrentUnboundedQueue<T, S>::Segment*
+ConcurrentUnboundedQueue<T, S>::allocate_segment(size_t id) noexcept {
+  Segment* segment = nullptr;
+  if (!_free_segments.template try_pop<true, false>(segment)) {
+    segment = new Segment(_segment_size);
+  }
+  segment->id = id;
+  return segment;
+}
+
+template <typename T, typename S>
+void ConcurrentUnboundedQueue<T, S>::recycle_segment(
+    Segment* segment) noexcept {
+  // Slots are reset to EMPTY one by one when consumed
+  segment->next.store(nullptr, ::std::memory_order_relaxed);
+  segment->consumed.store(0, ::std::memory_order_relaxed);
+  if (!_free_segments.template try_push<true, false>(segment)) {
+    delete segment;
+  }
+}
+
+template <typename T, typename S>
+void ConcurrentUnboundedQueue<T, S>::free_segments() noexcept {
+  auto segment = _head.load(::std::memory_order_relaxed);
+  while (segment != nullptr) {
+    auto next = segment->next.load(::std::memory_order_relaxed);
+    delete segment;
+    segment = next;
+  }
+  _head.store(nullptr, ::std::memory_order_relaxed);
+  _tail.store(nullptr, ::std::memory_order_relaxed);
+  while (_free_segments.template try_pop<false, false>(segment)) {
+    delete segment;
+  }
+}
+
+template <typename T, typename S>
+void ConcurrentUnboundedQueue<T, S>::initialize_segments() noexcept {
+  _segment_mask = _segment_size - 1;
+  _segment_bits = static_cast<size_t>(__builtin_ctzll(_segment_size));
+  auto segment = allocate_segment(0);
+  _head.store(segment, ::std::memory_order_relaxed);
+  _tail.store(segment, ::std::memory_order_relaxed);
+}
+
+template <typename T, typename S>
+template <typename R>
+ABSL_ATTRIBUTE_NOINLINE void ConcurrentUnboundedQueue<T, S>::retire_to(
+    void* gc, SegmentReclaimer&& reclaimer) noexcept {
+  static_cast<GarbageCollector<R>*>(gc)->retire(R {::std::move(reclaimer)});
+}
+// ConcurrentUnboundedQueue end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
@@ -65,6 +65,10 @@ class ConcurrentVector {
     template <typename C, typename = typename ::std::enable_if<
                               IsInvocable<C, const T*, const T*>::value>::type>
     inline void for_each(size_t begin, size_t end, C&& callback) const;
+    // 将[begin, end)区间的内容按分段依次拷贝到out开始的连续空间
+    // 返回拷贝结束的位置，类似std::copy
+    template <typename OT>
+    inline OT compact_to(size_t begin, size_t end, OT out) const;
     // 获取可访问大小
     inline size_t size() const noexcept;
 
@@ -88,6 +92,9 @@ class ConcurrentVector {
     template <typename C, typename = typename ::std::enable_if<
                               IsInvocable<C, const T*, const T*>::value>::type>
     inline void for_each(size_t begin, size_t end, C&& callback) const;
+    // 导出[begin, end)区间到连续空间
+    template <typename OT>
+    inline OT compact_to(size_t begin, size_t end, OT out) const;
     // 获取可访问大小
     inline size_t size() const noexcept;
 
@@ -153,6 +160,26 @@ class ConcurrentVector {
   template <typename C, typename = typename ::std::enable_if<
                             IsInvocable<C, const T*, const T*>::value>::type>
   inline void for_each(size_t begin, size_t end, C&& callback) const;
+  // 原子追加，通过一次fetch_add认领连续的序号区间，再写入认领到的位置
+  // 可以取代使用者自行通过IdAllocator等方式协调序号，返回认领的起始序号
+  // emplace_back以T(args...)构造临时对象，再移动赋值到认领位置上的元素
+  // 构造过程抛出异常时，位置上原有的元素依然保持有效
+  // append_n通过分段连续的copy_n写入[begin, begin + size)
+  // 认领和写入并不是原子的，写入结果对其他线程可见需要使用者自行同步
+  template <typename... Args>
+  inline size_t emplace_back(Args&&... args);
+  template <typename IT,
+            typename = typename ::std::enable_if<::std::is_convertible<
+                typename ::std::iterator_traits<IT>::iterator_category,
+                ::std::random_access_iterator_tag>::value>::type>
+  inline size_t append_n(IT begin, size_t size);
+  // 已经通过emplace_back/append_n认领的元素总数
+  inline size_t appended_size() const noexcept;
+  // 将[begin, end)区间的内容导出到out开始的单块连续空间
+  // 每个分段整体拷贝一次，之后可以在连续空间上进行SIMD友好的扫描
+  // 返回拷贝结束的位置，类似std::copy
+  template <typename OT>
+  inline OT compact_to(size_t begin, size_t end, OT out) const;
   // 获取当前结构快照，主要支持后续连续频繁下标访问
   inline Snapshot snapshot() noexcept;
   // 只读快照
@@ -237,6 +264,7 @@ class ConcurrentVector {
   Meta _meta;
   ::std::function<void(T*)> _constructor;
   ::std::atomic<BlockTable*> _block_table {nullptr};
+  ::std::atomic<size_t> _append_cursor {0};
   internal::concurrent_vector::RetireList<BlockTable, BlockTableDeleter>
       _retire_list;
 };
@@ -244,6 +244,16 @@ inline void ConcurrentVector<T, BLOCK_SIZE>::Snapshot::for_each(
   }
 }
 
+template <typename T, size_t BLOCK_SIZE>
+template <typename OT>
+inline OT ConcurrentVector<T, BLOCK_SIZE>::Snapshot::compact_to(
+    size_t begin, size_t end, OT out) const {
+  for_each(begin, end, [&](const T* iter, const T* segment_end) {
+    out = ::std::copy(iter, segment_end, out);
+  });
+  return out;
+}
+
 template <typename T, size_t BLOCK_SIZE>
 inline size_t ConcurrentVector<T, BLOCK_SIZE>::Snapshot::size() const noexcept {
   return _block_table->size << _meta.block_mask_bits();
@@ -271,6 +281,13 @@ inline void ConcurrentVector<T, BLOCK_SIZE>::ConstSnapshot::for_each(
   _snapshot.for_each(begin, end, ::std::forward<C>(callback));
 }
 
+template <typename T, size_t BLOCK_SIZE>
+template <typename OT>
+inline OT ConcurrentVector<T, BLOCK_SIZE>::ConstSnapshot::compact_to(
+    size_t begin, size_t end, OT out) const {
+  return _snapshot.compact_to(begin, end, out);
+}
+
 template <typename T, size_t BLOCK_SIZE>
 inline size_t ConcurrentVector<T, BLOCK_SIZE>::ConstSnapshot::size()
     const noexcept {
@@ -514,6 +531,35 @@ inline void ConcurrentVector<T, BLOCK_SIZE>::for_each(size_t begin, size_t end,
   snapshot().for_each(begin, end, ::std::forward<C>(callback));
 }
 
+template <typename T, size_t BLOCK_SIZE>
+template <typename... Args>
+inline size_t ConcurrentVector<T, BLOCK_SIZE>::emplace_back(Args&&... args) {
+  auto index = _append_cursor.fetch_add(1, ::std::memory_order_relaxed);
+  ensure(index) = T(::std::forward<Args>(args)...);
+  return index;
+}
+
+template <typename T, size_t BLOCK_SIZE>
+template <typename IT, typename>
+inline size_t ConcurrentVector<T, BLOCK_SIZE>::append_n(IT begin,
+                                                        size_t size) {
+  auto offset = _append_cursor.fetch_add(size, ::std::memory_order_relaxed);
+  copy_n(begin, size, offset);
+  return offset;
+}
+
+template <typename T, size_t BLOCK_SIZE>
+inline size_t ConcurrentVector<T, BLOCK_SIZE>::appended_size() const noexcept {
+  return _append_cursor.load(::std::memory_order_relaxed);
+}
+
+template <typename T, size_t BLOCK_SIZE>
+template <typename OT>
+inline OT ConcurrentVector<T, BLOCK_SIZE>::compact_to(size_t begin, size_t end,
+                                                      OT out) const {
+  return snapshot().compact_to(begin, end, out);
+}
+
 template <typename T, size_t BLOCK_SIZE>
 inline typename ConcurrentVector<T, BLOCK_SIZE>::Snapshot
 ConcurrentVector<T, BLOCK_SIZE>::snapshot() noexcept {
@@ -558,6 +604,12 @@ void ConcurrentVector<T, BLOCK_SIZE>::swap(ConcurrentVector& other) noexcept {
                        ::std::memory_order_relaxed);
     other._block_table.store(tmp, ::std::memory_order_relaxed);
   }
+  {
+    auto tmp = _append_cursor.load(::std::memory_order_relaxed);
+    _append_cursor.store(other._append_cursor.load(::std::memory_order_relaxed),
+                         ::std::memory_order_relaxed);
+    other._append_cursor.store(tmp, ::std::memory_order_relaxed);
+  }
   ::std::swap(_retire_list, other._retire_list);
 }
 
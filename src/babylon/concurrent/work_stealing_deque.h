@@ -0,0 +1,100 @@
+#pragma once
+
+#include "babylon/environment.h"
+
+#include <sys/types.h> // ssize_t
+
+#include <atomic> // std::atomic
+#include <memory> // std::unique_ptr
+
+BABYLON_NAMESPACE_BEGIN
+
+// Bounded work stealing deque, following the design of Chase & Lev, "Dynamic
+// Circular Work-Stealing Deque", and the C11 memory model adaption of Le et al.
+// "Correct and Efficient Work-Stealing for Weak Memory Models".
+//
+// A deque has a single owner thread, which push and pop at bottom end in LIFO
+// order, keeping recently produced and still cache-hot items to itself. Any
+// other thread could act as a thief and steal from top end in FIFO order,
+// taking the oldest item. Owner operations only need a CAS when competing for
+// the last item, and thieves compete with each other by a single CAS on top.
+//
+// Unlike the original design, capacity is fixed and push fail when full. It
+// is expected to be used as a local buffer in front of some global queue, so
+// caller can fallback to that queue instead of growing the deque.
+template <typename T>
+class ConcurrentWorkStealingDeque {
+ public:
+  // Default constructed deque has capacity 1. Not copyable nor movable, since
+  // owner and thieves hold reference to it concurrently.
+  ConcurrentWorkStealingDeque() noexcept;
+  ConcurrentWorkStealingDeque(ConcurrentWorkStealingDeque&&) = delete;
+  ConcurrentWorkStealingDeque(const ConcurrentWorkStealingDeque&) = delete;
+  ConcurrentWorkStealingDeque& operator=(ConcurrentWorkStealingDeque&&) =
+      delete;
+  ConcurrentWorkStealingDeque& operator=(const ConcurrentWorkStealingDeque&) =
+      delete;
+  ~ConcurrentWorkStealingDeque() noexcept = default;
+
+  // Construct with capacity no less than min_capacity. Actual capacity is
+  // ceiled to 2^n.
+  ConcurrentWorkStealingDeque(size_t min_capacity) noexcept;
+
+  inline size_t capacity() const noexcept;
+
+  // Approximate number of items in deque. Not synchronized with in-flight
+  // operations, and only useful as a hint.
+  inline size_t size() const noexcept;
+
+  // Resize and reset deque to empty. Not thread safe, can not run concurrently
+  // with any other operation.
+  size_t reserve_and_clear(size_t min_capacity) noexcept;
+
+  // Owner side. Push an item to bottom end. Return false when deque is full,
+  // value is not moved away in that case.
+  template <typename U>
+  inline bool try_push(U&& value) noexcept;
+
+  // Owner side. Pop the most recently pushed item from bottom end. Return
+  // false when deque is empty.
+  inline bool try_pop(T& value) noexcept;
+
+  // Thief side. Steal the oldest item from top end. Return false when deque is
+  // empty, or lose the race with other thief or owner.
+  inline bool try_steal(T& value) noexcept;
+
+  // Thief side. Steal about half of the items in deque, at least one if not
+  // empty, and call C(T& value) for each of them in FIFO order. Items are
+  // claimed one by one, stop early when losing any race.
+  //
+  // Steal half amortize the cost of finding a victim. A thief usually move the
+  // extra stolen items to its own deque, so other idle thieves could in turn
+  // steal from it, spreading work across workers in log(n) rounds.
+  //
+  // return: number of items stolen
+  template <typename C>
+  inline size_t try_steal_half(C&& callback) noexcept;
+
+ private:
+  struct Slot {
+    T value;
+    // Item in this slot is not consumed yet. Owner set it before publishing
+    // by bottom, and consumer clear it after value moved away. Needed because
+    // thief move value out after claiming it by CAS on top, during that window
+    // owner may already see the slot as free from the view of top index.
+    ::std::atomic<bool> occupied {false};
+  };
+
+  template <typename C>
+  inline bool try_steal(C&& callback) noexcept;
+
+  ::std::unique_ptr<Slot[]> _slots;
+  size_t _slot_mask {0};
+
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<ssize_t> _top {0};
+  alignas(BABYLON_CACHELINE_SIZE)::std::atomic<ssize_t> _bottom {0};
+};
+
+BABYLON_NAMESPACE_END
+
+#include "babylon/concurrent/work_stealing_deque.hpp"
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "babylon/absl_numeric_bits.h" // absl::bit_ceil
+#include "babylon/concurrent/work_stealing_deque.h"
+
+// clang-format off
+#include BABYLON_EXTERNAL(absl/base/optimization.h) // ABSL_PREDICT_FALSE
+// clang-format on
+
+#pragma GCC diagnostic push
+// Thread Sanitizer目前无法支持std::atomic_thread_fence
+// gcc-12之后增加了相应的报错，显示标记忽视并特殊处理相关段落
+#if GCC_VERSION >= 120000
+#pragma GCC diagnostic ignored "-Wtsan"
+#endif // GCC_VERSION >= 120000
+
+BABYLON_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+// ConcurrentWorkStealingDeque begin
+template <typename T>
+ConcurrentWorkStealingDeque<T>::ConcurrentWorkStealingDeque() noexcept
+    : ConcurrentWorkStealingDeque(1) {}
+
+template <typename T>
+ConcurrentWorkStealingDeque<T>::ConcurrentWorkStealingDeque(
+    size_t min_capacity) noexcept {
+  reserve_and_clear(min_capacity);
+}
+
+template <typename T>
+inline size_t ConcurrentWorkStealingDeque<T>::capacity() const noexcept {
+  return _slot_mask + 1;
+}
+
+template <typename T>
+inline size_t ConcurrentWorkStealingDeque<T>::size() const noexcept {
+  auto bottom = _bottom.load(::std::memory_order_relaxed);
+  auto top = _top.load(::std::memory_order_relaxed);
+  // 由于没有同步机制，可能存在bottom < top的情况，处理为0
+  return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+}
+
+template <typename T>
+size_t ConcurrentWorkStealingDeque<T>::reserve_and_clear(
+    size_t min_capacity) noexcept {
+  auto new_capacity = ::absl::bit_ceil(min_capacity);
+  if (!_slots || new_capacity != capacity()) {
+    _slots.reset(new Slot[new_capacity]);
+    _slot_mask = new_capacity - 1;
+  } else {
+    for (size_t i = 0; i < new_capacity; ++i) {
+      _slots[i].value = T();
+      _slots[i].occupied.store(false, ::std::memory_order_relaxed);
+    }
+  }
+  _top.store(0, ::std::memory_order_relaxed);
+  _bottom.store(0, ::std::memory_order_relaxed);
+  return capacity();
+}
+
+template <typename T>
+template <typename U>
+inline bool ConcurrentWorkStealingDeque<T>::try_push(U&& value) noexcept {
+  auto bottom = _bottom.load(::std::memory_order_relaxed);
+  auto top = _top.load(::std::memory_order_acquire);
+  if (static_cast<size_t>(bottom - top) > _slot_mask) {
+    return false;
+  }
+  auto& slot = _slots[static_cast<size_t>(bottom) & _slot_mask];
+  // A thief claimed this slot in last round, but still moving value out
+  if (ABSL_PREDICT_FALSE(slot.occupied.load(::std::memory_order_acquire))) {
+    return false;
+  }
+  slot.value = ::std::forward<U>(value);
+  slot.occupied.store(true, ::std::memory_order_relaxed);
+  _bottom.store(bottom + 1, ::std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+inline bool ConcurrentWorkStealingDeque<T>::try_pop(T& value) noexcept {
+  auto bottom = _bottom.load(::std::memory_order_relaxed) - 1;
+  _bottom.store(bottom, ::std::memory_order_relaxed);
+  // Make decrement of bottom visible to thieves before reading top, pair with
+  // the fence in try_steal
+  ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+  auto top = _top.load(::std::memory_order_relaxed);
+  if (top > bottom) {
+    // Empty
+    _bottom.store(bottom + 1, ::std::memory_order_relaxed);
+    return false;
+  }
+  if (top == bottom) {
+    // Last one, compete with thieves
+    bool success = _top.compare_exchange_strong(
+        top, top + 1, ::std::memory_order_seq_cst, ::std::memory_order_relaxed);
+    _bottom.store(bottom + 1, ::std::memory_order_relaxed);
+    if (!success) {
+      return false;
+    }
+  }
+  auto& slot = _slots[static_cast<size_t>(bottom) & _slot_mask];
+  value = ::std::move(slot.value);
+  slot.occupied.store(false, ::std::memory_order_relaxed);
+  return true;
+}
+
+template <typename T>
+inline bool ConcurrentWorkStealingDeque<T>::try_steal(T& value) noexcept {
+  return try_steal([&](T& stolen_value) {
+    value = ::std::move(stolen_value);
+  });
+}
+
+template <typename T>
+template <typename C>
+inline size_t ConcurrentWorkStealingDeque<T>::try_steal_half(
+    C&& callback) noexcept {
+  auto expect_num = (size() + 1) / 2;
+  size_t num = 0;
+  while (num < expect_num && try_steal(callback)) {
+    ++num;
+  }
+  return num;
+}
+
+template <typename T>
+template <typename C>
+inline bool ConcurrentWorkStealingDeque<T>::try_steal(C&& callback) noexcept {
+  auto top = _top.load(::std::memory_order_acquire);
+  // Pair with the fence in try_pop
+  ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+  auto bottom = _bottom.load(::std::memory_order_acquire);
+  if (top >= bottom) {
+    return false;
+  }
+  if (!_top.compare_exchange_strong(top, top + 1, ::std::memory_order_seq_cst,
+                                    ::std::memory_order_relaxed)) {
+    return false;
+  }
+  // Slot is claimed exclusively. Owner will not reuse it until occupied is
+  // cleared, so value can be moved out after the CAS
+  auto& slot = _slots[static_cast<size_t>(top) & _slot_mask];
+  callback(slot.value);
+  slot.occupied.store(false, ::std::memory_order_release);
+  return true;
+}
+// ConcurrentWorkStealingDeque end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
+
+#pragma GCC diagnostic pop
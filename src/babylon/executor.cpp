@@ -6,6 +6,16 @@
 
 BABYLON_NAMESPACE_BEGIN
 
+// Hint cpu that we are in a spin loop, reduce power and let the sibling
+// hyper-thread go first
+static inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Executor begin
 // Executor end
@@ -89,30 +99,110 @@ void ThreadPoolExecutor::set_enable_work_stealing(
   _enable_work_stealing = enable_work_stealing;
 }
 
+void ThreadPoolExecutor::set_use_work_stealing_deque(
+    bool use_work_stealing_deque) noexcept {
+  _use_work_stealing_deque = use_work_stealing_deque;
+}
+
+void ThreadPoolExecutor::set_enable_numa_aware(
+    bool enable_numa_aware) noexcept {
+  _enable_numa_aware = enable_numa_aware;
+}
+
+void ThreadPoolExecutor::set_numa_topology(
+    const NumaTopology& numa_topology) noexcept {
+  _numa_topology = numa_topology;
+}
+
+void ThreadPoolExecutor::set_idle_spin_times(size_t idle_spin_times) noexcept {
+  _idle_spin_times = idle_spin_times;
+}
+
+void ThreadPoolExecutor::set_idle_yield_times(
+    size_t idle_yield_times) noexcept {
+  _idle_yield_times = idle_yield_times;
+}
+
+void ThreadPoolExecutor::set_enable_priority(bool enable_priority) noexcept {
+  _enable_priority = enable_priority;
+}
+
+void ThreadPoolExecutor::set_priority_weights(
+    size_t critical_weight, size_t normal_weight,
+    size_t background_weight) noexcept {
+  _priority_weights[0] = critical_weight;
+  _priority_weights[1] = normal_weight;
+  _priority_weights[2] = background_weight;
+}
+
+void ThreadPoolExecutor::set_max_worker_number(
+    size_t max_worker_number) noexcept {
+  _max_worker_number = max_worker_number;
+}
+
+void ThreadPoolExecutor::set_enable_statistics(
+    bool enable_statistics) noexcept {
+  _enable_statistics = enable_statistics;
+}
+
 int ThreadPoolExecutor::start() noexcept {
   if (_running.load(::std::memory_order_acquire)) {
     return -1;
   }
   _running.store(true, ::std::memory_order_release);
+  // Per worker structures are prepared for all possible workers
+  auto slot_number = use_elastic() ? _max_worker_number : _worker_number;
   _global_task_queue.reserve_and_clear(_global_capacity * 2);
+  _node_task_queues.clear();
+  if (_enable_numa_aware) {
+    // Only nodes with worker get a queue, so every queue has its consumers
+    _node_task_queues.resize(
+        ::std::max<size_t>(1, ::std::min(_numa_topology.node_num(),
+                                         slot_number)));
+    for (auto& queue : _node_task_queues) {
+      queue.reserve_and_clear(_global_capacity * 2);
+    }
+  }
+  if (_enable_priority) {
+    _critical_task_queue.reserve_and_clear(_global_capacity * 2);
+    _background_task_queue.reserve_and_clear(_global_capacity * 2);
+    _worker_priority_credits.reset(new PriorityCredits[slot_number]);
+    auto queue_number = ::std::max<size_t>(1, _node_task_queues.size());
+    _blocking_worker_numbers.reset(new ::std::atomic<size_t>[queue_number]);
+    for (size_t i = 0; i < queue_number; ++i) {
+      _blocking_worker_numbers[i].store(0, ::std::memory_order_relaxed);
+    }
+  }
   _local_task_queues.set_constructor(
       [this](ConcurrentBoundedQueue<Task>* queue) {
         new (queue) ConcurrentBoundedQueue<Task>;
         queue->reserve_and_clear(_local_capacity * 2);
       });
-  _threads.reserve(_worker_number);
+  _local_task_deques.set_constructor([this](TaskDeque* deque) {
+    new (deque) TaskDeque(_local_capacity);
+  });
+  _worker_task_deques.reset(new ::std::atomic<TaskDeque*>[slot_number]);
+  _worker_alive.reset(new ::std::atomic<bool>[slot_number]);
+  for (size_t i = 0; i < slot_number; ++i) {
+    _worker_task_deques[i].store(nullptr, ::std::memory_order_relaxed);
+    _worker_alive[i].store(i < _worker_number, ::std::memory_order_relaxed);
+  }
+  _alive_worker_number.store(_worker_number, ::std::memory_order_relaxed);
+  _threads.resize(slot_number);
   for (size_t i = 0; i < _worker_number; ++i) {
-    _threads.emplace_back(&ThreadPoolExecutor::keep_execute, this);
+    _threads[i] = ::std::thread(&ThreadPoolExecutor::keep_execute, this, i);
   }
   if (_balance_interval.count() >= 0) {
     _balance_thread = ::std::thread(&ThreadPoolExecutor::keep_balance, this);
   }
+  if (use_elastic()) {
+    _elastic_thread = ::std::thread(&ThreadPoolExecutor::keep_elastic, this);
+  }
   return 0;
 }
 
 void ThreadPoolExecutor::wakeup_one_worker() noexcept {
-  _global_task_queue.push<true, false, true>(
-      Task {.type = TaskType::WAKEUP, .function {}});
+  push_global_task(Task {.type = TaskType::WAKEUP, .function {}});
 }
 
 void ThreadPoolExecutor::stop() noexcept {
@@ -123,16 +213,63 @@ void ThreadPoolExecutor::stop() noexcept {
   if (_balance_thread.joinable()) {
     _balance_thread.join();
   }
-  for (size_t i = 0; i < _threads.size(); ++i) {
-    _global_task_queue.push<true, false, true>(
-        Task {.type = TaskType::STOP, .function {}});
+  // No more worker grow after that, and worker no longer retire when not
+  // running, so each alive worker consume exactly one stop signal
+  if (_elastic_thread.joinable()) {
+    _elastic_thread.join();
+  }
+  auto alive_worker_number =
+      _alive_worker_number.load(::std::memory_order_acquire);
+  for (size_t i = 0; i < alive_worker_number; ++i) {
+    // Each worker block on queue of its own node at last
+    auto& queue = _enable_numa_aware
+                      ? _node_task_queues[i % _node_task_queues.size()]
+                      : _global_task_queue;
+    queue.push<true, false, true>(Task {.type = TaskType::STOP, .function {}});
+  }
+  if (use_idle_park()) {
+    _park_futex.value().fetch_add(1, ::std::memory_order_release);
+    _park_futex.wake_all();
   }
   for (auto& thread : _threads) {
-    thread.join();
+    if (thread.joinable()) {
+      thread.join();
+    }
   }
   _threads.clear();
 }
 
+size_t ThreadPoolExecutor::alive_worker_number() const noexcept {
+  return _alive_worker_number.load(::std::memory_order_acquire);
+}
+
+ThreadPoolExecutor::Statistics ThreadPoolExecutor::statistics()
+    const noexcept {
+  Statistics statistics;
+  statistics.local_pop_num = _local_pop_counter.value();
+  statistics.steal_num = _steal_counter.value();
+  statistics.global_pop_num = _global_pop_counter.value();
+  statistics.balance_move_num = _balance_move_counter.value();
+  statistics.queue_delay_us = _queue_delay_summer.value();
+  statistics.run_time_us = _run_time_summer.value();
+  _queue_delay_sampler.for_each(
+      [&](size_t index, const ConcurrentSampler::SampleBucket& bucket) {
+        statistics.queue_delay_histogram[index] +=
+            bucket.record_num.load(::std::memory_order_acquire);
+      });
+  _run_time_sampler.for_each(
+      [&](size_t index, const ConcurrentSampler::SampleBucket& bucket) {
+        statistics.run_time_histogram[index] +=
+            bucket.record_num.load(::std::memory_order_acquire);
+      });
+  return statistics;
+}
+
+void ThreadPoolExecutor::reset_statistics() noexcept {
+  _queue_delay_sampler.reset();
+  _run_time_sampler.reset();
+}
+
 int ThreadPoolExecutor::initialize(size_t worker_number,
                                    size_t global_capacity) noexcept {
   if (!_threads.empty()) {
@@ -145,44 +282,81 @@ int ThreadPoolExecutor::initialize(size_t worker_number,
 
 int ThreadPoolExecutor::invoke(
     MoveOnlyFunction<void(void)>&& function) noexcept {
-  return enqueue_task(
-      {.type = TaskType::FUNCTION, .function {::std::move(function)}});
+  Task task {.type = TaskType::FUNCTION, .function {::std::move(function)}};
+  stamp_enqueue_time(task);
+  return enqueue_task(::std::move(task));
+}
+
+int ThreadPoolExecutor::invoke_with_priority(
+    MoveOnlyFunction<void(void)>&& function, TaskPriority priority) noexcept {
+  Task task {.type = TaskType::FUNCTION,
+             .function {::std::move(function)},
+             .priority = priority};
+  stamp_enqueue_time(task);
+  return enqueue_task(::std::move(task));
+}
+
+int ThreadPoolExecutor::invoke_n(MoveOnlyFunction<void(void)>* functions,
+                                 size_t num) noexcept {
+  // Local tasks need no wakeup, keep same as invoke one by one
+  if (is_running_in() && _local_capacity > 0) {
+    for (size_t i = 0; i < num; ++i) {
+      invoke(::std::move(functions[i]));
+    }
+    return 0;
+  }
+  push_global_tasks(functions, num);
+  return 0;
 }
 
-void ThreadPoolExecutor::keep_execute() noexcept {
-  auto& local_queue = _local_task_queues.local();
+void ThreadPoolExecutor::keep_execute(size_t index) noexcept {
+  if (_enable_numa_aware) {
+    auto node_num = _node_task_queues.size();
+    auto& cpus = _numa_topology.node_cpus(index % node_num);
+    NumaTopology::bind_current_thread({cpus[index / node_num % cpus.size()]});
+  }
+  if (_use_work_stealing_deque) {
+    _worker_task_deques[index].store(&_local_task_deques.local(),
+                                     ::std::memory_order_release);
+  }
   RunnerScope scope {*this};
   while (true) {
     Task task;
-    if (!local_queue.try_pop<true, false>(task)) {
-      bool steal_success = false;
-      if (_enable_work_stealing) {
-        _local_task_queues.for_each([&](TaskQueue* iter, TaskQueue* end) {
-          if (steal_success) {
-            return;
-          }
-          while (iter != end) {
-            auto& queue = *iter++;
-            steal_success = queue.try_pop<true, false>(task);
-            if (steal_success) {
-              return;
-            }
-          }
-        });
-      }
-      if (!steal_success) {
-        _global_task_queue.pop<true, true, false>(task);
-      }
-    }
+    pop_task(index, task);
     switch (task.type) {
       case TaskType::FUNCTION: {
-        task.function();
+        if (_enable_statistics) {
+          run_with_statistics(task);
+        } else {
+          task.function();
+        }
       } break;
       case TaskType::STOP: {
+        // Lanes may be skipped when stop signal comes from global queue, run
+        // rest tasks in them before exit
+        if (_enable_priority) {
+          while (_critical_task_queue.try_pop<true, false>(task) ||
+                 _background_task_queue.try_pop<true, false>(task)) {
+            if (_enable_statistics) {
+              run_with_statistics(task);
+            } else {
+              task.function();
+            }
+          }
+        }
         return;
       }
       case TaskType::WAKEUP: {
       } break;
+      case TaskType::RETIRE: {
+        // Local deque is empty when idle, just hide it from thieves
+        if (_use_work_stealing_deque) {
+          _worker_task_deques[index].store(nullptr,
+                                           ::std::memory_order_release);
+        }
+        _worker_alive[index].store(false, ::std::memory_order_release);
+        return;
+      }
       default:
         assert(false);
     }
@@ -201,15 +375,136 @@ void ThreadPoolExecutor::keep_balance() noexcept {
           success = queue.try_pop<true, false>([&](Task& task) {
             enqueue_task(::std::move(task));
           });
+          if (success && _enable_statistics) {
+            _balance_move_counter << 1;
+          }
         }
       }
     });
+    if (_use_work_stealing_deque) {
+      _local_task_deques.for_each([&](TaskDeque* iter, TaskDeque* end) {
+        while (iter != end) {
+          auto& deque = *iter++;
+          Task task;
+          while (deque.try_steal(task)) {
+            enqueue_task(::std::move(task));
+            if (_enable_statistics) {
+              _balance_move_counter << 1;
+            }
+          }
+        }
+      });
+    }
+  }
+}
+
+void ThreadPoolExecutor::keep_elastic() noexcept {
+  // Check several times in each grow_queue_delay, so backlog lasting longer
+  // than that is noticed in time
+  auto check_interval = ::std::max(_grow_queue_delay / 4,
+                                   ::std::chrono::microseconds {100});
+  auto backlog_begin = ::std::chrono::steady_clock::time_point::max();
+  while (_running.load(::std::memory_order_acquire)) {
+    ::std::this_thread::sleep_for(check_interval);
+
+    // Any idle worker will drain the backlog soon, no need to grow
+    if (task_backlog() == 0 ||
+        _spinning_worker_number.load(::std::memory_order_acquire) > 0 ||
+        _parked_worker_number.load(::std::memory_order_acquire) > 0) {
+      backlog_begin = ::std::chrono::steady_clock::time_point::max();
+      continue;
+    }
+    auto now = ::std::chrono::steady_clock::now();
+    if (backlog_begin == ::std::chrono::steady_clock::time_point::max()) {
+      backlog_begin = now;
+    } else if (now - backlog_begin >= _grow_queue_delay && grow_worker()) {
+      // Give new worker a full period to take effect before grow again
+      backlog_begin = now;
+    }
+  }
+}
+
+size_t ThreadPoolExecutor::task_backlog() const noexcept {
+  size_t backlog = 0;
+  if (_enable_numa_aware) {
+    for (auto& queue : _node_task_queues) {
+      backlog += queue.size();
+    }
+  } else {
+    backlog += _global_task_queue.size();
+  }
+  if (_enable_priority) {
+    backlog += _critical_task_queue.size() + _background_task_queue.size();
+  }
+  // Tasks stuck in local queue of a busy worker also count, as long as a new
+  // worker can take them by stealing or balance thread can move them out
+  if (_enable_work_stealing || _balance_interval.count() >= 0) {
+    if (_use_work_stealing_deque) {
+      _local_task_deques.for_each(
+          [&](const TaskDeque* iter, const TaskDeque* end) {
+            while (iter != end) {
+              backlog += iter++->size();
+            }
+          });
+    } else {
+      _local_task_queues.for_each(
+          [&](const TaskQueue* iter, const TaskQueue* end) {
+            while (iter != end) {
+              backlog += iter++->size();
+            }
+          });
+    }
+  }
+  return backlog;
+}
+
+bool ThreadPoolExecutor::grow_worker() noexcept {
+  for (size_t i = 0; i < _threads.size(); ++i) {
+    if (_worker_alive[i].load(::std::memory_order_acquire)) {
+      continue;
+    }
+    // Retired worker is already on its way out, just join and reuse slot
+    if (_threads[i].joinable()) {
+      _threads[i].join();
+    }
+    _worker_alive[i].store(true, ::std::memory_order_relaxed);
+    _alive_worker_number.fetch_add(1, ::std::memory_order_acq_rel);
+    _threads[i] = ::std::thread(&ThreadPoolExecutor::keep_execute, this, i);
+    return true;
+  }
+  return false;
+}
+
+bool ThreadPoolExecutor::try_retire_worker() noexcept {
+  if (!_running.load(::std::memory_order_acquire)) {
+    return false;
+  }
+  auto alive_worker_number =
+      _alive_worker_number.load(::std::memory_order_acquire);
+  while (alive_worker_number > _worker_number) {
+    if (_alive_worker_number.compare_exchange_weak(
+            alive_worker_number, alive_worker_number - 1,
+            ::std::memory_order_acq_rel)) {
+      return true;
+    }
   }
+  return false;
 }
 
 int ThreadPoolExecutor::enqueue_task(Task&& task) noexcept {
+  if (_enable_priority && task.priority != TaskPriority::NORMAL) {
+    push_priority_task(::std::move(task));
+    return 0;
+  }
   if (is_running_in()) {
     if (_local_capacity > 0) {
+      if (_use_work_stealing_deque) {
+        if (_local_task_deques.local().try_push(::std::move(task))) {
+          return 0;
+        }
+        push_global_task(::std::move(task));
+        return 0;
+      }
       auto& local_queue = _local_task_queues.local();
       if (local_queue.size() < _local_capacity) {
         local_queue.push<false, false, false>(::std::move(task));
@@ -217,9 +512,426 @@ int ThreadPoolExecutor::enqueue_task(Task&& task) noexcept {
       }
     }
   }
-  _global_task_queue.push<true, false, true>(::std::move(task));
+  push_global_task(::std::move(task));
   return 0;
 }
+
+void ThreadPoolExecutor::pop_task(size_t index, Task& task) noexcept {
+  if (!try_pop_task(index, task)) {
+    pop_global_task(index, task);
+  }
+}
+
+bool ThreadPoolExecutor::try_pop_task(size_t index, Task& task) noexcept {
+  if (!_enable_priority) {
+    return pop_local_task(index, task);
+  }
+  // Strict order, unless weighted round robin pick another lane first
+  TaskPriority first = TaskPriority::CRITICAL;
+  auto& weights = _priority_weights;
+  if (weights[0] + weights[1] + weights[2] > 0) {
+    auto& credits = _worker_priority_credits[index].credits;
+    size_t picked = 0;
+    for (size_t i = 0; i < 3; ++i) {
+      credits[i] += static_cast<ssize_t>(weights[i]);
+      if (credits[i] > credits[picked]) {
+        picked = i;
+      }
+    }
+    credits[picked] -=
+        static_cast<ssize_t>(weights[0] + weights[1] + weights[2]);
+    first = static_cast<TaskPriority>(picked);
+  }
+  if (try_pop_priority_task(index, first, task)) {
+    return true;
+  }
+  for (auto priority : {TaskPriority::CRITICAL, TaskPriority::NORMAL,
+                        TaskPriority::BACKGROUND}) {
+    if (priority != first && try_pop_priority_task(index, priority, task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPoolExecutor::try_pop_priority_task(size_t index,
+                                               TaskPriority priority,
+                                               Task& task) noexcept {
+  switch (priority) {
+    case TaskPriority::CRITICAL:
+    case TaskPriority::BACKGROUND: {
+      auto& queue = priority == TaskPriority::CRITICAL ? _critical_task_queue
+                                                       : _background_task_queue;
+      if (!queue.try_pop<true, false>(task)) {
+        return false;
+      }
+      if (_enable_statistics) {
+        _global_pop_counter << 1;
+      }
+      return true;
+    }
+    default:
+      return pop_local_task(index, task) || try_pop_global_task(index, task);
+  }
+}
+
+void ThreadPoolExecutor::push_priority_task(Task&& task) noexcept {
+  auto& queue = task.priority == TaskPriority::CRITICAL
+                    ? _critical_task_queue
+                    : _background_task_queue;
+  queue.push<true, false, true>(::std::move(task));
+  // Idle workers only block on global queue, wakeup one of them per task to
+  // check lanes, so a burst of priority tasks is taken by as many workers
+  if (use_idle_park()) {
+    notify_idle_worker();
+    return;
+  }
+  // Same as notify_idle_worker, skip wakeup when nobody is blocking. Pair with
+  // the fence in pop_global_task, either submitter see the worker blocking,
+  // or the worker see the task in its final check
+  ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+  if (!_enable_numa_aware) {
+    if (_blocking_worker_numbers[0].load(::std::memory_order_relaxed) > 0) {
+      _global_task_queue.try_push<true, true>(
+          Task {.type = TaskType::WAKEUP, .function {}});
+    }
+    return;
+  }
+  // Lanes are shared by all nodes, but workers only block on queue of their
+  // own node. Prefer submitting node, then any other node having blocking
+  // worker. Wakeup is dropped when queue is full, which means no one blocking
+  auto node_num = _node_task_queues.size();
+  auto node = submit_node();
+  for (size_t i = 0; i < node_num; ++i) {
+    auto wakeup_node = (node + i) % node_num;
+    if (_blocking_worker_numbers[wakeup_node].load(
+            ::std::memory_order_relaxed) > 0) {
+      _node_task_queues[wakeup_node].try_push<true, true>(
+          Task {.type = TaskType::WAKEUP, .function {}});
+      return;
+    }
+  }
+}
+
+bool ThreadPoolExecutor::pop_local_task(size_t index, Task& task) noexcept {
+  if (_use_work_stealing_deque
+          ? _local_task_deques.local().try_pop(task)
+          : _local_task_queues.local().try_pop<true, false>(task)) {
+    if (_enable_statistics) {
+      _local_pop_counter << 1;
+    }
+    return true;
+  }
+  if (!_enable_work_stealing) {
+    return false;
+  }
+  if (_use_work_stealing_deque ? steal_task_from_deques(index, task)
+                               : steal_task_from_queues(task)) {
+    if (_enable_statistics) {
+      _steal_counter << 1;
+    }
+    return true;
+  }
+  return false;
+}
+
+bool ThreadPoolExecutor::steal_task_from_queues(Task& task) noexcept {
+  bool steal_success = false;
+  _local_task_queues.for_each([&](TaskQueue* iter, TaskQueue* end) {
+    if (steal_success) {
+      return;
+    }
+    while (iter != end) {
+      auto& queue = *iter++;
+      steal_success = queue.try_pop<true, false>(task);
+      if (steal_success) {
+        return;
+      }
+    }
+  });
+  return steal_success;
+}
+
+bool ThreadPoolExecutor::steal_task_from_deques(size_t index,
+                                                Task& task) noexcept {
+  // Start from a random victim, so idle workers spread their stealing over
+  // all deques instead of hammering the same low-index ones
+  thread_local uint64_t seed = reinterpret_cast<uintptr_t>(&seed) | 1;
+  seed ^= seed << 13;
+  seed ^= seed >> 7;
+  seed ^= seed << 17;
+
+  auto& local_deque = _local_task_deques.local();
+  auto slot_number = _threads.size();
+  auto begin = seed % slot_number;
+  for (size_t i = 0; i < slot_number; ++i) {
+    auto victim_index = (begin + i) % slot_number;
+    if (victim_index == index) {
+      continue;
+    }
+    auto victim = _worker_task_deques[victim_index].load(
+        ::std::memory_order_acquire);
+    if (victim == nullptr) {
+      continue;
+    }
+    // Run the oldest stolen task directly, keep the rest in local deque so
+    // other thieves could steal them from here in turn
+    bool steal_success = false;
+    victim->try_steal_half([&](Task& stolen_task) {
+      if (!steal_success) {
+        task = ::std::move(stolen_task);
+        steal_success = true;
+      } else if (!local_deque.try_push(::std::move(stolen_task))) {
+        push_global_task(::std::move(stolen_task));
+      }
+    });
+    if (steal_success) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t ThreadPoolExecutor::submit_node() const noexcept {
+  return _numa_topology.current_node() % _node_task_queues.size();
+}
+
+void ThreadPoolExecutor::push_global_task(Task&& task) noexcept {
+  if (!_enable_numa_aware) {
+    _global_task_queue.push<true, false, true>(::std::move(task));
+  } else {
+    push_node_task(::std::move(task));
+  }
+  if (use_idle_park()) {
+    notify_idle_worker();
+  }
+}
+
+void ThreadPoolExecutor::push_global_tasks(
+    MoveOnlyFunction<void(void)>* functions, size_t num) noexcept {
+  auto node = _enable_numa_aware ? submit_node() : 0;
+  auto& queue =
+      _enable_numa_aware ? _node_task_queues[node] : _global_task_queue;
+  while (num > 0) {
+    // Slots reserved in one push_n can not exceed capacity
+    auto batch_num = ::std::min(num, queue.capacity());
+    queue.push_n<true, false, true>(
+        [&](TaskQueue::Iterator iter, TaskQueue::Iterator end) {
+          while (iter != end) {
+            auto& task = *iter++;
+            task = Task {.type = TaskType::FUNCTION,
+                         .function {::std::move(*functions++)}};
+            stamp_enqueue_time(task);
+          }
+        },
+        batch_num);
+    num -= batch_num;
+    if (use_idle_park()) {
+      notify_idle_worker(batch_num);
+    }
+  }
+  if (_enable_numa_aware) {
+    wakeup_idle_node(node);
+  }
+}
+
+void ThreadPoolExecutor::push_node_task(Task&& task) noexcept {
+  auto node_num = _node_task_queues.size();
+  auto node = submit_node();
+  auto& queue = _node_task_queues[node];
+  if (queue.try_push<true, true>(::std::move(task))) {
+    wakeup_idle_node(node);
+    return;
+  }
+  // Spill to other nodes before blocking on a full queue
+  for (size_t i = 1; i < node_num; ++i) {
+    auto& other_queue = _node_task_queues[(node + i) % node_num];
+    if (other_queue.try_push<true, true>(::std::move(task))) {
+      return;
+    }
+  }
+  queue.push<true, false, true>(::std::move(task));
+}
+
+void ThreadPoolExecutor::wakeup_idle_node(size_t busy_node) noexcept {
+  // Workers of other nodes only look at this queue after wakeup. When some
+  // node seems idle, kick one of its workers to share the backlog. Not needed
+  // in idle park mode, where workers park and scan all queues together
+  if (use_idle_park() || _node_task_queues[busy_node].size() <= 1) {
+    return;
+  }
+  auto node_num = _node_task_queues.size();
+  for (size_t i = 1; i < node_num; ++i) {
+    auto& other_queue = _node_task_queues[(busy_node + i) % node_num];
+    if (other_queue.size() == 0) {
+      other_queue.try_push<true, true>(
+          Task {.type = TaskType::WAKEUP, .function {}});
+      return;
+    }
+  }
+}
+
+void ThreadPoolExecutor::pop_global_task(size_t index, Task& task) noexcept {
+  if (use_idle_park()) {
+    spin_then_park(index, task);
+    return;
+  }
+  if (try_pop_global_task(index, task)) {
+    return;
+  }
+  auto node = _enable_numa_aware ? index % _node_task_queues.size() : 0;
+  auto& queue =
+      _enable_numa_aware ? _node_task_queues[node] : _global_task_queue;
+  if (!_enable_priority) {
+    queue.pop<true, true, false>(task);
+  } else {
+    // Priority submitter only push wakeup when seeing blocking worker. So
+    // register as blocking, then check lanes again before block
+    auto& blocking_worker_number = _blocking_worker_numbers[node];
+    blocking_worker_number.fetch_add(1, ::std::memory_order_seq_cst);
+    ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+    if (try_pop_task(index, task)) {
+      blocking_worker_number.fetch_sub(1, ::std::memory_order_relaxed);
+      return;
+    }
+    queue.pop<true, true, false>(task);
+    blocking_worker_number.fetch_sub(1, ::std::memory_order_relaxed);
+  }
+  if (_enable_statistics && task.type == TaskType::FUNCTION) {
+    _global_pop_counter << 1;
+  }
+}
+
+bool ThreadPoolExecutor::try_pop_global_task(size_t index,
+                                             Task& task) noexcept {
+  if (!_enable_numa_aware) {
+    if (!_global_task_queue.try_pop<true, false>(task)) {
+      return false;
+    }
+    if (_enable_statistics && task.type == TaskType::FUNCTION) {
+      _global_pop_counter << 1;
+    }
+    return true;
+  }
+  auto node_num = _node_task_queues.size();
+  auto node = index % node_num;
+  for (size_t i = 0; i < node_num; ++i) {
+    auto& queue = _node_task_queues[(node + i) % node_num];
+    if (!queue.try_pop<true, false>(task)) {
+      continue;
+    }
+    // Without idle park, worker finally block on queue of its own node. So
+    // stop signal belongs to a worker of that node, give it back
+    if (i > 0 && !use_idle_park() &&
+        ABSL_PREDICT_FALSE(task.type == TaskType::STOP)) {
+      queue.push<true, false, true>(::std::move(task));
+      continue;
+    }
+    if (_enable_statistics && task.type == TaskType::FUNCTION) {
+      _global_pop_counter << 1;
+    }
+    return true;
+  }
+  return false;
+}
+
+void ThreadPoolExecutor::spin_then_park(size_t index, Task& task) noexcept {
+  _spinning_worker_number.fetch_add(1, ::std::memory_order_seq_cst);
+  while (true) {
+    auto poll_times = _idle_spin_times + _idle_yield_times;
+    for (size_t i = 0; i < poll_times; ++i) {
+      if (try_pop_task(index, task) || try_pop_global_task(index, task)) {
+        // Submitter skip wakeup when seeing a spinning worker. So the last
+        // spinner need to hand over spinning to a parked worker before leaving
+        // to run task, or rest tasks may wait for nobody
+        if (_spinning_worker_number.fetch_sub(1, ::std::memory_order_seq_cst) ==
+            1) {
+          notify_idle_worker();
+        }
+        return;
+      }
+      if (i < _idle_spin_times) {
+        cpu_relax();
+      } else {
+        SchedInterface::yield();
+      }
+    }
+
+    // Register as parked before leave spinning, so any submitter will see at
+    // least one of them. Then check again before sleep to close the window
+    _parked_worker_number.fetch_add(1, ::std::memory_order_seq_cst);
+    _spinning_worker_number.fetch_sub(1, ::std::memory_order_seq_cst);
+    auto epoch = _park_futex.value().load(::std::memory_order_acquire);
+    ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+    if (try_pop_task(index, task) || try_pop_global_task(index, task)) {
+      _parked_worker_number.fetch_sub(1, ::std::memory_order_relaxed);
+      notify_idle_worker();
+      return;
+    }
+    if (!use_elastic()) {
+      _park_futex.wait(epoch, nullptr);
+      _parked_worker_number.fetch_sub(1, ::std::memory_order_relaxed);
+    } else {
+      auto keepalive = _idle_keepalive.count();
+      struct ::timespec timeout;
+      timeout.tv_sec = keepalive / 1000000;
+      timeout.tv_nsec = keepalive % 1000000 * 1000;
+      errno = 0;
+      _park_futex.wait(epoch, &timeout);
+      auto timedout = errno == ETIMEDOUT;
+      _parked_worker_number.fetch_sub(1, ::std::memory_order_relaxed);
+      // Nobody notify during the whole keepalive, it is idle enough to retire
+      if (timedout && try_retire_worker()) {
+        task.type = TaskType::RETIRE;
+        return;
+      }
+    }
+    _spinning_worker_number.fetch_add(1, ::std::memory_order_seq_cst);
+  }
+}
+
+void ThreadPoolExecutor::notify_idle_worker(size_t task_num) noexcept {
+  // Pair with the fence in spin_then_park, either submitter see the worker
+  // spinning or parked, or the worker see the task in its final check
+  ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+  auto spinning_num = _spinning_worker_number.load(::std::memory_order_relaxed);
+  if (spinning_num >= task_num) {
+    return;
+  }
+  auto parked_num = _parked_worker_number.load(::std::memory_order_relaxed);
+  if (parked_num == 0) {
+    return;
+  }
+  _park_futex.value().fetch_add(1, ::std::memory_order_release);
+  auto wakeup_num = ::std::min(task_num - spinning_num, parked_num);
+  if (wakeup_num >= parked_num) {
+    _park_futex.wake_all();
+    return;
+  }
+  for (size_t i = 0; i < wakeup_num; ++i) {
+    _park_futex.wake_one();
+  }
+}
+void ThreadPoolExecutor::run_with_statistics(Task& task) noexcept {
+  using ::std::chrono::duration_cast;
+  using ::std::chrono::microseconds;
+  using ::std::chrono::steady_clock;
+
+  auto begin = steady_clock::now();
+  // Task enqueued before statistics enabled has no stamp
+  if (task.enqueue_time != steady_clock::time_point {}) {
+    auto queue_delay =
+        duration_cast<microseconds>(begin - task.enqueue_time).count();
+    _queue_delay_summer << queue_delay;
+    _queue_delay_sampler << static_cast<uint32_t>(queue_delay);
+  }
+  task.function();
+  auto run_time =
+      duration_cast<microseconds>(steady_clock::now() - begin).count();
+  _run_time_summer << run_time;
+  _run_time_sampler << static_cast<uint32_t>(run_time);
+}
+
 // ThreadPoolExecutor end
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -1,16 +1,44 @@
 #pragma once
 
-#include "babylon/basic_executor.h"           // BasicExecutor
-#include "babylon/concurrent/bounded_queue.h" // ConcurrentBoundedQueue
-#include "babylon/concurrent/thread_local.h"  // EnumerableThreadLocal
-#include "babylon/coroutine/task.h"           // CoroutineTask
-#include "babylon/future.h"                   // Future
-
-#include <thread> // std::thread
-#include <vector> // std::vector
+#include "babylon/basic_executor.h"                 // BasicExecutor
+#include "babylon/concurrent/bounded_queue.h"       // ConcurrentBoundedQueue
+#include "babylon/concurrent/counter.h"             // ConcurrentAdder
+#include "babylon/concurrent/sched_interface.h"     // Futex
+#include "babylon/concurrent/thread_local.h"        // EnumerableThreadLocal
+#include "babylon/concurrent/work_stealing_deque.h" // ConcurrentWorkStealingDeque
+#include "babylon/coroutine/task.h"                 // CoroutineTask
+#include "babylon/future.h"                         // Future
+#include "babylon/numa.h"                           // NumaTopology
+
+#include <chrono>   // std::chrono::steady_clock
+#include <iterator> // std::iterator_traits
+#include <optional> // std::optional
+#include <thread>   // std::thread
+#include <variant>  // std::monostate
+#include <vector>   // std::vector
 
 BABYLON_NAMESPACE_BEGIN
 
+// Scheduling attributes of a task, used by Executor::execute
+struct TaskAttributes {
+  // Executor without priority support just ignore it
+  TaskPriority priority {TaskPriority::NORMAL};
+  // Task not started before deadline is dropped when it is finally scheduled.
+  // Instead of callable, on_expire is called if not empty, and the associated
+  // future is set with an empty TaskResult. Used to fast-fail requests
+  // already timeout from the view of caller instead of burning cpu for them.
+  ::std::chrono::steady_clock::time_point deadline {
+      ::std::chrono::steady_clock::time_point::max()};
+  MoveOnlyFunction<void(void)> on_expire {};
+};
+
+// Result of a task executed with TaskAttributes. Empty when the task expired
+// before started, otherwise hold the result of callable, or std::monostate
+// for callable returning void.
+template <typename R>
+using TaskResult = ::std::optional<typename ::std::conditional<
+    ::std::is_void<R>::value, ::std::monostate, R>::type>;
+
 // Unified interface to launch a task to run asynchronously. A task can be a
 // closure of
 // - normal function
@@ -98,6 +126,16 @@ class Executor : public BasicExecutor {
 #endif // __cpp_concepts && __cpp_lib_coroutine
   //////////////////////////////////////////////////////////////////////////////
 
+  // Execute a callable with scheduling attributes, see TaskAttributes. The
+  // returned future tells whether the callable actually run, see TaskResult.
+  template <typename F = SchedInterface, typename C, typename... Args>
+#if __cpp_concepts && __cpp_lib_coroutine
+    requires(::std::invocable<C &&, Args && ...> &&
+             !CoroutineInvocable<C &&, Args && ...>)
+#endif // __cpp_concepts && __cpp_lib_coroutine
+  inline Future<TaskResult<ResultType<C&&, Args&&...>>, F> execute(
+      TaskAttributes&& attributes, C&& callable, Args&&... args) noexcept;
+
 #if __cpp_concepts && __cpp_lib_coroutine
   // Await a awaitable object, just like co_await it inside a coroutine context.
   // Return a future object to wait and get that result.
@@ -134,6 +172,26 @@ class Executor : public BasicExecutor {
 #endif // __cpp_concepts && __cpp_lib_coroutine
   //////////////////////////////////////////////////////////////////////////////
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Execute callables in range [begin, end) in bulk, each of them is called
+  // without argument. Callables are moved away from the range.
+  //
+  // Same as calling execute/submit in a loop, but executor can enqueue all of
+  // them in one batch and wakeup workers in one pass, like ThreadPoolExecutor
+  // does. Useful for fan-out of many small tasks. Coroutine is not supported
+  // in bulk, use execute/submit for them instead.
+  //
+  // execute_n return futures in same order of callables. A future is invalid
+  // if that callable fail to be scheduled, just like execute.
+  template <typename F = SchedInterface, typename IT>
+  inline ::std::vector<
+      Future<ResultType<typename ::std::iterator_traits<IT>::value_type&&>, F>>
+  execute_n(IT begin, IT end) noexcept;
+  // Return 0 if all success scheduled
+  template <typename IT>
+  inline int submit_n(IT begin, IT end) noexcept;
+  //////////////////////////////////////////////////////////////////////////////
+
  private:
 #if __cpp_concepts && __cpp_lib_coroutine
   template <typename T>
@@ -147,6 +205,10 @@ class Executor : public BasicExecutor {
   inline static void apply_and_set_value(
       Promise<void, F>& promise, C&& callable,
       ::std::tuple<Args...>&& args_tuple) noexcept;
+  template <typename F, typename C, typename... Args>
+  inline static void apply_and_set_value(
+      Promise<TaskResult<void>, F>& promise, C&& callable,
+      ::std::tuple<Args...>&& args_tuple) noexcept;
 
 #if __cpp_concepts && __cpp_lib_coroutine
   template <typename P, typename A>
@@ -276,6 +338,50 @@ class ThreadPoolExecutor : public Executor {
   // thread will check other worker's local waiting task before trying wait and
   // get task from global queue.
   //
+  // use_work_stealing_deque: When enable, local waiting tasks are kept in
+  // per-worker Chase-Lev deques instead of queues. Owner worker run its local
+  // tasks in LIFO order, while stealing worker pick a random victim and take
+  // about half of its oldest tasks at once. Reduce contention on low-index
+  // workers and steal scan cost when worker number is large.
+  //
+  // enable_numa_aware: When enable, workers are spread over NUMA nodes
+  // discovered by NumaTopology and pinned to cpus of their node. Global queue
+  // is split into one queue per node, each with global_capacity. Submitter
+  // push to queue of the node it is running on, spill to other nodes only when
+  // it is full, and wakeup a worker of an idle node when backlog builds up.
+  // Worker prefer queue of its own node, only fallback to queues of other nodes
+  // when its own is empty.
+  //
+  // idle_spin_times & idle_yield_times: When any of them is positive, an idle
+  // worker keep polling for task instead of blocking on global queue at once.
+  // First spin idle_spin_times rounds with cpu pause, then idle_yield_times
+  // rounds with sched_yield, and finally park on a futex. Submitter skip the
+  // futex wake entirely when some worker is still spinning, since that worker
+  // will pick the task up soon. Trade cpu usage for latency of short tasks,
+  // where futex wake cost can dominate.
+  //
+  // enable_priority: When enable, tasks with priority other than NORMAL are
+  // kept in separate critical and background lanes, each with global_capacity,
+  // instead of local and global queue. Idle worker check lanes in strict order
+  // of priority by default. Set priority_weights to pick lanes by weighted
+  // round robin instead, so background tasks can still make progress under
+  // heavy load. Empty lane is always skipped.
+  //
+  // max_worker_number: When set larger than worker_number, the pool become
+  // elastic. Start with worker_number workers, and grow one more worker each
+  // time queued tasks, including those in stealable local queues, keep
+  // waiting without any idle worker for longer than grow_queue_delay, up to
+  // max_worker_number. Worker idle for longer than idle_keepalive retire,
+  // until back to worker_number. Elastic pool always park idle worker like
+  // idle_spin_times & idle_yield_times do, with a timeout to detect idle.
+  // Local queue of a worker is always empty when it retire, and new worker
+  // may reuse its slot and thread local storage later.
+  //
+  // enable_statistics: When enable, each task is stamped at enqueue, and
+  // worker record its queue delay and running time, together with the source
+  // it is popped from. Cost two clock reads per task and some thread local
+  // counting, see statistics() for what is collected.
+  //
   // balance_interval: When set to positive, a
   // background thread will be used to **steal** all worker's local waiting task
   // periodically.
@@ -283,6 +389,23 @@ class ThreadPoolExecutor : public Executor {
   void set_local_capacity(size_t local_capacity) noexcept;
   void set_global_capacity(size_t global_capacity) noexcept;
   void set_enable_work_stealing(bool enable_work_stealing) noexcept;
+  void set_use_work_stealing_deque(bool use_work_stealing_deque) noexcept;
+  void set_enable_numa_aware(bool enable_numa_aware) noexcept;
+  // Topology used when numa aware is enabled, default to
+  // NumaTopology::instance()
+  void set_numa_topology(const NumaTopology& numa_topology) noexcept;
+  void set_idle_spin_times(size_t idle_spin_times) noexcept;
+  void set_idle_yield_times(size_t idle_yield_times) noexcept;
+  void set_enable_priority(bool enable_priority) noexcept;
+  void set_priority_weights(size_t critical_weight, size_t normal_weight,
+                            size_t background_weight) noexcept;
+  void set_max_worker_number(size_t max_worker_number) noexcept;
+  template <typename R, typename P>
+  void set_grow_queue_delay(
+      ::std::chrono::duration<R, P> grow_queue_delay) noexcept;
+  template <typename R, typename P>
+  void set_idle_keepalive(::std::chrono::duration<R, P> idle_keepalive) noexcept;
+  void set_enable_statistics(bool enable_statistics) noexcept;
   template <typename R, typename P>
   void set_balance_interval(
       ::std::chrono::duration<R, P> balance_interval) noexcept;
@@ -301,41 +424,162 @@ class ThreadPoolExecutor : public Executor {
 
   void stop() noexcept;
 
+  // Number of workers currently running, vary between worker_number and
+  // max_worker_number when elastic
+  size_t alive_worker_number() const noexcept;
+
+  // Snapshot of statistics collected when enable_statistics. Counters are
+  // accumulated since start, while histograms only cover records since last
+  // reset_statistics. Exporter is expected to take snapshot and reset
+  // periodically, and diff counters by itself.
+  struct Statistics {
+    // Tasks popped from local queue or deque of the running worker itself
+    size_t local_pop_num {0};
+    // Tasks stolen from local queue or deque of other workers
+    size_t steal_num {0};
+    // Tasks popped from global queue, node queues or priority lanes
+    size_t global_pop_num {0};
+    // Tasks moved from local to global queue by balance thread
+    size_t balance_move_num {0};
+    // Sum and number of delay from enqueue to start running, and of running
+    // time, both in microseconds
+    ConcurrentSummer::Summary queue_delay_us {0, 0};
+    ConcurrentSummer::Summary run_time_us {0, 0};
+    // Record number in each bucket of ConcurrentSampler::bucket_index, which
+    // is a log2 histogram of queue delay and running time in microseconds
+    size_t queue_delay_histogram[31] {};
+    size_t run_time_histogram[31] {};
+  };
+  Statistics statistics() const noexcept;
+  void reset_statistics() noexcept;
+
   int ABSL_DEPRECATED("Use start instead")
       initialize(size_t worker_num, size_t queue_capacity) noexcept;
 
  protected:
   virtual int invoke(MoveOnlyFunction<void(void)>&& function) noexcept override;
+  virtual int invoke_n(MoveOnlyFunction<void(void)>* functions,
+                       size_t num) noexcept override;
+  virtual int invoke_with_priority(MoveOnlyFunction<void(void)>&& function,
+                                   TaskPriority priority) noexcept override;
 
  private:
   enum class TaskType {
     FUNCTION,
     WAKEUP,
     STOP,
+    RETIRE,
   };
 
   struct Task {
     TaskType type;
     MoveOnlyFunction<void(void)> function;
+    TaskPriority priority {TaskPriority::NORMAL};
+    // Only stamped when statistics is enabled
+    ::std::chrono::steady_clock::time_point enqueue_time {};
+  };
+
+  // Smooth weighted round robin state of a worker, only accessed by owner
+  struct alignas(BABYLON_CACHELINE_SIZE) PriorityCredits {
+    ssize_t credits[3] {0, 0, 0};
   };
 
   using TaskQueue = ConcurrentBoundedQueue<Task>;
+  using TaskDeque = ConcurrentWorkStealingDeque<Task>;
 
-  void keep_execute() noexcept;
+  void keep_execute(size_t index) noexcept;
   void keep_balance() noexcept;
+  void keep_elastic() noexcept;
   int enqueue_task(Task&& task) noexcept;
 
+  void pop_task(size_t index, Task& task) noexcept;
+  bool try_pop_task(size_t index, Task& task) noexcept;
+  bool try_pop_priority_task(size_t index, TaskPriority priority,
+                             Task& task) noexcept;
+  void push_priority_task(Task&& task) noexcept;
+
+  bool pop_local_task(size_t index, Task& task) noexcept;
+  bool steal_task_from_queues(Task& task) noexcept;
+  bool steal_task_from_deques(size_t index, Task& task) noexcept;
+
+  size_t submit_node() const noexcept;
+  void push_global_task(Task&& task) noexcept;
+  void push_global_tasks(MoveOnlyFunction<void(void)>* functions,
+                         size_t num) noexcept;
+  void push_node_task(Task&& task) noexcept;
+  void wakeup_idle_node(size_t busy_node) noexcept;
+  void pop_global_task(size_t index, Task& task) noexcept;
+  bool try_pop_global_task(size_t index, Task& task) noexcept;
+
+  inline bool use_elastic() const noexcept;
+  size_t task_backlog() const noexcept;
+  bool grow_worker() noexcept;
+  bool try_retire_worker() noexcept;
+
+  inline bool use_idle_park() const noexcept;
+  void spin_then_park(size_t index, Task& task) noexcept;
+  void notify_idle_worker(size_t task_num = 1) noexcept;
+
+  inline void stamp_enqueue_time(Task& task) const noexcept;
+  void run_with_statistics(Task& task) noexcept;
+
   size_t _worker_number {1};
   size_t _local_capacity {0};
   size_t _global_capacity {1};
   bool _enable_work_stealing {false};
+  bool _use_work_stealing_deque {false};
+  bool _enable_numa_aware {false};
+  size_t _idle_spin_times {0};
+  size_t _idle_yield_times {0};
+  bool _enable_priority {false};
+  size_t _priority_weights[3] {0, 0, 0};
+  size_t _max_worker_number {0};
+  ::std::chrono::microseconds _grow_queue_delay {1000};
+  ::std::chrono::microseconds _idle_keepalive {1000000};
+  bool _enable_statistics {false};
   ::std::chrono::microseconds _balance_interval {-1};
 
   ::std::atomic<bool> _running {false};
   ::babylon::EnumerableThreadLocal<TaskQueue> _local_task_queues;
+  ::babylon::EnumerableThreadLocal<TaskDeque> _local_task_deques;
+  // Registered by each worker thread at start, so thief can pick a victim by
+  // random index instead of enumerating all thread local deques
+  ::std::unique_ptr<::std::atomic<TaskDeque*>[]> _worker_task_deques;
   TaskQueue _global_task_queue;
+  // Used instead of _global_task_queue when numa aware is enabled, one queue
+  // per node which has at least one worker
+  NumaTopology _numa_topology {NumaTopology::instance()};
+  ::std::vector<TaskQueue> _node_task_queues;
+  // Lanes used when priority is enabled, NORMAL tasks still go through queues
+  // above
+  TaskQueue _critical_task_queue;
+  TaskQueue _background_task_queue;
+  ::std::unique_ptr<PriorityCredits[]> _worker_priority_credits;
+  // Workers blocking on each queue above, used to skip wakeup for lanes when
+  // idle park is disabled
+  ::std::unique_ptr<::std::atomic<size_t>[]> _blocking_worker_numbers;
+  // Used when idle park is enabled. Parked worker wait on _park_futex, whose
+  // value is bumped by each notify
+  alignas(BABYLON_CACHELINE_SIZE)
+      ::std::atomic<size_t> _spinning_worker_number {0};
+  ::std::atomic<size_t> _parked_worker_number {0};
+  Futex<SchedInterface> _park_futex {0};
+  // One slot for each possible worker, slot of a not running worker is empty
+  // or hold a retired thread not joined yet
   ::std::vector<::std::thread> _threads;
+  ::std::unique_ptr<::std::atomic<bool>[]> _worker_alive;
+  ::std::atomic<size_t> _alive_worker_number {0};
   ::std::thread _balance_thread;
+  ::std::thread _elastic_thread;
+  // Used when statistics is enabled
+  ConcurrentAdder _local_pop_counter;
+  ConcurrentAdder _steal_counter;
+  ConcurrentAdder _global_pop_counter;
+  ConcurrentAdder _balance_move_counter;
+  ConcurrentSummer _queue_delay_summer;
+  ConcurrentSummer _run_time_summer;
+  ConcurrentSampler _queue_delay_sampler;
+  ConcurrentSampler _run_time_sampler;
 };
 
 BABYLON_NAMESPACE_END
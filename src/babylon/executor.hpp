@@ -38,6 +38,47 @@ inline Future<Executor::ResultType<C&&, Args&&...>, F> Executor::execute(
   return future;
 }
 
+template <typename F, typename C, typename... Args>
+#if __cpp_concepts && __cpp_lib_coroutine
+  requires(::std::invocable<C &&, Args && ...> &&
+           !CoroutineInvocable<C &&, Args && ...>)
+#endif // __cpp_concepts && __cpp_lib_coroutine
+inline Future<TaskResult<Executor::ResultType<C&&, Args&&...>>, F>
+Executor::execute(TaskAttributes&& attributes, C&& callable,
+                  Args&&... args) noexcept {
+  using R = TaskResult<ResultType<C&&, Args&&...>>;
+  struct S {
+    Promise<R, F> promise;
+    ::std::chrono::steady_clock::time_point deadline;
+    MoveOnlyFunction<void(void)> on_expire;
+    typename ::std::decay<C>::type callable;
+    ::std::tuple<typename ::std::decay<Args>::type...> args_tuple;
+    void operator()() noexcept {
+      if (deadline != ::std::chrono::steady_clock::time_point::max() &&
+          ABSL_PREDICT_FALSE(::std::chrono::steady_clock::now() >= deadline)) {
+        if (on_expire) {
+          on_expire();
+        }
+        promise.set_value(::std::nullopt);
+        return;
+      }
+      apply_and_set_value(promise, ::std::move(callable),
+                          ::std::move(args_tuple));
+    }
+  } s {.promise {},
+       .deadline = attributes.deadline,
+       .on_expire = ::std::move(attributes.on_expire),
+       .callable = ::std::forward<C>(callable),
+       .args_tuple {::std::forward<Args>(args)...}};
+  auto future = s.promise.get_future();
+  MoveOnlyFunction<void(void)> function {::std::move(s)};
+  auto ret = invoke_with_priority(::std::move(function), attributes.priority);
+  if (ABSL_PREDICT_FALSE(ret != 0)) {
+    future = Future<R, F>();
+  }
+  return future;
+}
+
 #if __cpp_concepts && __cpp_lib_coroutine
 template <typename F, typename C, typename... Args>
   requires CoroutineInvocable<C&&, Args&&...> && Executor::IsPlainFunction<C>
@@ -156,6 +197,47 @@ inline int Executor::submit(CoroutineTask<T>&& task) noexcept {
 }
 #endif // __cpp_concepts && __cpp_lib_coroutine
 
+template <typename F, typename IT>
+inline ::std::vector<Future<
+    Executor::ResultType<typename ::std::iterator_traits<IT>::value_type&&>,
+    F>>
+Executor::execute_n(IT begin, IT end) noexcept {
+  using C = typename ::std::iterator_traits<IT>::value_type;
+  using R = ResultType<C&&>;
+  struct S {
+    Promise<R, F> promise;
+    C callable;
+    void operator()() noexcept {
+      apply_and_set_value(promise, ::std::move(callable), ::std::tuple<> {});
+    }
+  };
+  ::std::vector<Future<R, F>> futures;
+  ::std::vector<MoveOnlyFunction<void(void)>> functions;
+  for (; begin != end; ++begin) {
+    S s {.promise {}, .callable = ::std::move(*begin)};
+    futures.emplace_back(s.promise.get_future());
+    functions.emplace_back(::std::move(s));
+  }
+  auto ret = invoke_n(functions.data(), functions.size());
+  if (ABSL_PREDICT_FALSE(ret != 0)) {
+    for (size_t i = 0; i < functions.size(); ++i) {
+      if (functions[i]) {
+        futures[i] = Future<R, F>();
+      }
+    }
+  }
+  return futures;
+}
+
+template <typename IT>
+inline int Executor::submit_n(IT begin, IT end) noexcept {
+  ::std::vector<MoveOnlyFunction<void(void)>> functions;
+  for (; begin != end; ++begin) {
+    functions.emplace_back(::std::move(*begin));
+  }
+  return invoke_n(functions.data(), functions.size());
+}
+
 template <typename P, typename C, typename... Args>
 inline void Executor::apply_and_set_value(
     P& promise, C&& callable, ::std::tuple<Args...>&& args_tuple) noexcept {
@@ -171,6 +253,14 @@ inline void Executor::apply_and_set_value(
   promise.set_value();
 }
 
+template <typename F, typename C, typename... Args>
+inline void Executor::apply_and_set_value(
+    Promise<TaskResult<void>, F>& promise, C&& callable,
+    ::std::tuple<Args...>&& args_tuple) noexcept {
+  ::std::apply(::std::forward<C>(callable), ::std::move(args_tuple));
+  promise.set_value(::std::monostate {});
+}
+
 #if __cpp_concepts && __cpp_lib_coroutine
 template <typename P, typename A>
 CoroutineTask<> Executor::await_and_set_value(P promise, A awaitable) noexcept {
@@ -209,6 +299,32 @@ void ThreadPoolExecutor::set_balance_interval(
     ::std::chrono::duration<R, P> balance_interval) noexcept {
   _balance_interval = balance_interval;
 }
+
+template <typename R, typename P>
+void ThreadPoolExecutor::set_grow_queue_delay(
+    ::std::chrono::duration<R, P> grow_queue_delay) noexcept {
+  _grow_queue_delay = grow_queue_delay;
+}
+
+template <typename R, typename P>
+void ThreadPoolExecutor::set_idle_keepalive(
+    ::std::chrono::duration<R, P> idle_keepalive) noexcept {
+  _idle_keepalive = idle_keepalive;
+}
+
+inline bool ThreadPoolExecutor::use_elastic() const noexcept {
+  return _max_worker_number > _worker_number;
+}
+
+inline bool ThreadPoolExecutor::use_idle_park() const noexcept {
+  return _idle_spin_times > 0 || _idle_yield_times > 0 || use_elastic();
+}
+
+inline void ThreadPoolExecutor::stamp_enqueue_time(Task& task) const noexcept {
+  if (_enable_statistics) {
+    task.enqueue_time = ::std::chrono::steady_clock::now();
+  }
+}
 // ThreadPoolExecutor end
 ////////////////////////////////////////////////////////////////////////////////
 
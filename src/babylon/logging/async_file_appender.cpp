@@ -1,15 +1,261 @@
 #include "babylon/logging/async_file_appender.h"
 
+#include "babylon/logging/binary_log.h" // BinaryLog
+
 #include "babylon/protect.h"
 
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <algorithm> // std::any_of
+
+#if BABYLON_USE_IO_URING
+#include <liburing.h>
+#endif // BABYLON_USE_IO_URING
+
 BABYLON_NAMESPACE_BEGIN
 
+////////////////////////////////////////////////////////////////////////////////
+// AsyncFileAppender::IoUring begin
+#if BABYLON_USE_IO_URING
+// 将每个Destination一轮积累的iov作为一个批次异步提交
+// 批次内部按IOV_MAX切分，每个批次同时只有一个writev请求在途
+// 上一个请求完成后再提交剩余部分，保证顺序的同时可以续写部分写入
+// 因此在途请求数不超过批次数，即depth，不会超出完成队列的容量
+// 批次全部完成后将页面归还给PageAllocator
+class AsyncFileAppender::IoUring {
+ public:
+  ~IoUring() noexcept;
+
+  int initialize(size_t depth) noexcept;
+
+  // 提交dest积累的iov，dest已有批次在途时推迟到下一轮
+  // 但在途期间积压过多时，会等待在途批次完成后再提交
+  void submit(AsyncFileAppender& appender, Writer& writer, Destination& dest,
+              int fd) noexcept;
+  // 收割已经完成的请求，wait为true时至少等待一个请求完成
+  // 等待出错时销毁ring并放弃在途批次，之后的提交回退到writev
+  void reap(AsyncFileAppender& appender, Writer& writer, bool wait) noexcept;
+  // 是否已经没有在途批次
+  inline bool idle() const noexcept;
+
+ private:
+  // 积压超过这个规模时不再推迟
+  constexpr static size_t MAX_DEFERRED_IOV = IOV_MAX * 8;
+
+  // 批次在途期间destinations可能扩容，因此只记录序号
+  struct Batch {
+    size_t dest_index {0};
+    int fd {-1};
+    // iov保持原样用于归还页面，pending_iov记录写入进度
+    ::std::vector<struct ::iovec> iov;
+    ::std::vector<struct ::iovec> pending_iov;
+    size_t next {0};
+  };
+
+  // 将批次剩余部分的下一段放入提交队列
+  void prepare(size_t index) noexcept;
+  // 按照写入的字节数推进批次，返回是否已经全部写出
+  bool advance(Batch& batch, size_t bytes) noexcept;
+  void finish(AsyncFileAppender& appender, Writer& writer,
+              size_t index) noexcept;
+  void abort(AsyncFileAppender& appender, Writer& writer) noexcept;
+
+  struct ::io_uring _ring;
+  bool _initialized {false};
+  ::std::vector<Batch> _batches;
+  ::std::vector<size_t> _free_batches;
+};
+
+AsyncFileAppender::IoUring::~IoUring() noexcept {
+  if (_initialized) {
+    ::io_uring_queue_exit(&_ring);
+  }
+}
+
+int AsyncFileAppender::IoUring::initialize(size_t depth) noexcept {
+  depth = ::std::max<size_t>(depth, 8);
+  struct ::io_uring_params params;
+  __builtin_memset(&params, 0, sizeof(params));
+  auto ret = ::io_uring_queue_init_params(depth, &_ring, &params);
+  if (ret < 0) {
+    errno = -ret;
+    return -1;
+  }
+  // 依赖偏移-1表示使用并推进文件当前位置，老版本内核不支持时回退到writev
+  if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+    ::io_uring_queue_exit(&_ring);
+    errno = ENOTSUP;
+    return -1;
+  }
+  _initialized = true;
+  _batches.resize(depth);
+  _free_batches.reserve(depth);
+  for (size_t i = depth; i > 0; --i) {
+    _free_batches.emplace_back(i - 1);
+  }
+  return 0;
+}
+
+void AsyncFileAppender::IoUring::submit(AsyncFileAppender& appender,
+                                        Writer& writer, Destination& dest,
+                                        int fd) noexcept {
+  if (dest.writing) {
+    if (dest.iov.size() < MAX_DEFERRED_IOV) {
+      return;
+    }
+    while (dest.writing) {
+      reap(appender, writer, true);
+    }
+  }
+  while (_free_batches.empty()) {
+    reap(appender, writer, true);
+  }
+  if (ABSL_PREDICT_FALSE(!_initialized)) {
+    appender.write_use_plain_writev(dest, fd);
+    return;
+  }
+
+  auto index = _free_batches.back();
+  _free_batches.pop_back();
+  auto& batch = _batches[index];
+  batch.dest_index = &dest - writer.destinations.data();
+  batch.fd = fd;
+  batch.iov.swap(dest.iov);
+  batch.pending_iov.assign(batch.iov.begin(), batch.iov.end());
+  batch.next = 0;
+  dest.writing = true;
+
+  prepare(index);
+  ::io_uring_submit(&_ring);
+}
+
+void AsyncFileAppender::IoUring::reap(AsyncFileAppender& appender,
+                                      Writer& writer, bool wait) noexcept {
+  if (ABSL_PREDICT_FALSE(!_initialized)) {
+    return;
+  }
+  if (wait) {
+    int ret;
+    do {
+      // 同时提交之前可能没能成功提交的请求，避免空等
+      ret = ::io_uring_submit_and_wait(&_ring, 1);
+    } while (ret == -EINTR || ret == -EAGAIN);
+    if (ret < 0) {
+      abort(appender, writer);
+      return;
+    }
+  }
+
+  unsigned head;
+  unsigned count = 0;
+  bool resubmit = false;
+  struct ::io_uring_cqe* cqe;
+  io_uring_for_each_cqe(&_ring, head, cqe) {
+    ++count;
+    auto index = reinterpret_cast<size_t>(::io_uring_cqe_get_data(cqe));
+    auto& batch = _batches[index];
+    auto res = cqe->res;
+    if (res == -EINTR || res == -EAGAIN) {
+      // 可恢复的错误，原样重新提交
+      prepare(index);
+      resubmit = true;
+    } else if (res <= 0 || advance(batch, res)) {
+      // 和writev一样，其他错误不做重试，放弃批次剩余的部分
+      finish(appender, writer, index);
+    } else {
+      // 部分写入，续写剩余的部分
+      prepare(index);
+      resubmit = true;
+    }
+  }
+  ::io_uring_cq_advance(&_ring, count);
+  if (resubmit) {
+    ::io_uring_submit(&_ring);
+  }
+}
+
+inline bool AsyncFileAppender::IoUring::idle() const noexcept {
+  return _free_batches.size() == _batches.size();
+}
+
+void AsyncFileAppender::IoUring::prepare(size_t index) noexcept {
+  auto& batch = _batches[index];
+  auto size = ::std::min<size_t>(IOV_MAX,
+                                 batch.pending_iov.size() - batch.next);
+  // 每个批次最多占用一个提交队列位置，队列深度等于批次数，一定可以获取到
+  auto sqe = ::io_uring_get_sqe(&_ring);
+  // 偏移-1表示使用并推进文件当前位置，和writev行为一致
+  ::io_uring_prep_writev(sqe, batch.fd, &batch.pending_iov[batch.next], size,
+                         static_cast<__u64>(-1));
+  ::io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(index));
+}
+
+bool AsyncFileAppender::IoUring::advance(Batch& batch, size_t bytes) noexcept {
+  auto& iov = batch.pending_iov;
+  while (batch.next < iov.size() && bytes >= iov[batch.next].iov_len) {
+    bytes -= iov[batch.next++].iov_len;
+  }
+  if (batch.next < iov.size()) {
+    auto& one_iov = iov[batch.next];
+    one_iov.iov_base = static_cast<char*>(one_iov.iov_base) + bytes;
+    one_iov.iov_len -= bytes;
+  }
+  return batch.next == iov.size();
+}
+
+void AsyncFileAppender::IoUring::finish(AsyncFileAppender& appender,
+                                        Writer& writer, size_t index) noexcept {
+  auto& batch = _batches[index];
+  writer.destinations[batch.dest_index].writing = false;
+  appender.release_pages(batch.iov);
+  batch.pending_iov.clear();
+  _free_batches.emplace_back(index);
+}
+
+void AsyncFileAppender::IoUring::abort(AsyncFileAppender& appender,
+                                       Writer& writer) noexcept {
+  // 销毁ring时内核会取消在途请求，之后在途批次不会再有完成通知
+  ::io_uring_queue_exit(&_ring);
+  _initialized = false;
+  ::std::vector<bool> in_flight(_batches.size(), true);
+  for (auto index : _free_batches) {
+    in_flight[index] = false;
+  }
+  for (size_t i = 0; i < _batches.size(); ++i) {
+    if (in_flight[i]) {
+      finish(appender, writer, i);
+    }
+  }
+}
+#else  // !BABYLON_USE_IO_URING
+// 未检测到liburing时的占位实现，初始化总是失败，回退到writev
+class AsyncFileAppender::IoUring {
+ public:
+  inline int initialize(size_t) noexcept {
+    errno = ENOSYS;
+    return -1;
+  }
+  inline void submit(AsyncFileAppender& appender, Writer&, Destination& dest,
+                     int fd) noexcept {
+    appender.write_use_plain_writev(dest, fd);
+  }
+  inline void reap(AsyncFileAppender&, Writer&, bool) noexcept {}
+  inline bool idle() const noexcept {
+    return true;
+  }
+};
+#endif // !BABYLON_USE_IO_URING
+// AsyncFileAppender::IoUring end
+////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // AsyncFileAppender begin
+AsyncFileAppender::AsyncFileAppender() noexcept {
+  set_writer_num(1);
+}
+
 AsyncFileAppender::~AsyncFileAppender() noexcept {
   close();
 }
@@ -20,19 +266,90 @@ void AsyncFileAppender::set_page_allocator(
 }
 
 void AsyncFileAppender::set_queue_capacity(size_t queue_capacity) noexcept {
-  _queue.reserve_and_clear(queue_capacity);
+  _queue_capacity = queue_capacity;
+  for (auto& writer : _writers) {
+    writer->queue.reserve_and_clear(queue_capacity);
+  }
+}
+
+void AsyncFileAppender::set_writer_num(size_t num) noexcept {
+  _writers.resize(::std::max<size_t>(1, num));
+  for (auto& writer : _writers) {
+    if (!writer) {
+      writer.reset(new Writer);
+      writer->queue.reserve_and_clear(_queue_capacity);
+    }
+  }
+}
+
+void AsyncFileAppender::set_use_io_uring(bool use_io_uring) noexcept {
+  _use_io_uring = use_io_uring;
+}
+
+void AsyncFileAppender::set_io_uring_depth(size_t depth) noexcept {
+  _io_uring_depth = depth;
+}
+
+void AsyncFileAppender::set_use_zstd(bool use_zstd) noexcept {
+  _use_zstd = use_zstd;
+}
+
+void AsyncFileAppender::set_zstd_level(int level) noexcept {
+  _zstd_level = level;
+}
+
+void AsyncFileAppender::set_format_binary_log(bool format_binary_log) noexcept {
+  _format_binary_log = format_binary_log;
 }
 
 int AsyncFileAppender::initialize() noexcept {
-  _write_thread = ::std::thread(&AsyncFileAppender::keep_writing, this);
+  // 攒批不能占满队列，否则生产者会阻塞在入队上直到最长延迟
+  _flush_batch_size = ::std::max<size_t>(
+      1, ::std::min(_flush_batch_size, _writers[0]->queue.capacity() / 2));
+  for (auto& writer : _writers) {
+    if (_use_io_uring) {
+      writer->io_uring.reset(new IoUring);
+      if (0 != writer->io_uring->initialize(_io_uring_depth)) {
+        writer->io_uring.reset();
+      }
+    }
+    if (_use_zstd) {
+      writer->compressor.reset(new LogCompressor);
+      if (0 != writer->compressor->initialize(_zstd_level)) {
+        writer->compressor.reset();
+      }
+    }
+    writer->thread = ::std::thread(&AsyncFileAppender::keep_writing, this,
+                                   ::std::ref(*writer));
+  }
   return 0;
 }
 
+void AsyncFileAppender::set_max_flush_delay(
+    ::std::chrono::microseconds delay) noexcept {
+  _max_flush_delay = delay;
+}
+
+void AsyncFileAppender::set_flush_batch_size(size_t size) noexcept {
+  _flush_batch_size = size;
+}
+
+void AsyncFileAppender::set_flush_severity(LogSeverity severity) noexcept {
+  _flush_severity = severity;
+}
+
 void AsyncFileAppender::write(LogEntry& entry, FileObject* file) noexcept {
-  _queue.push<true, false, false>([&](Item& target) {
-    target.entry = entry;
-    target.file = file;
-  });
+  write(entry, file, LogSeverity::DEBUG);
+}
+
+void AsyncFileAppender::write(LogEntry& entry, FileObject* file,
+                              LogSeverity severity) noexcept {
+  push(entry, file, severity, false);
+}
+
+void AsyncFileAppender::write_binary(LogEntry& entry, FileObject* file,
+                                     LogSeverity severity) noexcept {
+  push(entry, file, severity, true);
 }
 
 void AsyncFileAppender::discard(LogEntry& entry) noexcept {
@@ -55,97 +372,335 @@ void AsyncFileAppender::discard(LogEntry& entry) noexcept {
 }
 
 int AsyncFileAppender::close() noexcept {
-  if (_write_thread.joinable()) {
-    _queue.push([](Item& target) {
-      target.entry.size = 0;
-      target.file = nullptr;
-    });
-    _write_thread.join();
+  // 先通知全部写线程退出，再逐个等待，使各线程的收尾工作并行进行
+  for (auto& writer : _writers) {
+    if (writer->thread.joinable()) {
+      writer->queue.push<true, false, false>([](Item& target) {
+        target.entry.size = 0;
+        target.file = nullptr;
+        target.binary = false;
+      });
+      notify_writer(*writer, true);
+    }
+  }
+  for (auto& writer : _writers) {
+    if (writer->thread.joinable()) {
+      writer->thread.join();
+    }
   }
   return 0;
 }
 
-void AsyncFileAppender::keep_writing() noexcept {
+size_t AsyncFileAppender::file_index(FileObject* file) noexcept {
+  auto index = file->index();
+  if (ABSL_PREDICT_TRUE(index != SIZE_MAX)) {
+    return index;
+  }
+
+  // 仅在文件首次写入时发生，加锁分配全局序号
+  ::std::lock_guard<::std::mutex> lock {_file_index_mutex};
+  index = file->index();
+  if (index == SIZE_MAX) {
+    index = _file_num++;
+    file->set_index(index);
+  }
+  return index;
+}
+
+void AsyncFileAppender::push(LogEntry& entry, FileObject* file,
+                             LogSeverity severity, bool binary) noexcept {
+  auto& writer = *_writers[file_index(file) % _writers.size()];
+  writer.queue.push<true, false, false>([&](Item& target) {
+    target.entry = entry;
+    target.file = file;
+    target.binary = binary;
+  });
+  notify_writer(writer, severity >= _flush_severity);
+}
+
+void AsyncFileAppender::keep_writing(Writer& writer) noexcept {
   auto stop = false;
   // 由于writev限制了单次最大长度到UIO_MAXIOV，更大的batch并无意义
   // 另一方面ConcurrentBoundedQueue也限制了最大batch，合并取最严的限制
-  auto batch = ::std::min<size_t>(UIO_MAXIOV, _queue.capacity());
+  auto batch = ::std::min<size_t>(UIO_MAXIOV, writer.queue.capacity());
+  auto last_write_time = ::std::chrono::steady_clock::now();
+
+  while (true) {
+    // 队列为空时等待新日志入队，或者到达下一次检测时间
+    // 有新日志入队后开始攒批直到最长延迟，期间需要立即写出时提前唤醒
+    auto deadline = last_write_time + IDLE_CHECK_INTERVAL;
+    // 因为io_uring批次在途而推迟的部分，同样最多延迟max_flush_delay
+    if (writer.io_uring &&
+        ::std::any_of(writer.destinations.begin(), writer.destinations.end(),
+                      [](const Destination& dest) {
+                        return !dest.iov.empty();
+                      })) {
+      deadline = last_write_time + _max_flush_delay;
+    }
+    if (wait_writer_futex(writer, WAIT_ANY, deadline)) {
+      wait_writer_futex(writer, WAIT_FLUSH,
+                        ::std::chrono::steady_clock::now() + _max_flush_delay);
+    }
+    writer.futex.value().store(RUNNING, ::std::memory_order_relaxed);
 
-  do {
     // 无论本轮是否有日志要写出，都检测一次文件描述符
     // 便于长期无日志输出时依然保持日志滚动
-    auto poped = _queue.try_pop_n<false, false>(
-        [&](Queue::Iterator iter, Queue::Iterator end) {
-          while (iter < end) {
-            auto& item = *iter++;
-            if (ABSL_PREDICT_FALSE(item.entry.size == 0)) {
-              stop = true;
-              break;
+    size_t poped = 0;
+    do {
+      poped = writer.queue.try_pop_n<false, false>(
+          [&](Queue::Iterator iter, Queue::Iterator end) {
+            while (iter < end) {
+              auto& item = *iter++;
+              if (ABSL_PREDICT_FALSE(item.entry.size == 0)) {
+                stop = true;
+                break;
+              }
+              auto& dest = destination(writer, item.file);
+              if (ABSL_PREDICT_TRUE(!item.binary && _format_binary_log)) {
+                item.entry.append_to_iovec(_page_allocator->page_size(),
+                                           dest.iov);
+              } else {
+                append_converted(writer, dest, item);
+              }
             }
-            auto& dest = destination(item.file);
-            item.entry.append_to_iovec(_page_allocator->page_size(), dest.iov);
-          }
-        },
-        batch);
-
-    for (auto& dest : _destinations) {
-      auto result = dest.file->check_and_get_file_descriptor();
-      auto fd = ::std::get<0>(result);
-      auto old_fd = ::std::get<1>(result);
-      if (old_fd >= 0) {
-        ::close(old_fd);
+          },
+          batch);
+      write_destinations(writer);
+      // 获取到完整批量说明队列有积压，继续拉取
+    } while (poped >= batch && !stop);
+    last_write_time = ::std::chrono::steady_clock::now();
+    if (stop) {
+      break;
+    }
+  }
+
+  // 等待在途批次全部完成，期间因为在途而推迟的部分也会继续提交
+  if (writer.io_uring) {
+    while (!writer.io_uring->idle()) {
+      writer.io_uring->reap(*this, writer, true);
+      write_destinations(writer);
+    }
+  }
+}
+
+void AsyncFileAppender::notify_writer(Writer& writer, bool flush) noexcept {
+  // 和写线程设置等待状态后检查队列的动作配对，避免丢失唤醒
+  ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+  auto& value = writer.futex.value();
+  auto current = value.load(::std::memory_order_relaxed);
+  if (ABSL_PREDICT_FALSE(flush || writer.queue.size() >= _flush_batch_size)) {
+    if (current != FLUSH) {
+      current = value.exchange(FLUSH, ::std::memory_order_relaxed);
+      if (current == WAIT_ANY || current == WAIT_FLUSH) {
+        writer.futex.wake_one();
+      }
+    }
+  } else if (current == WAIT_ANY) {
+    if (value.compare_exchange_strong(current, RUNNING,
+                                      ::std::memory_order_relaxed)) {
+      writer.futex.wake_one();
+    }
+  }
+}
+
+bool AsyncFileAppender::wait_writer_futex(
+    Writer& writer, uint32_t state,
+    ::std::chrono::steady_clock::time_point deadline) noexcept {
+  auto& value = writer.futex.value();
+  while (true) {
+    auto current = value.load(::std::memory_order_relaxed);
+    if (current == FLUSH) {
+      return false;
+    }
+    if (current != state &&
+        !value.compare_exchange_weak(current, state,
+                                     ::std::memory_order_relaxed)) {
+      continue;
+    }
+    // 和生产者入队后检查状态的动作配对，避免丢失唤醒
+    ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+    auto size = writer.queue.size();
+    if (state == WAIT_ANY ? size > 0 : size >= _flush_batch_size) {
+      return true;
+    }
+    auto timeout_ns = ::std::chrono::nanoseconds {
+        deadline - ::std::chrono::steady_clock::now()}.count();
+    if (timeout_ns <= 0) {
+      return false;
+    }
+    struct ::timespec timeout;
+    timeout.tv_sec = timeout_ns / 1000000000L;
+    timeout.tv_nsec = timeout_ns % 1000000000L;
+    writer.futex.wait(state, &timeout);
+    // 被生产者唤醒时状态会先被修改，超时或者意外唤醒重新检测
+    if (value.load(::std::memory_order_relaxed) != state) {
+      return value.load(::std::memory_order_relaxed) != FLUSH;
+    }
+  }
+}
+
+void AsyncFileAppender::write_destinations(Writer& writer) noexcept {
+  if (writer.io_uring) {
+    writer.io_uring->reap(*this, writer, false);
+  }
+  for (auto& dest : writer.destinations) {
+    // 序号全局分配，由其他写线程负责的位置保持为空
+    if (dest.file == nullptr) {
+      continue;
+    }
+    auto result = dest.file->check_and_get_file_descriptor();
+    auto fd = ::std::get<0>(result);
+    auto old_fd = ::std::get<1>(result);
+    if (old_fd >= 0) {
+      // 关闭前需要等待写入旧文件的在途批次完成
+      while (dest.writing) {
+        writer.io_uring->reap(*this, writer, true);
       }
-      if (!dest.iov.empty()) {
+      ::close(old_fd);
+      prepend_definitions(writer, dest);
+    }
+    if (writer.compressor && dest.compressed_iov < dest.iov.size() &&
+        0 != writer.compressor->compress(*_page_allocator, dest.iov,
+                                         dest.compressed_iov)) {
+      writer.compress_failure_num.fetch_add(1, ::std::memory_order_relaxed);
+    }
+    if (!dest.iov.empty()) {
+      if (writer.io_uring) {
+        writer.io_uring->submit(*this, writer, dest, fd);
+      } else {
         write_use_plain_writev(dest, fd);
       }
+      // 提交后依然留在iov中的部分，均为已经压缩完成的推迟部分
+      dest.compressed_iov = dest.iov.size();
     }
+  }
+}
 
-    // 当一轮日志量过低时，拉长下一轮写入的周期
-    // 尝试进行有效的批量写入
-    if (poped < 100) {
-      _backoff_us = ::std::min<size_t>(_backoff_us + 10, 100000);
-      ::usleep(_backoff_us);
-    } else if (poped >= batch) {
-      // 获取到完整批量说明队列有积压
-      // 缩短检测周期
-      _backoff_us >>= 1;
+AsyncFileAppender::Destination& AsyncFileAppender::destination(
+    Writer& writer, FileObject* file) noexcept {
+  // 文件按照序号取模分配到写线程，线程内按照序号除以线程数定位
+  auto index = file->index() / _writers.size();
+  auto& destinations = writer.destinations;
+  if (ABSL_PREDICT_FALSE(index >= destinations.size())) {
+    destinations.resize(index + 1);
+  }
+  auto& dest = destinations[index];
+  dest.file = file;
+  return dest;
+}
+
+void AsyncFileAppender::append_converted(Writer& writer, Destination& dest,
+                                         Item& item) noexcept {
+  auto& input = writer.input;
+  auto& output = writer.output;
+  item.entry.append_to_iovec(_page_allocator->page_size(), writer.scratch);
+  input.clear();
+  for (auto& one_iov : writer.scratch) {
+    input.append(static_cast<const char*>(one_iov.iov_base), one_iov.iov_len);
+  }
+  release_pages(writer.scratch);
+
+  output.clear();
+  if (!item.binary) {
+    BinaryLog::encode_text(input, output);
+  } else {
+    // 编码和解析都在进程内完成，解析失败的记录丢弃并计数
+    BinaryLog::Kind kind;
+    StringView body;
+    uint32_t id;
+    const BinaryLogSite* site = nullptr;
+    if (!BinaryLog::parse_header(input, kind, body) ||
+        kind != BinaryLog::RECORD || !BinaryLog::parse_site_id(body, id) ||
+        (site = BinaryLogSite::find(id)) == nullptr) {
+      writer.dropped_binary_log_num.fetch_add(1, ::std::memory_order_relaxed);
+      return;
+    }
+    if (_format_binary_log) {
+      if (0 != BinaryLog::format(body, *site, output)) {
+        writer.dropped_binary_log_num.fetch_add(1,
+                                                ::std::memory_order_relaxed);
+        return;
+      }
+    } else {
+      auto& defined_sites = dest.defined_sites;
+      if (id >= defined_sites.size()) {
+        defined_sites.resize(id + 1);
+      }
+      if (!defined_sites[id]) {
+        BinaryLog::encode_definition(*site, output);
+        defined_sites[id] = true;
+      }
+      output.append(input);
     }
-  } while (!stop);
+  }
+  append_to_pages(output, dest.iov);
 }
 
-AsyncFileAppender::Destination& AsyncFileAppender::destination(
-    FileObject* file) noexcept {
-  auto index = file->index();
-  if (index != SIZE_MAX) {
-    return _destinations[index];
+void AsyncFileAppender::prepend_definitions(Writer& writer,
+                                            Destination& dest) noexcept {
+  auto& output = writer.output;
+  output.clear();
+  for (size_t id = 0; id < dest.defined_sites.size(); ++id) {
+    if (dest.defined_sites[id]) {
+      BinaryLog::encode_definition(*BinaryLogSite::find(id), output);
+    }
+  }
+  if (output.empty()) {
+    return;
   }
 
-  file->set_index(_destinations.size());
-  _destinations.emplace_back(Destination {.file = file});
-  return _destinations.back();
+  // 推迟写出的部分已经压缩，定义单独压缩为一帧
+  auto& iov = writer.scratch;
+  append_to_pages(output, iov);
+  if (writer.compressor &&
+      0 != writer.compressor->compress(*_page_allocator, iov, 0)) {
+    writer.compress_failure_num.fetch_add(1, ::std::memory_order_relaxed);
+    release_pages(iov);
+    return;
+  }
+  dest.iov.insert(dest.iov.begin(), iov.begin(), iov.end());
+  if (writer.compressor) {
+    dest.compressed_iov += iov.size();
+  }
+  iov.clear();
+}
+
+void AsyncFileAppender::append_to_pages(
+    const ::std::string& data, ::std::vector<struct ::iovec>& iov) noexcept {
+  auto page_size = _page_allocator->page_size();
+  for (size_t i = 0; i < data.size(); i += page_size) {
+    auto size = ::std::min(page_size, data.size() - i);
+    auto page = _page_allocator->allocate();
+    __builtin_memcpy(page, data.data() + i, size);
+    iov.emplace_back(::iovec {page, size});
+  }
 }
 
 void AsyncFileAppender::write_use_plain_writev(Destination& dest,
                                                int fd) noexcept {
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wpragmas"
-#pragma GCC diagnostic ignored "-Wunknown-warning-option"
-#pragma GCC diagnostic ignored "-Wexit-time-destructors"
-  static thread_local ::std::vector<void*> pages;
-#pragma GCC diagnostic pop
-
   auto& iov = dest.iov;
   for (auto iter = iov.begin(); iter < iov.end();) {
     auto piov = &*iter;
     auto size = ::std::min<ssize_t>(IOV_MAX, iov.end() - iter);
-    for (ssize_t i = 0; i < size; ++i) {
-      pages.emplace_back(piov[i].iov_base);
-    }
     auto written = ::writev(fd, piov, size);
     (void)written;
     iter += size;
   }
+  release_pages(iov);
+}
+
+void AsyncFileAppender::release_pages(
+    ::std::vector<struct ::iovec>& iov) noexcept {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wexit-time-destructors"
+  static thread_local ::std::vector<void*> pages;
+#pragma GCC diagnostic pop
 
+  for (auto& one_iov : iov) {
+    pages.emplace_back(one_iov.iov_base);
+  }
   _page_allocator->deallocate(pages.data(), pages.size());
   pages.clear();
   iov.clear();
@@ -2,12 +2,19 @@
 
 #include "babylon/concurrent/bounded_queue.h" // babylon::ConcurrentBoundedQueue
 #include "babylon/logging/file_object.h"      // babylon::PageAllocator
+#include "babylon/logging/log_compressor.h"   // babylon::LogCompressor
 #include "babylon/logging/log_entry.h"        // babylon::LogEntry
+#include "babylon/logging/log_severity.h"     // babylon::LogSeverity
 #include "babylon/reusable/page_allocator.h"  // babylon::PageAllocator
 
 #include <sys/uio.h> // ::iovec
 
+#include <atomic>    // std::atomic
+#include <chrono>    // std::chrono::microseconds
+#include <memory>    // std::unique_ptr
+#include <mutex>     // std::mutex
 #include <streambuf> // std::streambuf
+#include <string>    // std::string
 #include <thread>    // std::thread
 #include <vector>    // std::vector
 
@@ -18,6 +25,7 @@ BABYLON_NAMESPACE_BEGIN
 // 之后由独立的异步线程完成到文件的写入动作
 class AsyncFileAppender {
  public:
+  AsyncFileAppender() noexcept;
   // 析构时自动关闭
   ~AsyncFileAppender() noexcept;
 
@@ -25,18 +33,62 @@ class AsyncFileAppender {
   void set_page_allocator(PageAllocator& page_allocator) noexcept;
   void set_queue_capacity(size_t queue_capacity) noexcept;
   void set_direct_buffer_size(size_t size) noexcept;
+  // 写线程数目，默认1，需要在initialize之前设置
+  // 每个文件对象首次写入时获得一个全局序号，按序号固定分配给一个写线程
+  // 每个写线程持有独立的队列，同一文件内保持提交顺序，不同文件之间并行写出
+  // 队列容量对每个写线程分别生效
+  void set_writer_num(size_t num) noexcept;
+  // 使用io_uring异步提交写入，避免单个慢速文件阻塞其他文件的写入
+  // 需要编译时检测到liburing，否则或者运行时初始化失败，自动回退到writev
+  // depth为最多同时在途的写入批次数，默认64
+  void set_use_io_uring(bool use_io_uring) noexcept;
+  void set_io_uring_depth(size_t depth) noexcept;
+  // 将每一轮写出的批次压缩为独立的zstd帧后再写出，用写线程的CPU换取IO带宽
+  // 压缩输出同样使用page_allocator的页面，解压可以使用LogCompressor::decompress
+  // 或者zstd -d命令，详见LogCompressor
+  // 需要编译时检测到libzstd，否则或者运行时初始化失败，自动回退到不压缩
+  // 批次越大压缩率越好，可以配合调大max_flush_delay使用
+  // level为zstd压缩级别，默认3
+  void set_use_zstd(bool use_zstd) noexcept;
+  void set_zstd_level(int level) noexcept;
+  // 二进制日志（参见LogStream::write_binary）是否在写线程格式化为文本，默认true
+  // 格式化后和普通文本日志混合写出，日志头使用AsyncLogStream的默认格式
+  // 关闭后原样写出二进制记录，文本日志也包装为TEXT记录，文件整体为二进制格式
+  // 每个调用点首次写入文件，以及文件滚动后，会先写出一条DEFINITION记录
+  // 因此文件可以独立使用BinaryLogDecoder离线解码
+  void set_format_binary_log(bool format_binary_log) noexcept;
+  // 写线程阻塞等待新日志入队，并在以下任一条件满足时写出
+  // - 攒批中最早的日志等待超过max_flush_delay，默认1ms
+  // - 攒批日志数达到flush_batch_size，默认256，最大为队列容量的一半
+  // - 收到级别不低于flush_severity的日志，默认WARNING
+  void set_max_flush_delay(::std::chrono::microseconds delay) noexcept;
+  void set_flush_batch_size(size_t size) noexcept;
+  void set_flush_severity(LogSeverity severity) noexcept;
 
   // 启动异步线程，进入工作状态
   int initialize() noexcept;
 
   // 获取内存池，日志对象需要在这个内存池上分配
   inline PageAllocator& page_allocator() noexcept;
-  // 提交一个构造好的日志对象
+  // 提交一个构造好的日志对象，附带级别时用于判定是否需要立即写出
   void write(LogEntry& log, FileObject* file_object) noexcept;
+  void write(LogEntry& log, FileObject* file_object,
+             LogSeverity severity) noexcept;
+  // 提交一条由BinaryLog::encode编码的二进制日志
+  void write_binary(LogEntry& log, FileObject* file_object,
+                    LogSeverity severity) noexcept;
   // 放弃一个构造好的日志对象
   void discard(LogEntry& log) noexcept;
   // 返回当前待写入的日志对象数目
   inline size_t pending_size() const noexcept;
+  // 是否实际使用了io_uring写入，initialize之后有效
+  inline bool use_io_uring() const noexcept;
+  // 是否实际启用了压缩，initialize之后有效
+  inline bool use_zstd() const noexcept;
+  // 压缩失败的次数，压缩文件中无法混入未压缩内容，失败的批次只能丢弃
+  inline size_t compress_failure_num() const noexcept;
+  // 无法解析，找不到调用点，或者格式化失败而丢弃的二进制日志数目
+  inline size_t dropped_binary_log_num() const noexcept;
 
   // 等待已入队日志写入完成后关闭异步线程
   int close() noexcept;
@@ -45,27 +97,103 @@ class AsyncFileAppender {
   struct Item {
     LogEntry entry;
     FileObject* file;
+    bool binary;
   };
   using Queue = ConcurrentBoundedQueue<Item>;
 
   struct Destination {
     FileObject* file {nullptr};
     ::std::vector<struct ::iovec> iov {};
+    // 已经提交给io_uring但尚未完成的写入批次
+    // 为保持顺序，每个文件同时最多只有一个批次在途
+    bool writing {false};
+    // iov中已经压缩完成的前缀，因为批次在途推迟写出的部分不会重复压缩
+    size_t compressed_iov {0};
+    // 原样写出二进制日志时，已经在当前文件写出过DEFINITION的调用点
+    ::std::vector<bool> defined_sites {};
   };
+  class IoUring;
+  struct Writer;
 
   static void writev_all(int fd, const ::std::vector<struct ::iovec>& iov,
                          size_t bytes) noexcept;
 
-  void keep_writing() noexcept;
-  Destination& destination(FileObject* object) noexcept;
+  // 获取文件对象的全局序号，首次写入时分配
+  size_t file_index(FileObject* file) noexcept;
+  void push(LogEntry& entry, FileObject* file, LogSeverity severity,
+            bool binary) noexcept;
+
+  void keep_writing(Writer& writer) noexcept;
+  // 入队后按需唤醒写线程，flush为true时要求立即写出
+  void notify_writer(Writer& writer, bool flush) noexcept;
+  // 设置等待状态后等待到deadline，返回是否需要继续攒批
+  // WAIT_ANY: 有日志入队时返回true
+  // WAIT_FLUSH: 攒够批量时返回true
+  // 超时或者被要求立即写出时返回false
+  bool wait_writer_futex(
+      Writer& writer, uint32_t state,
+      ::std::chrono::steady_clock::time_point deadline) noexcept;
+  void write_destinations(Writer& writer) noexcept;
+  Destination& destination(Writer& writer, FileObject* object) noexcept;
+  // 二进制日志，以及需要包装为TEXT记录的文本日志，拷贝出来转换后再追加
+  void append_converted(Writer& writer, Destination& dest,
+                        Item& item) noexcept;
+  // 文件滚动后，在新文件开头重新写出已定义调用点的DEFINITION
+  void prepend_definitions(Writer& writer, Destination& dest) noexcept;
+  void append_to_pages(const ::std::string& data,
+                       ::std::vector<struct ::iovec>& iov) noexcept;
 
   void write_use_plain_writev(Destination& dest, int fd) noexcept;
+  void release_pages(::std::vector<struct ::iovec>& iov) noexcept;
+
+  // 长期无日志时，检测文件描述符以保持日志滚动的周期
+  constexpr static ::std::chrono::milliseconds IDLE_CHECK_INTERVAL {100};
+  // 写线程的状态，生产者据此判断是否需要唤醒
+  // RUNNING: 正在写出，无需唤醒
+  // FLUSH: 生产者要求立即写出
+  // WAIT_ANY: 队列为空，有日志入队即唤醒
+  // WAIT_FLUSH: 攒批中，只在需要立即写出时唤醒
+  constexpr static uint32_t RUNNING = 0;
+  constexpr static uint32_t FLUSH = 1;
+  constexpr static uint32_t WAIT_ANY = 2;
+  constexpr static uint32_t WAIT_FLUSH = 3;
+
+  // 一个写线程，以及其独占的队列和负责写出的文件
+  // destinations按照文件序号除以写线程数定位，不属于本线程的位置为空
+  struct Writer {
+    Queue queue {1024};
+    ::std::thread thread;
+    ::std::vector<Destination> destinations;
+    Futex<SchedInterface> futex {RUNNING};
+    ::std::unique_ptr<IoUring> io_uring;
+    ::std::unique_ptr<LogCompressor> compressor;
+    // 统计量，只由写线程自身累加
+    ::std::atomic<size_t> compress_failure_num {0};
+    ::std::atomic<size_t> dropped_binary_log_num {0};
+    // 转换日志时复用的缓冲区
+    ::std::vector<struct ::iovec> scratch;
+    ::std::string input;
+    ::std::string output;
+  };
 
-  Queue _queue {1024};
   PageAllocator* _page_allocator {&SystemPageAllocator::instance()};
-  ::std::thread _write_thread;
-  size_t _backoff_us {0};
-  ::std::vector<Destination> _destinations;
+  size_t _queue_capacity {1024};
+  ::std::vector<::std::unique_ptr<Writer>> _writers;
+
+  ::std::mutex _file_index_mutex;
+  size_t _file_num {0};
+
+  ::std::chrono::microseconds _max_flush_delay {1000};
+  size_t _flush_batch_size {256};
+  LogSeverity _flush_severity {LogSeverity::WARNING};
+
+  bool _use_io_uring {false};
+  size_t _io_uring_depth {64};
+
+  bool _use_zstd {false};
+  int _zstd_level {3};
+
+  bool _format_binary_log {true};
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,7 +203,35 @@ inline PageAllocator& AsyncFileAppender::page_allocator() noexcept {
 }
 
 inline size_t AsyncFileAppender::pending_size() const noexcept {
-  return _queue.size();
+  size_t size = 0;
+  for (auto& writer : _writers) {
+    size += writer->queue.size();
+  }
+  return size;
+}
+
+inline bool AsyncFileAppender::use_io_uring() const noexcept {
+  return static_cast<bool>(_writers[0]->io_uring);
+}
+
+inline bool AsyncFileAppender::use_zstd() const noexcept {
+  return static_cast<bool>(_writers[0]->compressor);
+}
+
+inline size_t AsyncFileAppender::compress_failure_num() const noexcept {
+  size_t num = 0;
+  for (auto& writer : _writers) {
+    num += writer->compress_failure_num.load(::std::memory_order_relaxed);
+  }
+  return num;
+}
+
+inline size_t AsyncFileAppender::dropped_binary_log_num() const noexcept {
+  size_t num = 0;
+  for (auto& writer : _writers) {
+    num += writer->dropped_binary_log_num.load(::std::memory_order_relaxed);
+  }
+  return num;
 }
 // AsyncFileAppender end
 ////////////////////////////////////////////////////////////////////////////////
@@ -53,7 +53,18 @@ void AsyncLogStream::do_begin() noexcept {
 void AsyncLogStream::do_end() noexcept {
   _buffer.sputc('\n');
   auto& log_entry = _buffer.end();
-  _appender->write(log_entry, _file_object);
+  _appender->write(log_entry, _file_object, severity());
+}
+
+::std::streambuf* AsyncLogStream::do_begin_binary() noexcept {
+  _buffer.set_page_allocator(_appender->page_allocator());
+  _buffer.begin();
+  return &_buffer;
+}
+
+void AsyncLogStream::do_end_binary() noexcept {
+  auto& log_entry = _buffer.end();
+  _appender->write_binary(log_entry, _file_object, severity());
 }
 
 BABYLON_NAMESPACE_END
@@ -47,6 +47,10 @@ class AsyncLogStream : public LogStream {
   virtual void do_begin() noexcept override;
   virtual void do_end() noexcept override;
 
+  // 二进制日志不经过HeaderFormatter，由AsyncFileAppender使用默认日志头格式化
+  virtual ::std::streambuf* do_begin_binary() noexcept override;
+  virtual void do_end_binary() noexcept override;
+
   AsyncFileAppender* _appender {nullptr};
   FileObject* _file_object {nullptr};
   LogStreamBuffer _buffer;
@@ -0,0 +1,465 @@
+#include "babylon/logging/binary_log.h"
+
+#include "babylon/concurrent/vector.h" // ConcurrentVector
+#include "babylon/time.h"              // localtime
+
+// clang-format off
+#include BABYLON_EXTERNAL(absl/strings/str_format.h) // absl::FormatUntyped
+#include BABYLON_EXTERNAL(absl/time/clock.h)         // absl::Now
+// clang-format on
+
+#include <sys/syscall.h> // __NR_gettid
+#include <unistd.h>      // ::syscall
+
+#include <atomic> // std::atomic
+#include <vector> // std::vector
+
+BABYLON_NAMESPACE_BEGIN
+
+namespace {
+// 进程内全部调用点，按照id顺序注册
+struct BinaryLogSiteRegistry {
+  ::std::atomic<uint32_t> next_id {0};
+  ConcurrentVector<const BinaryLogSite*> sites;
+};
+
+BinaryLogSiteRegistry& binary_log_site_registry() noexcept {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wexit-time-destructors"
+  static BinaryLogSiteRegistry registry;
+#pragma GCC diagnostic pop
+  return registry;
+}
+
+template <typename T>
+inline void append_raw(::std::string& output, T value) noexcept {
+  output.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void append_string(::std::string& output, StringView value) noexcept {
+  append_raw(output, static_cast<uint32_t>(value.size()));
+  output.append(value.data(), value.size());
+}
+
+// 带边界检查的顺序读取
+class BinaryLogReader {
+ public:
+  inline BinaryLogReader(StringView data) noexcept : _data {data} {}
+
+  template <typename T>
+  inline bool read(T& value) noexcept {
+    if (_data.size() < sizeof(T)) {
+      return false;
+    }
+    __builtin_memcpy(&value, _data.data(), sizeof(T));
+    _data.remove_prefix(sizeof(T));
+    return true;
+  }
+
+  inline bool read_string(StringView& value) noexcept {
+    uint32_t size;
+    if (!read(size) || _data.size() < size) {
+      return false;
+    }
+    value = StringView {_data.data(), size};
+    _data.remove_prefix(size);
+    return true;
+  }
+
+  inline bool empty() const noexcept {
+    return _data.empty();
+  }
+
+ private:
+  StringView _data;
+};
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryLogSite begin
+BinaryLogSite::BinaryLogSite(LogSeverity severity, StringView file, int line,
+                             StringView function, StringView format) noexcept
+    : _severity {severity},
+      _line {line},
+      _file {file},
+      _function {function},
+      _format {format} {
+  auto& registry = binary_log_site_registry();
+  _id = registry.next_id.fetch_add(1, ::std::memory_order_relaxed);
+  registry.sites.ensure(_id) = this;
+}
+
+BinaryLogSite::BinaryLogSite(uint32_t id, LogSeverity severity,
+                             StringView file, int line, StringView function,
+                             StringView format) noexcept
+    : _id {id},
+      _severity {severity},
+      _line {line},
+      _file {file},
+      _function {function},
+      _format {format} {}
+
+const BinaryLogSite* BinaryLogSite::find(uint32_t id) noexcept {
+  auto& registry = binary_log_site_registry();
+  if (id >= registry.next_id.load(::std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return registry.sites.ensure(id);
+}
+// BinaryLogSite end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryLog begin
+void BinaryLog::encode(
+    ::std::streambuf& buffer, const BinaryLogSite& site,
+    ::std::initializer_list<BinaryLogValue> values) noexcept {
+  thread_local int tid = ::syscall(__NR_gettid);
+
+  // 先计算总长度，之后头部和各个参数依次写入
+  uint32_t size = sizeof(uint32_t) + sizeof(int64_t) + sizeof(int32_t) + 1;
+  for (auto& value : values) {
+    switch (value.type()) {
+      case BinaryLogValue::BOOL:
+      case BinaryLogValue::CHAR:
+        size += 1 + 1;
+        break;
+      case BinaryLogValue::STRING:
+        size += 1 + sizeof(uint32_t) + value.string_value().size();
+        break;
+      default:
+        size += 1 + sizeof(uint64_t);
+        break;
+    }
+  }
+
+  char header[HEADER_SIZE + sizeof(uint32_t) + sizeof(int64_t) +
+              sizeof(int32_t) + 1];
+  auto ptr = header;
+  auto put = [&](const void* data, size_t length) {
+    __builtin_memcpy(ptr, data, length);
+    ptr += length;
+  };
+  auto kind = RECORD;
+  auto id = site.id();
+  auto now = ::absl::ToUnixMicros(::absl::Now());
+  auto num = static_cast<uint8_t>(values.size());
+  put(&kind, 1);
+  put(&size, sizeof(size));
+  put(&id, sizeof(id));
+  put(&now, sizeof(now));
+  put(&tid, sizeof(tid));
+  put(&num, 1);
+  buffer.sputn(header, sizeof(header));
+
+  for (auto& value : values) {
+    char arg[1 + sizeof(uint64_t)];
+    ptr = arg;
+    auto type = value.type();
+    put(&type, 1);
+    switch (type) {
+      case BinaryLogValue::INT64: {
+        auto v = value.int64_value();
+        put(&v, sizeof(v));
+      } break;
+      case BinaryLogValue::UINT64: {
+        auto v = value.uint64_value();
+        put(&v, sizeof(v));
+      } break;
+      case BinaryLogValue::DOUBLE: {
+        auto v = value.double_value();
+        put(&v, sizeof(v));
+      } break;
+      case BinaryLogValue::BOOL: {
+        auto v = value.bool_value();
+        put(&v, 1);
+      } break;
+      case BinaryLogValue::CHAR: {
+        auto v = value.char_value();
+        put(&v, 1);
+      } break;
+      case BinaryLogValue::POINTER: {
+        auto v = reinterpret_cast<uintptr_t>(value.pointer_value());
+        put(&v, sizeof(v));
+      } break;
+      case BinaryLogValue::STRING: {
+        auto v = static_cast<uint32_t>(value.string_value().size());
+        put(&v, sizeof(v));
+      } break;
+    }
+    buffer.sputn(arg, ptr - arg);
+    if (type == BinaryLogValue::STRING) {
+      auto sv = value.string_value();
+      buffer.sputn(sv.data(), static_cast<ssize_t>(sv.size()));
+    }
+  }
+}
+
+void BinaryLog::encode_definition(const BinaryLogSite& site,
+                                  ::std::string& output) noexcept {
+  auto size = sizeof(uint32_t) + 1 + sizeof(int32_t) + sizeof(uint32_t) * 3 +
+              site.file().size() + site.function().size() +
+              site.format().size();
+  append_raw(output, DEFINITION);
+  append_raw(output, static_cast<uint32_t>(size));
+  append_raw(output, site.id());
+  append_raw(output, static_cast<uint8_t>(site.severity()));
+  append_raw(output, static_cast<int32_t>(site.line()));
+  append_string(output, site.file());
+  append_string(output, site.function());
+  append_string(output, site.format());
+}
+
+void BinaryLog::encode_text(StringView text, ::std::string& output) noexcept {
+  append_raw(output, TEXT);
+  append_raw(output, static_cast<uint32_t>(text.size()));
+  output.append(text.data(), text.size());
+}
+
+bool BinaryLog::parse_header(StringView data, Kind& kind,
+                             StringView& body) noexcept {
+  BinaryLogReader reader {data};
+  uint32_t size;
+  if (!reader.read(kind) || !reader.read(size) ||
+      data.size() - HEADER_SIZE < size) {
+    return false;
+  }
+  body = StringView {data.data() + HEADER_SIZE, size};
+  return true;
+}
+
+bool BinaryLog::parse_site_id(StringView body, uint32_t& id) noexcept {
+  BinaryLogReader reader {body};
+  return reader.read(id);
+}
+
+int BinaryLog::format(StringView body, const BinaryLogSite& site,
+                      ::std::string& output) noexcept {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wexit-time-destructors"
+  static thread_local ::std::vector<BinaryLogValue> values;
+#pragma GCC diagnostic pop
+
+  BinaryLogReader reader {body};
+  uint32_t id;
+  int64_t now;
+  int32_t tid;
+  uint8_t num;
+  if (!reader.read(id) || !reader.read(now) || !reader.read(tid) ||
+      !reader.read(num)) {
+    return -1;
+  }
+  values.clear();
+  for (size_t i = 0; i < num; ++i) {
+    uint8_t type;
+    if (!reader.read(type)) {
+      return -1;
+    }
+    bool success = false;
+    switch (type) {
+      case BinaryLogValue::INT64: {
+        int64_t v;
+        if ((success = reader.read(v))) {
+          values.emplace_back(v);
+        }
+      } break;
+      case BinaryLogValue::UINT64: {
+        uint64_t v;
+        if ((success = reader.read(v))) {
+          values.emplace_back(v);
+        }
+      } break;
+      case BinaryLogValue::DOUBLE: {
+        double v;
+        if ((success = reader.read(v))) {
+          values.emplace_back(v);
+        }
+      } break;
+      case BinaryLogValue::BOOL: {
+        bool v;
+        if ((success = reader.read(v))) {
+          values.emplace_back(v);
+        }
+      } break;
+      case BinaryLogValue::CHAR: {
+        char v;
+        if ((success = reader.read(v))) {
+          values.emplace_back(v);
+        }
+      } break;
+      case BinaryLogValue::POINTER: {
+        uintptr_t v;
+        if ((success = reader.read(v))) {
+          values.emplace_back(reinterpret_cast<const void*>(v));
+        }
+      } break;
+      case BinaryLogValue::STRING: {
+        StringView v;
+        if ((success = reader.read_string(v))) {
+          values.emplace_back(v);
+        }
+      } break;
+    }
+    if (!success) {
+      return -1;
+    }
+  }
+
+  // 和AsyncLogStream的默认日志头保持一致
+  time_t secs = now / 1000000;
+  struct ::tm time_struct;
+  StringView severity_name = site.severity();
+  ::babylon::localtime(&secs, &time_struct);
+  ::absl::StrAppendFormat(
+      &output, "%.*s %d-%02d-%02d %02d:%02d:%02d.%06d %d %.*s:%d %.*s] ",
+      severity_name.size(), severity_name.data(), time_struct.tm_year + 1900,
+      time_struct.tm_mon + 1, time_struct.tm_mday, time_struct.tm_hour,
+      time_struct.tm_min, time_struct.tm_sec, static_cast<int>(now % 1000000),
+      tid, site.file().size(), site.file().data(), site.line(),
+      site.function().size(), site.function().data());
+  auto size = output.size();
+  if (!format_message(site.format(), values.data(), values.size(), output)) {
+    output.resize(size);
+    auto format = site.format();
+    output.append("[binary log format mismatch] ");
+    output.append(format.data(), format.size());
+  }
+  output.push_back('\n');
+  return 0;
+}
+
+bool BinaryLog::format_message(StringView format, const BinaryLogValue* values,
+                               size_t num, ::std::string& output) noexcept {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wexit-time-destructors"
+  static thread_local ::std::vector<::absl::string_view> strings;
+  static thread_local ::std::vector<::absl::FormatArg> args;
+#pragma GCC diagnostic pop
+
+  // FormatArg只持有参数的引用，先准备好字符串参数并确保不再扩容
+  strings.clear();
+  strings.reserve(num);
+  args.clear();
+  for (size_t i = 0; i < num; ++i) {
+    auto& value = values[i];
+    switch (value.type()) {
+      case BinaryLogValue::INT64:
+        args.emplace_back(value.int64_value());
+        break;
+      case BinaryLogValue::UINT64:
+        args.emplace_back(value.uint64_value());
+        break;
+      case BinaryLogValue::DOUBLE:
+        args.emplace_back(value.double_value());
+        break;
+      case BinaryLogValue::BOOL:
+        args.emplace_back(value.bool_value());
+        break;
+      case BinaryLogValue::CHAR:
+        args.emplace_back(value.char_value());
+        break;
+      case BinaryLogValue::POINTER:
+        args.emplace_back(value.pointer_value());
+        break;
+      case BinaryLogValue::STRING: {
+        auto sv = value.string_value();
+        strings.emplace_back(sv.data(), sv.size());
+        args.emplace_back(strings.back());
+      } break;
+    }
+  }
+  return ::absl::FormatUntyped(
+      &output, ::absl::UntypedFormatSpec {{format.data(), format.size()}},
+      args);
+}
+// BinaryLog end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryLogDecoder begin
+struct BinaryLogDecoder::Definition {
+  ::std::string file;
+  ::std::string function;
+  ::std::string format;
+  ::std::unique_ptr<BinaryLogSite> site;
+};
+
+BinaryLogDecoder::BinaryLogDecoder() noexcept = default;
+BinaryLogDecoder::BinaryLogDecoder(BinaryLogDecoder&&) noexcept = default;
+BinaryLogDecoder& BinaryLogDecoder::operator=(BinaryLogDecoder&&) noexcept =
+    default;
+BinaryLogDecoder::~BinaryLogDecoder() noexcept = default;
+
+ssize_t BinaryLogDecoder::decode(const char* data, size_t size,
+                                 ::std::string& output) noexcept {
+  size_t consumed = 0;
+  while (consumed < size) {
+    BinaryLog::Kind kind;
+    StringView body;
+    if (!BinaryLog::parse_header({data + consumed, size - consumed}, kind,
+                                 body)) {
+      break;
+    }
+    switch (kind) {
+      case BinaryLog::RECORD: {
+        uint32_t id;
+        if (!BinaryLog::parse_site_id(body, id)) {
+          return -1;
+        }
+        auto iter = _definitions.find(id);
+        if (iter == _definitions.end() ||
+            0 != BinaryLog::format(body, *iter->second->site, output)) {
+          return -1;
+        }
+      } break;
+      case BinaryLog::DEFINITION: {
+        if (0 != define(body)) {
+          return -1;
+        }
+      } break;
+      case BinaryLog::TEXT: {
+        output.append(body.data(), body.size());
+      } break;
+      default:
+        return -1;
+    }
+    consumed += BinaryLog::HEADER_SIZE + body.size();
+  }
+  return static_cast<ssize_t>(consumed);
+}
+
+int BinaryLogDecoder::define(StringView body) noexcept {
+  BinaryLogReader reader {body};
+  uint32_t id;
+  uint8_t severity;
+  int32_t line;
+  StringView file;
+  StringView function;
+  StringView format;
+  if (!reader.read(id) || !reader.read(severity) || !reader.read(line) ||
+      !reader.read_string(file) || !reader.read_string(function) ||
+      !reader.read_string(format) || severity >= LogSeverity::NUM) {
+    return -1;
+  }
+
+  // 文件滚动后会重复定义，内容相同，直接覆盖即可
+  ::std::unique_ptr<Definition> definition {new Definition};
+  definition->file.assign(file.data(), file.size());
+  definition->function.assign(function.data(), function.size());
+  definition->format.assign(format.data(), format.size());
+  definition->site.reset(new BinaryLogSite {
+      id, severity, definition->file, line, definition->function,
+      definition->format});
+  _definitions[id] = ::std::move(definition);
+  return 0;
+}
+// BinaryLogDecoder end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
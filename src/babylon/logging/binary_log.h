@@ -0,0 +1,300 @@
+#pragma once
+
+#include "babylon/logging/log_severity.h" // LogSeverity
+#include "babylon/string_view.h"          // StringView
+
+// clang-format off
+#include "babylon/protect.h"
+// clang-format on
+
+#include <sys/types.h> // ssize_t
+
+#include <initializer_list> // std::initializer_list
+#include <memory>           // std::unique_ptr
+#include <streambuf>        // std::streambuf
+#include <string>           // std::string
+#include <type_traits>      // std::enable_if
+#include <unordered_map>    // std::unordered_map
+
+BABYLON_NAMESPACE_BEGIN
+
+// 二进制日志的一个调用点，一般由BABYLON_LOG_BINARY宏在调用处静态构造
+// 构造时注册获得一个进程内唯一的id，日志记录中只保存id和参数的原始字节
+// 日志等级，文件名，行号，函数名和格式串这些静态信息之后通过id查找
+class BinaryLogSite {
+ public:
+  BinaryLogSite(BinaryLogSite&&) = delete;
+  BinaryLogSite(const BinaryLogSite&) = delete;
+  BinaryLogSite& operator=(BinaryLogSite&&) = delete;
+  BinaryLogSite& operator=(const BinaryLogSite&) = delete;
+  ~BinaryLogSite() noexcept = default;
+
+  // 各个参数需要在调用点的生命周期内保持有效，一般均为字面量
+  BinaryLogSite(LogSeverity severity, StringView file, int line,
+                StringView function, StringView format) noexcept;
+
+  inline uint32_t id() const noexcept;
+  inline LogSeverity severity() const noexcept;
+  inline StringView file() const noexcept;
+  inline int line() const noexcept;
+  inline StringView function() const noexcept;
+  inline StringView format() const noexcept;
+
+  // 查找进程内注册的调用点，不存在时返回nullptr
+  static const BinaryLogSite* find(uint32_t id) noexcept;
+
+ private:
+  // 离线解码时根据DEFINITION记录构造，不进行注册
+  BinaryLogSite(uint32_t id, LogSeverity severity, StringView file, int line,
+                StringView function, StringView format) noexcept;
+
+  uint32_t _id {0};
+  LogSeverity _severity;
+  int _line {-1};
+  StringView _file;
+  StringView _function;
+  StringView _format;
+
+  friend class BinaryLogDecoder;
+};
+
+// 二进制日志的一个参数，在调用线程只记录类型和原始值
+// 整数统一扩展到64位，浮点数统一扩展到double，字符串只记录引用
+// 因此格式串需要按照扩展后的类型书写，例如%d对应所有有符号整数
+class BinaryLogValue {
+ public:
+  enum Type : uint8_t {
+    INT64 = 0,
+    UINT64 = 1,
+    DOUBLE = 2,
+    BOOL = 3,
+    CHAR = 4,
+    POINTER = 5,
+    STRING = 6,
+  };
+
+  inline BinaryLogValue(bool value) noexcept;
+  inline BinaryLogValue(char value) noexcept;
+  template <typename T,
+            typename ::std::enable_if<::std::is_integral<T>::value &&
+                                          ::std::is_signed<T>::value,
+                                      int>::type = 0>
+  inline BinaryLogValue(T value) noexcept;
+  template <typename T,
+            typename ::std::enable_if<::std::is_integral<T>::value &&
+                                          ::std::is_unsigned<T>::value,
+                                      int>::type = 0>
+  inline BinaryLogValue(T value) noexcept;
+  inline BinaryLogValue(double value) noexcept;
+  inline BinaryLogValue(long double value) noexcept;
+  inline BinaryLogValue(const void* value) noexcept;
+  inline BinaryLogValue(const char* value) noexcept;
+  inline BinaryLogValue(StringView value) noexcept;
+  inline BinaryLogValue(const ::std::string& value) noexcept;
+
+  inline Type type() const noexcept;
+  inline int64_t int64_value() const noexcept;
+  inline uint64_t uint64_value() const noexcept;
+  inline double double_value() const noexcept;
+  inline bool bool_value() const noexcept;
+  inline char char_value() const noexcept;
+  inline const void* pointer_value() const noexcept;
+  inline StringView string_value() const noexcept;
+
+ private:
+  Type _type {INT64};
+  union {
+    int64_t _int64;
+    uint64_t _uint64;
+    double _double;
+    bool _bool;
+    char _char;
+    const void* _pointer;
+    size_t _size;
+  };
+  const char* _data {nullptr};
+};
+
+// 二进制日志记录的编码和格式化
+//
+// 记录由定长头部和变长内容组成
+// | kind:1 | size:4 | body:size |
+//
+// RECORD记录一条日志，由调用线程编码写入
+// | site id:4 | 微秒时间戳:8 | 线程号:4 | 参数数目:1 | 参数... |
+// 数值类型的参数为| 类型:1 | 原始值 |，原始值长度由类型确定
+// 字符串类型的参数为| 类型:1 | 长度:4 | 内容 |
+//
+// DEFINITION记录一个调用点的静态信息，用于离线解码
+// | site id:4 | 等级:1 | 行号:4 | 文件名 | 函数名 | 格式串 |
+// 其中字符串均为| 长度:4 | 内容 |
+//
+// TEXT记录一条普通文本日志，用于和二进制日志混合写入同一个文件
+// | 文本内容 |
+//
+// 各个整数均采用本机字节序
+class BinaryLog {
+ public:
+  enum Kind : uint8_t {
+    RECORD = 1,
+    DEFINITION = 2,
+    TEXT = 3,
+  };
+
+  constexpr static size_t HEADER_SIZE = 5;
+
+  // 将一条RECORD整体写入buffer，调用线程上只有拷贝动作
+  static void encode(::std::streambuf& buffer, const BinaryLogSite& site,
+                     ::std::initializer_list<BinaryLogValue> values) noexcept;
+  // 编码DEFINITION或者TEXT记录，追加到output
+  static void encode_definition(const BinaryLogSite& site,
+                                ::std::string& output) noexcept;
+  static void encode_text(StringView text, ::std::string& output) noexcept;
+
+  // 解析data开头的记录头，data中不足一个完整记录时返回false
+  static bool parse_header(StringView data, Kind& kind,
+                           StringView& body) noexcept;
+  // 获取RECORD记录体中的site id，记录体不完整时返回false
+  static bool parse_site_id(StringView body, uint32_t& id) noexcept;
+
+  // 将RECORD记录体格式化为一行文本日志追加到output，包含换行符
+  // 日志头和AsyncLogStream的默认日志头格式相同
+  // 记录体损坏时返回-1，格式串和参数不匹配时依然输出，并附带错误提示
+  static int format(StringView body, const BinaryLogSite& site,
+                    ::std::string& output) noexcept;
+
+  // 使用参数格式化format，结果追加到output，格式串和参数不匹配时返回false
+  static bool format_message(StringView format, const BinaryLogValue* values,
+                             size_t num, ::std::string& output) noexcept;
+};
+
+// 离线解码由AsyncFileAppender原样写出的二进制日志文件
+// 文件内的DEFINITION记录会被解码器记住，因此需要从文件头开始顺序解码
+class BinaryLogDecoder {
+ public:
+  BinaryLogDecoder() noexcept;
+  BinaryLogDecoder(BinaryLogDecoder&&) noexcept;
+  BinaryLogDecoder(const BinaryLogDecoder&) = delete;
+  BinaryLogDecoder& operator=(BinaryLogDecoder&&) noexcept;
+  BinaryLogDecoder& operator=(const BinaryLogDecoder&) = delete;
+  ~BinaryLogDecoder() noexcept;
+
+  // 解码连续的若干记录，格式化后的文本追加到output
+  // 末尾不完整的记录（例如文件仍在写入中）不做处理，由调用者稍后重试
+  // 返回消费的字节数，数据损坏或者遇到未定义的调用点时返回-1
+  ssize_t decode(const char* data, size_t size,
+                 ::std::string& output) noexcept;
+
+ private:
+  struct Definition;
+
+  int define(StringView body) noexcept;
+
+  ::std::unordered_map<uint32_t, ::std::unique_ptr<Definition>> _definitions;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryLogSite begin
+inline uint32_t BinaryLogSite::id() const noexcept {
+  return _id;
+}
+
+inline LogSeverity BinaryLogSite::severity() const noexcept {
+  return _severity;
+}
+
+inline StringView BinaryLogSite::file() const noexcept {
+  return _file;
+}
+
+inline int BinaryLogSite::line() const noexcept {
+  return _line;
+}
+
+inline StringView BinaryLogSite::function() const noexcept {
+  return _function;
+}
+
+inline StringView BinaryLogSite::format() const noexcept {
+  return _format;
+}
+// BinaryLogSite end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryLogValue begin
+inline BinaryLogValue::BinaryLogValue(bool value) noexcept
+    : _type {BOOL}, _bool {value} {}
+
+inline BinaryLogValue::BinaryLogValue(char value) noexcept
+    : _type {CHAR}, _char {value} {}
+
+template <typename T,
+          typename ::std::enable_if<::std::is_integral<T>::value &&
+                                        ::std::is_signed<T>::value,
+                                    int>::type>
+inline BinaryLogValue::BinaryLogValue(T value) noexcept
+    : _type {INT64}, _int64 {value} {}
+
+template <typename T,
+          typename ::std::enable_if<::std::is_integral<T>::value &&
+                                        ::std::is_unsigned<T>::value,
+                                    int>::type>
+inline BinaryLogValue::BinaryLogValue(T value) noexcept
+    : _type {UINT64}, _uint64 {value} {}
+
+inline BinaryLogValue::BinaryLogValue(double value) noexcept
+    : _type {DOUBLE}, _double {value} {}
+
+inline BinaryLogValue::BinaryLogValue(long double value) noexcept
+    : _type {DOUBLE}, _double {static_cast<double>(value)} {}
+
+inline BinaryLogValue::BinaryLogValue(const void* value) noexcept
+    : _type {POINTER}, _pointer {value} {}
+
+inline BinaryLogValue::BinaryLogValue(const char* value) noexcept
+    : BinaryLogValue {StringView {value}} {}
+
+inline BinaryLogValue::BinaryLogValue(StringView value) noexcept
+    : _type {STRING}, _size {value.size()}, _data {value.data()} {}
+
+inline BinaryLogValue::BinaryLogValue(const ::std::string& value) noexcept
+    : BinaryLogValue {StringView {value}} {}
+
+inline BinaryLogValue::Type BinaryLogValue::type() const noexcept {
+  return _type;
+}
+
+inline int64_t BinaryLogValue::int64_value() const noexcept {
+  return _int64;
+}
+
+inline uint64_t BinaryLogValue::uint64_value() const noexcept {
+  return _uint64;
+}
+
+inline double BinaryLogValue::double_value() const noexcept {
+  return _double;
+}
+
+inline bool BinaryLogValue::bool_value() const noexcept {
+  return _bool;
+}
+
+inline char BinaryLogValue::char_value() const noexcept {
+  return _char;
+}
+
+inline const void* BinaryLogValue::pointer_value() const noexcept {
+  return _pointer;
+}
+
+inline StringView BinaryLogValue::string_value() const noexcept {
+  return StringView {_data, _size};
+}
+// BinaryLogValue end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
+
+#include "babylon/unprotect.h"
@@ -6,12 +6,21 @@ BABYLON_NAMESPACE_BEGIN
 
 ////////////////////////////////////////////////////////////////////////////////
 // FileObject::begin
+FileObject::FileObject(FileObject&& other) noexcept
+    : _index {other._index.load(::std::memory_order_relaxed)} {}
+
+FileObject& FileObject::operator=(FileObject&& other) noexcept {
+  _index.store(other._index.load(::std::memory_order_relaxed),
+               ::std::memory_order_relaxed);
+  return *this;
+}
+
 void FileObject::set_index(size_t index) noexcept {
-  _index = index;
+  _index.store(index, ::std::memory_order_relaxed);
 }
 
 size_t FileObject::index() const noexcept {
-  return _index;
+  return _index.load(::std::memory_order_relaxed);
 }
 // FileObject::end
 ////////////////////////////////////////////////////////////////////////////////
@@ -2,6 +2,7 @@
 
 #include "babylon/environment.h"
 
+#include <atomic>  // std::atomic
 #include <cstdint> // SIZE_MAX
 #include <tuple>   // std::tuple
 
@@ -15,9 +16,9 @@ class FileObject {
  public:
   // 可以默认构造和移动，不可拷贝
   FileObject() noexcept = default;
-  FileObject(FileObject&&) noexcept = default;
+  FileObject(FileObject&&) noexcept;
   FileObject(const FileObject&) = delete;
-  FileObject& operator=(FileObject&&) noexcept = default;
+  FileObject& operator=(FileObject&&) noexcept;
   FileObject& operator=(const FileObject&) = delete;
   virtual ~FileObject() noexcept = default;
 
@@ -39,7 +40,8 @@ class FileObject {
   void set_index(size_t index) noexcept;
   size_t index() const noexcept;
 
-  size_t _index {SIZE_MAX};
+  // 多个写线程时，由提交日志的线程分配，写线程读取
+  ::std::atomic<size_t> _index {SIZE_MAX};
 
   friend class AsyncFileAppender;
 };
@@ -0,0 +1,185 @@
+#include "babylon/logging/log_compressor.h"
+
+#include "babylon/protect.h"
+
+#include <cerrno> // errno
+#include <memory> // std::unique_ptr
+
+#if BABYLON_USE_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif // BABYLON_USE_ZSTD
+
+BABYLON_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+// LogCompressor begin
+#if BABYLON_USE_ZSTD
+LogCompressor::~LogCompressor() noexcept {
+  ::ZSTD_freeCCtx(static_cast<::ZSTD_CCtx*>(_context));
+}
+
+bool LogCompressor::available() noexcept {
+  return true;
+}
+
+int LogCompressor::initialize(int level) noexcept {
+  auto context = ::ZSTD_createCCtx();
+  if (context == nullptr) {
+    errno = ENOMEM;
+    return -1;
+  }
+  ::ZSTD_freeCCtx(static_cast<::ZSTD_CCtx*>(_context));
+  _context = context;
+  ::ZSTD_CCtx_setParameter(context, ::ZSTD_c_compressionLevel, level);
+  ::ZSTD_CCtx_setParameter(context, ::ZSTD_c_checksumFlag, 1);
+  return 0;
+}
+
+int LogCompressor::compress(PageAllocator& page_allocator,
+                            ::std::vector<struct ::iovec>& iov,
+                            size_t begin) noexcept {
+  auto context = static_cast<::ZSTD_CCtx*>(_context);
+  auto end = iov.size();
+  size_t total = 0;
+  for (size_t i = begin; i < end; ++i) {
+    total += iov[i].iov_len;
+  }
+  ::ZSTD_CCtx_reset(context, ::ZSTD_reset_session_only);
+  ::ZSTD_CCtx_setPledgedSrcSize(context, total);
+
+  // 输出页面先追加在末尾，完成后再替换掉输入部分
+  auto page_size = page_allocator.page_size();
+  ::ZSTD_outBuffer out {page_allocator.allocate(), page_size, 0};
+  auto next_page = [&] {
+    if (out.pos == out.size) {
+      iov.emplace_back(::iovec {out.dst, out.pos});
+      out = {page_allocator.allocate(), page_size, 0};
+    }
+  };
+  size_t ret = 0;
+  for (size_t i = begin; i < end; ++i) {
+    ::ZSTD_inBuffer in {iov[i].iov_base, iov[i].iov_len, 0};
+    while (in.pos < in.size) {
+      ret = ::ZSTD_compressStream2(context, &out, &in, ::ZSTD_e_continue);
+      if (ABSL_PREDICT_FALSE(::ZSTD_isError(ret))) {
+        break;
+      }
+      next_page();
+    }
+    if (ABSL_PREDICT_FALSE(::ZSTD_isError(ret))) {
+      break;
+    }
+  }
+  if (ABSL_PREDICT_TRUE(!::ZSTD_isError(ret))) {
+    ::ZSTD_inBuffer in {nullptr, 0, 0};
+    do {
+      ret = ::ZSTD_compressStream2(context, &out, &in, ::ZSTD_e_end);
+      if (ABSL_PREDICT_FALSE(::ZSTD_isError(ret))) {
+        break;
+      }
+      next_page();
+    } while (ret != 0);
+  }
+
+  if (out.pos > 0) {
+    iov.emplace_back(::iovec {out.dst, out.pos});
+  } else {
+    page_allocator.deallocate(out.dst);
+  }
+  if (ABSL_PREDICT_FALSE(::ZSTD_isError(ret))) {
+    ::ZSTD_CCtx_reset(context, ::ZSTD_reset_session_only);
+    release_pages(page_allocator, iov, begin, iov.size());
+    errno = EINVAL;
+    return -1;
+  }
+  release_pages(page_allocator, iov, begin, end);
+  return 0;
+}
+
+ssize_t LogCompressor::decompress(const char* data, size_t size,
+                                  ::std::string& output) noexcept {
+  struct ContextDeleter {
+    void operator()(::ZSTD_DCtx* context) noexcept {
+      ::ZSTD_freeDCtx(context);
+    }
+  };
+  ::std::unique_ptr<::ZSTD_DCtx, ContextDeleter> context {::ZSTD_createDCtx()};
+  if (context == nullptr) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  size_t consumed = 0;
+  while (consumed < size) {
+    auto frame_size =
+        ::ZSTD_findFrameCompressedSize(data + consumed, size - consumed);
+    if (::ZSTD_isError(frame_size)) {
+      // 帧头或者帧体尚未完整写出，留待下次处理
+      if (::ZSTD_getErrorCode(frame_size) == ::ZSTD_error_srcSize_wrong) {
+        break;
+      }
+      errno = EINVAL;
+      return -1;
+    }
+
+    ::ZSTD_inBuffer in {data + consumed, frame_size, 0};
+    ::ZSTD_DCtx_reset(context.get(), ::ZSTD_reset_session_only);
+    size_t ret = 0;
+    do {
+      auto offset = output.size();
+      output.resize(offset + ::ZSTD_DStreamOutSize());
+      ::ZSTD_outBuffer out {&output[offset], output.size() - offset, 0};
+      ret = ::ZSTD_decompressStream(context.get(), &out, &in);
+      output.resize(offset + out.pos);
+      if (::ZSTD_isError(ret)) {
+        errno = EINVAL;
+        return -1;
+      }
+    } while (ret != 0);
+    consumed += frame_size;
+  }
+  return static_cast<ssize_t>(consumed);
+}
+#else  // !BABYLON_USE_ZSTD
+LogCompressor::~LogCompressor() noexcept {}
+
+bool LogCompressor::available() noexcept {
+  return false;
+}
+
+int LogCompressor::initialize(int) noexcept {
+  errno = ENOTSUP;
+  return -1;
+}
+
+int LogCompressor::compress(PageAllocator& page_allocator,
+                            ::std::vector<struct ::iovec>& iov,
+                            size_t begin) noexcept {
+  release_pages(page_allocator, iov, begin, iov.size());
+  errno = ENOTSUP;
+  return -1;
+}
+
+ssize_t LogCompressor::decompress(const char*, size_t, ::std::string&) noexcept {
+  errno = ENOTSUP;
+  return -1;
+}
+#endif // !BABYLON_USE_ZSTD
+
+void LogCompressor::release_pages(PageAllocator& page_allocator,
+                                  ::std::vector<struct ::iovec>& iov,
+                                  size_t begin, size_t end) noexcept {
+  for (size_t i = begin; i < end; ++i) {
+    _pages.emplace_back(iov[i].iov_base);
+  }
+  page_allocator.deallocate(_pages.data(), _pages.size());
+  _pages.clear();
+  iov.erase(iov.begin() + begin, iov.begin() + end);
+}
+// LogCompressor end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
+
+#include "babylon/unprotect.h"
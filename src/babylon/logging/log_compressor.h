@@ -0,0 +1,54 @@
+#pragma once
+
+#include "babylon/reusable/page_allocator.h" // babylon::PageAllocator
+
+#include <sys/uio.h> // ::iovec
+
+#include <string> // std::string
+#include <vector> // std::vector
+
+BABYLON_NAMESPACE_BEGIN
+
+// 将AsyncFileAppender的一批日志压缩为一个独立的zstd帧
+// 每个帧都完整记录原始长度和校验和，可以独立解压
+// 因此文件可以从任意帧边界开始读取，也可以按帧跳过
+// 多个帧直接拼接依然是合法的zstd流，可以直接使用zstd -d解压
+// 需要编译时检测到libzstd，否则initialize失败
+class LogCompressor {
+ public:
+  LogCompressor() noexcept = default;
+  LogCompressor(LogCompressor&&) = delete;
+  LogCompressor(const LogCompressor&) = delete;
+  LogCompressor& operator=(LogCompressor&&) = delete;
+  LogCompressor& operator=(const LogCompressor&) = delete;
+  ~LogCompressor() noexcept;
+
+  // 是否编译了压缩支持
+  static bool available() noexcept;
+
+  // 按照zstd压缩级别初始化，压缩支持不可用时返回-1
+  int initialize(int level) noexcept;
+
+  // 将iov中从begin开始的部分压缩为一个帧，并原地替换
+  // 输入的每个iov_base均为一个页面，压缩后归还给page_allocator
+  // 输出同样写入从page_allocator申请的页面，写出后可以照常归还
+  // 失败时输入和输出页面均被归还，iov截断到begin，并返回-1
+  int compress(PageAllocator& page_allocator,
+               ::std::vector<struct ::iovec>& iov, size_t begin) noexcept;
+
+  // 解压连续的若干帧，结果追加到output
+  // 末尾不完整的帧（例如文件仍在写入中）不做处理，由调用者稍后重试
+  // 返回消费的字节数，数据损坏或者压缩支持不可用时返回-1
+  static ssize_t decompress(const char* data, size_t size,
+                            ::std::string& output) noexcept;
+
+ private:
+  void release_pages(PageAllocator& page_allocator,
+                     ::std::vector<struct ::iovec>& iov, size_t begin,
+                     size_t end) noexcept;
+
+  void* _context {nullptr};
+  ::std::vector<void*> _pages;
+};
+
+BABYLON_NAMESPACE_END
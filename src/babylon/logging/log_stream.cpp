@@ -22,9 +22,43 @@ class NullLogStream::Buffer : public ::std::streambuf {
   }
 };
 
+LogStream& LogStream::do_write_binary(
+    const BinaryLogSite& site,
+    ::std::initializer_list<BinaryLogValue> values) noexcept {
+  if (_depth == 0 && !_noflush) {
+    auto buffer = do_begin_binary();
+    if (buffer != nullptr) {
+      BinaryLog::encode(*buffer, site, values);
+      do_end_binary();
+      return *this;
+    }
+  }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wexit-time-destructors"
+  static thread_local ::std::string message;
+#pragma GCC diagnostic pop
+  message.clear();
+  if (!BinaryLog::format_message(site.format(), values.begin(), values.size(),
+                                 message)) {
+    message.assign(site.format().data(), site.format().size());
+  }
+  begin();
+  write(message.data(), message.size());
+  return end();
+}
+
 void LogStream::do_begin() noexcept {}
 void LogStream::do_end() noexcept {}
 
+::std::streambuf* LogStream::do_begin_binary() noexcept {
+  return nullptr;
+}
+
+void LogStream::do_end_binary() noexcept {}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpragmas"
 #pragma GCC diagnostic ignored "-Wunknown-warning-option"
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "babylon/logging/binary_log.h"   // BinaryLogSite
 #include "babylon/logging/log_severity.h" // LogSeverity
 #include "babylon/type_traits.h"          // BABYLON_DECLARE_MEMBER_INVOCABLE
 
@@ -31,6 +32,9 @@ BABYLON_NAMESPACE_BEGIN
 // ls.begin(args...);
 // ls.format("...", ...).format("...", ...);
 // ls.end();
+//
+// 此外支持格式化推迟执行的二进制日志，一般通过BABYLON_LOG_BINARY宏使用
+// ls.write_binary(site, args...); // 独立作为一条日志发送给日志框架
 class LogStream : protected ::std::ostream {
  private:
   using Base = ::std::ostream;
@@ -69,6 +73,18 @@ class LogStream : protected ::std::ostream {
   inline LogStream& format(const ::absl::FormatSpec<Args...>& format,
                            const Args&... args) noexcept;
 
+  // 以二进制形式独立写入一条日志，调用线程只拷贝调用点id和参数的原始值
+  // 格式化推迟到后端写出线程，或者在离线解码时进行
+  // 后端不支持二进制日志，或者处于begin和end之间时，降级为即时格式化写入
+  template <typename... Args>
+  inline LogStream& write_binary(const BinaryLogSite& site,
+                                 const Args&... args) noexcept;
+  // 只在未求值上下文中使用，BABYLON_LOG_BINARY宏借此检查格式串和参数是否匹配
+  // 和format一样由absl::FormatSpec完成检查，编译器支持时在编译期报错
+  template <typename... Args>
+  static int check_binary_format(const ::absl::FormatSpec<Args...>& format,
+                                 const Args&... args) noexcept;
+
   // 内置类型绕过std::ostream层直接输出
   template <typename T,
             typename ::std::enable_if<IsDirectWritable<LogStream, T>::value,
@@ -132,9 +148,18 @@ class LogStream : protected ::std::ostream {
   BABYLON_TMP_GEN_WRITE(long double, "Lg")
 #undef BABYLON_TMP_GEN_WRITE
 
+  LogStream& do_write_binary(
+      const BinaryLogSite& site,
+      ::std::initializer_list<BinaryLogValue> values) noexcept;
+
   virtual void do_begin() noexcept;
   virtual void do_end() noexcept;
 
+  // 支持二进制日志的后端返回用于写入一条记录的缓冲区，默认不支持返回nullptr
+  // 写入完成后通过do_end_binary发送
+  virtual ::std::streambuf* do_begin_binary() noexcept;
+  virtual void do_end_binary() noexcept;
+
   size_t _depth {0};
   bool _noflush {false};
   LogSeverity _severity {LogSeverity::DEBUG};
@@ -266,6 +291,13 @@ inline LogStream& LogStream::format(const ::absl::FormatSpec<Args...>& format,
   return do_absl_format(this, format, args...);
 }
 
+template <typename... Args>
+inline LogStream& LogStream::write_binary(const BinaryLogSite& site,
+                                          const Args&... args) noexcept {
+  static_assert(sizeof...(Args) < 256, "too many binary log arguments");
+  return do_write_binary(site, {BinaryLogValue(args)...});
+}
+
 template <
     typename T, typename... Args,
     typename ::std::enable_if<
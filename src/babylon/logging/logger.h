@@ -146,3 +146,29 @@ BABYLON_NAMESPACE_END
 #define BABYLON_LOG(severity)                                                \
   BABYLON_LOG_STREAM(::babylon::LoggerManager::instance().get_root_logger(), \
                      severity)
+
+// 二进制日志，调用线程只记录调用点和参数的原始值，格式化推迟执行
+// 格式串采用absl::StrFormat语法，需要为字面量，详见LogStream::write_binary
+// 编译器支持时（例如clang）在编译期检查格式串和参数是否匹配，参数不会被额外求值
+// BABYLON_LOG_BINARY(INFO, "value %d of %s", 10, name);
+#define BABYLON_LOG_BINARY_STREAM(logger, severity, format, ...)               \
+  do {                                                                         \
+    static_cast<void>(sizeof(::babylon::LogStream::check_binary_format(        \
+        format, ##__VA_ARGS__)));                                              \
+    auto& __babylon_binary_logger = (logger);                                  \
+    if (__babylon_binary_logger.min_severity() <=                              \
+        ::babylon::LogSeverity::severity) {                                    \
+      static const ::babylon::BinaryLogSite __babylon_binary_log_site {        \
+          ::babylon::LogSeverity::severity, __FILE__, __LINE__, __func__,      \
+          format};                                                             \
+      __babylon_binary_logger                                                  \
+          .stream(::babylon::LogSeverity::severity, __FILE__, __LINE__,        \
+                  __func__)                                                    \
+          .write_binary(__babylon_binary_log_site, ##__VA_ARGS__);             \
+    }                                                                          \
+  } while (false)
+
+#define BABYLON_LOG_BINARY(severity, format, ...)                       \
+  BABYLON_LOG_BINARY_STREAM(                                            \
+      ::babylon::LoggerManager::instance().get_root_logger(), severity, \
+      format, ##__VA_ARGS__)
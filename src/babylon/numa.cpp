@@ -0,0 +1,185 @@
+#include "babylon/numa.h"
+
+#include <ctype.h>   // ::isspace
+#include <dirent.h>  // ::opendir
+#include <pthread.h> // ::pthread_setaffinity_np
+#include <sched.h>   // ::sched_getcpu
+#include <stdlib.h>  // ::atoi
+#include <unistd.h>  // ::sysconf
+
+#include <algorithm> // std::sort
+#include <fstream>   // std::ifstream
+
+BABYLON_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+// NumaTopology begin
+NumaTopology::NumaTopology() noexcept {
+  // Online cpus may be sparse, e.g. after hotplug or in a cpuset limited
+  // container, so prefer the online list from sysfs, then the affinity of
+  // current process. Only fallback to [0, N) when both are not available
+  ::std::vector<int> cpus;
+  {
+    ::std::ifstream ifs {"/sys/devices/system/cpu/online"};
+    ::std::string cpu_list;
+    if (!::std::getline(ifs, cpu_list) ||
+        0 != parse_cpu_list(cpu_list, cpus)) {
+      cpus.clear();
+    }
+  }
+  if (cpus.empty()) {
+    ::cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (0 == ::sched_getaffinity(0, sizeof(cpu_set), &cpu_set)) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpu_set)) {
+          cpus.emplace_back(cpu);
+        }
+      }
+    }
+  }
+  if (cpus.empty()) {
+    auto cpu_num = ::sysconf(_SC_NPROCESSORS_ONLN);
+    for (int cpu = 0; cpu < ::std::max<long>(cpu_num, 1); ++cpu) {
+      cpus.emplace_back(cpu);
+    }
+  }
+
+  int max_cpu = *::std::max_element(cpus.begin(), cpus.end());
+  _cpu_node.resize(static_cast<size_t>(max_cpu) + 1, 0);
+  _node_cpus.emplace_back(::std::move(cpus));
+}
+
+int NumaTopology::load(StringView node_root) noexcept {
+  ::std::string root {node_root.data(), node_root.size()};
+  auto dir = ::opendir(root.c_str());
+  if (dir == nullptr) {
+    return -1;
+  }
+  ::std::vector<int> node_ids;
+  while (auto entry = ::readdir(dir)) {
+    ::std::string name {entry->d_name};
+    if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+        name.find_first_not_of("0123456789", 4) != ::std::string::npos) {
+      continue;
+    }
+    node_ids.emplace_back(::atoi(name.c_str() + 4));
+  }
+  ::closedir(dir);
+  ::std::sort(node_ids.begin(), node_ids.end());
+
+  ::std::vector<::std::vector<int>> node_cpus;
+  for (auto node_id : node_ids) {
+    ::std::ifstream ifs {root + "/node" + ::std::to_string(node_id) +
+                         "/cpulist"};
+    ::std::string cpu_list;
+    if (!::std::getline(ifs, cpu_list)) {
+      continue;
+    }
+    ::std::vector<int> cpus;
+    if (0 != parse_cpu_list(cpu_list, cpus) || cpus.empty()) {
+      continue;
+    }
+    node_cpus.emplace_back(::std::move(cpus));
+  }
+  if (node_cpus.empty()) {
+    return -1;
+  }
+
+  ::std::vector<size_t> cpu_node;
+  for (size_t node = 0; node < node_cpus.size(); ++node) {
+    for (auto cpu : node_cpus[node]) {
+      if (static_cast<size_t>(cpu) >= cpu_node.size()) {
+        cpu_node.resize(static_cast<size_t>(cpu) + 1, 0);
+      }
+      cpu_node[static_cast<size_t>(cpu)] = node;
+    }
+  }
+  _node_cpus = ::std::move(node_cpus);
+  _cpu_node = ::std::move(cpu_node);
+  return 0;
+}
+
+size_t NumaTopology::node_of_cpu(int cpu) const noexcept {
+  if (cpu < 0 || static_cast<size_t>(cpu) >= _cpu_node.size()) {
+    return 0;
+  }
+  return _cpu_node[static_cast<size_t>(cpu)];
+}
+
+size_t NumaTopology::current_node() const noexcept {
+  if (_node_cpus.size() <= 1) {
+    return 0;
+  }
+  return node_of_cpu(::sched_getcpu());
+}
+
+const NumaTopology& NumaTopology::instance() noexcept {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wexit-time-destructors"
+  static NumaTopology topology = [] {
+    NumaTopology topology;
+    topology.load();
+    return topology;
+  }();
+#pragma GCC diagnostic pop
+  return topology;
+}
+
+int NumaTopology::parse_cpu_list(StringView cpu_list,
+                                 ::std::vector<int>& cpus) noexcept {
+  ::std::string list {cpu_list.data(), cpu_list.size()};
+  size_t begin_pos = 0;
+  while (begin_pos < list.size()) {
+    auto end_pos = list.find(',', begin_pos);
+    if (end_pos == ::std::string::npos) {
+      end_pos = list.size();
+    }
+    auto range = list.substr(begin_pos, end_pos - begin_pos);
+    begin_pos = end_pos + 1;
+    // Trim tailing newline or spaces
+    while (!range.empty() && ::isspace(range.back())) {
+      range.pop_back();
+    }
+    if (range.empty()) {
+      continue;
+    }
+    if (range.find_first_not_of("0123456789-") != ::std::string::npos) {
+      return -1;
+    }
+    auto dash = range.find('-');
+    auto first = range.substr(0, dash);
+    auto last = dash == ::std::string::npos ? first : range.substr(dash + 1);
+    if (first.empty() || last.empty() ||
+        last.find('-') != ::std::string::npos) {
+      return -1;
+    }
+    auto first_cpu = ::atoi(first.c_str());
+    auto last_cpu = ::atoi(last.c_str());
+    if (first_cpu > last_cpu) {
+      return -1;
+    }
+    for (auto cpu = first_cpu; cpu <= last_cpu; ++cpu) {
+      cpus.emplace_back(cpu);
+    }
+  }
+  return 0;
+}
+
+int NumaTopology::bind_current_thread(const ::std::vector<int>& cpus) noexcept {
+  ::cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(cpu_set),
+                                  &cpu_set);
+}
+// NumaTopology end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
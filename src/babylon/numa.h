@@ -0,0 +1,75 @@
+#pragma once
+
+#include "babylon/string_view.h" // babylon::StringView
+
+#include <string> // std::string
+#include <vector> // std::vector
+
+BABYLON_NAMESPACE_BEGIN
+
+// Describe how cpus are grouped into NUMA nodes, discovered from sysfs. Used
+// to keep thread and memory of a worker together on the same node.
+//
+// When NUMA information is not available, from a container without sysfs for
+// example, topology fallback to a single node holding all online cpus. So user
+// can always use it unconditionally.
+class NumaTopology {
+ public:
+  // Default constructed topology is a single node with all online cpus. Cpu
+  // ids are taken from sysfs or affinity of current process, so they are not
+  // assumed to be numbered from 0 to N-1 continuously
+  NumaTopology() noexcept;
+  NumaTopology(NumaTopology&&) noexcept = default;
+  NumaTopology(const NumaTopology&) = default;
+  NumaTopology& operator=(NumaTopology&&) noexcept = default;
+  NumaTopology& operator=(const NumaTopology&) = default;
+  ~NumaTopology() noexcept = default;
+
+  // Discover topology from node_root, which is expected to be organized like
+  // /sys/devices/system/node, with a nodeN/cpulist file for every node. Only
+  // nodes with at least one cpu are kept, and renumbered to [0, node_num()).
+  //
+  // return ==0: success
+  //        !=0: no node found, topology keep unchanged
+  int load(StringView node_root = "/sys/devices/system/node") noexcept;
+
+  inline size_t node_num() const noexcept;
+  inline const ::std::vector<int>& node_cpus(size_t node) const noexcept;
+
+  // Node which cpu belongs to, return 0 for unknown cpu
+  size_t node_of_cpu(int cpu) const noexcept;
+
+  // Node which current thread is running on, by sched_getcpu. Cheap enough to
+  // be called in submit path, since sched_getcpu is served by vDSO
+  size_t current_node() const noexcept;
+
+  // Topology of current machine, loaded once at first use
+  static const NumaTopology& instance() noexcept;
+
+  // Parse cpu list format used by sysfs, e.g. "0-3,8,10-11", append result to
+  // cpus. Return 0 if success.
+  static int parse_cpu_list(StringView cpu_list,
+                            ::std::vector<int>& cpus) noexcept;
+
+  // Pin current thread to run on given cpus only. Return 0 if success.
+  static int bind_current_thread(const ::std::vector<int>& cpus) noexcept;
+
+ private:
+  ::std::vector<::std::vector<int>> _node_cpus;
+  ::std::vector<size_t> _cpu_node;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// NumaTopology begin
+inline size_t NumaTopology::node_num() const noexcept {
+  return _node_cpus.size();
+}
+
+inline const ::std::vector<int>& NumaTopology::node_cpus(
+    size_t node) const noexcept {
+  return _node_cpus[node];
+}
+// NumaTopology end
+////////////////////////////////////////////////////////////////////////////////
+
+BABYLON_NAMESPACE_END
@@ -1,5 +1,6 @@
 #include "babylon/reusable/page_allocator.h"
 
+
 BABYLON_NAMESPACE_BEGIN
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -247,12 +248,52 @@ void CountingPageAllocator::deallocate(void** pages, size_t num) noexcept {
 // CountingPageAllocator end
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// PageHeap::NodePageAllocator begin
+// 作为节点缓存的上游，在页面真正分配和释放时维护其归属节点
+class PageHeap::NodePageAllocator : public PageAllocator {
+ public:
+  inline void set_node(PageHeap* heap, size_t node) noexcept {
+    _heap = heap;
+    _node = node;
+  }
+
+  virtual size_t page_size() const noexcept override {
+    return _heap->page_size();
+  }
+
+  using PageAllocator::allocate;
+  virtual void allocate(void** pages, size_t num) noexcept override {
+    _heap->upstream().allocate(pages, num);
+    _heap->record_home_node(pages, num, _node);
+  }
+
+  using PageAllocator::deallocate;
+  virtual void deallocate(void** pages, size_t num) noexcept override {
+    _heap->forget_home_node(pages, num);
+    _heap->upstream().deallocate(pages, num);
+  }
+
+ private:
+  PageHeap* _heap {nullptr};
+  size_t _node {0};
+};
+// PageHeap::NodePageAllocator end
+////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // PageHeap begin
+// 按页面地址直接映射的归属节点标签表，每个标签为页面地址，节点号存放在
+// 页面对齐后空闲的低位中。冲突时后记录的页面覆盖之前的标签，丢失标签的页面
+// 按照当前节点处理，因此读写都不需要加锁和分配内存
+static constexpr size_t HOME_NODE_TAG_NUM = 1 << 16;
+
 PageHeap::PageHeap() noexcept {
   _cached_allocator.set_free_page_capacity(1024);
 }
 
+PageHeap::~PageHeap() noexcept = default;
+
 void PageHeap::set_page_size(size_t page_size) noexcept {
   if (page_size == SystemPageAllocator::instance().page_size()) {
     _cached_allocator.set_upstream(SystemPageAllocator::instance());
@@ -260,10 +301,40 @@ void PageHeap::set_page_size(size_t page_size) noexcept {
     _base_allocator.set_page_size(page_size);
     _cached_allocator.set_upstream(_base_allocator);
   }
+  for (size_t i = 0; i < _node_num; ++i) {
+    _node_cached_allocators[i].set_upstream(_node_upstreams[i]);
+  }
 }
 
 void PageHeap::set_free_page_capacity(size_t capacity) noexcept {
   _cached_allocator.set_free_page_capacity(capacity);
+  for (size_t i = 0; i < _node_num; ++i) {
+    _node_cached_allocators[i].set_free_page_capacity(
+        (capacity + _node_num - 1) / _node_num);
+  }
+}
+
+void PageHeap::set_enable_numa_aware(bool enable_numa_aware) noexcept {
+  _node_cached_allocators.reset();
+  _node_upstreams.reset();
+  _home_node_tags.reset();
+  _node_num = 0;
+  if (!enable_numa_aware) {
+    return;
+  }
+  auto node_num = NumaTopology::instance().node_num();
+  _home_node_tags.reset(new ::std::atomic<uintptr_t>[HOME_NODE_TAG_NUM]);
+  for (size_t i = 0; i < HOME_NODE_TAG_NUM; ++i) {
+    _home_node_tags[i].store(0, ::std::memory_order_relaxed);
+  }
+  _node_upstreams.reset(new NodePageAllocator[node_num]);
+  for (size_t i = 0; i < node_num; ++i) {
+    _node_upstreams[i].set_node(this, i);
+  }
+  _node_cached_allocators.reset(new CachedPageAllocator[node_num]);
+  _node_num = node_num;
+  set_page_size(page_size());
+  set_free_page_capacity(_cached_allocator.free_page_capacity());
 }
 
 size_t PageHeap::page_size() const noexcept {
@@ -271,13 +342,38 @@ size_t PageHeap::page_size() const noexcept {
 }
 
 void PageHeap::allocate(void** pages, size_t num) noexcept {
-  _cached_allocator.allocate(pages, num);
+  cached_allocator().allocate(pages, num);
   _allocate_page_num << num;
 }
 
 void PageHeap::deallocate(void** pages, size_t num) noexcept {
-  _cached_allocator.deallocate(pages, num);
   _allocate_page_num << -num;
+  if (_node_num <= 1) {
+    cached_allocator().deallocate(pages, num);
+    return;
+  }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wexit-time-destructors"
+  static thread_local ::std::vector<::std::vector<void*>> batches;
+#pragma GCC diagnostic pop
+
+  // 按归属节点分组归还，而不是归还到当前线程所在节点
+  if (batches.size() < _node_num) {
+    batches.resize(_node_num);
+  }
+  for (size_t i = 0; i < num; ++i) {
+    batches[home_node(pages[i])].emplace_back(pages[i]);
+  }
+  for (size_t node = 0; node < _node_num; ++node) {
+    auto& batch = batches[node];
+    if (!batch.empty()) {
+      _node_cached_allocators[node].deallocate(batch.data(), batch.size());
+      batch.clear();
+    }
+  }
 }
 
 size_t PageHeap::allocate_page_num() const noexcept {
@@ -286,15 +382,38 @@ size_t PageHeap::allocate_page_num() const noexcept {
 }
 
 size_t PageHeap::free_page_num() const noexcept {
+  if (_node_num > 0) {
+    size_t num = 0;
+    for (size_t i = 0; i < _node_num; ++i) {
+      num += _node_cached_allocators[i].free_page_num();
+    }
+    return num;
+  }
   return _cached_allocator.free_page_num();
 }
 
 size_t PageHeap::free_page_capacity() const noexcept {
+  if (_node_num > 0) {
+    size_t capacity = 0;
+    for (size_t i = 0; i < _node_num; ++i) {
+      capacity += _node_cached_allocators[i].free_page_capacity();
+    }
+    return capacity;
+  }
   return _cached_allocator.free_page_capacity();
 }
 
 typename ConcurrentSummer::Summary PageHeap::cache_hit_summary()
     const noexcept {
+  if (_node_num > 0) {
+    ConcurrentSummer::Summary summary {0, 0};
+    for (size_t i = 0; i < _node_num; ++i) {
+      auto node_summary = _node_cached_allocators[i].cache_hit_summary();
+      summary.sum += node_summary.sum;
+      summary.num += node_summary.num;
+    }
+    return summary;
+  }
   return _cached_allocator.cache_hit_summary();
 }
 
@@ -316,6 +435,61 @@ PageHeap::PageHeap(size_t free_page_capacity, size_t page_size) noexcept {
   set_free_page_capacity(free_page_capacity);
   set_page_size(page_size);
 }
+
+// private:
+PageAllocator& PageHeap::upstream() noexcept {
+  if (page_size() == SystemPageAllocator::instance().page_size()) {
+    return SystemPageAllocator::instance();
+  }
+  return _base_allocator;
+}
+
+CachedPageAllocator& PageHeap::cached_allocator() noexcept {
+  if (_node_num > 0) {
+    return _node_cached_allocators[NumaTopology::instance().current_node()];
+  }
+  return _cached_allocator;
+}
+
+::std::atomic<uintptr_t>& PageHeap::home_node_tag(void* page) noexcept {
+  // 页面按照page_size对齐，低位不参与映射
+  auto index = reinterpret_cast<uintptr_t>(page) / page_size();
+  return _home_node_tags[index & (HOME_NODE_TAG_NUM - 1)];
+}
+
+void PageHeap::record_home_node(void** pages, size_t num,
+                                size_t node) noexcept {
+  // 页面对齐的低位放不下节点号时不做记录
+  if (node >= page_size()) {
+    return;
+  }
+  for (size_t i = 0; i < num; ++i) {
+    home_node_tag(pages[i]).store(reinterpret_cast<uintptr_t>(pages[i]) | node,
+                                  ::std::memory_order_relaxed);
+  }
+}
+
+void PageHeap::forget_home_node(void** pages, size_t num) noexcept {
+  auto mask = page_size() - 1;
+  for (size_t i = 0; i < num; ++i) {
+    auto& tag = home_node_tag(pages[i]);
+    auto value = tag.load(::std::memory_order_relaxed);
+    // 标签可能已经被映射到同位置的其他页面覆盖
+    if ((value & ~mask) == reinterpret_cast<uintptr_t>(pages[i])) {
+      tag.compare_exchange_strong(value, 0, ::std::memory_order_relaxed);
+    }
+  }
+}
+
+size_t PageHeap::home_node(void* page) noexcept {
+  auto mask = page_size() - 1;
+  auto value = home_node_tag(page).load(::std::memory_order_relaxed);
+  // 不是经由本PageHeap分配的页面，或者标签已被覆盖，按照当前节点处理
+  if ((value & ~mask) != reinterpret_cast<uintptr_t>(page)) {
+    return NumaTopology::instance().current_node();
+  }
+  return value & mask;
+}
 // PageHeap end
 ////////////////////////////////////////////////////////////////////////////////
 
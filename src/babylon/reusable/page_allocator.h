@@ -3,11 +3,14 @@
 #include "babylon/concurrent/bounded_queue.h" // ConcurrentBoundedQueue
 #include "babylon/concurrent/counter.h"       // ConcurrentAdder
 #include "babylon/environment.h"
+#include "babylon/numa.h"                     // NumaTopology
 
 // clang-format off
 #include "babylon/protect.h"
 // clang-format on
 
+#include <atomic> // std::atomic
+#include <memory> // std::unique_ptr
 #include <vector>
 
 BABYLON_NAMESPACE_BEGIN
@@ -170,6 +173,7 @@ class PageHeap : public PageAllocator {
  public:
   // 可默认构造，不支持拷贝和移动
   PageHeap() noexcept;
+  virtual ~PageHeap() noexcept override;
   PageHeap(PageHeap&&) = delete;
   PageHeap(const PageHeap&) = delete;
   PageHeap& operator=(PageHeap&&) = delete;
@@ -180,6 +184,17 @@ class PageHeap : public PageAllocator {
   void set_page_size(size_t page_size) noexcept;
   void set_free_page_capacity(size_t capacity) noexcept;
 
+  // 开启后按照NumaTopology::instance()为每个NUMA节点维护独立的缓存队列
+  // 缓存容量在节点间均分，分配使用当前线程所在节点的缓存
+  // 页面首次从上游分配时记录所在节点作为归属节点，释放时归还到归属节点的缓存
+  // 因此跨节点传递后释放的页面也不会在节点间漂移
+  // 归属节点按页面地址记录在无锁的定长标签表中，极少数因冲突丢失记录的页面
+  // 按照释放线程所在节点处理
+  // 配合ThreadPoolExecutor的numa aware模式使用时，工作线程被绑定在节点内
+  // 反复使用的页面会保持在本节点上，避免跨节点访存
+  // 需要在使用前完成调整
+  void set_enable_numa_aware(bool enable_numa_aware) noexcept;
+
   // PageAllocator接口实现
   virtual size_t page_size() const noexcept override;
   using PageAllocator::allocate;
@@ -206,8 +221,25 @@ class PageHeap : public PageAllocator {
   PageHeap(size_t max_free_page_num, size_t page_size) noexcept;
 
  private:
+  class NodePageAllocator;
+
+  PageAllocator& upstream() noexcept;
+  CachedPageAllocator& cached_allocator() noexcept;
+
+  // numa aware模式下维护页面的归属节点
+  ::std::atomic<uintptr_t>& home_node_tag(void* page) noexcept;
+  void record_home_node(void** pages, size_t num, size_t node) noexcept;
+  void forget_home_node(void** pages, size_t num) noexcept;
+  size_t home_node(void* page) noexcept;
+
   NewDeletePageAllocator _base_allocator;
   CachedPageAllocator _cached_allocator;
+  // numa aware模式下取代_cached_allocator使用
+  // 缓存释放页面时会访问归属节点记录，因此需要在其之后析构
+  ::std::unique_ptr<::std::atomic<uintptr_t>[]> _home_node_tags;
+  ::std::unique_ptr<NodePageAllocator[]> _node_upstreams;
+  ::std::unique_ptr<CachedPageAllocator[]> _node_cached_allocators;
+  size_t _node_num {0};
   ConcurrentAdder _allocate_page_num;
 };
 
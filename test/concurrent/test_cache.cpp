@@ -0,0 +1,145 @@
+#include "babylon/concurrent/cache.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using ::babylon::ConcurrentCache;
+
+namespace {
+struct CountedKey {
+  CountedKey(size_t value) : value {value} {
+    live_num++;
+  }
+  CountedKey(const CountedKey& other) : value {other.value} {
+    live_num++;
+  }
+  ~CountedKey() {
+    live_num--;
+  }
+  bool operator==(const CountedKey& other) const {
+    return value == other.value;
+  }
+
+  size_t value;
+  static ::std::atomic<ssize_t> live_num;
+};
+::std::atomic<ssize_t> CountedKey::live_num {0};
+
+struct CountedKeyHash {
+  size_t operator()(const CountedKey& key) const {
+    return key.value;
+  }
+};
+} // namespace
+
+TEST(concurrent_cache, capacity_spread_over_shards) {
+  ConcurrentCache<size_t, ::std::string> cache {1000, 10};
+  ASSERT_EQ(16, cache.shard_num());
+  ASSERT_EQ(1008, cache.capacity());
+  ConcurrentCache<size_t, ::std::string> single_shard_cache {100, 1};
+  ASSERT_EQ(1, single_shard_cache.shard_num());
+  ASSERT_EQ(100, single_shard_cache.capacity());
+}
+
+TEST(concurrent_cache, put_get_and_replace) {
+  ConcurrentCache<::std::string, ::std::string> cache {128};
+  ::std::string value;
+  ASSERT_FALSE(cache.get("10086", value));
+  ASSERT_TRUE(cache.put("10086", "10010"));
+  ASSERT_TRUE(cache.get("10086", value));
+  ASSERT_EQ("10010", value);
+  ASSERT_FALSE(cache.put("10086", 3, 'x'));
+  ASSERT_TRUE(cache.find("10086", [&](const ::std::string& cached) {
+    value = cached;
+  }));
+  ASSERT_EQ("xxx", value);
+  ASSERT_EQ(1, cache.size());
+  ASSERT_EQ(2, cache.hit_count());
+  ASSERT_EQ(1, cache.miss_count());
+  ASSERT_EQ(0, cache.eviction_count());
+}
+
+TEST(concurrent_cache, erase_remove_entry) {
+  ConcurrentCache<size_t, size_t> cache {128};
+  cache.put(10086, 10010);
+  ASSERT_TRUE(cache.contains(10086));
+  ASSERT_TRUE(cache.erase(10086));
+  ASSERT_FALSE(cache.erase(10086));
+  ASSERT_FALSE(cache.contains(10086));
+  ASSERT_EQ(0, cache.size());
+  ASSERT_TRUE(cache.put(10086, 10010));
+  ASSERT_EQ(1, cache.size());
+}
+
+TEST(concurrent_cache, erased_key_destroyed_with_cache) {
+  {
+    ConcurrentCache<CountedKey, size_t, CountedKeyHash> cache {128, 1};
+    for (size_t i = 0; i < 64; ++i) {
+      cache.put(CountedKey {i}, i);
+    }
+    for (size_t i = 0; i < 64; i += 2) {
+      ASSERT_TRUE(cache.erase(CountedKey {i}));
+    }
+    ASSERT_EQ(32, cache.size());
+  }
+  ASSERT_EQ(0, CountedKey::live_num.load());
+}
+
+TEST(concurrent_cache, evict_by_clock_when_full) {
+  ConcurrentCache<size_t, size_t> cache {4, 1};
+  for (size_t i = 0; i < 4; ++i) {
+    cache.put(i, i);
+  }
+  // Referenced entries get a second chance
+  size_t value;
+  ASSERT_TRUE(cache.get(0, value));
+  ASSERT_TRUE(cache.get(2, value));
+  cache.put(4, 4);
+  cache.put(5, 5);
+  ASSERT_EQ(4, cache.size());
+  ASSERT_EQ(2, cache.eviction_count());
+  ASSERT_TRUE(cache.contains(0));
+  ASSERT_FALSE(cache.contains(1));
+  ASSERT_TRUE(cache.contains(2));
+  ASSERT_FALSE(cache.contains(3));
+  ASSERT_TRUE(cache.contains(4));
+  ASSERT_TRUE(cache.contains(5));
+}
+
+TEST(concurrent_cache, keep_working_after_many_evictions) {
+  ConcurrentCache<size_t, size_t> cache {256, 4};
+  for (size_t i = 0; i < 100000; ++i) {
+    cache.put(i, i * 2);
+    size_t value;
+    ASSERT_TRUE(cache.get(i, value));
+    ASSERT_EQ(i * 2, value);
+  }
+  ASSERT_EQ(cache.capacity(), cache.size());
+  ASSERT_EQ(100000 - cache.capacity(), cache.eviction_count());
+}
+
+TEST(concurrent_cache, concurrent_get_and_put_correct) {
+  ConcurrentCache<size_t, ::std::string> cache {1024};
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i] {
+      ::std::string value;
+      for (size_t j = 0; j < 20000; ++j) {
+        auto key = (i * 7919 + j) % 4096;
+        if (j % 4 == 0) {
+          cache.put(key, ::std::to_string(key));
+        } else if (cache.get(key, value)) {
+          ASSERT_EQ(::std::to_string(key), value);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_GE(cache.capacity(), cache.size());
+  ASSERT_EQ(8 * 15000, cache.hit_count() + cache.miss_count());
+}
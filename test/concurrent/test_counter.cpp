@@ -5,10 +5,15 @@
 #include <thread>
 
 using ::babylon::ConcurrentAdder;
+using ::babylon::ConcurrentHistogram;
+using ::babylon::ConcurrentHistogramWindow;
 using ::babylon::ConcurrentMaxer;
 using ::babylon::ConcurrentMiner;
 using ::babylon::ConcurrentSampler;
 using ::babylon::ConcurrentSummer;
+using ::babylon::ConcurrentWindowAdder;
+using ::babylon::ConcurrentWindowSummer;
+using ::babylon::ConcurrentWindowTicker;
 
 template <typename T>
 void test_concurrent_adder_caculate_right() {
@@ -397,3 +402,164 @@ TEST(concurrent_sampler, new_capacity_used_after_reset) {
     ASSERT_EQ(50, result.size());
   }
 }
+
+TEST(concurrent_histogram, bucket_cover_all_value_continuously) {
+  ASSERT_EQ(0, ConcurrentHistogram::bucket_index(0));
+  ASSERT_EQ(63, ConcurrentHistogram::bucket_index(63));
+  ASSERT_EQ(ConcurrentHistogram::BUCKET_NUM - 1,
+            ConcurrentHistogram::bucket_index(UINT32_MAX));
+  uint32_t expected_lower_bound = 0;
+  for (size_t i = 0; i < ConcurrentHistogram::BUCKET_NUM; ++i) {
+    auto lower_bound = ConcurrentHistogram::bucket_lower_bound(i);
+    auto upper_bound = ConcurrentHistogram::bucket_upper_bound(i);
+    ASSERT_EQ(expected_lower_bound, lower_bound);
+    ASSERT_LE(lower_bound, upper_bound);
+    ASSERT_EQ(i, ConcurrentHistogram::bucket_index(lower_bound));
+    ASSERT_EQ(i, ConcurrentHistogram::bucket_index(upper_bound));
+    // Relative error no more than 1 / SUB_BUCKET_NUM
+    ASSERT_LE(upper_bound - lower_bound,
+              lower_bound / ConcurrentHistogram::SUB_BUCKET_NUM);
+    expected_lower_bound = upper_bound + 1;
+  }
+  ASSERT_EQ(0, expected_lower_bound);
+}
+
+TEST(concurrent_histogram, percentile_from_multithread) {
+  ConcurrentHistogram histogram;
+  ASSERT_EQ(0, histogram.snapshot().percentile(0.99));
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&, i] {
+      for (uint32_t value = i + 1; value <= 1000; value += 4) {
+        histogram << value;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto snapshot = histogram.snapshot();
+  ASSERT_EQ(1000, snapshot.count());
+  ASSERT_EQ(500500, snapshot.sum());
+  ASSERT_DOUBLE_EQ(500.5, snapshot.average());
+  ASSERT_EQ(1, snapshot.percentile(0));
+  ASSERT_EQ(50, snapshot.percentile(0.05));
+  // 500 in [496, 503], 990 in [976, 991], 999 and 1000 in [992, 1007]
+  ASSERT_EQ(503, snapshot.percentile(0.5));
+  ASSERT_EQ(991, snapshot.percentile(0.99));
+  ASSERT_EQ(1007, snapshot.percentile(0.999));
+  ASSERT_EQ(1007, snapshot.percentile(1));
+}
+
+TEST(concurrent_histogram, snapshot_mergeable) {
+  ConcurrentHistogram a;
+  ConcurrentHistogram b;
+  a << 10;
+  b << 20;
+  b << 30;
+  auto snapshot = a.snapshot();
+  snapshot += b.snapshot();
+  ASSERT_EQ(3, snapshot.count());
+  ASSERT_EQ(60, snapshot.sum());
+  ASSERT_EQ(20, snapshot.percentile(0.5));
+  snapshot -= a.snapshot();
+  ASSERT_EQ(2, snapshot.count());
+  ASSERT_EQ(20, snapshot.percentile(0.5));
+}
+
+TEST(concurrent_histogram, window_keep_recent_ticks) {
+  ConcurrentWindowTicker ticker;
+  ConcurrentHistogram histogram;
+  ConcurrentHistogramWindow window {histogram, 2, ticker};
+  ASSERT_EQ(2, window.window_size());
+  histogram << 1;
+  ticker.tick();
+  histogram << 2;
+  histogram << 2;
+  ticker.tick();
+  ASSERT_EQ(2, window.snapshot(1).count());
+  ASSERT_EQ(3, window.snapshot(2).count());
+  // Window larger than recorded
+  ASSERT_EQ(3, window.snapshot(10).count());
+  histogram << 3;
+  ticker.tick();
+  // Earliest tick is dropped
+  ASSERT_EQ(3, window.snapshot(2).count());
+  ASSERT_EQ(7, window.snapshot(2).sum());
+  ASSERT_EQ(1, window.snapshot(1).count());
+  ASSERT_EQ(0, window.snapshot(0).count());
+}
+
+TEST(concurrent_window_adder, rate_in_recent_ticks) {
+  ConcurrentWindowTicker ticker;
+  ConcurrentWindowAdder adder {3, ticker};
+  ASSERT_EQ(3, adder.window_size());
+  ASSERT_EQ(0, adder.rate(3));
+  ::std::thread a([&] {
+    adder << 10;
+  });
+  ::std::thread b([&] {
+    adder << 20;
+  });
+  a.join();
+  b.join();
+  ticker.tick();
+  adder << 60;
+  ticker.tick();
+  ASSERT_EQ(90, adder.value());
+  ASSERT_EQ(60, adder.value(1));
+  ASSERT_EQ(90, adder.value(2));
+  ASSERT_DOUBLE_EQ(45, adder.rate(2));
+  // Window larger than recorded
+  ASSERT_DOUBLE_EQ(45, adder.rate(10));
+  ticker.tick();
+  ticker.tick();
+  // Earliest tick is dropped
+  ASSERT_EQ(60, adder.value(3));
+  ASSERT_DOUBLE_EQ(20, adder.rate(3));
+}
+
+TEST(concurrent_window_summer, average_and_rate_in_recent_ticks) {
+  ConcurrentWindowTicker ticker;
+  ConcurrentWindowSummer summer {2, ticker};
+  ASSERT_EQ(0, summer.average(2));
+  summer << 10;
+  summer << 20;
+  ticker.tick();
+  summer << 60;
+  ticker.tick();
+  ASSERT_EQ(90, summer.value().sum);
+  ASSERT_EQ(3, summer.value().num);
+  ASSERT_EQ(60, summer.value(1).sum);
+  ASSERT_EQ(1, summer.value(1).num);
+  ASSERT_DOUBLE_EQ(60, summer.average(1));
+  ASSERT_DOUBLE_EQ(30, summer.average(2));
+  ASSERT_DOUBLE_EQ(1.5, summer.rate(2));
+  ticker.tick();
+  ASSERT_DOUBLE_EQ(60, summer.average(2));
+  ASSERT_DOUBLE_EQ(0.5, summer.rate(2));
+}
+
+TEST(concurrent_window_ticker, drive_registered_periodically) {
+  ConcurrentWindowTicker ticker;
+  ConcurrentWindowAdder adder {100, ticker};
+  adder << 1;
+  ticker.start(::std::chrono::milliseconds {10});
+  while (adder.value(100) == 0) {
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds {1});
+  }
+  ticker.stop();
+  {
+    // Unregistered after destroy
+    ConcurrentWindowAdder other {10, ticker};
+  }
+  ticker.tick();
+  ASSERT_EQ(1, adder.value(100));
+}
+
+TEST(concurrent_window_ticker, shared_instance_used_by_default) {
+  ConcurrentWindowAdder adder;
+  ASSERT_EQ(60, adder.window_size());
+  adder << 1;
+  ASSERT_EQ(1, adder.value());
+}
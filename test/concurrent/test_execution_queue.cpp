@@ -3,12 +3,15 @@
 #include "gtest/gtest.h"
 
 #include <future>
+#include <thread>
 
 using ::babylon::AlwaysUseNewThreadExecutor;
 using ::babylon::ConcurrentExecutionQueue;
+using ::babylon::ConcurrentMpscQueue;
 using ::babylon::Executor;
 using ::babylon::InplaceExecutor;
 using ::babylon::MoveOnlyFunction;
+using ::babylon::SchedInterface;
 using Queue = ConcurrentExecutionQueue<::std::string>;
 using Iterator = Queue::Iterator;
 
@@ -92,3 +95,33 @@ TEST(concurrent_execution_queue, execute_fail_when_launch_consumer_error) {
   queue.join();
   ASSERT_TRUE(called);
 }
+
+TEST(concurrent_execution_queue, work_with_mpsc_queue) {
+  using MpscQueue =
+      ConcurrentExecutionQueue<size_t, SchedInterface,
+                               ConcurrentMpscQueue<size_t, SchedInterface>>;
+  using MpscIterator = MpscQueue::Iterator;
+  MpscQueue queue;
+  ::std::atomic<size_t> sum {0};
+  auto ret = queue.initialize(4, AlwaysUseNewThreadExecutor::instance(),
+                              [&](MpscIterator begin, MpscIterator end) {
+                                while (begin != end) {
+                                  sum += *begin++;
+                                }
+                              });
+  ASSERT_EQ(0, ret);
+  ASSERT_EQ(4, queue.capacity());
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      for (size_t j = 0; j < 1000; ++j) {
+        ASSERT_EQ(0, queue.execute(j));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  queue.join();
+  ASSERT_EQ(4 * 999 * 1000 / 2, sum.load());
+}
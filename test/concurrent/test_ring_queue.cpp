@@ -0,0 +1,232 @@
+#include "babylon/concurrent/ring_queue.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using ::babylon::ConcurrentMpscQueue;
+using ::babylon::ConcurrentSpscQueue;
+
+TEST(concurrent_spsc_queue, capacity_ceil_to_pow2) {
+  ConcurrentSpscQueue<::std::string> queue;
+  ASSERT_EQ(1, queue.capacity());
+  ASSERT_EQ(8, queue.reserve_and_clear(5));
+  ConcurrentSpscQueue<::std::string> sized_queue {100};
+  ASSERT_EQ(128, sized_queue.capacity());
+}
+
+TEST(concurrent_spsc_queue, push_pop_with_value_and_callback) {
+  ConcurrentSpscQueue<::std::string> queue {2};
+  queue.push("10086");
+  ASSERT_TRUE(queue.try_push([](::std::string& s) {
+    s = "10010";
+  }));
+  ASSERT_FALSE(queue.try_push("10000"));
+  ASSERT_EQ(2, queue.size());
+  ::std::string s;
+  queue.pop(s);
+  ASSERT_EQ("10086", s);
+  ASSERT_TRUE(queue.try_pop([&](::std::string& value) {
+    s = value;
+  }));
+  ASSERT_EQ("10010", s);
+  ASSERT_FALSE(queue.try_pop(s));
+  ASSERT_EQ(0, queue.size());
+}
+
+TEST(concurrent_spsc_queue, batch_split_when_wrap_around) {
+  using Iterator = ConcurrentSpscQueue<int>::Iterator;
+  ConcurrentSpscQueue<int> queue {4};
+  ::std::vector<int> values {0, 1, 2};
+  queue.push_n(values.begin(), values.end());
+  ::std::vector<int> popped(2);
+  queue.pop_n(popped.begin(), popped.end());
+  ASSERT_EQ((::std::vector<int> {0, 1}), popped);
+
+  ::std::vector<size_t> batches;
+  ASSERT_EQ(3, (queue.try_push_n<false, true>(
+                    [&](Iterator iter, Iterator end) {
+                      batches.push_back(end - iter);
+                      while (iter != end) {
+                        *iter++ = 10;
+                      }
+                    },
+                    10)));
+  ASSERT_EQ((::std::vector<size_t> {1, 2}), batches);
+
+  popped.clear();
+  batches.clear();
+  ASSERT_EQ(4, (queue.try_pop_n<false, true>(
+                    [&](Iterator iter, Iterator end) {
+                      batches.push_back(end - iter);
+                      popped.insert(popped.end(), iter, end);
+                    },
+                    10)));
+  ASSERT_EQ((::std::vector<size_t> {2, 2}), batches);
+  ASSERT_EQ((::std::vector<int> {2, 10, 10, 10}), popped);
+  ASSERT_EQ(0, (queue.try_pop_n<false, true>([](Iterator, Iterator) {}, 10)));
+}
+
+TEST(concurrent_spsc_queue, push_pop_block_and_wakeup) {
+  ConcurrentSpscQueue<::std::string> queue {1};
+  ::std::thread thread([&] {
+    ::std::string s;
+    queue.pop(s);
+    ASSERT_EQ("10086", s);
+    ::usleep(100000);
+    queue.pop(s);
+    ASSERT_EQ("10010", s);
+  });
+  ::usleep(100000);
+  queue.push("10086");
+  queue.push("10010");
+  thread.join();
+  ASSERT_EQ(0, queue.size());
+}
+
+TEST(concurrent_spsc_queue, concurrent_works_fine) {
+  using Iterator = ConcurrentSpscQueue<size_t>::Iterator;
+  ConcurrentSpscQueue<size_t> queue {64};
+  size_t times = 1000000;
+  ::std::thread producer([&] {
+    for (size_t i = 0; i < times; i += 4) {
+      if (i % 8 == 0) {
+        queue.push(i);
+        queue.push<false, false, true>(i + 1);
+        queue.push(i + 2);
+        queue.push(i + 3);
+      } else {
+        size_t value = i;
+        queue.push_n(
+            [&](Iterator iter, Iterator end) {
+              while (iter != end) {
+                *iter++ = value++;
+              }
+            },
+            4);
+      }
+    }
+  });
+  size_t expected = 0;
+  while (expected < times) {
+    if (expected % 3 == 0) {
+      size_t value;
+      queue.pop(value);
+      ASSERT_EQ(expected++, value);
+    } else {
+      queue.pop_n(
+          [&](Iterator iter, Iterator end) {
+            while (iter != end) {
+              ASSERT_EQ(expected++, *iter++);
+            }
+          },
+          ::std::min<size_t>(7, times - expected));
+    }
+  }
+  producer.join();
+  ASSERT_EQ(0, queue.size());
+}
+
+TEST(concurrent_mpsc_queue, push_pop_with_value_and_callback) {
+  ConcurrentMpscQueue<::std::string> queue {2};
+  ASSERT_EQ(2, queue.capacity());
+  queue.push("10086");
+  ASSERT_TRUE(queue.try_push([](::std::string& s) {
+    s = "10010";
+  }));
+  ASSERT_FALSE(queue.try_push("10000"));
+  ASSERT_EQ(2, queue.size());
+  ::std::string s;
+  queue.pop(s);
+  ASSERT_EQ("10086", s);
+  ASSERT_TRUE(queue.try_pop([&](::std::string& value) {
+    s = value;
+  }));
+  ASSERT_EQ("10010", s);
+  ASSERT_FALSE(queue.try_pop(s));
+}
+
+TEST(concurrent_mpsc_queue, batch_split_when_wrap_around) {
+  using Iterator = ConcurrentMpscQueue<int>::Iterator;
+  ConcurrentMpscQueue<int> queue {4};
+  ::std::vector<int> values {0, 1, 2};
+  queue.push_n(values.begin(), values.end());
+  ::std::vector<int> popped(2);
+  queue.pop_n(popped.begin(), popped.end());
+  ASSERT_EQ((::std::vector<int> {0, 1}), popped);
+
+  ::std::vector<size_t> batches;
+  ASSERT_EQ(3, (queue.try_push_n<true, true>(
+                    [&](Iterator iter, Iterator end) {
+                      batches.push_back(end - iter);
+                      while (iter != end) {
+                        *iter++ = 10;
+                      }
+                    },
+                    10)));
+  ASSERT_EQ((::std::vector<size_t> {1, 2}), batches);
+
+  popped.clear();
+  ASSERT_EQ(4, (queue.try_pop_n<false, true>(
+                    [&](Iterator iter, Iterator end) {
+                      while (iter != end) {
+                        popped.push_back(*iter++);
+                      }
+                    },
+                    10)));
+  ASSERT_EQ((::std::vector<int> {2, 10, 10, 10}), popped);
+  ASSERT_EQ(0, (queue.try_pop_n<false, true>([](Iterator, Iterator) {}, 10)));
+}
+
+TEST(concurrent_mpsc_queue, concurrent_works_fine) {
+  using Iterator = ConcurrentMpscQueue<size_t>::Iterator;
+  ConcurrentMpscQueue<size_t> queue {64};
+  size_t producer_num = 4;
+  size_t times = 200000;
+  ::std::vector<::std::thread> producers;
+  for (size_t i = 0; i < producer_num; ++i) {
+    producers.emplace_back([&, i] {
+      for (size_t j = 0; j < times; j += 4) {
+        if (i % 2 == 0) {
+          for (size_t k = 0; k < 4; ++k) {
+            queue.push(j + k);
+          }
+        } else {
+          size_t value = j;
+          queue.push_n(
+              [&](Iterator iter, Iterator end) {
+                while (iter != end) {
+                  *iter++ = value++;
+                }
+              },
+              4);
+        }
+      }
+    });
+  }
+  size_t sum = 0;
+  size_t popped = 0;
+  while (popped < producer_num * times) {
+    if (popped % 2 == 0) {
+      size_t value = 0;
+      queue.pop(value);
+      sum += value;
+      popped++;
+    } else {
+      popped += queue.try_pop_n<false, true>(
+          [&](Iterator iter, Iterator end) {
+            while (iter != end) {
+              sum += *iter++;
+            }
+          },
+          16);
+    }
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  ASSERT_EQ(producer_num * (times - 1) * times / 2, sum);
+  ASSERT_EQ(0, queue.size());
+}
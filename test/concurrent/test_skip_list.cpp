@@ -0,0 +1,174 @@
+#include "babylon/concurrent/skip_list.h"
+#include "babylon/reusable/memory_resource.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+using ::babylon::ConcurrentSkipListMap;
+using ::babylon::SwissMemoryResource;
+
+TEST(concurrent_skip_list, emplace_find_and_erase) {
+  ConcurrentSkipListMap<::std::string, ::std::string> map;
+  ASSERT_FALSE(map.contains("10086"));
+  ASSERT_TRUE(map.emplace("10086", "10010"));
+  ASSERT_FALSE(map.emplace("10086", "10000"));
+  ::std::string value;
+  ASSERT_TRUE(map.find("10086", [&](::std::string& found) {
+    value = found;
+  }));
+  ASSERT_EQ("10010", value);
+  ASSERT_EQ(1, map.size());
+  ASSERT_TRUE(map.erase("10086"));
+  ASSERT_FALSE(map.erase("10086"));
+  ASSERT_FALSE(map.contains("10086"));
+  ASSERT_EQ(0, map.size());
+  ASSERT_TRUE(map.emplace("10086", 3, 'x'));
+  ASSERT_TRUE(map.find("10086", [&](::std::string& found) {
+    value = found;
+  }));
+  ASSERT_EQ("xxx", value);
+}
+
+TEST(concurrent_skip_list, iterate_in_order) {
+  ConcurrentSkipListMap<size_t, size_t> map;
+  ::std::vector<size_t> keys;
+  for (size_t i = 0; i < 1000; ++i) {
+    keys.emplace_back(i * 2);
+  }
+  ::std::shuffle(keys.begin(), keys.end(), ::std::mt19937 {});
+  for (auto key : keys) {
+    ASSERT_TRUE(map.emplace(key, key + 1));
+  }
+  size_t expected = 0;
+  for (auto& pair : map.range()) {
+    ASSERT_EQ(expected, pair.first);
+    ASSERT_EQ(expected + 1, pair.second);
+    expected += 2;
+  }
+  ASSERT_EQ(2000, expected);
+
+  auto range = map.range(101);
+  auto iter = range.begin();
+  ASSERT_EQ(102, iter->first);
+  ASSERT_EQ(104, (++iter)->first);
+
+  ::std::vector<size_t> scanned;
+  ASSERT_EQ(5, map.scan(100, 110, [&](const size_t& key, size_t&) {
+    scanned.emplace_back(key);
+  }));
+  ASSERT_EQ((::std::vector<size_t> {100, 102, 104, 106, 108}), scanned);
+  ASSERT_EQ(0, map.scan(2000, 3000, [](const size_t&, size_t&) {}));
+}
+
+TEST(concurrent_skip_list, range_skip_erased_and_keep_node_valid) {
+  ConcurrentSkipListMap<size_t, ::std::string> map;
+  for (size_t i = 0; i < 10; ++i) {
+    map.emplace(i, ::std::to_string(i));
+  }
+  auto range = map.range();
+  auto iter = range.begin();
+  ASSERT_EQ(0, iter->first);
+  // Current node is kept valid, and erased successor is skipped
+  map.erase(0);
+  map.erase(1);
+  ASSERT_EQ("0", iter->second);
+  ++iter;
+  ASSERT_EQ(2, iter->first);
+  ASSERT_EQ("2", iter->second);
+  // Moved range keep iterators valid
+  auto moved_range = ::std::move(range);
+  ++iter;
+  ASSERT_EQ(3, iter->first);
+  // Begin is fixed when range created, even if erased later
+  ::std::vector<size_t> keys;
+  for (auto& pair : moved_range) {
+    ASSERT_EQ(::std::to_string(pair.first), pair.second);
+    keys.emplace_back(pair.first);
+  }
+  ASSERT_EQ((::std::vector<size_t> {0, 2, 3, 4, 5, 6, 7, 8, 9}), keys);
+}
+
+TEST(concurrent_skip_list, allocate_node_from_memory_resource) {
+  SwissMemoryResource resource;
+  {
+    ConcurrentSkipListMap<size_t, ::std::string> map {resource};
+    for (size_t i = 0; i < 100; ++i) {
+      map.emplace(i, ::std::to_string(i));
+    }
+    for (size_t i = 0; i < 100; i += 2) {
+      ASSERT_TRUE(map.erase(i));
+    }
+    ASSERT_EQ(50, map.size());
+    ASSERT_EQ(50, map.scan(0, 100, [](const size_t& key, ::std::string&) {
+      ASSERT_EQ(1, key % 2);
+    }));
+  }
+  resource.release();
+}
+
+TEST(concurrent_skip_list, concurrent_emplace_erase_and_scan_correct) {
+  ConcurrentSkipListMap<size_t, size_t> map;
+  ::std::atomic<bool> running {true};
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&, i] {
+      for (size_t j = 0; j < 20000; ++j) {
+        auto key = (i * 7919 + j * 31) % 1024;
+        if (j % 2 == 0) {
+          map.emplace(key, key * 3);
+        } else {
+          map.erase(key);
+        }
+      }
+    });
+  }
+  ::std::thread scanner([&] {
+    while (running.load()) {
+      size_t last = 0;
+      bool first = true;
+      for (auto& pair : map.range()) {
+        ASSERT_EQ(pair.first * 3, pair.second);
+        if (!first) {
+          ASSERT_LT(last, pair.first);
+        }
+        last = pair.first;
+        first = false;
+      }
+    }
+  });
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  running = false;
+  scanner.join();
+
+  size_t count = 0;
+  for (size_t key = 0; key < 1024; ++key) {
+    count += map.contains(key);
+  }
+  ASSERT_EQ(count, map.size());
+  ASSERT_EQ(count, map.scan(0, 1024, [](const size_t&, size_t&) {}));
+}
+
+TEST(concurrent_skip_list, concurrent_emplace_same_key_only_one_win) {
+  ConcurrentSkipListMap<size_t, size_t> map;
+  ::std::atomic<size_t> inserted {0};
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i] {
+      for (size_t j = 0; j < 10000; ++j) {
+        if (map.emplace(j, i)) {
+          inserted++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(10000, inserted);
+  ASSERT_EQ(10000, map.size());
+}
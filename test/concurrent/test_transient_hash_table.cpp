@@ -1,11 +1,18 @@
+#include "babylon/concurrent/garbage_collector.h"
 #include "babylon/concurrent/transient_hash_table.h"
 
 #include "gtest/gtest.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
 #include <random>
 #include <thread>
+#include <vector>
 
 using ::babylon::ConcurrentFixedSwissTable;
+using ::babylon::GarbageCollector;
 using ::babylon::ConcurrentTransientHashMap;
 using ::babylon::ConcurrentTransientHashSet;
 
@@ -142,6 +149,50 @@ TEST(fixed_swiss_table, find_item_insert_before) {
   ASSERT_EQ(1, table.count("10086"));
 }
 
+TEST(fixed_swiss_table, batch_find_and_emplace_same_as_one_by_one) {
+  ConcurrentFixedSwissTable<size_t> table {64};
+  ::std::vector<size_t> keys;
+  for (size_t i = 0; i < 40; ++i) {
+    keys.emplace_back(i * 3);
+  }
+  table.emplace(keys[7]);
+  ::std::vector<size_t> inserted;
+  table.emplace_batch(keys.data(), keys.size(), [&](size_t i, auto result) {
+    ASSERT_NE(table.end(), result.first);
+    ASSERT_EQ(keys[i], *result.first);
+    if (result.second) {
+      inserted.emplace_back(i);
+    }
+  });
+  ASSERT_EQ(39, inserted.size());
+  ASSERT_EQ(40, table.size());
+
+  keys.emplace_back(10086);
+  size_t visited = 0;
+  table.find_batch(keys.data(), keys.size(), [&](size_t i, auto iter) {
+    ASSERT_EQ(visited++, i);
+    if (keys[i] == 10086) {
+      ASSERT_EQ(table.end(), iter);
+    } else {
+      ASSERT_EQ(table.find(keys[i]), iter);
+    }
+  });
+  ASSERT_EQ(41, visited);
+
+  // 表满时和逐个插入一样返回失败
+  ::std::vector<size_t> more_keys;
+  for (size_t i = 1000; i < 1100; ++i) {
+    more_keys.emplace_back(i);
+  }
+  size_t failed = 0;
+  table.emplace_batch(more_keys.data(), more_keys.size(),
+                      [&](size_t, auto result) {
+                        failed += result.first == table.end();
+                      });
+  ASSERT_EQ(64, table.size());
+  ASSERT_EQ(100 - (64 - 40), failed);
+}
+
 TEST(fixed_swiss_table, empty_table_iterable_but_get_nothing) {
   {
     ConcurrentFixedSwissTable<::std::string> table;
@@ -284,6 +335,309 @@ TEST(fixed_swiss_table, rehash_can_shrink) {
   ASSERT_EQ(expected, sum);
 }
 
+TEST(fixed_swiss_table, erase_reclaim_value_through_gc) {
+  using Table = ConcurrentFixedSwissTable<::std::string>;
+  Table table {16};
+  GarbageCollector<Table::Reclaimer> gc;
+  table.emplace("10086");
+  table.emplace("10010");
+  auto accessor = gc.epoch().create_accessor();
+  gc.start();
+  {
+    ::std::lock_guard<::babylon::Epoch::Accessor> lock {accessor};
+    auto iter = table.find("10086");
+    ASSERT_NE(table.end(), iter);
+    ASSERT_EQ(1, table.erase("10086", gc));
+    ASSERT_EQ(0, table.erase("10086", gc));
+    ASSERT_EQ(table.end(), table.find("10086"));
+    ASSERT_EQ(1, table.size());
+    // 临界区内删除的元素依然可以访问，也不会被compact清理
+    ::usleep(100000);
+    ASSERT_EQ("10086", *iter);
+    ASSERT_EQ(0, table.compact());
+  }
+  gc.stop();
+  ASSERT_EQ(1, table.compact());
+  size_t count = 0;
+  for (auto& value : table) {
+    ASSERT_EQ("10010", value);
+    ++count;
+  }
+  ASSERT_EQ(1, count);
+}
+
+TEST(fixed_swiss_table, compact_make_erased_slot_usable_again) {
+  using Table = ConcurrentFixedSwissTable<::std::string>;
+  Table table {64};
+  {
+    GarbageCollector<Table::Reclaimer> gc;
+    gc.set_queue_capacity(64);
+    gc.start();
+    for (size_t i = 0; i < 48; ++i) {
+      ASSERT_TRUE(table.emplace(::std::to_string(i)).second);
+    }
+    for (size_t i = 0; i < 48; i += 2) {
+      ASSERT_EQ(1, table.erase(::std::to_string(i), gc));
+    }
+    gc.stop();
+  }
+  ASSERT_EQ(24, table.size());
+  // 墓碑优先被复用，但插入依然需要路径末尾存在空位
+  // 因此至少可以用满剩余的空位
+  size_t inserted = 0;
+  while (table.emplace(::std::to_string(inserted + 100)).second) {
+    inserted++;
+  }
+  ASSERT_LE(16, inserted);
+  ASSERT_GE(40, inserted);
+  // 表满时全部墓碑都处于探测链中，无法清理
+  ASSERT_EQ(0, table.compact());
+  table.rehash(table.bucket_count() * 2);
+  ASSERT_EQ(24 + inserted, table.size());
+  ASSERT_TRUE(table.emplace("10086").second);
+  for (size_t i = 1; i < 48; i += 2) {
+    ASSERT_TRUE(table.contains(::std::to_string(i)));
+  }
+}
+
+TEST(fixed_swiss_table, emplace_reuse_reclaimed_slot) {
+  using Table = ConcurrentFixedSwissTable<::std::string>;
+  // 只有一个组，所有key的探测路径相同
+  Table table {16};
+  {
+    GarbageCollector<Table::Reclaimer> gc;
+    gc.start();
+    for (size_t i = 0; i < 15; ++i) {
+      ASSERT_TRUE(table.emplace(::std::to_string(i)).second);
+    }
+    for (size_t i = 0; i < 15; i += 2) {
+      ASSERT_EQ(1, table.erase(::std::to_string(i), gc));
+    }
+    gc.stop();
+  }
+  ASSERT_EQ(7, table.size());
+  // 8个墓碑全部被复用，唯一的空位保留下来
+  for (size_t i = 0; i < 8; ++i) {
+    ASSERT_TRUE(table.emplace(::std::to_string(i + 100)).second);
+  }
+  ASSERT_FALSE(table.emplace("107").second);
+  ASSERT_TRUE(table.emplace("10086").second);
+  ASSERT_EQ(table.end(), table.emplace("10010").first);
+  ASSERT_EQ(16, table.size());
+  for (size_t i = 1; i < 15; i += 2) {
+    ASSERT_TRUE(table.contains(::std::to_string(i)));
+  }
+  for (size_t i = 0; i < 8; ++i) {
+    ASSERT_TRUE(table.contains(::std::to_string(i + 100)));
+  }
+}
+
+TEST(fixed_swiss_table, concurrent_emplace_reuse_reclaimed_slot_only_once) {
+  using Table = ConcurrentFixedSwissTable<size_t>;
+  Table table {1024};
+  GarbageCollector<Table::Reclaimer> gc;
+  gc.set_queue_capacity(1024);
+  gc.start();
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i] {
+      for (size_t j = 0; j < 4096; ++j) {
+        ::std::lock_guard<::babylon::Epoch> lock {gc.epoch()};
+        // 两两线程插入相同的key，同时有其他线程删除制造墓碑
+        auto key = (i / 2 * 7 + j) % 512;
+        if (i % 4 == 3) {
+          table.erase(key, gc);
+        } else {
+          table.emplace(key);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  gc.stop();
+  ::std::vector<size_t> values;
+  for (auto value : table) {
+    values.push_back(value);
+  }
+  ASSERT_EQ(values.size(), table.size());
+  ::std::sort(values.begin(), values.end());
+  ASSERT_EQ(values.end(), ::std::unique(values.begin(), values.end()));
+}
+
+TEST(fixed_swiss_table, compact_keep_probe_chain_unbroken) {
+  using Table = ConcurrentFixedSwissTable<size_t>;
+  Table table {4096};
+  GarbageCollector<Table::Reclaimer> gc;
+  gc.set_queue_capacity(1024);
+  gc.start();
+  ::std::mt19937 gen(::std::random_device {}());
+  ::std::vector<size_t> keys;
+  for (size_t i = 0; i < 1024; ++i) {
+    keys.push_back(gen());
+  }
+  for (size_t round = 0; round < 64; ++round) {
+    for (auto key : keys) {
+      table.emplace(key);
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (gen() % 2 == 0) {
+        ASSERT_EQ(1, table.erase(keys[i], gc));
+        keys[i] = gen();
+      }
+    }
+    gc.stop();
+    table.compact();
+    gc.start();
+    for (auto key : keys) {
+      ASSERT_TRUE(table.contains(key) || table.emplace(key).second);
+    }
+    for (auto key : keys) {
+      ASSERT_TRUE(table.contains(key));
+    }
+  }
+  ASSERT_EQ(keys.size(), table.size());
+}
+
+TEST(fixed_swiss_table, dump_and_load_mmap) {
+  auto file_name = "swiss_table_" + ::std::to_string(::getpid());
+  {
+    using Table = ConcurrentFixedSwissTable<
+        ::std::pair<const uint64_t, uint32_t>, ::std::hash<uint64_t>,
+        ::babylon::internal::concurrent_transient_hash_table::
+            PairKeyExtractor<uint64_t, uint32_t>>;
+    Table table {1024};
+    for (uint64_t i = 0; i < 1000; ++i) {
+      table.emplace(i * 7, static_cast<uint32_t>(i));
+    }
+    ASSERT_EQ(0, table.dump(file_name.c_str()));
+
+    Table loaded;
+    ASSERT_EQ(0, loaded.load_mmap(file_name.c_str()));
+    ASSERT_EQ(1000, loaded.size());
+    ASSERT_EQ(1024, loaded.bucket_count());
+    for (uint64_t i = 0; i < 1000; ++i) {
+      auto iter = loaded.find(i * 7);
+      ASSERT_NE(loaded.end(), iter);
+      ASSERT_EQ(i, iter->second);
+      ASSERT_FALSE(loaded.contains(i * 7 + 1));
+    }
+    size_t count = 0;
+    for (auto& pair : loaded) {
+      ASSERT_EQ(pair.first, pair.second * 7);
+      count++;
+    }
+    ASSERT_EQ(1000, count);
+
+    // 映射表上的修改直接失败，不会写入只读映射
+    ASSERT_EQ(loaded.end(), loaded.emplace(10086UL, 10010U).first);
+    uint64_t batch_keys[] = {7, 10086};
+    size_t batch_failed = 0;
+    loaded.emplace_batch(batch_keys, 2,
+                         [&](size_t, ::std::pair<Table::iterator, bool> r) {
+                           batch_failed += r.first == loaded.end() ? 1 : 0;
+                         });
+    ASSERT_EQ(2, batch_failed);
+    {
+      GarbageCollector<Table::Reclaimer> gc;
+      ASSERT_EQ(0, loaded.erase(7UL, gc));
+    }
+    ASSERT_EQ(0, loaded.compact());
+    ASSERT_TRUE(loaded.contains(7UL));
+    ASSERT_EQ(1000, loaded.size());
+
+    // 复制出普通的表后可以继续修改
+    Table copied {loaded};
+    ASSERT_TRUE(copied.emplace(10086UL, 10010U).second);
+    ASSERT_EQ(1001, copied.size());
+    // clear后重建为普通的表
+    loaded.clear();
+    ASSERT_EQ(0, loaded.size());
+    ASSERT_EQ(1024, loaded.bucket_count());
+    ASSERT_TRUE(loaded.emplace(10086UL, 10010U).second);
+  }
+  {
+    // 元素类型或哈希函数不一致时拒绝加载
+    struct BadHash {
+      size_t operator()(uint64_t value) const noexcept {
+        return value + 1;
+      }
+    };
+    ConcurrentFixedSwissTable<uint64_t, BadHash> bad_hash_table;
+    ASSERT_NE(0, bad_hash_table.load_mmap(file_name.c_str()));
+    ASSERT_EQ(EINVAL, errno);
+    ConcurrentFixedSwissTable<uint32_t> bad_type_table;
+    ASSERT_NE(0, bad_type_table.load_mmap(file_name.c_str()));
+    ASSERT_EQ(EINVAL, errno);
+    ASSERT_NE(0, bad_type_table.load_mmap("not_exist_file"));
+    ASSERT_EQ(ENOENT, errno);
+  }
+  ::unlink(file_name.c_str());
+}
+
+TEST(hash_set, erase_and_compact_last_table) {
+  using Set = ConcurrentTransientHashSet<::std::string>;
+  Set set {16};
+  for (size_t i = 0; i < 64; ++i) {
+    set.emplace(::std::to_string(i));
+  }
+  ASSERT_EQ(64, set.size());
+  {
+    GarbageCollector<Set::Reclaimer> gc;
+    gc.set_queue_capacity(64);
+    gc.start();
+    for (size_t i = 0; i < 64; ++i) {
+      ASSERT_EQ(1, set.erase(::std::to_string(i), gc));
+    }
+    ASSERT_EQ(0, set.erase("10086", gc));
+    gc.stop();
+  }
+  ASSERT_EQ(0, set.size());
+  ASSERT_TRUE(set.empty());
+  ASSERT_EQ(set.end(), set.begin());
+  ASSERT_LT(0, set.compact());
+  set.clear();
+  ASSERT_TRUE(set.emplace("10086").second);
+  ASSERT_EQ(1, set.size());
+}
+
+TEST(hash_map, concurrent_erase_and_find_correct) {
+  using Map = ConcurrentTransientHashMap<size_t, ::std::string>;
+  Map map {4096};
+  GarbageCollector<::std::function<void()>> gc;
+  gc.set_queue_capacity(8192);
+  gc.start();
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i] {
+      for (size_t j = 0; j < 1024; ++j) {
+        ::std::lock_guard<::babylon::Epoch> lock {gc.epoch()};
+        auto key = (i / 2 * 1024 + j) % 2048;
+        if (i % 2 == 0) {
+          map.emplace(key, ::std::to_string(key));
+        } else {
+          map.erase(key, gc);
+        }
+        auto iter = map.find(key);
+        if (iter != map.end()) {
+          ASSERT_EQ(::std::to_string(key), iter->second);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  gc.stop();
+  size_t count = 0;
+  for (auto& pair : map) {
+    ASSERT_EQ(::std::to_string(pair.first), pair.second);
+    ++count;
+  }
+  ASSERT_EQ(count, map.size());
+}
+
 TEST(hash_set, default_constructible) {
   ConcurrentTransientHashSet<::std::string> set;
   ASSERT_LT(0, set.bucket_count());
@@ -414,6 +768,126 @@ TEST(hash_set, concurrent_emplace_and_find_correct) {
   ASSERT_EQ(expected, sum);
 }
 
+TEST(hash_set, migrate_to_later_table_when_enabled) {
+  ConcurrentTransientHashSet<::std::string> set {16};
+  set.set_migration_step(1);
+  auto& first = *set.emplace("0").first;
+  for (size_t i = 1; i < 1000; ++i) {
+    set.emplace(::std::to_string(i));
+  }
+  // 反复查找推动迁移完成，迁移前获取的引用依然有效
+  for (size_t round = 0; round < 8; ++round) {
+    for (size_t i = 0; i < 1000; ++i) {
+      ASSERT_TRUE(set.contains(::std::to_string(i)));
+    }
+  }
+  ASSERT_EQ("0", first);
+  ASSERT_NE(&first, &*set.find("0"));
+  // 完成迁移的子表被摘除，恢复到单表查找
+  ASSERT_LE(1000, set.bucket_count());
+  ASSERT_EQ(1000, set.size());
+  size_t sum = 0;
+  size_t count = 0;
+  for (auto& value : set) {
+    sum += ::std::stoul(value);
+    ++count;
+  }
+  ASSERT_EQ(1000, count);
+  ASSERT_EQ(999 * 1000 / 2, sum);
+  set.clear();
+  ASSERT_TRUE(set.empty());
+  ASSERT_TRUE(set.emplace("10086").second);
+}
+
+TEST(hash_set, concurrent_emplace_and_find_correct_when_migrating) {
+  ConcurrentTransientHashSet<::std::string> set {16};
+  set.set_migration_step(2);
+  ::std::vector<::std::thread> threads;
+  threads.reserve(32);
+  for (size_t i = 0; i < 32; ++i) {
+    threads.emplace_back([&, i] {
+      for (size_t j = 0; j < 256; ++j) {
+        set.emplace(::std::to_string(i * 256 + j));
+        for (size_t k = 0; k <= j; k += 16) {
+          ASSERT_TRUE(set.contains(::std::to_string(i * 256 + k)));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(32 * 256, set.size());
+  size_t sum = 0;
+  size_t count = 0;
+  for (auto& value : set) {
+    sum += ::std::stoul(value);
+    ++count;
+  }
+  ASSERT_EQ(32 * 256, count);
+  ASSERT_EQ((32 * 256 - 1) * 32 * 256 / 2, sum);
+}
+
+TEST(hash_map, erase_correct_when_migrating) {
+  using Map = ConcurrentTransientHashMap<size_t, ::std::string>;
+  Map map {16};
+  map.set_migration_step(1);
+  GarbageCollector<Map::Reclaimer> gc;
+  gc.set_queue_capacity(1024);
+  gc.start();
+  for (size_t i = 0; i < 1024; ++i) {
+    ::std::lock_guard<::babylon::Epoch> lock {gc.epoch()};
+    map.emplace(i, ::std::to_string(i));
+    if (i % 2 == 0) {
+      ASSERT_EQ(1, map.erase(i / 2, gc));
+    }
+  }
+  gc.stop();
+  ASSERT_EQ(512, map.size());
+  for (size_t i = 0; i < 1024; ++i) {
+    ASSERT_EQ(i >= 512, map.contains(i));
+  }
+}
+
+TEST(hash_map, retired_table_released_through_gc_when_migrating) {
+  static ::std::atomic<ssize_t> alive {0};
+  struct S {
+    S() noexcept {
+      ++alive;
+    }
+    S(const S&) noexcept {
+      ++alive;
+    }
+    ~S() noexcept {
+      --alive;
+    }
+  };
+  using Map = ConcurrentTransientHashMap<size_t, S>;
+  GarbageCollector<Map::Reclaimer> gc;
+  gc.set_queue_capacity(1024);
+  gc.start();
+  {
+    Map map {16};
+    map.set_migration_step(1, gc);
+    for (size_t i = 0; i < 1000; ++i) {
+      ::std::lock_guard<::babylon::Epoch> lock {gc.epoch()};
+      map.emplace(i);
+    }
+    for (size_t round = 0; round < 8; ++round) {
+      for (size_t i = 0; i < 1000; ++i) {
+        ::std::lock_guard<::babylon::Epoch> lock {gc.epoch()};
+        ASSERT_TRUE(map.contains(i));
+      }
+    }
+    ASSERT_LE(1000, map.bucket_count());
+    // 子表中迁移留下的旧副本随子表一起经由gc释放
+    gc.stop();
+    ASSERT_EQ(1000, alive);
+    ASSERT_EQ(1000, map.size());
+  }
+  ASSERT_EQ(0, alive);
+}
+
 TEST(hash_map, default_constructible) {
   ConcurrentTransientHashMap<::std::string, ::std::string> map;
   ASSERT_LT(0, map.bucket_count());
@@ -473,6 +947,38 @@ TEST(hash_map, support_brackets_operator) {
   ASSERT_EQ(&value, &map["10086"]);
 }
 
+TEST(hash_map, batch_find_and_emplace_expand_when_full) {
+  ConcurrentTransientHashMap<::std::string, size_t> map {16};
+  ::std::vector<::std::string> keys;
+  for (size_t i = 0; i < 100; ++i) {
+    keys.emplace_back(::std::to_string(i));
+  }
+  size_t inserted = 0;
+  map.emplace_batch(keys.data(), keys.size(), [&](size_t i, auto result) {
+    ASSERT_NE(map.end(), result.first);
+    ASSERT_EQ(keys[i], result.first->first);
+    ASSERT_EQ(0, result.first->second);
+    result.first->second = i;
+    inserted += result.second;
+  });
+  ASSERT_EQ(100, inserted);
+  ASSERT_EQ(100, map.size());
+
+  keys.emplace_back("10086");
+  map.find_batch(keys.data(), keys.size(), [&](size_t i, auto iter) {
+    if (i < 100) {
+      ASSERT_NE(map.end(), iter);
+      ASSERT_EQ(i, iter->second);
+    } else {
+      ASSERT_EQ(map.end(), iter);
+    }
+  });
+  map.emplace_batch(keys.data(), keys.size(), [&](size_t i, auto result) {
+    ASSERT_EQ(i == 100, result.second);
+  });
+  ASSERT_EQ(101, map.size());
+}
+
 TEST(hash_map, support_non_copyable_nor_moveable_emplace) {
   struct S {
     S() = default;
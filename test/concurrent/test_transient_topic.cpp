@@ -4,6 +4,7 @@
 
 #include <future>
 #include <thread>
+#include <vector>
 
 using ::babylon::ConcurrentTransientTopic;
 
@@ -211,3 +212,88 @@ TEST(concurrent_transient_topic, support_concurrent_publish_consume) {
     ASSERT_EQ(expect_sum, sum.load(::std::memory_order_relaxed));
   }
 }
+
+TEST(concurrent_transient_topic, consumer_group_share_progress) {
+  ConcurrentTransientTopic<::std::string> topic;
+  auto consumer = topic.subscribe();
+  auto group = topic.subscribe_group();
+  ASSERT_TRUE(group);
+  topic.publish("1");
+  topic.publish("2");
+  topic.publish("3");
+  ASSERT_EQ("1", *group.consume());
+  // Only published items are claimed, not waiting for full batch
+  auto range = group.consume(10);
+  ASSERT_EQ(2, range.size());
+  ASSERT_EQ("2", range[0]);
+  ASSERT_EQ("3", range[1]);
+  topic.close();
+  ASSERT_EQ(nullptr, group.consume());
+  ASSERT_EQ(0, group.consume(2).size());
+  // Broadcast consumer still see all items
+  ASSERT_EQ(3, consumer.consume(10).size());
+}
+
+TEST(concurrent_transient_topic, consumer_group_consume_zero_claim_nothing) {
+  ConcurrentTransientTopic<::std::string> topic;
+  auto group = topic.subscribe_group();
+  topic.publish("1");
+  ASSERT_EQ(0, group.consume(0).size());
+  // Shared progress is not moved
+  ASSERT_EQ("1", *group.consume());
+  topic.close();
+  ASSERT_EQ(0, group.consume(0).size());
+  ASSERT_EQ(nullptr, group.consume());
+}
+
+TEST(concurrent_transient_topic, consumer_group_consume_each_item_once) {
+  ConcurrentTransientTopic<size_t> topic;
+
+  size_t publish_concurrents = 8;
+  size_t publish_times = 10000;
+  size_t consume_concurrents = 4;
+  size_t total = publish_concurrents * publish_times;
+
+  auto group = topic.subscribe_group();
+  ::std::vector<::std::atomic<size_t>> hits(total);
+  ::std::atomic<size_t> broadcast_sum(0);
+
+  ::std::vector<::std::thread> consume_threads;
+  for (size_t i = 0; i < consume_concurrents; ++i) {
+    consume_threads.emplace_back([&, i] {
+      for (auto range = group.consume(i + 1); range.size() > 0;
+           range = group.consume(i + 1)) {
+        for (size_t j = 0; j < range.size(); ++j) {
+          hits[range[j]].fetch_add(1, ::std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  consume_threads.emplace_back([&] {
+    auto consumer = topic.subscribe();
+    for (auto value = consumer.consume(); value != nullptr;
+         value = consumer.consume()) {
+      broadcast_sum.fetch_add(*value, ::std::memory_order_relaxed);
+    }
+  });
+
+  ::std::vector<::std::thread> publish_threads;
+  for (size_t i = 0; i < publish_concurrents; ++i) {
+    publish_threads.emplace_back([&, i] {
+      for (size_t j = 0; j < publish_times; ++j) {
+        topic.publish(i * publish_times + j);
+      }
+    });
+  }
+  for (auto& thread : publish_threads) {
+    thread.join();
+  }
+  topic.close();
+  for (auto& thread : consume_threads) {
+    thread.join();
+  }
+  for (auto& hit : hits) {
+    ASSERT_EQ(1, hit.load(::std::memory_order_relaxed));
+  }
+  ASSERT_EQ(total * (total - 1) / 2, broadcast_sum.load());
+}
@@ -0,0 +1,228 @@
+#include "babylon/concurrent/unbounded_queue.h"
+#include "babylon/move_only_function.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using ::babylon::ConcurrentUnboundedQueue;
+using ::babylon::GarbageCollector;
+using ::babylon::MoveOnlyFunction;
+
+TEST(concurrent_unbounded_queue, segment_size_ceil_to_pow2) {
+  ConcurrentUnboundedQueue<::std::string> queue;
+  ASSERT_EQ(1024, queue.segment_size());
+  ConcurrentUnboundedQueue<::std::string> sized_queue {100};
+  ASSERT_EQ(128, sized_queue.segment_size());
+}
+
+TEST(concurrent_unbounded_queue, slots_are_packed) {
+  using Iterator = ConcurrentUnboundedQueue<int>::Iterator;
+  ConcurrentUnboundedQueue<int> queue {4};
+  queue.push_n(
+      [](Iterator iter, Iterator end) {
+        ASSERT_EQ(4, end - iter);
+        ASSERT_GT(BABYLON_CACHELINE_SIZE,
+                  reinterpret_cast<char*>(&*(iter + 1)) -
+                      reinterpret_cast<char*>(&*iter));
+        while (iter != end) {
+          *iter++ = 0;
+        }
+      },
+      4);
+}
+
+TEST(concurrent_unbounded_queue, push_pop_with_value_and_callback) {
+  ConcurrentUnboundedQueue<::std::string> queue;
+  queue.push("10086");
+  queue.push([](::std::string& s) {
+    s = "10010";
+  });
+  ASSERT_EQ(2, queue.size());
+  ::std::string s;
+  queue.pop(s);
+  ASSERT_EQ("10086", s);
+  queue.pop([&](::std::string& value) {
+    s = value;
+  });
+  ASSERT_EQ("10010", s);
+  ASSERT_EQ(0, queue.size());
+}
+
+TEST(concurrent_unbounded_queue, push_never_block_across_segments) {
+  ConcurrentUnboundedQueue<int> queue {4};
+  for (int i = 0; i < 100; ++i) {
+    queue.push<false, false>(i);
+  }
+  ASSERT_EQ(100, queue.size());
+  for (int i = 0; i < 100; ++i) {
+    int value = -1;
+    ASSERT_TRUE(queue.try_pop<false>(value));
+    ASSERT_EQ(i, value);
+  }
+  int value = -1;
+  ASSERT_FALSE(queue.try_pop(value));
+}
+
+TEST(concurrent_unbounded_queue, batch_split_by_segment) {
+  using Iterator = ConcurrentUnboundedQueue<int>::Iterator;
+  ConcurrentUnboundedQueue<int> queue {4};
+  ::std::vector<int> values;
+  for (int i = 0; i < 10; ++i) {
+    values.push_back(i);
+  }
+  queue.push_n(values.begin(), values.end());
+  ::std::vector<size_t> batches;
+  queue.push_n(
+      [&](Iterator iter, Iterator end) {
+        batches.push_back(end - iter);
+        while (iter != end) {
+          *iter++ = 10;
+        }
+      },
+      5);
+  ASSERT_EQ((::std::vector<size_t> {2, 3}), batches);
+
+  ::std::vector<int> popped(7);
+  queue.pop_n(popped.begin(), popped.end());
+  ASSERT_EQ((::std::vector<int> {0, 1, 2, 3, 4, 5, 6}), popped);
+  popped.clear();
+  ASSERT_EQ(8, queue.try_pop_n<true>(
+                   [&](Iterator iter, Iterator end) {
+                     while (iter != end) {
+                       popped.push_back(*iter++);
+                     }
+                   },
+                   100));
+  ASSERT_EQ((::std::vector<int> {7, 8, 9, 10, 10, 10, 10, 10}), popped);
+  ASSERT_EQ(0, queue.try_pop_n<true>([](Iterator, Iterator) {}, 100));
+}
+
+TEST(concurrent_unbounded_queue, pop_block_until_push) {
+  ConcurrentUnboundedQueue<::std::string> queue;
+  ::std::thread thread([&] {
+    ::std::string s;
+    queue.pop(s);
+    ASSERT_EQ("10086", s);
+  });
+  ::usleep(100000);
+  queue.push("10086");
+  thread.join();
+}
+
+TEST(concurrent_unbounded_queue, clear_drop_all) {
+  ConcurrentUnboundedQueue<int> queue {2};
+  for (int i = 0; i < 10; ++i) {
+    queue.push(i);
+  }
+  queue.clear();
+  ASSERT_EQ(0, queue.size());
+  int value = -1;
+  ASSERT_FALSE(queue.try_pop(value));
+  queue.push(10086);
+  ASSERT_TRUE(queue.try_pop(value));
+  ASSERT_EQ(10086, value);
+}
+
+TEST(concurrent_unbounded_queue, concurrent_works_fine) {
+  using Iterator = ConcurrentUnboundedQueue<size_t>::Iterator;
+  ConcurrentUnboundedQueue<size_t> queue {16};
+  size_t producer_num = 4;
+  size_t consumer_num = 4;
+  size_t times = 100000;
+
+  ::std::atomic<size_t> sum {0};
+  ::std::atomic<size_t> popped {0};
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < producer_num; ++i) {
+    threads.emplace_back([&, i] {
+      for (size_t j = 0; j < times; j += 4) {
+        if (i % 2 == 0) {
+          for (size_t k = 0; k < 4; ++k) {
+            queue.push(j + k);
+          }
+        } else {
+          size_t value = j;
+          queue.push_n(
+              [&](Iterator iter, Iterator end) {
+                while (iter != end) {
+                  *iter++ = value++;
+                }
+              },
+              4);
+        }
+      }
+    });
+  }
+  for (size_t i = 0; i < consumer_num; ++i) {
+    threads.emplace_back([&, i] {
+      size_t local_sum = 0;
+      size_t local_popped = 0;
+      while (local_popped < times) {
+        if (i % 3 == 0) {
+          size_t value;
+          queue.pop(value);
+          local_sum += value;
+          local_popped++;
+        } else if (i % 3 == 1) {
+          queue.pop_n(
+              [&](Iterator iter, Iterator end) {
+                while (iter != end) {
+                  local_sum += *iter++;
+                  local_popped++;
+                }
+              },
+              2);
+        } else {
+          size_t value;
+          if (queue.try_pop(value)) {
+            local_sum += value;
+            local_popped++;
+          }
+        }
+      }
+      sum += local_sum;
+      popped += local_popped;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(producer_num * times, popped.load());
+  ASSERT_EQ(producer_num * (times - 1) * times / 2, sum.load());
+  ASSERT_EQ(0, queue.size());
+}
+
+TEST(concurrent_unbounded_queue, share_garbage_collector) {
+  // Queues of different types share gc through MoveOnlyFunction
+  GarbageCollector<MoveOnlyFunction<void(void)>> gc;
+  gc.start();
+  {
+    ConcurrentUnboundedQueue<int> int_queue {4, gc};
+    ConcurrentUnboundedQueue<::std::string> string_queue {4, gc};
+    for (int i = 0; i < 100; ++i) {
+      int_queue.push(i);
+      string_queue.push(::std::to_string(i));
+    }
+    for (int i = 0; i < 100; ++i) {
+      int value = -1;
+      int_queue.pop(value);
+      ASSERT_EQ(i, value);
+      ::std::string s;
+      string_queue.pop(s);
+      ASSERT_EQ(::std::to_string(i), s);
+    }
+    ASSERT_EQ(0, int_queue.size());
+    ASSERT_EQ(0, string_queue.size());
+  }
+  // Destructor wait retired segments back, and gc keep serving later queues
+  ConcurrentUnboundedQueue<int> queue {4, gc};
+  for (int i = 0; i < 100; ++i) {
+    queue.push(i);
+    int value = -1;
+    queue.pop(value);
+    ASSERT_EQ(i, value);
+  }
+}
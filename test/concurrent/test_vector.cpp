@@ -2,7 +2,9 @@
 
 #include <gtest/gtest.h>
 
+#include <iterator>
 #include <thread>
+#include <vector>
 
 using ::babylon::ConcurrentVector;
 
@@ -224,3 +226,67 @@ TEST(concurrent_vector, support_concurret_access_and_extend) {
     }
   }
 }
+
+TEST(concurrent_vector, append_claim_continuous_index) {
+  ConcurrentVector<::std::string> vector(4);
+  ASSERT_EQ(0, vector.appended_size());
+  ASSERT_EQ(0, vector.emplace_back("10086"));
+  ASSERT_EQ(1, vector.emplace_back(3, 'x'));
+  ::std::vector<::std::string> data = {"0", "1", "2", "3", "4", "5"};
+  ASSERT_EQ(2, vector.append_n(data.begin(), data.size()));
+  ASSERT_EQ(8, vector.appended_size());
+  ASSERT_EQ(8, vector.size());
+  ASSERT_EQ("10086", vector[0]);
+  ASSERT_EQ("xxx", vector[1]);
+  for (size_t i = 0; i < data.size(); ++i) {
+    ASSERT_EQ(data[i], vector[i + 2]);
+  }
+}
+
+TEST(concurrent_vector, concurrent_append_never_overlap) {
+  ConcurrentVector<size_t> vector(16);
+  ::std::vector<::std::thread> threads;
+  for (size_t i = 0; i < 8; ++i) {
+    threads.emplace_back([i, &vector] {
+      ::std::vector<size_t> data(3, i);
+      for (size_t j = 0; j < 1000; ++j) {
+        if (j % 2 == 0) {
+          vector.emplace_back(i);
+        } else {
+          vector.append_n(data.begin(), data.size());
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(8 * (500 + 500 * 3), vector.appended_size());
+  ::std::vector<size_t> counts(8, 0);
+  for (size_t i = 0; i < vector.appended_size(); ++i) {
+    counts[vector[i]]++;
+  }
+  for (auto count : counts) {
+    ASSERT_EQ(2000, count);
+  }
+}
+
+TEST(concurrent_vector, compact_to_continuous_buffer) {
+  ConcurrentVector<size_t> vector(4);
+  for (size_t i = 0; i < 10; ++i) {
+    vector.emplace_back(i);
+  }
+  ::std::vector<size_t> compacted(7);
+  auto end = vector.compact_to(2, 9, compacted.data());
+  ASSERT_EQ(compacted.data() + 7, end);
+  ASSERT_EQ((::std::vector<size_t> {2, 3, 4, 5, 6, 7, 8}), compacted);
+
+  const auto& const_vector = vector;
+  ::std::vector<size_t> all;
+  const_vector.snapshot().compact_to(0, vector.appended_size(),
+                                     ::std::back_inserter(all));
+  ASSERT_EQ(10, all.size());
+  for (size_t i = 0; i < all.size(); ++i) {
+    ASSERT_EQ(i, all[i]);
+  }
+}
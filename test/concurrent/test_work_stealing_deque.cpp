@@ -0,0 +1,135 @@
+#include "babylon/concurrent/work_stealing_deque.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using ::babylon::ConcurrentWorkStealingDeque;
+
+TEST(concurrent_work_stealing_deque, capacity_ceil_to_pow2) {
+  ConcurrentWorkStealingDeque<::std::string> deque;
+  ASSERT_EQ(1, deque.capacity());
+  ASSERT_EQ(1, deque.reserve_and_clear(0));
+  ASSERT_EQ(4, deque.reserve_and_clear(3));
+  ASSERT_EQ(8, deque.reserve_and_clear(5));
+  ConcurrentWorkStealingDeque<::std::string> sized_deque {100};
+  ASSERT_EQ(128, sized_deque.capacity());
+}
+
+TEST(concurrent_work_stealing_deque, owner_pop_lifo) {
+  ConcurrentWorkStealingDeque<::std::string> deque {4};
+  ASSERT_TRUE(deque.try_push("1"));
+  ASSERT_TRUE(deque.try_push("2"));
+  ASSERT_TRUE(deque.try_push("3"));
+  ASSERT_EQ(3, deque.size());
+  ::std::string s;
+  ASSERT_TRUE(deque.try_pop(s));
+  ASSERT_EQ("3", s);
+  ASSERT_TRUE(deque.try_pop(s));
+  ASSERT_EQ("2", s);
+  ASSERT_TRUE(deque.try_pop(s));
+  ASSERT_EQ("1", s);
+  ASSERT_FALSE(deque.try_pop(s));
+  ASSERT_EQ(0, deque.size());
+}
+
+TEST(concurrent_work_stealing_deque, thief_steal_fifo) {
+  ConcurrentWorkStealingDeque<::std::string> deque {4};
+  ASSERT_TRUE(deque.try_push("1"));
+  ASSERT_TRUE(deque.try_push("2"));
+  ASSERT_TRUE(deque.try_push("3"));
+  ::std::string s;
+  ASSERT_TRUE(deque.try_steal(s));
+  ASSERT_EQ("1", s);
+  ASSERT_TRUE(deque.try_pop(s));
+  ASSERT_EQ("3", s);
+  ASSERT_TRUE(deque.try_steal(s));
+  ASSERT_EQ("2", s);
+  ASSERT_FALSE(deque.try_steal(s));
+  ASSERT_FALSE(deque.try_pop(s));
+}
+
+TEST(concurrent_work_stealing_deque, push_fail_when_full) {
+  ConcurrentWorkStealingDeque<::std::string> deque {2};
+  ASSERT_TRUE(deque.try_push("1"));
+  ASSERT_TRUE(deque.try_push("2"));
+  ::std::string s {"3"};
+  ASSERT_FALSE(deque.try_push(::std::move(s)));
+  ASSERT_EQ("3", s);
+  ASSERT_TRUE(deque.try_steal(s));
+  ASSERT_EQ("1", s);
+  ASSERT_TRUE(deque.try_push("3"));
+  ASSERT_TRUE(deque.try_pop(s));
+  ASSERT_EQ("3", s);
+}
+
+TEST(concurrent_work_stealing_deque, steal_half) {
+  ConcurrentWorkStealingDeque<int> deque {8};
+  for (int i = 0; i < 7; ++i) {
+    ASSERT_TRUE(deque.try_push(i));
+  }
+  ::std::vector<int> stolen;
+  ASSERT_EQ(4, deque.try_steal_half([&](int& value) {
+    stolen.push_back(value);
+  }));
+  ASSERT_EQ((::std::vector<int> {0, 1, 2, 3}), stolen);
+  ASSERT_EQ(3, deque.size());
+  stolen.clear();
+  ASSERT_EQ(2, deque.try_steal_half([&](int& value) {
+    stolen.push_back(value);
+  }));
+  ASSERT_EQ((::std::vector<int> {4, 5}), stolen);
+  ASSERT_EQ(1, deque.try_steal_half([](int&) {}));
+  ASSERT_EQ(0, deque.try_steal_half([](int&) {}));
+}
+
+TEST(concurrent_work_stealing_deque, concurrent_owner_and_thieves) {
+  ConcurrentWorkStealingDeque<size_t> deque {64};
+  size_t times = 200000;
+  size_t thief_num = 4;
+  ::std::atomic<bool> finished {false};
+  ::std::vector<size_t> consumed(times + 1, 0);
+  ::std::atomic<size_t> stolen_sum {0};
+  ::std::vector<::std::thread> thieves;
+  for (size_t i = 0; i < thief_num; ++i) {
+    thieves.emplace_back([&] {
+      size_t sum = 0;
+      size_t value;
+      while (!finished.load(::std::memory_order_acquire)) {
+        if (deque.try_steal(value)) {
+          sum += value;
+        }
+      }
+      while (deque.try_steal(value)) {
+        sum += value;
+      }
+      stolen_sum += sum;
+    });
+  }
+  size_t popped_sum = 0;
+  for (size_t i = 1; i <= times; ++i) {
+    while (!deque.try_push(i)) {
+      size_t value;
+      if (deque.try_pop(value)) {
+        popped_sum += value;
+      }
+    }
+    if (i % 3 == 0) {
+      size_t value;
+      if (deque.try_pop(value)) {
+        popped_sum += value;
+      }
+    }
+  }
+  finished.store(true, ::std::memory_order_release);
+  for (auto& thread : thieves) {
+    thread.join();
+  }
+  size_t value;
+  while (deque.try_pop(value)) {
+    popped_sum += value;
+  }
+  ASSERT_EQ(times * (times + 1) / 2, popped_sum + stolen_sum);
+}
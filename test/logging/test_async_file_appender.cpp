@@ -2,12 +2,15 @@
 
 #include <fcntl.h>
 #include <gtest/gtest.h>
+#include <poll.h>
 
 #include <random>
 
 using ::babylon::AsyncFileAppender;
 using ::babylon::FileObject;
+using ::babylon::LogCompressor;
 using ::babylon::LogEntry;
+using ::babylon::LogSeverity;
 using ::babylon::LogStreamBuffer;
 using ::babylon::PageAllocator;
 
@@ -46,6 +49,11 @@ struct AsyncFileAppenderTest : public ::testing::Test {
     ASSERT_EQ(0, close(pipefd[0]));
   }
 
+  bool pipe_readable(int timeout_ms) {
+    struct ::pollfd pfd {pipefd[0], POLLIN, 0};
+    return ::poll(&pfd, 1, timeout_ms) > 0;
+  }
+
   void read_pipe(char* data, size_t size) {
     while (size > 0) {
       auto got = ::read(pipefd[0], data, size);
@@ -130,3 +138,152 @@ TEST_F(AsyncFileAppenderTest, write_different_size_level_correct) {
   }
   appender.close();
 }
+
+TEST_F(AsyncFileAppenderTest, write_use_io_uring_if_available) {
+  appender.set_use_io_uring(true);
+  appender.set_io_uring_depth(4);
+  ASSERT_EQ(0, appender.initialize());
+  for (size_t i = 0; i < 1000; ++i) {
+    LogStream ls(appender.page_allocator());
+    ls << "this line should appear in pipe with num " << i << ::std::endl;
+    appender.write(ls.end(), &file_object);
+  }
+  for (size_t i = 0; i < 1000; ++i) {
+    ::std::string expected = "this line should appear in pipe with num " +
+                             ::std::to_string(i) + "\n";
+    ::std::string s;
+    s.resize(expected.size());
+    read_pipe(&s[0], s.size());
+    ASSERT_EQ(expected, s);
+  }
+  appender.close();
+}
+
+TEST_F(AsyncFileAppenderTest, write_use_zstd_if_available) {
+  appender.set_use_zstd(true);
+  ASSERT_EQ(0, appender.initialize());
+  ASSERT_EQ(LogCompressor::available(), appender.use_zstd());
+  ::std::string expected;
+  for (size_t i = 0; i < 1000; ++i) {
+    LogStream ls(appender.page_allocator());
+    ls << "this line should appear in pipe with num " << i << ::std::endl;
+    appender.write(ls.end(), &file_object);
+    expected += "this line should appear in pipe with num " +
+                ::std::to_string(i) + "\n";
+  }
+  appender.close();
+
+  ::std::string s;
+  while (pipe_readable(0)) {
+    char buffer[4096];
+    auto got = ::read(pipefd[0], buffer, sizeof(buffer));
+    s.append(buffer, got);
+  }
+  ASSERT_EQ(0, appender.compress_failure_num());
+  if (appender.use_zstd()) {
+    ASSERT_GT(expected.size(), s.size());
+    ::std::string output;
+    ASSERT_EQ(s.size(), LogCompressor::decompress(s.data(), s.size(), output));
+    s.swap(output);
+  }
+  ASSERT_EQ(expected, s);
+}
+
+TEST_F(AsyncFileAppenderTest, flush_immediately_by_severity) {
+  appender.set_max_flush_delay(::std::chrono::seconds(10));
+  appender.set_flush_severity(LogSeverity::WARNING);
+  ASSERT_EQ(0, appender.initialize());
+  {
+    LogStream ls(appender.page_allocator());
+    ls << "info line" << ::std::endl;
+    appender.write(ls.end(), &file_object, LogSeverity::INFO);
+  }
+  ASSERT_FALSE(pipe_readable(100));
+  {
+    LogStream ls(appender.page_allocator());
+    ls << "warning line" << ::std::endl;
+    appender.write(ls.end(), &file_object, LogSeverity::WARNING);
+  }
+  ::std::string expected = "info line\nwarning line\n";
+  ::std::string s;
+  s.resize(expected.size());
+  read_pipe(&s[0], s.size());
+  ASSERT_EQ(expected, s);
+}
+
+TEST_F(AsyncFileAppenderTest, flush_immediately_by_batch_size) {
+  appender.set_max_flush_delay(::std::chrono::seconds(10));
+  appender.set_flush_batch_size(10);
+  ASSERT_EQ(0, appender.initialize());
+  for (size_t i = 0; i < 10; ++i) {
+    ASSERT_FALSE(pipe_readable(i == 9 ? 100 : 0));
+    LogStream ls(appender.page_allocator());
+    ls << i;
+    appender.write(ls.end(), &file_object, LogSeverity::INFO);
+  }
+  ::std::string s;
+  s.resize(10);
+  read_pipe(&s[0], s.size());
+  ASSERT_EQ("0123456789", s);
+}
+
+TEST_F(AsyncFileAppenderTest, flush_after_max_delay) {
+  appender.set_max_flush_delay(::std::chrono::milliseconds(200));
+  ASSERT_EQ(0, appender.initialize());
+  auto begin = ::std::chrono::steady_clock::now();
+  {
+    LogStream ls(appender.page_allocator());
+    ls << "info line" << ::std::endl;
+    appender.write(ls.end(), &file_object, LogSeverity::INFO);
+  }
+  ::std::string expected = "info line\n";
+  ::std::string s;
+  s.resize(expected.size());
+  read_pipe(&s[0], s.size());
+  ASSERT_EQ(expected, s);
+  ASSERT_LE(::std::chrono::milliseconds(150),
+            ::std::chrono::steady_clock::now() - begin);
+}
+
+TEST_F(AsyncFileAppenderTest, write_files_by_multiple_writers_in_order) {
+  // 3个文件分配到2个写线程，其中一个写线程负责2个文件
+  StaticFileObject file_objects[3];
+  int fds[3][2];
+  file_objects[0].fd = pipefd[1];
+  fds[0][0] = pipefd[0];
+  for (size_t i = 1; i < 3; ++i) {
+    ASSERT_EQ(0, ::pipe(fds[i]));
+    ::fcntl(fds[i][1], F_SETPIPE_SZ, 16 * 4096);
+    file_objects[i].fd = fds[i][1];
+  }
+  appender.set_writer_num(2);
+  ASSERT_EQ(0, appender.initialize());
+
+  for (size_t i = 0; i < 1000; ++i) {
+    auto& file_object = file_objects[i % 3];
+    LogStream ls(appender.page_allocator());
+    ls << i << ::std::endl;
+    appender.write(ls.end(), &file_object);
+  }
+  appender.close();
+
+  for (size_t i = 0; i < 3; ++i) {
+    ::std::string expected;
+    for (size_t j = i; j < 1000; j += 3) {
+      expected += ::std::to_string(j) + "\n";
+    }
+    ::std::string s;
+    s.resize(expected.size());
+    size_t size = 0;
+    while (size < s.size()) {
+      auto got = ::read(fds[i][0], &s[size], s.size() - size);
+      ASSERT_LT(0, got);
+      size += got;
+    }
+    ASSERT_EQ(expected, s);
+  }
+  for (size_t i = 1; i < 3; ++i) {
+    ASSERT_EQ(0, close(fds[i][1]));
+    ASSERT_EQ(0, close(fds[i][0]));
+  }
+}
@@ -0,0 +1,264 @@
+#include "babylon/logging/async_file_appender.h"
+#include "babylon/logging/async_log_stream.h"
+#include "babylon/logging/binary_log.h"
+
+#include "gtest/gtest.h"
+
+#include <poll.h>
+
+#include <atomic>
+#include <sstream>
+
+using ::babylon::AsyncFileAppender;
+using ::babylon::AsyncLogStream;
+using ::babylon::BinaryLog;
+using ::babylon::BinaryLogDecoder;
+using ::babylon::BinaryLogSite;
+using ::babylon::BinaryLogValue;
+using ::babylon::DefaultLogStream;
+using ::babylon::FileObject;
+using ::babylon::LoggerBuilder;
+using ::babylon::LogSeverity;
+using ::babylon::LogStreamBuffer;
+
+namespace {
+// 设置next_fd后，下次检测时滚动到新的文件描述符
+struct RollingPipeFileObject : public FileObject {
+  virtual ::std::tuple<int, int> check_and_get_file_descriptor() noexcept
+      override {
+    auto new_fd = next_fd.exchange(-1);
+    if (new_fd < 0) {
+      return ::std::tuple<int, int> {fd, -1};
+    }
+    auto old_fd = fd;
+    fd = new_fd;
+    return ::std::tuple<int, int> {fd, old_fd};
+  }
+  int fd {-1};
+  ::std::atomic<int> next_fd {-1};
+};
+
+::std::string encode(const BinaryLogSite& site,
+                     ::std::initializer_list<BinaryLogValue> values) {
+  ::std::stringbuf buffer;
+  BinaryLog::encode(buffer, site, values);
+  return buffer.str();
+}
+} // namespace
+
+struct BinaryLogTest : public ::testing::Test {
+  virtual void SetUp() override {
+    ASSERT_EQ(0, ::pipe(pipefd));
+    file_object.fd = pipefd[1];
+  }
+
+  virtual void TearDown() override {
+    ::close(pipefd[0]);
+  }
+
+  void use_async_log_stream() {
+    LoggerBuilder builder;
+    builder.set_log_stream_creator(
+        AsyncLogStream::creator(appender, file_object));
+    ::babylon::LoggerManager::instance().set_root_builder(
+        ::std::move(builder));
+    ::babylon::LoggerManager::instance().apply();
+  }
+
+  static bool readable(int fd, int timeout_ms) {
+    struct ::pollfd pfd {fd, POLLIN, 0};
+    return ::poll(&pfd, 1, timeout_ms) > 0;
+  }
+
+  // 写端全部关闭后读取到结束
+  static ::std::string read_all(int fd) {
+    ::std::string s;
+    char buffer[4096];
+    ssize_t got;
+    while ((got = ::read(fd, buffer, sizeof(buffer))) > 0) {
+      s.append(buffer, got);
+    }
+    return s;
+  }
+
+  int pipefd[2];
+  RollingPipeFileObject file_object;
+  AsyncFileAppender appender;
+};
+
+TEST(BinaryLog, format_message_by_values) {
+  ::std::string string {"string"};
+  BinaryLogValue values[] = {int8_t(-1), uint16_t(2), 3.5f,        true,
+                             'c',        "str",       string,      int64_t(-4),
+                             uint64_t(5)};
+  ::std::string output;
+  ASSERT_TRUE(BinaryLog::format_message("%d %u %.1f %d %c %s %s %d %u", values,
+                                        sizeof(values) / sizeof(values[0]),
+                                        output));
+  ASSERT_EQ("-1 2 3.5 1 c str string -4 5", output);
+
+  output.clear();
+  ASSERT_FALSE(BinaryLog::format_message("%d %d", values, 1, output));
+  ASSERT_FALSE(BinaryLog::format_message("%d", values + 5, 1, output));
+}
+
+TEST(BinaryLog, site_registered_with_unique_id) {
+  static const BinaryLogSite site1 {LogSeverity::INFO, __FILE__, __LINE__,
+                                    __func__, "site1 %d"};
+  static const BinaryLogSite site2 {LogSeverity::WARNING, __FILE__, __LINE__,
+                                    __func__, "site2 %d"};
+  ASSERT_NE(site1.id(), site2.id());
+  ASSERT_EQ(&site1, BinaryLogSite::find(site1.id()));
+  ASSERT_EQ(&site2, BinaryLogSite::find(site2.id()));
+  ASSERT_EQ(nullptr, BinaryLogSite::find(UINT32_MAX));
+}
+
+TEST(BinaryLog, decode_with_definition) {
+  static const BinaryLogSite site {LogSeverity::INFO, "some_file.cpp", 10086,
+                                   "some_function", "value %d of %s"};
+  ::std::string data;
+  BinaryLog::encode_definition(site, data);
+  data += encode(site, {10, "name"});
+  BinaryLog::encode_text("plain text\n", data);
+  data += encode(site, {-20, ::std::string {"other"}});
+
+  BinaryLogDecoder decoder;
+  ::std::string output;
+  ASSERT_EQ(data.size(), decoder.decode(data.data(), data.size(), output));
+  ::std::cerr << output;
+  ASSERT_EQ(0, output.find("INFO "));
+  ASSERT_NE(output.npos,
+            output.find(" some_file.cpp:10086 some_function] value 10 of "
+                        "name\nplain text\nINFO "));
+  ASSERT_EQ("] value -20 of other\n",
+            output.substr(output.find("] value -20 of other")));
+}
+
+TEST(BinaryLog, decode_stop_at_incomplete_record) {
+  static const BinaryLogSite site {LogSeverity::INFO, __FILE__, __LINE__,
+                                   __func__, "value %d"};
+  ::std::string first;
+  BinaryLog::encode_definition(site, first);
+  auto second = encode(site, {10});
+  for (size_t i = 0; i < second.size(); ++i) {
+    auto data = first + second.substr(0, i);
+    BinaryLogDecoder decoder;
+    ::std::string output;
+    ASSERT_EQ(first.size(), decoder.decode(data.data(), data.size(), output));
+    ASSERT_TRUE(output.empty());
+  }
+}
+
+TEST(BinaryLog, fail_decode_undefined_site) {
+  static const BinaryLogSite site {LogSeverity::INFO, __FILE__, __LINE__,
+                                   __func__, "value %d"};
+  auto data = encode(site, {10});
+  BinaryLogDecoder decoder;
+  ::std::string output;
+  ASSERT_GT(0, decoder.decode(data.data(), data.size(), output));
+}
+
+TEST(BinaryLog, fallback_to_format_immediately) {
+  static const BinaryLogSite site {LogSeverity::INFO, __FILE__, __LINE__,
+                                   __func__, "value %d of %s"};
+  DefaultLogStream ls;
+  ::testing::internal::CaptureStderr();
+  ls.write_binary(site, 10, "name");
+  ls.begin() << "prefix ";
+  ls.write_binary(site, 20, "other");
+  ls.end();
+  auto text = ::testing::internal::GetCapturedStderr();
+  ::std::cerr << text;
+  ASSERT_NE(text.npos, text.find("] value 10 of name\n"));
+  ASSERT_NE(text.npos, text.find("] prefix value 20 of other\n"));
+}
+
+TEST_F(BinaryLogTest, format_in_appender) {
+  ASSERT_EQ(0, appender.initialize());
+  use_async_log_stream();
+
+  BABYLON_LOG_BINARY(INFO, "value %d of %s", 10, "name");
+  BABYLON_LOG(INFO) << "text line";
+  appender.close();
+  ::close(file_object.fd);
+
+  auto text = read_all(pipefd[0]);
+  ::std::cerr << text;
+  ASSERT_EQ(0, text.find("INFO "));
+  ASSERT_NE(text.npos, text.find("] value 10 of name\nINFO "));
+  ASSERT_EQ("] text line\n", text.substr(text.find("] text line")));
+}
+
+TEST_F(BinaryLogTest, write_raw_and_decode_after_rolling) {
+  int next_pipefd[2];
+  ASSERT_EQ(0, ::pipe(next_pipefd));
+  appender.set_format_binary_log(false);
+  ASSERT_EQ(0, appender.initialize());
+  use_async_log_stream();
+
+  ::std::string data;
+  for (size_t i = 0; i < 2; ++i) {
+    BABYLON_LOG_BINARY(WARNING, "value %d of %s", i, "name");
+    BABYLON_LOG(WARNING) << "text line " << i;
+    if (i == 0) {
+      // 确保两条日志都已经写入首个文件后再滚动
+      while (data.find("text line 0") == data.npos) {
+        ASSERT_TRUE(readable(pipefd[0], 1000));
+        char buffer[4096];
+        auto got = ::read(pipefd[0], buffer, sizeof(buffer));
+        data.append(buffer, got);
+      }
+      file_object.next_fd = next_pipefd[1];
+    }
+  }
+  appender.close();
+  ::close(file_object.fd);
+
+  data += read_all(pipefd[0]);
+  BinaryLogDecoder decoder;
+  ::std::string text;
+  ASSERT_EQ(data.size(), decoder.decode(data.data(), data.size(), text));
+  ::std::cerr << text;
+  ASSERT_NE(text.npos, text.find("] value 0 of name\nWARNING "));
+  ASSERT_EQ("] text line 0\n", text.substr(text.find("] text line 0")));
+
+  // 滚动后的文件可以独立解码
+  data = read_all(next_pipefd[0]);
+  ::close(next_pipefd[0]);
+  BinaryLogDecoder next_decoder;
+  text.clear();
+  ASSERT_EQ(data.size(), next_decoder.decode(data.data(), data.size(), text));
+  ::std::cerr << text;
+  ASSERT_NE(text.npos, text.find("] value 1 of name\nWARNING "));
+  ASSERT_EQ("] text line 1\n", text.substr(text.find("] text line 1")));
+}
+
+TEST_F(BinaryLogTest, count_dropped_record_in_appender) {
+  static const BinaryLogSite site {LogSeverity::INFO, __FILE__, __LINE__,
+                                   __func__, "value %d"};
+  ASSERT_EQ(0, appender.initialize());
+
+  // 篡改为未注册的调用点id
+  auto data = encode(site, {10});
+  uint32_t id = UINT32_MAX;
+  __builtin_memcpy(&data[BinaryLog::HEADER_SIZE], &id, sizeof(id));
+  LogStreamBuffer buffer;
+  buffer.set_page_allocator(appender.page_allocator());
+  buffer.begin();
+  buffer.sputn(data.data(), static_cast<::std::streamsize>(data.size()));
+  appender.write_binary(buffer.end(), &file_object, LogSeverity::INFO);
+
+  // 正常的记录不受影响
+  data = encode(site, {20});
+  buffer.begin();
+  buffer.sputn(data.data(), static_cast<::std::streamsize>(data.size()));
+  appender.write_binary(buffer.end(), &file_object, LogSeverity::INFO);
+  appender.close();
+  ::close(file_object.fd);
+
+  auto text = read_all(pipefd[0]);
+  ::std::cerr << text;
+  ASSERT_EQ(1, appender.dropped_binary_log_num());
+  ASSERT_EQ(text.npos, text.find("value 10"));
+  ASSERT_NE(text.npos, text.find("] value 20\n"));
+}
@@ -0,0 +1,113 @@
+#include <babylon/logging/log_compressor.h>
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+using ::babylon::LogCompressor;
+using ::babylon::NewDeletePageAllocator;
+
+struct LogCompressorTest : public ::testing::Test {
+  virtual void SetUp() override {
+    page_allocator.set_page_size(128);
+  }
+
+  void append(const ::std::string& s) {
+    for (size_t i = 0; i < s.size(); i += page_allocator.page_size()) {
+      auto size = ::std::min(page_allocator.page_size(), s.size() - i);
+      auto page = page_allocator.allocate();
+      __builtin_memcpy(page, s.data() + i, size);
+      iov.emplace_back(::iovec {page, size});
+    }
+  }
+
+  ::std::string concat(size_t begin) {
+    ::std::string s;
+    for (size_t i = begin; i < iov.size(); ++i) {
+      s.append(static_cast<char*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    return s;
+  }
+
+  void release() {
+    for (auto& one_iov : iov) {
+      page_allocator.deallocate(one_iov.iov_base);
+    }
+    iov.clear();
+  }
+
+  NewDeletePageAllocator page_allocator;
+  ::std::vector<struct ::iovec> iov;
+  LogCompressor compressor;
+};
+
+TEST_F(LogCompressorTest, fail_when_not_available) {
+  if (LogCompressor::available()) {
+    return;
+  }
+  ASSERT_NE(0, compressor.initialize(3));
+  ::std::string output;
+  ASSERT_GT(0, LogCompressor::decompress("", 0, output));
+}
+
+TEST_F(LogCompressorTest, compress_and_decompress_frames) {
+  if (!LogCompressor::available()) {
+    return;
+  }
+  ASSERT_EQ(0, compressor.initialize(3));
+
+  ::std::string expected;
+  ::std::string compressed;
+  for (size_t i = 0; i < 10; ++i) {
+    ::std::string batch;
+    for (size_t j = 0; j < 100; ++j) {
+      batch += "this line is batch " + ::std::to_string(i) + " num " +
+               ::std::to_string(j) + "\n";
+    }
+    expected += batch;
+    append("head");
+    append(batch);
+    ASSERT_EQ(0, compressor.compress(page_allocator, iov, 1));
+    ASSERT_EQ("head", concat(0).substr(0, 4));
+    auto frame = concat(1);
+    ASSERT_GT(batch.size(), frame.size());
+    compressed += frame;
+    release();
+  }
+
+  ::std::string output;
+  ASSERT_EQ(compressed.size(),
+            LogCompressor::decompress(compressed.data(), compressed.size(),
+                                      output));
+  ASSERT_EQ(expected, output);
+}
+
+TEST_F(LogCompressorTest, decompress_stop_at_incomplete_frame) {
+  if (!LogCompressor::available()) {
+    return;
+  }
+  ASSERT_EQ(0, compressor.initialize(3));
+
+  append("first frame\n");
+  ASSERT_EQ(0, compressor.compress(page_allocator, iov, 0));
+  auto first = concat(0);
+  release();
+  append("second frame\n");
+  ASSERT_EQ(0, compressor.compress(page_allocator, iov, 0));
+  auto second = concat(0);
+  release();
+
+  for (size_t i = 0; i < second.size(); ++i) {
+    auto data = first + second.substr(0, i);
+    ::std::string output;
+    ASSERT_EQ(first.size(),
+              LogCompressor::decompress(data.data(), data.size(), output));
+    ASSERT_EQ("first frame\n", output);
+  }
+
+  auto corrupted = first;
+  corrupted[0] = ~corrupted[0];
+  ::std::string output;
+  ASSERT_GT(0, LogCompressor::decompress(corrupted.data(), corrupted.size(),
+                                         output));
+}
@@ -2,6 +2,8 @@
 
 #include "gtest/gtest.h"
 
+#include <sched.h>
+
 #include <thread>
 
 using ::babylon::BatchPageAllocator;
@@ -171,6 +173,45 @@ TEST(page_heap, free_page_capacity_auto_ceiled) {
   ASSERT_EQ(8, (PageHeap {8}).free_page_capacity());
 }
 
+TEST(page_heap, numa_aware_split_cache_by_node) {
+  auto node_num = ::babylon::NumaTopology::instance().node_num();
+  PageHeap page_heap;
+  page_heap.set_free_page_capacity(1024 * node_num);
+  page_heap.set_enable_numa_aware(true);
+  ASSERT_EQ(kernel_page_size, page_heap.page_size());
+  ASSERT_EQ(1024 * node_num, page_heap.free_page_capacity());
+  page_heap.set_page_size(8192);
+  ASSERT_EQ(8192, page_heap.page_size());
+
+  auto page = page_heap.allocate();
+  ASSERT_EQ(1, page_heap.allocate_page_num());
+  page_heap.deallocate(page);
+  ASSERT_EQ(0, page_heap.allocate_page_num());
+  ASSERT_EQ(1, page_heap.free_page_num());
+  // Same thread stay on same node mostly, reuse the page from node cache
+  ::babylon::NumaTopology::bind_current_thread({::sched_getcpu()});
+  page = page_heap.allocate();
+  page_heap.deallocate(page);
+  ASSERT_EQ(page, page_heap.allocate());
+  page_heap.deallocate(page);
+  ASSERT_LT(0, page_heap.cache_hit_summary().sum);
+}
+
+TEST(page_heap, numa_aware_return_page_to_home_node) {
+  PageHeap page_heap;
+  page_heap.set_enable_numa_aware(true);
+  ::babylon::NumaTopology::bind_current_thread({::sched_getcpu()});
+  auto page = page_heap.allocate();
+  // Deallocate from another thread, maybe on another node, page still go back
+  // to cache of node where it is allocated
+  ::std::thread([&] {
+    page_heap.deallocate(page);
+  }).join();
+  ASSERT_EQ(1, page_heap.free_page_num());
+  ASSERT_EQ(page, page_heap.allocate());
+  page_heap.deallocate(page);
+}
+
 TEST(page_heap, acquire_new_allocated_page_when_no_free_left) {
   PageHeap page_heap;
   ::std::vector<void*> pages(2);
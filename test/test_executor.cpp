@@ -2,6 +2,10 @@
 
 #include "gtest/gtest.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
 #include <future>
 
 using ::babylon::AlwaysUseNewThreadExecutor;
@@ -10,6 +14,9 @@ using ::babylon::Executor;
 using ::babylon::Future;
 using ::babylon::InplaceExecutor;
 using ::babylon::MoveOnlyFunction;
+using ::babylon::NumaTopology;
+using ::babylon::TaskAttributes;
+using ::babylon::TaskPriority;
 using ::babylon::ThreadPoolExecutor;
 
 struct ExecutorTest : public ::testing::Test {
@@ -365,6 +372,80 @@ TEST_F(ExecutorTest, handle_non_copyable_function_and_args) {
   ASSERT_EQ(10123, value);
 }
 
+TEST_F(ExecutorTest, execute_and_submit_in_bulk) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(4);
+  executor.set_global_capacity(8);
+  executor.start();
+
+  // More than capacity, need multiple batches
+  ::std::atomic<size_t> sum {0};
+  ::std::vector<::std::function<size_t()>> callables;
+  for (size_t i = 0; i < 100; ++i) {
+    callables.emplace_back([&, i] {
+      sum.fetch_add(i, ::std::memory_order_relaxed);
+      return i;
+    });
+  }
+  auto futures = executor.execute_n(callables.begin(), callables.end());
+  ASSERT_EQ(100, futures.size());
+  for (size_t i = 0; i < 100; ++i) {
+    ASSERT_EQ(i, futures[i].get());
+  }
+  ASSERT_EQ(99 * 100 / 2, sum.load());
+
+  ::std::vector<::std::function<void()>> submit_callables;
+  ::std::atomic<size_t> count {0};
+  for (size_t i = 0; i < 100; ++i) {
+    submit_callables.emplace_back([&] {
+      count.fetch_add(1, ::std::memory_order_relaxed);
+    });
+  }
+  ASSERT_EQ(0,
+            executor.submit_n(submit_callables.begin(), submit_callables.end()));
+  executor.stop();
+  ASSERT_EQ(100, count.load());
+}
+
+TEST_F(ExecutorTest, execute_in_bulk_inside_worker_and_idle_park) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(4);
+  executor.set_global_capacity(64);
+  executor.set_local_capacity(4);
+  executor.set_enable_work_stealing(true);
+  executor.set_idle_spin_times(10);
+  executor.start();
+
+  auto future = executor.execute([&] {
+    ::std::vector<::std::function<size_t()>> callables;
+    for (size_t i = 0; i < 10; ++i) {
+      callables.emplace_back([i] {
+        return i;
+      });
+    }
+    size_t sum = 0;
+    for (auto& future :
+         executor.execute_n(callables.begin(), callables.end())) {
+      sum += future.get();
+    }
+    return sum;
+  });
+  ASSERT_EQ(45, future.get());
+
+  ::std::this_thread::sleep_for(::std::chrono::milliseconds {10});
+  ::std::vector<::std::function<void()>> callables;
+  ::std::atomic<size_t> count {0};
+  for (size_t i = 0; i < 100; ++i) {
+    callables.emplace_back([&] {
+      count.fetch_add(1, ::std::memory_order_relaxed);
+    });
+  }
+  for (auto& future : executor.execute_n(callables.begin(), callables.end())) {
+    future.get();
+  }
+  ASSERT_EQ(100, count.load());
+}
+
 TEST_F(ExecutorTest, return_invalid_future_when_invoke_fail) {
   struct BadExecutor : public Executor {
     virtual int invoke(MoveOnlyFunction<void(void)>&&) noexcept override {
@@ -378,6 +459,31 @@ TEST_F(ExecutorTest, return_invalid_future_when_invoke_fail) {
   ASSERT_NE(0, executor.submit([] {}));
 }
 
+TEST_F(ExecutorTest, bulk_execute_stop_at_first_invoke_fail) {
+  struct PartialExecutor : public Executor {
+    virtual int invoke(
+        MoveOnlyFunction<void(void)>&& function) noexcept override {
+      if (invoked >= 2) {
+        return -1;
+      }
+      ++invoked;
+      function();
+      return 0;
+    }
+    size_t invoked {0};
+  } executor;
+  ::std::vector<::std::function<int()>> callables(4, [] {
+    return 1;
+  });
+  auto futures = executor.execute_n(callables.begin(), callables.end());
+  ASSERT_EQ(4, futures.size());
+  ASSERT_EQ(1, futures[0].get());
+  ASSERT_EQ(1, futures[1].get());
+  ASSERT_FALSE(futures[2].valid());
+  ASSERT_FALSE(futures[3].valid());
+  ASSERT_NE(0, executor.submit_n(callables.begin(), callables.end()));
+}
+
 TEST_F(ExecutorTest, current_executor_mark_during_execution) {
   {
     struct S {
@@ -581,6 +687,45 @@ TEST_F(ExecutorTest, local_task_steal_after_wakeup) {
       .get();
 }
 
+TEST_F(ExecutorTest, local_task_steal_from_deque_when_finish) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(2);
+  executor.set_local_capacity(1);
+  executor.set_enable_work_stealing(true);
+  executor.set_use_work_stealing_deque(true);
+  executor.start();
+
+  ::std::promise<void> promise;
+  auto future = promise.get_future();
+  executor.submit([&] {
+    future.get();
+  });
+  executor
+      .execute([&] {
+        auto inner_future = executor.execute([] {});
+        ASSERT_FALSE(inner_future.wait_for(::std::chrono::milliseconds {100}));
+        promise.set_value();
+        inner_future.get();
+      })
+      .get();
+}
+
+TEST_F(ExecutorTest, local_task_in_deque_auto_balance) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(2);
+  executor.set_local_capacity(1);
+  executor.set_use_work_stealing_deque(true);
+  executor.set_balance_interval(::std::chrono::milliseconds {1});
+  executor.start();
+  ::std::this_thread::sleep_for(::std::chrono::milliseconds {100});
+
+  executor
+      .execute([&] {
+        executor.execute([] {}).get();
+      })
+      .get();
+}
+
 TEST_F(ExecutorTest, local_task_auto_balance) {
   ThreadPoolExecutor executor;
   executor.set_worker_number(2);
@@ -596,6 +741,383 @@ TEST_F(ExecutorTest, local_task_auto_balance) {
       .get();
 }
 
+TEST_F(ExecutorTest, numa_aware_spread_workers_over_nodes) {
+  // Fake a 2 nodes topology by splitting online cpus into halves
+  auto cpus = NumaTopology().node_cpus(0);
+  auto half = (cpus.size() + 1) / 2;
+  ::std::string root = "numa_" + ::std::to_string(::getpid());
+  ::mkdir(root.c_str(), 0755);
+  for (size_t i = 0; i < 2; ++i) {
+    auto node = root + "/node" + ::std::to_string(i);
+    ::mkdir(node.c_str(), 0755);
+    ::std::ofstream ofs {node + "/cpulist"};
+    for (size_t j = i * half; j < ::std::min(cpus.size(), (i + 1) * half);
+         ++j) {
+      ofs << cpus[j] << ",";
+    }
+    if (i * half >= cpus.size()) {
+      ofs << cpus[0];
+    }
+  }
+  NumaTopology topology;
+  ASSERT_EQ(0, topology.load(root));
+  for (size_t i = 0; i < 2; ++i) {
+    auto node = root + "/node" + ::std::to_string(i);
+    ::unlink((node + "/cpulist").c_str());
+    ::rmdir(node.c_str());
+  }
+  ::rmdir(root.c_str());
+  ASSERT_EQ(2, topology.node_num());
+
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(4);
+  executor.set_global_capacity(1024);
+  executor.set_enable_numa_aware(true);
+  executor.set_numa_topology(topology);
+  executor.start();
+
+  ::std::atomic<size_t> sum {0};
+  ::std::vector<Future<void>> futures;
+  for (size_t i = 0; i < 1000; ++i) {
+    futures.emplace_back(executor.execute([&, i] {
+      executor.submit([&, i] {
+        sum.fetch_add(i, ::std::memory_order_relaxed);
+      });
+    }));
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+  executor.stop();
+  ASSERT_EQ(999 * 1000 / 2, sum.load());
+}
+
+TEST_F(ExecutorTest, idle_worker_spin_then_park) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(4);
+  executor.set_global_capacity(16);
+  executor.set_idle_spin_times(1000);
+  executor.set_idle_yield_times(10);
+  executor.start();
+
+  for (size_t i = 0; i < 3; ++i) {
+    // All workers parked after idle for a while, still wakeup by submit
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds {50});
+    ::std::atomic<size_t> sum {0};
+    ::std::vector<Future<void>> futures;
+    for (size_t j = 0; j < 100; ++j) {
+      futures.emplace_back(executor.execute([&, j] {
+        sum.fetch_add(j, ::std::memory_order_relaxed);
+      }));
+    }
+    for (auto& future : futures) {
+      future.get();
+    }
+    ASSERT_EQ(99 * 100 / 2, sum.load());
+  }
+  executor.stop();
+}
+
+TEST_F(ExecutorTest, idle_worker_steal_local_task_when_spinning) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(2);
+  executor.set_local_capacity(1);
+  executor.set_enable_work_stealing(true);
+  executor.set_idle_spin_times(1UL << 30);
+  executor.start();
+
+  ::std::promise<void> promise;
+  auto future = promise.get_future();
+  executor
+      .execute([&] {
+        // Another worker keep spinning and steal it without wakeup
+        auto inner_future = executor.execute([&] {
+          promise.set_value();
+        });
+        future.get();
+        inner_future.get();
+      })
+      .get();
+  executor.stop();
+}
+
+TEST_F(ExecutorTest, elastic_worker_grow_for_backlog_in_local_queue) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(1);
+  executor.set_max_worker_number(2);
+  executor.set_local_capacity(4);
+  executor.set_enable_work_stealing(true);
+  executor.set_grow_queue_delay(::std::chrono::milliseconds {1});
+  executor.start();
+
+  // Only worker blocks on tasks queued locally, global queue keep empty. New
+  // worker is grown to steal them
+  auto value = executor
+                   .execute([&] {
+                     auto future = executor.execute([] {
+                       return 10086;
+                     });
+                     return future.get();
+                   })
+                   .get();
+  ASSERT_EQ(10086, value);
+  ASSERT_EQ(2, executor.alive_worker_number());
+  executor.stop();
+}
+
+TEST_F(ExecutorTest, elastic_worker_grow_and_retire) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(1);
+  executor.set_max_worker_number(4);
+  executor.set_global_capacity(64);
+  executor.set_local_capacity(4);
+  executor.set_enable_work_stealing(true);
+  executor.set_use_work_stealing_deque(true);
+  executor.set_grow_queue_delay(::std::chrono::milliseconds {1});
+  executor.set_idle_keepalive(::std::chrono::milliseconds {50});
+  executor.start();
+  ASSERT_EQ(1, executor.alive_worker_number());
+
+  // Backlog of blocked tasks grow workers one by one
+  ::std::promise<void> promise;
+  auto shared_future = promise.get_future().share();
+  ::std::atomic<size_t> running {0};
+  ::std::vector<Future<void>> futures;
+  for (size_t i = 0; i < 8; ++i) {
+    futures.emplace_back(executor.execute([&] {
+      running.fetch_add(1);
+      shared_future.wait();
+    }));
+  }
+  while (running.load() < 4) {
+    ::usleep(1000);
+  }
+  ASSERT_EQ(4, executor.alive_worker_number());
+  promise.set_value();
+  for (auto& future : futures) {
+    future.get();
+  }
+
+  // Retire after idle for keepalive
+  while (executor.alive_worker_number() > 1) {
+    ::usleep(1000);
+  }
+  ::usleep(100000);
+  ASSERT_EQ(1, executor.alive_worker_number());
+
+  // Grow again in reused slot, and local tasks still get stolen
+  ::std::atomic<size_t> sum {0};
+  executor
+      .execute([&] {
+        ::std::vector<Future<void>> inner_futures;
+        for (size_t i = 0; i < 100; ++i) {
+          inner_futures.emplace_back(executor.execute([&, i] {
+            ::usleep(100);
+            sum.fetch_add(i);
+          }));
+        }
+        for (auto& future : inner_futures) {
+          future.get();
+        }
+      })
+      .get();
+  ASSERT_EQ(99 * 100 / 2, sum.load());
+  executor.stop();
+}
+
+TEST_F(ExecutorTest, collect_statistics_when_enabled) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(1);
+  executor.set_local_capacity(8);
+  executor.set_enable_statistics(true);
+  executor.start();
+
+  executor
+      .execute([&] {
+        for (size_t i = 0; i < 4; ++i) {
+          executor.submit([] {});
+        }
+        ::usleep(10000);
+      })
+      .get();
+  executor.stop();
+
+  auto statistics = executor.statistics();
+  ASSERT_EQ(4, statistics.local_pop_num);
+  ASSERT_EQ(0, statistics.steal_num);
+  ASSERT_EQ(1, statistics.global_pop_num);
+  ASSERT_EQ(0, statistics.balance_move_num);
+  ASSERT_EQ(5, statistics.queue_delay_us.num);
+  ASSERT_EQ(5, statistics.run_time_us.num);
+  ASSERT_LE(10000, statistics.run_time_us.sum);
+  // Local tasks wait for the outer one which sleep 10ms
+  size_t long_delay_num = 0;
+  size_t long_run_num = 0;
+  for (size_t i = 0; i < 31; ++i) {
+    if (i >= ::babylon::ConcurrentSampler::bucket_index(8192)) {
+      long_delay_num += statistics.queue_delay_histogram[i];
+      long_run_num += statistics.run_time_histogram[i];
+    }
+  }
+  ASSERT_EQ(4, long_delay_num);
+  ASSERT_EQ(1, long_run_num);
+
+  executor.reset_statistics();
+  statistics = executor.statistics();
+  ASSERT_EQ(4, statistics.local_pop_num);
+  for (size_t i = 0; i < 31; ++i) {
+    ASSERT_EQ(0, statistics.queue_delay_histogram[i]);
+    ASSERT_EQ(0, statistics.run_time_histogram[i]);
+  }
+}
+
+TEST_F(ExecutorTest, execute_with_attributes_expire_after_deadline) {
+  bool expired = false;
+  auto future = inplace_executor.execute(
+      TaskAttributes {
+          .priority = TaskPriority::CRITICAL,
+          .deadline = ::std::chrono::steady_clock::now(),
+          .on_expire =
+              [&] {
+                expired = true;
+              }},
+      [] {
+        return 10086;
+      });
+  ASSERT_TRUE(future.ready());
+  ASSERT_FALSE(future.get());
+  ASSERT_TRUE(expired);
+
+  future = inplace_executor.execute(
+      TaskAttributes {.deadline = ::std::chrono::steady_clock::now() +
+                                  ::std::chrono::seconds {10}},
+      [] {
+        return 10086;
+      });
+  ASSERT_TRUE(future.get());
+  ASSERT_EQ(10086, *future.get());
+}
+
+TEST_F(ExecutorTest, priority_lanes_in_strict_order) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(1);
+  executor.set_global_capacity(16);
+  executor.set_enable_priority(true);
+  executor.start();
+
+  ::std::promise<void> promise;
+  auto future = promise.get_future();
+  executor.submit([&] {
+    future.get();
+  });
+  ::std::vector<::std::string> order;
+  executor.execute(TaskAttributes {.priority = TaskPriority::BACKGROUND}, [&] {
+    order.emplace_back("background");
+  });
+  executor.execute(TaskAttributes {}, [&] {
+    order.emplace_back("normal");
+  });
+  executor.execute(TaskAttributes {.priority = TaskPriority::CRITICAL}, [&] {
+    order.emplace_back("critical");
+  });
+  promise.set_value();
+  executor.stop();
+  ASSERT_EQ((::std::vector<::std::string> {"critical", "normal", "background"}),
+            order);
+}
+
+TEST_F(ExecutorTest, priority_lanes_in_weighted_order) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(1);
+  executor.set_global_capacity(16);
+  executor.set_enable_priority(true);
+  executor.set_priority_weights(1, 1, 1);
+  executor.start();
+
+  ::std::promise<void> promise;
+  auto future = promise.get_future();
+  executor.submit([&] {
+    future.get();
+  });
+  ::std::vector<TaskPriority> order;
+  for (size_t i = 0; i < 3; ++i) {
+    for (auto priority : {TaskPriority::BACKGROUND, TaskPriority::CRITICAL}) {
+      executor.execute(TaskAttributes {.priority = priority}, [&, priority] {
+        order.emplace_back(priority);
+      });
+    }
+  }
+  promise.set_value();
+  executor.stop();
+  ASSERT_EQ(6, order.size());
+  // Background is not starved until all critical finished
+  auto first_background =
+      ::std::find(order.begin(), order.end(), TaskPriority::BACKGROUND);
+  auto last_critical =
+      ::std::find(order.rbegin(), order.rend(), TaskPriority::CRITICAL);
+  ASSERT_LT(first_background - order.begin(),
+            order.rend() - last_critical - 1);
+}
+
+TEST_F(ExecutorTest, priority_task_wakeup_blocking_worker) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(2);
+  executor.set_global_capacity(16);
+  executor.set_enable_priority(true);
+  executor.set_enable_statistics(true);
+  executor.start();
+  ::std::this_thread::sleep_for(::std::chrono::milliseconds {10});
+
+  for (auto priority : {TaskPriority::CRITICAL, TaskPriority::BACKGROUND}) {
+    auto future = executor.execute(TaskAttributes {.priority = priority}, [] {
+      return 1;
+    });
+    ASSERT_TRUE(future.wait_for(::std::chrono::seconds {10}));
+    ASSERT_EQ(1, *future.get());
+  }
+
+  // Rest tasks in lanes finished before stop
+  ::std::atomic<size_t> count {0};
+  executor.submit([&] {
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds {10});
+  });
+  for (size_t i = 0; i < 10; ++i) {
+    executor.execute(TaskAttributes {.priority = TaskPriority::BACKGROUND},
+                     [&] {
+                       count.fetch_add(1, ::std::memory_order_relaxed);
+                     });
+  }
+  executor.stop();
+  ASSERT_EQ(10, count.load());
+  // Tasks run during stop are counted too
+  ASSERT_EQ(13, executor.statistics().run_time_us.num);
+}
+
+TEST_F(ExecutorTest, priority_lanes_with_idle_park) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(4);
+  executor.set_global_capacity(1024);
+  executor.set_enable_priority(true);
+  executor.set_idle_spin_times(10);
+  executor.start();
+
+  ::std::atomic<size_t> count {0};
+  ::std::vector<Future<::babylon::TaskResult<void>>> futures;
+  for (size_t i = 0; i < 3000; ++i) {
+    futures.emplace_back(
+        executor.execute(TaskAttributes {.priority = static_cast<TaskPriority>(
+                                              i % 3)},
+                         [&] {
+                           count.fetch_add(1, ::std::memory_order_relaxed);
+                         }));
+  }
+  for (auto& future : futures) {
+    ASSERT_TRUE(future.get());
+  }
+  ASSERT_EQ(3000, count.load());
+  executor.stop();
+}
+
 TEST_F(ExecutorTest, press) {
   ThreadPoolExecutor executor;
   executor.set_worker_number(64);
@@ -635,3 +1157,82 @@ TEST_F(ExecutorTest, press) {
   }
   ASSERT_EQ(expect_sum, get_sum);
 }
+
+TEST_F(ExecutorTest, press_with_idle_park) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(64);
+  executor.set_global_capacity(128);
+  executor.set_idle_spin_times(100);
+  executor.set_idle_yield_times(2);
+  executor.start();
+
+  size_t concurrent = 32;
+  size_t times = 2000;
+
+  ::std::vector<Future<size_t>> level1_futures;
+  ::std::vector<Future<size_t>> level2_futures;
+  level1_futures.resize(concurrent);
+  level2_futures.resize(concurrent * times);
+  for (size_t i = 0; i < concurrent; ++i) {
+    level1_futures[i] = executor.execute([&, i] {
+      size_t sum = 0;
+      for (size_t j = 0; j < times; ++j) {
+        ::std::string s(i * times + j, 'x');
+        level2_futures[i * times + j] = executor.execute(
+            [](::std::string&& s) {
+              return s.size();
+            },
+            ::std::move(s));
+        sum += i * times + j;
+      }
+      return sum;
+    });
+  }
+
+  size_t expect_sum = 0;
+  for (auto& future : level1_futures) {
+    expect_sum += future.get();
+  }
+  size_t get_sum = 0;
+  for (auto& future : level2_futures) {
+    get_sum += future.get();
+  }
+  ASSERT_EQ(expect_sum, get_sum);
+  executor.stop();
+}
+
+TEST_F(ExecutorTest, press_with_work_stealing_deque) {
+  ThreadPoolExecutor executor;
+  executor.set_worker_number(64);
+  executor.set_global_capacity(128);
+  executor.set_local_capacity(64);
+  executor.set_enable_work_stealing(true);
+  executor.set_use_work_stealing_deque(true);
+  executor.start();
+
+  size_t concurrent = 32;
+  size_t times = 2000;
+
+  ::std::vector<Future<size_t>> level1_futures;
+  ::std::atomic<size_t> get_sum {0};
+  level1_futures.resize(concurrent);
+  for (size_t i = 0; i < concurrent; ++i) {
+    level1_futures[i] = executor.execute([&, i] {
+      size_t sum = 0;
+      for (size_t j = 0; j < times; ++j) {
+        executor.submit([&, value = i * times + j] {
+          get_sum.fetch_add(value, ::std::memory_order_relaxed);
+        });
+        sum += i * times + j;
+      }
+      return sum;
+    });
+  }
+
+  size_t expect_sum = 0;
+  for (auto& future : level1_futures) {
+    expect_sum += future.get();
+  }
+  executor.stop();
+  ASSERT_EQ(expect_sum, get_sum.load());
+}
@@ -0,0 +1,93 @@
+#include "babylon/numa.h"
+
+#include "gtest/gtest.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+
+using ::babylon::NumaTopology;
+
+struct NumaTopologyTest : public ::testing::Test {
+  virtual void SetUp() override {
+    // Fake sysfs tree live in a private temp dir, not in cwd
+    auto tmpdir = ::getenv("TMPDIR");
+    root = tmpdir != nullptr && *tmpdir != '\0' ? tmpdir : "/tmp";
+    root += "/numa_XXXXXX";
+    ASSERT_NE(nullptr, ::mkdtemp(&root[0]));
+  }
+
+  virtual void TearDown() override {
+    for (auto& node : nodes) {
+      ::unlink((root + "/" + node + "/cpulist").c_str());
+      ::rmdir((root + "/" + node).c_str());
+    }
+    ::rmdir(root.c_str());
+  }
+
+  void add_node(const ::std::string& node, const ::std::string& cpu_list) {
+    ::mkdir((root + "/" + node).c_str(), 0755);
+    ::std::ofstream(root + "/" + node + "/cpulist") << cpu_list << "\n";
+    nodes.emplace_back(node);
+  }
+
+  ::std::string root;
+  ::std::vector<::std::string> nodes;
+};
+
+TEST_F(NumaTopologyTest, default_to_single_node) {
+  NumaTopology topology;
+  ASSERT_EQ(1, topology.node_num());
+  ASSERT_FALSE(topology.node_cpus(0).empty());
+  ASSERT_EQ(0, topology.current_node());
+  ASSERT_LE(1, NumaTopology::instance().node_num());
+  auto& cpus = topology.node_cpus(0);
+  ASSERT_NE(cpus.end(),
+            ::std::find(cpus.begin(), cpus.end(), ::sched_getcpu()));
+}
+
+TEST_F(NumaTopologyTest, parse_cpu_list) {
+  ::std::vector<int> cpus;
+  ASSERT_EQ(0, NumaTopology::parse_cpu_list("0-3,8,10-11\n", cpus));
+  ASSERT_EQ((::std::vector<int> {0, 1, 2, 3, 8, 10, 11}), cpus);
+  cpus.clear();
+  ASSERT_EQ(0, NumaTopology::parse_cpu_list("", cpus));
+  ASSERT_TRUE(cpus.empty());
+  ASSERT_NE(0, NumaTopology::parse_cpu_list("3-1", cpus));
+  ASSERT_NE(0, NumaTopology::parse_cpu_list("a-b", cpus));
+  ASSERT_NE(0, NumaTopology::parse_cpu_list("1-2-3", cpus));
+}
+
+TEST_F(NumaTopologyTest, load_from_sysfs_like_directory) {
+  add_node("node0", "0-1,4-5");
+  add_node("node2", "2-3,6-7");
+  add_node("node3", "");
+  add_node("possible", "0-7");
+  NumaTopology topology;
+  ASSERT_EQ(0, topology.load(root));
+  ASSERT_EQ(2, topology.node_num());
+  ASSERT_EQ((::std::vector<int> {0, 1, 4, 5}), topology.node_cpus(0));
+  ASSERT_EQ((::std::vector<int> {2, 3, 6, 7}), topology.node_cpus(1));
+  ASSERT_EQ(0, topology.node_of_cpu(5));
+  ASSERT_EQ(1, topology.node_of_cpu(6));
+  ASSERT_EQ(0, topology.node_of_cpu(100));
+  ASSERT_GT(2, topology.current_node());
+}
+
+TEST_F(NumaTopologyTest, keep_unchanged_when_load_fail) {
+  NumaTopology topology;
+  auto cpus = topology.node_cpus(0);
+  ASSERT_NE(0, topology.load(root + "/not_exist"));
+  ASSERT_NE(0, topology.load(root));
+  ASSERT_EQ(1, topology.node_num());
+  ASSERT_EQ(cpus, topology.node_cpus(0));
+}
+
+TEST_F(NumaTopologyTest, bind_current_thread) {
+  NumaTopology topology;
+  ASSERT_EQ(0, NumaTopology::bind_current_thread(topology.node_cpus(0)));
+}